@@ -98,7 +98,7 @@ KINEMATICS_TYPE kinematicsType(void)
 }
 
 MODULE_LICENSE("GPL");
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
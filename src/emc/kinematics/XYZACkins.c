@@ -15,7 +15,7 @@
 #include "rtapi.h"
 #include "rtapi_math.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 struct haldata {
     hal_float_t *Y_offset;
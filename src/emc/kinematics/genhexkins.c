@@ -54,7 +54,22 @@
 #include "genhexkins.h"
 #include "kinematics.h"             /* these decls, KINEMATICS_FORWARD_FLAGS */
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#ifdef RTAPI
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_app.h"		/* RTAPI realtime module decls */
+#include "hal.h"
+
+static struct haldata {
+  hal_bit_t fast_forward;	/* param: warm started forward solver */
+  hal_s32_t last_iterations;	/* params: forward solver statistics */
+  hal_s32_t max_iterations;
+  hal_s32_t last_factorizations;
+  hal_u32_t last_solve_time;	/* ns */
+  hal_u32_t max_solve_time;
+} *haldata = 0;
+#endif
+
+#define VTVERSION VTKINEMATICS_VERSION2
 
 /******************************* MatInvert() ***************************/
 
@@ -157,6 +172,74 @@ static void MatMult(double J[][6], const double x[], double Ans[])
   }
 }
 
+/******************************* LuFactor() *******************************/
+
+/*---------------------------------------------------------------------------
+  LU factorization of a 6x6 matrix in place, with partial pivoting.
+  LuSolve() then solves A x = y with the factors, for about the cost of
+  one MatMult().  Returns -1 if the matrix is singular.
+  ---------------------------------------------------------------------------*/
+
+static int LuFactor(double A[][NUM_STRUTS], int piv[])
+{
+  double m, temp;
+  int j, k, n, p;
+
+  for (k = 0; k < NUM_STRUTS; k++) {
+    p = k;
+    for (j = k + 1; j < NUM_STRUTS; j++) {
+      if (rtapi_fabs(A[j][k]) > rtapi_fabs(A[p][k])) {
+	p = j;
+      }
+    }
+    if (rtapi_fabs(A[p][k]) < 1e-12) {
+      return -1;
+    }
+    piv[k] = p;
+    if (p != k) {
+      for (n = 0; n < NUM_STRUTS; n++) {
+	temp = A[k][n];
+	A[k][n] = A[p][n];
+	A[p][n] = temp;
+      }
+    }
+    for (j = k + 1; j < NUM_STRUTS; j++) {
+      m = A[j][k] /= A[k][k];
+      for (n = k + 1; n < NUM_STRUTS; n++) {
+	A[j][n] -= m * A[k][n];
+      }
+    }
+  }
+  return 0;
+}
+
+static void LuSolve(double LU[][NUM_STRUTS], const int piv[],
+		    const double y[], double x[])
+{
+  double temp;
+  int j, k;
+
+  for (j = 0; j < NUM_STRUTS; j++) {
+    x[j] = y[j];
+  }
+  for (k = 0; k < NUM_STRUTS; k++) {
+    temp = x[k];
+    x[k] = x[piv[k]];
+    x[piv[k]] = temp;
+  }
+  for (j = 0; j < NUM_STRUTS; j++) {
+    for (k = 0; k < j; k++) {
+      x[j] -= LU[j][k] * x[k];
+    }
+  }
+  for (j = NUM_STRUTS - 1; j >= 0; j--) {
+    for (k = j + 1; k < NUM_STRUTS; k++) {
+      x[j] -= LU[j][k] * x[k];
+    }
+    x[j] /= LU[j][j];
+  }
+}
+
 /* define position of base strut ends in base (world) coordinate system */
 static PmCartesian b[6] = {{BASE_0_X, BASE_0_Y, BASE_0_Z},
 			   {BASE_1_X, BASE_1_Y, BASE_1_Z},
@@ -330,11 +413,101 @@ int jacobianForward(const double * joints,
    flags are set to indicate their value appropriate to the world coordinates
    passed in. */
 
+/*
+  Forward kins are called every servo cycle, and motion calls them for
+  two separate poses (feedback and, in joint mode, command), each time
+  passing the previous result back in as the initial estimate.  For each
+  of these 'tracks' the solver keeps the last two solutions and the LU
+  factors of the inverse Jacobian it last used:
+
+  - if the estimate passed in is the last solution of a track, the start
+    point is extrapolated from the last two solutions (constant velocity
+    predictor)
+  - the Newton steps reuse the LU factors, from earlier iterations and
+    from earlier cycles, and only refactor when a step fails to reduce
+    the strut length error by a factor 1/FWD_REFACTOR_RATIO
+  - the rotational part of a step is applied as a rotation to the
+    rotation matrix, instead of being added to roll, pitch and yaw,
+    which it is not a change of
+
+  On a fast path the solve takes 3-4 iterations and a factorization
+  every other cycle, against 9 or more iterations and factorizations.
+  With fast-forward off, every iteration inverts the Jacobian from the
+  estimate passed in, as this code always did.
+*/
+
+#define FWD_TRACKS 2
+#define FWD_REFACTOR_RATIO 0.001
+
+typedef struct {
+  unsigned int used;		/* call count when last used, 0: free */
+  int have_prev;
+  EmcPose last, prev;		/* last two solutions */
+  int lu_valid;
+  double lu[NUM_STRUTS][NUM_STRUTS];
+  int piv[NUM_STRUTS];
+} fwd_track_t;
+
+static fwd_track_t tracks[FWD_TRACKS];
+static unsigned int fwd_calls = 0;
+static int fast_forward = 1;
 static int iteration = 0;	/* global so we can report it */
-int kinematicsForward(const double * joints,
-                      EmcPose * pos,
-                      const KINEMATICS_FORWARD_FLAGS * fflags,
-                      KINEMATICS_INVERSE_FLAGS * iflags)
+static int factorizations = 0;
+
+static int PoseEqual(const EmcPose * p, const EmcPose * q)
+{
+  return p->tran.x == q->tran.x && p->tran.y == q->tran.y &&
+    p->tran.z == q->tran.z && p->a == q->a && p->b == q->b && p->c == q->c;
+}
+
+/* pick the track whose last solution is the estimate, or recycle the
+   least recently used one */
+static fwd_track_t *FindTrack(const EmcPose * pos)
+{
+  fwd_track_t *t, *lru = &tracks[0];
+  int i;
+
+  for (i = 0; i < FWD_TRACKS; i++) {
+    t = &tracks[i];
+    if (t->used && PoseEqual(&t->last, pos)) {
+      return t;
+    }
+    if (t->used < lru->used) {
+      lru = t;
+    }
+  }
+  lru->used = 0;
+  lru->have_prev = 0;
+  lru->lu_valid = 0;
+  return lru;
+}
+
+static void Predict(const fwd_track_t * t, EmcPose * q)
+{
+  *q = t->last;
+  if (t->have_prev) {
+    q->tran.x += t->last.tran.x - t->prev.tran.x;
+    q->tran.y += t->last.tran.y - t->prev.tran.y;
+    q->tran.z += t->last.tran.z - t->prev.tran.z;
+    q->a += t->last.a - t->prev.a;
+    q->b += t->last.b - t->prev.b;
+    q->c += t->last.c - t->prev.c;
+  }
+}
+
+/* 'angle' plus the multiple of 2 pi that brings it closest to 'near' */
+static double UnwrapAngle(double angle, double near)
+{
+  while (angle - near > PM_PI) {
+    angle -= PM_2_PI;
+  }
+  while (angle - near < -PM_PI) {
+    angle += PM_2_PI;
+  }
+  return angle;
+}
+
+static int ForwardSolve(const double * joints, EmcPose * pos)
 {
   PmCartesian aw;
   PmCartesian InvKinStrutVect,InvKinStrutVectUnit;
@@ -344,13 +517,18 @@ int kinematicsForward(const double * joints,
   double InverseJacobian[NUM_STRUTS][NUM_STRUTS];
   double InvKinStrutLength, StrutLengthDiff[NUM_STRUTS];
   double delta[NUM_STRUTS];
-  double conv_err = 1.0;
+  double conv_err = 1.0, last_err = 0.0;
 
-  PmRotationMatrix RMatrix;
-  PmRpy q_RPY;
+  PmRotationMatrix RMatrix, RDelta, RNext;
+  PmRotationVector rv;
+  PmRpy q_RPY, rpy;
+
+  fwd_track_t *track = 0;
+  EmcPose start = *pos;
 
   int iterate = 1;
-  int i;
+  int warm = 0;
+  int i, j;
   int retval = 0;
 
 #define HIGH_CONV_CRITERION   (1e-12)
@@ -363,6 +541,7 @@ int kinematicsForward(const double * joints,
   double conv_criterion = HIGH_CONV_CRITERION;
 
   iteration = 0;
+  factorizations = 0;
 
   /* abort on obvious problems, like joints <= 0 */
   /* FIXME-- should check against triangle inequality, so that joints
@@ -376,15 +555,27 @@ int kinematicsForward(const double * joints,
     return -1;
   }
 
+  if (fast_forward) {
+    track = FindTrack(pos);
+    warm = (track->used != 0);
+    if (warm) {
+      Predict(track, &start);
+    }
+    if (++fwd_calls == 0) {
+      fwd_calls = 1;
+    }
+    track->used = fwd_calls;
+  }
+
   /* assign a,b,c to roll, pitch, yaw angles */
-  q_RPY.r = pos->a * PM_PI / 180.0;
-  q_RPY.p = pos->b * PM_PI / 180.0;
-  q_RPY.y = pos->c * PM_PI / 180.0;
+  q_RPY.r = start.a * PM_PI / 180.0;
+  q_RPY.p = start.b * PM_PI / 180.0;
+  q_RPY.y = start.c * PM_PI / 180.0;
 
-  /* Assign translation values in pos to q_trans */
-  q_trans.x = pos->tran.x;
-  q_trans.y = pos->tran.y;
-  q_trans.z = pos->tran.z;
+  /* Assign translation values in start to q_trans */
+  q_trans.x = start.tran.x;
+  q_trans.y = start.tran.y;
+  q_trans.z = start.tran.z;
 
   /* Enter Newton-Raphson iterative method   */
   while (iterate) {
@@ -392,7 +583,8 @@ int kinematicsForward(const double * joints,
     if ((conv_err > +LARGE_CONV_ERROR) || 
 	(conv_err < -LARGE_CONV_ERROR)) {
       /* we can't converge */
-      return -2;
+      retval = -2;
+      break;
     };
 
     iteration++;
@@ -417,11 +609,15 @@ int kinematicsForward(const double * joints,
        convergence criterion and return error flag if it can't */
     if (iteration > FAIL_CONV_ITERATIONS) {
       /* we can't converge */
-      return -5;
+      retval = -5;
+      break;
     }
 
-    /* Convert q_RPY to Rotation Matrix */
-    pmRpyMatConvert(&q_RPY, &RMatrix);
+    /* Convert q_RPY to Rotation Matrix, the fast solver updates
+       RMatrix itself after the first iteration */
+    if (!track || iteration == 1) {
+      pmRpyMatConvert(&q_RPY, &RMatrix);
+    }
 
     /* compute StrutLengthDiff[] by running inverse kins on Cartesian
      estimate to get joint estimate, subtract joints to get joint deltas,
@@ -431,7 +627,8 @@ int kinematicsForward(const double * joints,
       pmCartCartAdd(&q_trans, &RMatrix_a, &aw);
       pmCartCartSub(&aw, &b[i], &InvKinStrutVect);
       if (0 != pmCartUnit(&InvKinStrutVect, &InvKinStrutVectUnit)) {
-	return -1;
+	retval = -1;
+	break;
       }
       pmCartMag(&InvKinStrutVect, &InvKinStrutLength);
       StrutLengthDiff[i] = InvKinStrutLength - joints[i];
@@ -447,25 +644,66 @@ int kinematicsForward(const double * joints,
       InverseJacobian[i][4] = RMatrix_a_cross_Strut.y;
       InverseJacobian[i][5] = RMatrix_a_cross_Strut.z;
     }
+    if (retval != 0) {
+      break;
+    }
 
-    /* invert Inverse Jacobian */
-    MatInvert(InverseJacobian, Jacobian);
+    /* determine value of conv_error (used to determine if no convergence) */
+    conv_err = 0.0;
+    for (i = 0; i < NUM_STRUTS; i++) {
+      conv_err += rtapi_fabs(StrutLengthDiff[i]);
+    }
 
-    /* multiply Jacobian by LegLengthDiff */
-    MatMult(Jacobian, StrutLengthDiff, delta);
+    if (track) {
+      /* refactor when there are no factors yet, or when the old ones
+	 no longer give (near) quadratic convergence */
+      if (!track->lu_valid ||
+	  (iteration > 1 && conv_err > FWD_REFACTOR_RATIO * last_err)) {
+	for (i = 0; i < NUM_STRUTS; i++) {
+	  for (j = 0; j < NUM_STRUTS; j++) {
+	    track->lu[i][j] = InverseJacobian[i][j];
+	  }
+	}
+	factorizations++;
+	track->lu_valid = (0 == LuFactor(track->lu, track->piv));
+	if (!track->lu_valid) {
+	  retval = -1;
+	  break;
+	}
+      }
+      LuSolve(track->lu, track->piv, StrutLengthDiff, delta);
+    } else {
+      /* invert Inverse Jacobian */
+      factorizations++;
+      MatInvert(InverseJacobian, Jacobian);
+
+      /* multiply Jacobian by LegLengthDiff */
+      MatMult(Jacobian, StrutLengthDiff, delta);
+    }
+    last_err = conv_err;
 
     /* subtract delta from last iterations pos values */
     q_trans.x -= delta[0];
     q_trans.y -= delta[1];
     q_trans.z -= delta[2];
-    q_RPY.r   -= delta[3];
-    q_RPY.p   -= delta[4];
-    q_RPY.y   -= delta[5];
-
-    /* determine value of conv_error (used to determine if no convergence) */
-    conv_err = 0.0;
-    for (i = 0; i < NUM_STRUTS; i++) {
-      conv_err += rtapi_fabs(StrutLengthDiff[i]);
+    if (track) {
+      /* delta[3..5] is a rotation about the world axes, not a change
+	 of roll, pitch and yaw: rotate RMatrix by it, which keeps the
+	 iteration quadratic away from zero angles */
+      rv.s = rtapi_sqrt(delta[3] * delta[3] + delta[4] * delta[4] +
+			delta[5] * delta[5]);
+      if (rv.s > 0.0) {
+	rv.x = -delta[3] / rv.s;
+	rv.y = -delta[4] / rv.s;
+	rv.z = -delta[5] / rv.s;
+	pmRotMatConvert(&rv, &RDelta);
+	pmMatMatMult(&RDelta, &RMatrix, &RNext);
+	RMatrix = RNext;
+      }
+    } else {
+      q_RPY.r   -= delta[3];
+      q_RPY.p   -= delta[4];
+      q_RPY.y   -= delta[5];
     }
 
     /* enter loop to determine if a strut needs another iteration */
@@ -477,6 +715,22 @@ int kinematicsForward(const double * joints,
     }
   } /* exit Newton-Raphson Iterative loop */
 
+  if (retval < 0) {
+    if (track) {
+      track->used = 0;
+      track->lu_valid = 0;
+    }
+    return retval;
+  }
+
+  if (track) {
+    /* back to roll, pitch and yaw, on the same turn as the start */
+    pmMatRpyConvert(&RMatrix, &rpy);
+    q_RPY.r = UnwrapAngle(rpy.r, q_RPY.r);
+    q_RPY.p = UnwrapAngle(rpy.p, q_RPY.p);
+    q_RPY.y = UnwrapAngle(rpy.y, q_RPY.y);
+  }
+
   /* assign r,p,w to a,b,c */
   pos->a = q_RPY.r * 180.0 / PM_PI;  
   pos->b = q_RPY.p * 180.0 / PM_PI;  
@@ -487,6 +741,44 @@ int kinematicsForward(const double * joints,
   pos->tran.y = q_trans.y;
   pos->tran.z = q_trans.z;
 
+  if (track) {
+    track->prev = track->last;
+    track->have_prev = warm;
+    track->last = *pos;
+  }
+
+  return retval;
+}
+
+int kinematicsForward(const double * joints,
+                      EmcPose * pos,
+                      const KINEMATICS_FORWARD_FLAGS * fflags,
+                      KINEMATICS_INVERSE_FLAGS * iflags)
+{
+  int retval;
+#ifdef RTAPI
+  long long int t0 = rtapi_get_time();
+
+  if (haldata) {
+    fast_forward = haldata->fast_forward;
+  }
+#endif
+
+  retval = ForwardSolve(joints, pos);
+
+#ifdef RTAPI
+  if (haldata) {
+    haldata->last_iterations = iteration;
+    haldata->last_factorizations = factorizations;
+    if (iteration > haldata->max_iterations) {
+      haldata->max_iterations = iteration;
+    }
+    haldata->last_solve_time = rtapi_get_time() - t0;
+    if (haldata->last_solve_time > haldata->max_solve_time) {
+      haldata->max_solve_time = haldata->last_solve_time;
+    }
+  }
+#endif
   return retval;
 }
 
@@ -570,6 +862,59 @@ static double timestamp(void)
   return ((double) tp.tv_sec) + ((double) tp.tv_usec) / 1000000.0;
 }
 
+/* follow a fast Lissajous path around 'center', one forward solve per
+   simulated 1 ms servo cycle, the way motion would call the kins */
+static int benchmark_path(const EmcPose * center, int fast)
+{
+#define PATH_CYCLES 20000
+  EmcPose world, pos = *center;
+  double joints[6];
+  KINEMATICS_INVERSE_FLAGS iflags = 0;
+  KINEMATICS_FORWARD_FLAGS fflags = 0;
+  double t, start, end, err, max_err = 0.0;
+  long total_iterations = 0, total_factorizations = 0;
+  int n, max_iterations = 0, retval;
+
+  fast_forward = fast;
+  start = timestamp();
+  for (n = 0; n < PATH_CYCLES; n++) {
+    t = n * 0.001;
+    world = *center;
+    world.tran.x += 2.0 * rtapi_sin(3.0 * t);
+    world.tran.y += 2.0 * rtapi_cos(2.0 * t);
+    world.tran.z += 1.0 * rtapi_sin(5.0 * t);
+    world.a += 5.0 * rtapi_sin(2.0 * t);
+    world.b += 5.0 * rtapi_cos(3.0 * t);
+    world.c += 5.0 * rtapi_sin(t);
+    kinematicsInverse(&world, joints, &iflags, &fflags);
+    retval = kinematicsForward(joints, &pos, &fflags, &iflags);
+    if (0 != retval) {
+      printf("fwd kins error %d at cycle %d\n", retval, n);
+      return 1;
+    }
+    total_iterations += iteration;
+    total_factorizations += factorizations;
+    if (iteration > max_iterations) {
+      max_iterations = iteration;
+    }
+    err = rtapi_fabs(pos.tran.x - world.tran.x) + rtapi_fabs(pos.tran.y - world.tran.y) +
+      rtapi_fabs(pos.tran.z - world.tran.z);
+    if (err > max_err) {
+      max_err = err;
+    }
+  }
+  end = timestamp();
+
+  printf("%s: %f iterations (max %d), %f factorizations, "
+	 "max error %g, %f usecs per solve\n",
+	 fast ? "fast" : "full",
+	 (double) total_iterations / PATH_CYCLES, max_iterations,
+	 (double) total_factorizations / PATH_CYCLES, max_err,
+	 (end - start) * 1e6 / PATH_CYCLES);
+  return 0;
+#undef PATH_CYCLES
+}
+
 int main(int argc, char *argv[])
 {
 #define BUFFERLEN 256
@@ -587,9 +932,22 @@ int main(int argc, char *argv[])
 #define ITERATIONS 100000
   double start, end;
 
-  /* syntax is a.out {i|f # # # # # #} */
+  /* syntax is a.out {i|f|p # # # # # #} */
   if (argc == 8) {
-    if (argv[1][0] == 'f') {
+    if (argv[1][0] == 'p') {
+      /* center of a path passed, so compare both forward solvers on it */
+      if (6 != sscanf(argv[2], "%lf", &pos.tran.x) +
+	  sscanf(argv[3], "%lf", &pos.tran.y) +
+	  sscanf(argv[4], "%lf", &pos.tran.z) +
+	  sscanf(argv[5], "%lf", &pos.a) +
+	  sscanf(argv[6], "%lf", &pos.b) +
+	  sscanf(argv[7], "%lf", &pos.c)) {
+	fprintf(stderr, "bad value in pose\n");
+	return 1;
+      }
+      return benchmark_path(&pos, 0) || benchmark_path(&pos, 1);
+    }
+    else if (argv[1][0] == 'f') {
       /* joints passed, so do interations on forward kins for timing */
       for (t = 0; t < 6; t++) {
 	if (1 != sscanf(argv[t + 2], "%lf", &joints[t])) {
@@ -628,7 +986,7 @@ int main(int argc, char *argv[])
       inverse = 1;
     }
     else {
-      fprintf(stderr, "syntax: %s {i|f # # # # # #}\n", argv[0]);
+      fprintf(stderr, "syntax: %s {i|f|p # # # # # #}\n", argv[0]);
       return 1;
     }
 
@@ -888,10 +1246,6 @@ int main(int argc, char *argv[])
 #endif /* MAIN */
 
 #ifdef RTAPI
-#include "rtapi.h"		/* RTAPI realtime OS API */
-#include "rtapi_app.h"		/* RTAPI realtime module decls */
-#include "hal.h"
-
 MODULE_LICENSE("GPL");
 
 static vtkins_t vtk = {
@@ -905,8 +1259,31 @@ static int comp_id, vtable_id;
 static const char *name = "genhexkins";
 
 int rtapi_app_main(void) {
+    int res;
+
     comp_id = hal_init(name);
     if(comp_id > 0) {
+	haldata = hal_malloc(sizeof(struct haldata));
+	if (!haldata) {
+	    hal_exit(comp_id);
+	    return -ENOMEM;
+	}
+	if ((res = hal_param_bit_newf(HAL_RW, &haldata->fast_forward, comp_id,
+				      "%s.fast-forward", name)) < 0 ||
+	    (res = hal_param_s32_newf(HAL_RO, &haldata->last_iterations, comp_id,
+				      "%s.last-iterations", name)) < 0 ||
+	    (res = hal_param_s32_newf(HAL_RW, &haldata->max_iterations, comp_id,
+				      "%s.max-iterations", name)) < 0 ||
+	    (res = hal_param_s32_newf(HAL_RO, &haldata->last_factorizations,
+				      comp_id, "%s.last-factorizations", name)) < 0 ||
+	    (res = hal_param_u32_newf(HAL_RO, &haldata->last_solve_time, comp_id,
+				      "%s.last-solve-time", name)) < 0 ||
+	    (res = hal_param_u32_newf(HAL_RW, &haldata->max_solve_time, comp_id,
+				      "%s.max-solve-time", name)) < 0) {
+	    hal_exit(comp_id);
+	    return res;
+	}
+	haldata->fast_forward = 1;
 	vtable_id = hal_export_vtable(name, VTVERSION, &vtk, comp_id);
 	if (vtable_id < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
@@ -32,6 +32,7 @@
 */
 
 #include "rtapi_math.h"
+#include "sincos.h"		/* sincos() */
 #include "gotypes.h"		/* go_result, go_integer */
 #include "gomath.h"		/* go_pose */
 #include "genserkins.h"		/* these decls */
@@ -65,6 +66,7 @@ double j[GENSER_MAX_JOINTS];
 #endif
 
 enum { GENSER_DEFAULT_MAX_ITERATIONS = 100 };
+#define GENSER_DEFAULT_DAMPING 0.01
 
 int genser_kin_init(void) {
     genser_struct *genser = KINS_PTR;
@@ -224,6 +226,190 @@ static int compute_jinv(go_matrix * Jfwd, go_matrix * Jinv)
     return GO_RESULT_OK;
 }
 
+/*
+  Specialized inverse kinematics: damped least squares on an analytic
+  Jacobian.  One pass over the DH links gives the end pose and, from
+  the z axis and origin of every link frame, the geometric Jacobian;
+  the generic path above builds the same Jacobian through go_matrix
+  products and runs the forward kins a second time for the pose.  The
+  update is
+
+	dj = J^T (J J^T + damping^2 I)^-1 dvw
+
+  which is the plain Newton step away from singularities and stays
+  bounded near them.  All matrices are fixed size, on the stack.
+*/
+
+/* end pose and geometric Jacobian for the joint estimate */
+static int dls_pose_jacobian(const genser_struct * genser,
+			     const go_real * jest,
+			     go_mat * R, go_cart * p,
+			     go_real J[6][GENSER_MAX_JOINTS])
+{
+    go_cart z[GENSER_MAX_JOINTS], o[GENSER_MAX_JOINTS];
+    go_cart pl, v;
+    go_mat Rl;
+    go_real sth, cth, sal, cal, theta, d;
+    int link;
+
+    R->x.x = 1, R->x.y = 0, R->x.z = 0;
+    R->y.x = 0, R->y.y = 1, R->y.z = 0;
+    R->z.x = 0, R->z.y = 0, R->z.z = 1;
+    p->x = p->y = p->z = 0;
+
+    for (link = 0; link < genser->link_num; link++) {
+	const go_link *l = &genser->links[link];
+
+	if (GO_LINK_DH != l->type) {
+	    return GO_RESULT_IMPL_ERROR;
+	}
+	theta = l->u.dh.theta;
+	d = l->u.dh.d;
+	if (GO_QUANTITY_LENGTH == l->quantity) {
+	    d = jest[link];
+	} else {
+	    theta = jest[link];
+	}
+	/* same transform as go_dh_pose_convert() */
+	sincos(theta, &sth, &cth);
+	sincos(l->u.dh.alpha, &sal, &cal);
+	Rl.x.x = cth, Rl.y.x = -sth, Rl.z.x = 0.0;
+	Rl.x.y = sth * cal, Rl.y.y = cth * cal, Rl.z.y = -sal;
+	Rl.x.z = sth * sal, Rl.y.z = cth * sal, Rl.z.z = cal;
+	pl.x = l->u.dh.a;
+	pl.y = -sal * d;
+	pl.z = cal * d;
+
+	go_mat_cart_mult(R, &pl, &v);
+	go_cart_cart_add(p, &v, p);
+	go_mat_mat_mult(R, &Rl, R);
+	/* the joint moves along or about the z axis of its frame */
+	z[link] = R->z;
+	o[link] = *p;
+    }
+
+    for (link = 0; link < genser->link_num; link++) {
+	if (GO_QUANTITY_LENGTH == genser->links[link].quantity) {
+	    J[0][link] = z[link].x, J[1][link] = z[link].y, J[2][link] = z[link].z;
+	    J[3][link] = 0, J[4][link] = 0, J[5][link] = 0;
+	} else {
+	    go_cart_cart_sub(p, &o[link], &pl);
+	    go_cart_cart_cross(&z[link], &pl, &v);
+	    J[0][link] = v.x, J[1][link] = v.y, J[2][link] = v.z;
+	    J[3][link] = z[link].x, J[4][link] = z[link].y, J[5][link] = z[link].z;
+	}
+    }
+
+    return GO_RESULT_OK;
+}
+
+/* solve A x = b for symmetric positive definite 6x6 A, in place */
+static int dls_cholesky_solve(go_real A[6][6], go_real b[6])
+{
+    go_real sum;
+    int i, j, k;
+
+    for (j = 0; j < 6; j++) {
+	sum = A[j][j];
+	for (k = 0; k < j; k++) {
+	    sum -= A[j][k] * A[j][k];
+	}
+	if (sum <= 0.0) {
+	    return GO_RESULT_SINGULAR;
+	}
+	A[j][j] = rtapi_sqrt(sum);
+	for (i = j + 1; i < 6; i++) {
+	    sum = A[i][j];
+	    for (k = 0; k < j; k++) {
+		sum -= A[i][k] * A[j][k];
+	    }
+	    A[i][j] = sum / A[j][j];
+	}
+    }
+    for (i = 0; i < 6; i++) {
+	for (k = 0; k < i; k++) {
+	    b[i] -= A[i][k] * b[k];
+	}
+	b[i] /= A[i][i];
+    }
+    for (i = 5; i >= 0; i--) {
+	for (k = i + 1; k < 6; k++) {
+	    b[i] -= A[k][i] * b[k];
+	}
+	b[i] /= A[i][i];
+    }
+
+    return GO_RESULT_OK;
+}
+
+/* iterate jest[] (radians) until the end pose is 'pos' */
+static int genser_kin_inv_dls(genser_struct * genser,
+			      const go_pose * pos, go_real * jest)
+{
+    go_real J[6][GENSER_MAX_JOINTS];
+    go_real A[6][6];
+    go_real dvw[6];
+    go_real dj[GENSER_MAX_JOINTS];
+    go_real lambda2 = genser->damping * genser->damping;
+    go_mat Rpos, R, Rinv, Rdelta;
+    go_cart p;
+    go_rvec rvec;
+    int link, row, col, k;
+    int retval;
+
+    go_quat_mat_convert(&pos->rot, &Rpos);
+
+    for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
+	retval = dls_pose_jacobian(genser, jest, &R, &p, J);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+
+	/* pose error in the {0} frame, as in kinematicsInverse() */
+	dvw[0] = pos->tran.x - p.x;
+	dvw[1] = pos->tran.y - p.y;
+	dvw[2] = pos->tran.z - p.z;
+	go_mat_inv(&R, &Rinv);
+	go_mat_mat_mult(&Rpos, &Rinv, &Rdelta);
+	go_mat_rvec_convert(&Rdelta, &rvec);
+	dvw[3] = rvec.x;
+	dvw[4] = rvec.y;
+	dvw[5] = rvec.z;
+
+	/* done when the pose error is within tolerance; small joint
+	   increments alone are not enough, the damping shrinks them
+	   toward an unreachable pose as well */
+	if (GO_TRAN_SMALL(dvw[0]) && GO_TRAN_SMALL(dvw[1]) &&
+	    GO_TRAN_SMALL(dvw[2]) && GO_ROT_SMALL(dvw[3]) &&
+	    GO_ROT_SMALL(dvw[4]) && GO_ROT_SMALL(dvw[5])) {
+	    return GO_RESULT_OK;
+	}
+
+	/* A = J J^T + damping^2 I, symmetric */
+	for (row = 0; row < 6; row++) {
+	    for (col = 0; col <= row; col++) {
+		A[row][col] = 0;
+		for (k = 0; k < genser->link_num; k++) {
+		    A[row][col] += J[row][k] * J[col][k];
+		}
+		A[col][row] = A[row][col];
+	    }
+	    A[row][row] += lambda2;
+	}
+	retval = dls_cholesky_solve(A, dvw);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	for (link = 0; link < genser->link_num; link++) {
+	    dj[link] = 0;
+	    for (row = 0; row < 6; row++) {
+		dj[link] += J[row][link] * dvw[row];
+	    }
+	    jest[link] += dj[link];
+	}
+    }
+
+    return GO_RESULT_ERROR;
+}
+
 int genser_kin_jac_inv(void *kins,
     const go_pose * pos,
     const go_screw * vel, const go_real * joints, go_real * jointvels)
@@ -421,6 +607,11 @@ int kinematicsInverse(const EmcPose * world,
     haldata->pos->tran.y = world->tran.y;
     haldata->pos->tran.z = world->tran.z;
 
+    /* the fast path doesn't run genser_kin_fwd(), which sets up the
+       links and link_num, so do it before link_num is used below */
+    if (genser->fast_inverse)
+	genser_kin_init();
+
     go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
     go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
 
@@ -430,6 +621,18 @@ int kinematicsInverse(const EmcPose * world,
 	jest[link] = joints[link] * (PM_PI / 180);
     }
 
+    if (genser->fast_inverse) {
+	retval = genser_kin_inv_dls(genser, haldata->pos, jest);
+	if (GO_RESULT_OK != retval) {
+	    rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+	    return retval;
+	}
+	for (link = 0; link < genser->link_num; link++) {
+	    joints[link] = jest[link] * 180 / PM_PI;
+	}
+	return GO_RESULT_OK;
+    }
+
     for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
 	/* update the Jacobians */
 	for (link = 0; link < genser->link_num; link++) {
@@ -519,6 +722,73 @@ int kinematicsInverse(const EmcPose * world,
     return GO_RESULT_ERROR;
 }
 
+/*
+  The batch version refreshes the link parameters once, then runs the
+  damped least-squares solver over the poses, each starting from the
+  previous solution.  After a failure the next pose starts from the
+  last good one.
+*/
+long kinematicsInverseBatch(const EmcPose * world,
+			    double *joints,
+			    int joint_stride,
+			    long count,
+			    const KINEMATICS_INVERSE_FLAGS * iflags,
+			    KINEMATICS_FORWARD_FLAGS * fflags,
+			    int *status)
+{
+    genser_struct *genser = KINS_PTR;
+    go_real jest[GENSER_MAX_JOINTS], jgood[GENSER_MAX_JOINTS];
+    go_pose pos;
+    go_rpy rpy;
+    double *out;
+    long i, failed = 0;
+    int link, retval;
+
+    if (!genser->fast_inverse) {
+	/* one kinematicsInverse() call per pose */
+	vtkins_t single = {
+	    .kinematicsInverse = kinematicsInverse,
+	};
+	return kinsInverseBatch(&single, world, joints, joint_stride, count,
+				iflags, fflags, status);
+    }
+
+    genser_kin_init();
+    for (link = 0; link < genser->link_num; link++) {
+	jgood[link] = jest[link] = joints[link] * (PM_PI / 180);
+    }
+
+    for (i = 0; i < count; i++) {
+	rpy.y = world[i].c * PM_PI / 180;
+	rpy.p = world[i].b * PM_PI / 180;
+	rpy.r = world[i].a * PM_PI / 180;
+	go_rpy_quat_convert(&rpy, &pos.rot);
+	pos.tran.x = world[i].tran.x;
+	pos.tran.y = world[i].tran.y;
+	pos.tran.z = world[i].tran.z;
+
+	out = joints + i * joint_stride;
+	retval = genser_kin_inv_dls(genser, &pos, jest);
+	if (GO_RESULT_OK == retval) {
+	    for (link = 0; link < genser->link_num; link++) {
+		jgood[link] = jest[link];
+		out[link] = jest[link] * 180 / PM_PI;
+	    }
+	} else {
+	    failed++;
+	    for (link = 0; link < genser->link_num; link++) {
+		jest[link] = jgood[link];
+		out[link] = jgood[link] * 180 / PM_PI;
+	    }
+	}
+	if (fflags)
+	    fflags[i] = 0;
+	if (status)
+	    status[i] = retval;
+    }
+    return failed;
+}
+
 /*
   Extras, not callable using go_kin_ wrapper but if you know you have
   linked in these kinematics, go ahead and call these for your ad hoc
@@ -565,7 +835,8 @@ static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
     .kinematicsInverse  = kinematicsInverse,
     // .kinematicsHome = kinematicsHome,
-    .kinematicsType = kinematicsType
+    .kinematicsType = kinematicsType,
+    .kinematicsInverseBatch = kinematicsInverseBatch
 };
 
 
@@ -616,8 +887,16 @@ int rtapi_app_main(void)
     if ((res=
         hal_param_s32_newf(HAL_RW, &(KINS_PTR->max_iterations), comp_id, "genserkins.max-iterations")) < 0)
         goto error;
+    if ((res=
+        hal_param_bit_newf(HAL_RW, &(KINS_PTR->fast_inverse), comp_id, "genserkins.fast-inverse")) < 0)
+        goto error;
+    if ((res=
+        hal_param_float_newf(HAL_RW, &(KINS_PTR->damping), comp_id, "genserkins.damping")) < 0)
+        goto error;
 
     KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
+    KINS_PTR->fast_inverse = 1;
+    KINS_PTR->damping = GENSER_DEFAULT_DAMPING;
 
 
     A(0) = DEFAULT_A1;
@@ -639,12 +918,12 @@ int rtapi_app_main(void)
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
 
-    vtable_id = hal_export_vtable(name, VTKINEMATICS_VERSION1, &vtk, comp_id);
+    vtable_id = hal_export_vtable(name, VTKINEMATICS_VERSION2, &vtk, comp_id);
 
     if (vtable_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"%s: ERROR: hal_export_vtable(%s,%d,%p) failed: %d\n",
-			name, name,  VTKINEMATICS_VERSION1, &vtk, vtable_id );
+			name, name,  VTKINEMATICS_VERSION2, &vtk, vtable_id );
 	return -ENOENT;
     }
     hal_ready(comp_id);
@@ -666,9 +945,13 @@ void rtapi_app_exit(void)
 #ifdef ULAPI
 
 #include <stdio.h>
+#include <stdlib.h>		/* rand(), realloc() */
+#include <string.h>		/* memset() */
+#include <math.h>		/* fabs() */
 #include <malloc.h>
 #include <sys/time.h>		/* struct timeval */
 #include <unistd.h>		/* gettimeofday() */
+#include "kinsbatch.h"		/* kinsbatch_check() */
 
 static double timestamp()
 {
@@ -680,6 +963,128 @@ static double timestamp()
     return ((double) tp.tv_sec) + ((double) tp.tv_usec) / 1000000.0;
 }
 
+/* inverse kins for random reachable poses: random joints, their pose
+   from the forward kins, and as the estimate the same joints off by up
+   to 'spread' degrees each */
+static int benchmark_inverse(double spread, int fast)
+{
+#define BENCH_POSES 20000
+    static const double range[6] = { 170, 80, 80, 170, 80, 170 };
+    EmcPose pos, check;
+    double joints[6], est[6];
+    KINEMATICS_INVERSE_FLAGS iflags = 0;
+    KINEMATICS_FORWARD_FLAGS fflags = 0;
+    double start, elapsed = 0.0, err, max_err = 0.0;
+    long total_iterations = 0;
+    int n, t, failed = 0, max_iterations = 0;
+
+    KINS_PTR->fast_inverse = fast;
+    srand(1);
+    for (n = 0; n < BENCH_POSES; n++) {
+	for (t = 0; t < 6; t++) {
+	    joints[t] = range[t] * (2.0 * rand() / RAND_MAX - 1.0);
+	    est[t] = joints[t] + spread * (2.0 * rand() / RAND_MAX - 1.0);
+	}
+	/* keep away from the wrist singularity */
+	if (fabs(joints[4]) < 5.0) {
+	    joints[4] = 5.0;
+	}
+	kinematicsForward(joints, &pos, &fflags, &iflags);
+
+	start = timestamp();
+	if (0 != kinematicsInverse(&pos, est, &iflags, &fflags)) {
+	    failed++;
+	    elapsed += timestamp() - start;
+	    continue;
+	}
+	elapsed += timestamp() - start;
+	total_iterations += KINS_PTR->iterations;
+	if (KINS_PTR->iterations > max_iterations) {
+	    max_iterations = KINS_PTR->iterations;
+	}
+	check = pos;
+	kinematicsForward(est, &check, &fflags, &iflags);
+	err = fabs(check.tran.x - pos.tran.x) + fabs(check.tran.y - pos.tran.y) +
+	    fabs(check.tran.z - pos.tran.z);
+	if (err > max_err) {
+	    max_err = err;
+	}
+    }
+
+    printf("%s: %f iterations (max %d), %d of %d failed, "
+	"max position error %g, %f usecs per solve\n",
+	fast ? "dls" : "generic",
+	(double) total_iterations / (BENCH_POSES - failed), max_iterations,
+	failed, BENCH_POSES, max_err, elapsed * 1e6 / BENCH_POSES);
+    return 0;
+#undef BENCH_POSES
+}
+
+/* read a path of world poses, one "x y z a b c" per line, from stdin
+   and print its joint space extents */
+static int check_path(int procs)
+{
+    vtkins_t vtk = {
+	.kinematicsForward = kinematicsForward,
+	.kinematicsInverse = kinematicsInverse,
+	.kinematicsType = kinematicsType,
+	.kinematicsInverseBatch = kinematicsInverseBatch
+    };
+    char buffer[BUFFERLEN];
+    EmcPose *path = NULL, *p;
+    long count = 0, size = 0;
+    double estimate[EMCMOT_MAX_JOINTS] = { 0.0 };
+    kinsbatch_result_t res;
+    double start, end;
+    int t, retval;
+
+    while (NULL != fgets(buffer, BUFFERLEN, stdin)) {
+	if (count == size) {
+	    size = size ? 2 * size : 65536;
+	    p = realloc(path, size * sizeof(EmcPose));
+	    if (!p) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	    }
+	    path = p;
+	}
+	p = &path[count];
+	memset(p, 0, sizeof(*p));
+	if (6 == sscanf(buffer, "%lf %lf %lf %lf %lf %lf",
+		&p->tran.x, &p->tran.y, &p->tran.z, &p->a, &p->b, &p->c)) {
+	    count++;
+	}
+    }
+    if (count == 0) {
+	fprintf(stderr, "no poses\n");
+	return 1;
+    }
+
+    /* start from the joints of the first pose as seen from zero */
+    if (0 != kinematicsInverse(&path[0], estimate, 0, 0)) {
+	fprintf(stderr, "no joint solution for the first pose\n");
+	free(path);
+	return 1;
+    }
+
+    start = timestamp();
+    retval = kinsbatch_check(&vtk, path, count, 6, estimate, NULL, NULL,
+	procs, &res);
+    end = timestamp();
+    free(path);
+    if (retval < 0) {
+	fprintf(stderr, "kinsbatch_check failed: %d\n", retval);
+	return 1;
+    }
+
+    printf("%ld poses, %ld failed (first %ld), %f secs\n",
+	res.count, res.failed, res.first_failed, end - start);
+    for (t = 0; t < 6; t++) {
+	printf("joint %d: %f .. %f\n", t, res.min[t], res.max[t]);
+    }
+    return res.failed != 0;
+}
+
 int main(int argc, char *argv[])
 {
     char buffer[BUFFERLEN];
@@ -701,6 +1106,9 @@ int main(int argc, char *argv[])
 
     KINS_PTR = malloc(sizeof(genser_struct));
     haldata->pos = (go_pose *) malloc(sizeof(go_pose));
+    KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
+    KINS_PTR->fast_inverse = 1;
+    KINS_PTR->damping = GENSER_DEFAULT_DAMPING;
 
     for (i = 0; i < GENSER_MAX_JOINTS ; i++) {
 	haldata->a[i] = malloc(sizeof(double));
@@ -726,7 +1134,26 @@ int main(int argc, char *argv[])
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
 
-    /* syntax is a.out {i|f # # # # # #} */
+    /* syntax is a.out {i|f # # # # # #}, a.out b <spread>
+       or a.out c <procs> < path */
+    if (argc == 3 && argv[1][0] == 'c') {
+	int procs;
+
+	if (1 != sscanf(argv[2], "%d", &procs)) {
+	    fprintf(stderr, "bad value: %s\n", argv[2]);
+	    return 1;
+	}
+	return check_path(procs);
+    }
+    if (argc == 3 && argv[1][0] == 'b') {
+	double spread;
+
+	if (1 != sscanf(argv[2], "%lf", &spread)) {
+	    fprintf(stderr, "bad value: %s\n", argv[2]);
+	    return 1;
+	}
+	return benchmark_inverse(spread, 0) || benchmark_inverse(spread, 1);
+    }
     if (argc == 8) {
 	if (argv[1][0] == 'f') {
 	    /* joints passed, so do interations on forward kins for timing */
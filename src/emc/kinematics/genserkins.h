@@ -74,6 +74,8 @@ typedef struct {
   int link_num;		/*!< How many are actually present. */
   hal_s32_t iterations;	/*!< How many iterations were actually used to compute the inverse kinematics. */
   hal_s32_t max_iterations;	/*!< Number of iterations after which to give up and report an error. */
+  hal_bit_t fast_inverse;	/*!< Use the damped least-squares inverse kinematics. */
+  hal_float_t damping;	/*!< Damping factor of the least-squares update. */
 } genser_struct;
 
 extern int genser_kin_size(void); 
@@ -126,11 +126,109 @@ typedef int (* vtk_kinematicsHome_t)(struct EmcPose * world,
 
 typedef KINEMATICS_TYPE  (*vtk_kinematicsType_t)(void);
 
+/* batch versions, for offline evaluation of whole paths: element i
+   uses world[i] and the joints at joints + i * joint_stride.  The flags
+   arrays have one entry per element and may be NULL (input flags all
+   zero, output flags not wanted), same for status[], which gets the
+   return value for each element.  Iterative kins start each element
+   from the result of the previous one, so only the first element's
+   estimate comes from the caller.  Return the number of elements
+   that failed (nonzero return value). */
+typedef long (*vtk_kinematicsForwardBatch_t)(const double *joints,
+				     int joint_stride,
+				     struct EmcPose * world,
+				     long count,
+				     const KINEMATICS_FORWARD_FLAGS * fflags,
+				     KINEMATICS_INVERSE_FLAGS * iflags,
+				     int *status);
+
+typedef long (*vtk_kinematicsInverseBatch_t)(const struct EmcPose * world,
+				     double *joints,
+				     int joint_stride,
+				     long count,
+				     const KINEMATICS_INVERSE_FLAGS * iflags,
+				     KINEMATICS_FORWARD_FLAGS * fflags,
+				     int *status);
+
 typedef struct {
     vtk_kinematicsForward_t kinematicsForward;
     vtk_kinematicsInverse_t kinematicsInverse;
     //    vtk_kinematicsHome_t    kinematicsHome; // unused
     vtk_kinematicsType_t    kinematicsType;
+    // optional, NULL if the module has no batch code of its own;
+    // use kinsForwardBatch()/kinsInverseBatch() below
+    vtk_kinematicsForwardBatch_t kinematicsForwardBatch;
+    vtk_kinematicsInverseBatch_t kinematicsInverseBatch;
 } vtkins_t;
 
+/* batch calls through a kins vtable, falling back to one call per
+   element when the module does not export batch functions */
+static inline long kinsForwardBatch(const vtkins_t *vtk,
+				    const double *joints, int joint_stride,
+				    struct EmcPose * world, long count,
+				    const KINEMATICS_FORWARD_FLAGS * fflags,
+				    KINEMATICS_INVERSE_FLAGS * iflags,
+				    int *status)
+{
+    KINEMATICS_FORWARD_FLAGS ff = 0;
+    KINEMATICS_INVERSE_FLAGS ifl;
+    long i, failed = 0;
+    int r;
+
+    if (vtk->kinematicsForwardBatch)
+	return vtk->kinematicsForwardBatch(joints, joint_stride, world, count,
+					   fflags, iflags, status);
+    for (i = 0; i < count; i++) {
+	if (i > 0)
+	    world[i] = world[i - 1];
+	if (fflags)
+	    ff = fflags[i];
+	ifl = iflags ? iflags[i] : 0;
+	r = vtk->kinematicsForward(joints + i * joint_stride, &world[i],
+				   &ff, &ifl);
+	if (iflags)
+	    iflags[i] = ifl;
+	if (status)
+	    status[i] = r;
+	if (r != 0)
+	    failed++;
+    }
+    return failed;
+}
+
+static inline long kinsInverseBatch(const vtkins_t *vtk,
+				    const struct EmcPose * world,
+				    double *joints, int joint_stride,
+				    long count,
+				    const KINEMATICS_INVERSE_FLAGS * iflags,
+				    KINEMATICS_FORWARD_FLAGS * fflags,
+				    int *status)
+{
+    KINEMATICS_INVERSE_FLAGS ifl = 0;
+    KINEMATICS_FORWARD_FLAGS ff;
+    long i, failed = 0;
+    int j, r;
+
+    if (vtk->kinematicsInverseBatch)
+	return vtk->kinematicsInverseBatch(world, joints, joint_stride, count,
+					   iflags, fflags, status);
+    for (i = 0; i < count; i++) {
+	if (i > 0)
+	    for (j = 0; j < joint_stride; j++)
+		joints[i * joint_stride + j] = joints[(i - 1) * joint_stride + j];
+	if (iflags)
+	    ifl = iflags[i];
+	ff = fflags ? fflags[i] : 0;
+	r = vtk->kinematicsInverse(&world[i], joints + i * joint_stride,
+				   &ifl, &ff);
+	if (fflags)
+	    fflags[i] = ff;
+	if (status)
+	    status[i] = r;
+	if (r != 0)
+	    failed++;
+    }
+    return failed;
+}
+
 #endif
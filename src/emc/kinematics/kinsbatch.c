@@ -0,0 +1,246 @@
+/********************************************************************
+* Description: kinsbatch.c
+*   User space evaluation of kinematics over whole paths
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************/
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "kinsbatch.h"
+
+#define KINSBATCH_CHUNK 4096	/* poses per kinsInverseBatch() call */
+#define KINSBATCH_MAX_PROCS 64
+#define KINSBATCH_SEAM_TOL 1e-6	/* joint units */
+
+/* what a process reports for its part of the path: besides the result,
+   the joints at the first pose and the joints the next part starts from */
+typedef struct {
+    kinsbatch_result_t r;
+    int first_status;
+    double first[EMCMOT_MAX_JOINTS];
+    double last[EMCMOT_MAX_JOINTS];
+} kinsbatch_part_t;
+
+static void result_init(kinsbatch_result_t * r)
+{
+    int j;
+
+    memset(r, 0, sizeof(*r));
+    r->first_failed = -1;
+    r->first_violation = -1;
+    for (j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+	r->min[j] = DBL_MAX;
+	r->max[j] = -DBL_MAX;
+    }
+}
+
+/* the parts are merged in path order, so 'first' indices stay first */
+static void result_merge(kinsbatch_result_t * r, const kinsbatch_result_t * part)
+{
+    int j;
+
+    if (r->first_failed < 0)
+	r->first_failed = part->first_failed;
+    if (r->first_violation < 0)
+	r->first_violation = part->first_violation;
+    r->count += part->count;
+    r->failed += part->failed;
+    r->violations += part->violations;
+    for (j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+	if (part->min[j] < r->min[j])
+	    r->min[j] = part->min[j];
+	if (part->max[j] > r->max[j])
+	    r->max[j] = part->max[j];
+    }
+}
+
+static int check_range(const vtkins_t * vtk, const EmcPose * path,
+		       long start, long end, int num_joints,
+		       const double *estimate,
+		       const double *min_limit, const double *max_limit,
+		       kinsbatch_part_t * part)
+{
+    kinsbatch_result_t *r = &part->r;
+    double *joints;
+    int *status;
+    double *jp;
+    long pos, k, n;
+    int j, bad;
+
+    result_init(r);
+    joints = calloc(KINSBATCH_CHUNK, EMCMOT_MAX_JOINTS * sizeof(double));
+    status = calloc(KINSBATCH_CHUNK, sizeof(int));
+    if (!joints || !status) {
+	free(joints);
+	free(status);
+	return -ENOMEM;
+    }
+    for (j = 0; j < num_joints; j++)
+	joints[j] = estimate ? estimate[j] : 0.0;
+
+    for (pos = start; pos < end; pos += n) {
+	n = end - pos;
+	if (n > KINSBATCH_CHUNK)
+	    n = KINSBATCH_CHUNK;
+	kinsInverseBatch(vtk, path + pos, joints, EMCMOT_MAX_JOINTS, n,
+			 NULL, NULL, status);
+	if (pos == start) {
+	    part->first_status = status[0];
+	    memcpy(part->first, joints, sizeof(part->first));
+	}
+	for (k = 0; k < n; k++) {
+	    jp = joints + k * EMCMOT_MAX_JOINTS;
+	    if (status[k] != 0) {
+		if (r->first_failed < 0)
+		    r->first_failed = pos + k;
+		r->failed++;
+		continue;
+	    }
+	    bad = 0;
+	    for (j = 0; j < num_joints; j++) {
+		if (jp[j] < r->min[j])
+		    r->min[j] = jp[j];
+		if (jp[j] > r->max[j])
+		    r->max[j] = jp[j];
+		if ((min_limit && jp[j] < min_limit[j]) ||
+		    (max_limit && jp[j] > max_limit[j]))
+		    bad = 1;
+	    }
+	    if (bad) {
+		if (r->first_violation < 0)
+		    r->first_violation = pos + k;
+		r->violations++;
+	    }
+	}
+	/* the next batch starts where this one ended */
+	memmove(joints, joints + (n - 1) * EMCMOT_MAX_JOINTS,
+		EMCMOT_MAX_JOINTS * sizeof(double));
+	r->count += n;
+    }
+    memcpy(part->last, joints, sizeof(part->last));
+
+    free(joints);
+    free(status);
+    return 0;
+}
+
+/* the part was started from 'estimate' rather than from where the path
+   before it ended; it stands if the pose at the seam, solved from 'seed',
+   comes out the same */
+static int seam_matches(const vtkins_t * vtk, const EmcPose * path,
+			long start, int num_joints, const double *seed,
+			const kinsbatch_part_t * part)
+{
+    double joints[EMCMOT_MAX_JOINTS];
+    int j, status;
+
+    memcpy(joints, seed, sizeof(joints));
+    kinsInverseBatch(vtk, path + start, joints, EMCMOT_MAX_JOINTS, 1,
+		     NULL, NULL, &status);
+    if (status != part->first_status)
+	return 0;
+    for (j = 0; j < num_joints; j++)
+	if (fabs(joints[j] - part->first[j]) > KINSBATCH_SEAM_TOL)
+	    return 0;
+    return 1;
+}
+
+int kinsbatch_check(const vtkins_t * vtk,
+		    const EmcPose * path, long count,
+		    int num_joints, const double *estimate,
+		    const double *min_limit, const double *max_limit,
+		    int nprocs, kinsbatch_result_t * result)
+{
+    kinsbatch_part_t part;
+    pid_t pid[KINSBATCH_MAX_PROCS];
+    int fd[KINSBATCH_MAX_PROCS];
+    double seed[EMCMOT_MAX_JOINTS];
+    int pipefd[2];
+    long per, start, end;
+    int p, started, lost, retval = 0;
+
+    if (!vtk || !path || count < 0 || !result ||
+	num_joints < 1 || num_joints > EMCMOT_MAX_JOINTS)
+	return -EINVAL;
+    if (nprocs > KINSBATCH_MAX_PROCS)
+	nprocs = KINSBATCH_MAX_PROCS;
+    /* not worth a fork for less than a batch each */
+    if (nprocs > count / KINSBATCH_CHUNK)
+	nprocs = count / KINSBATCH_CHUNK;
+    if (nprocs <= 1) {
+	retval = check_range(vtk, path, 0, count, num_joints, estimate,
+			     min_limit, max_limit, &part);
+	*result = part.r;
+	return retval;
+    }
+
+    /* parts of whole batches, so the batches are the ones of a single
+       process */
+    per = (count + nprocs - 1) / nprocs;
+    per = (per + KINSBATCH_CHUNK - 1) / KINSBATCH_CHUNK * KINSBATCH_CHUNK;
+    for (started = 0; started < nprocs && started * per < count; started++) {
+	start = started * per;
+	end = start + per < count ? start + per : count;
+	if (pipe(pipefd) < 0)
+	    break;
+	pid[started] = fork();
+	if (pid[started] < 0) {
+	    close(pipefd[0]);
+	    close(pipefd[1]);
+	    break;
+	}
+	if (pid[started] == 0) {
+	    close(pipefd[0]);
+	    if (check_range(vtk, path, start, end, num_joints, estimate,
+			    min_limit, max_limit, &part) < 0 ||
+		write(pipefd[1], &part, sizeof(part)) != sizeof(part))
+		_exit(1);
+	    _exit(0);
+	}
+	close(pipefd[1]);
+	fd[started] = pipefd[0];
+    }
+
+    /* Every part but the first started from 'estimate', and on a path
+       with more than one joint solution per pose it may have tracked
+       another one than a single process would.  Go through the seams
+       in path order and redo, from where the path before it ended, any
+       part that disagrees at its first pose, so the result is that of
+       a single process.  A part whose result got lost is redone too. */
+    result_init(result);
+    for (p = 0; p < started; p++) {
+	start = p * per;
+	end = start + per < count ? start + per : count;
+	lost = read(fd[p], &part, sizeof(part)) != sizeof(part);
+	close(fd[p]);
+	waitpid(pid[p], NULL, 0);
+	if (retval == 0 && (lost || (p > 0 &&
+	    !seam_matches(vtk, path, start, num_joints, seed, &part))))
+	    retval = check_range(vtk, path, start, end, num_joints,
+				 p ? seed : estimate,
+				 min_limit, max_limit, &part);
+	if (retval == 0) {
+	    result_merge(result, &part.r);
+	    memcpy(seed, part.last, sizeof(seed));
+	}
+    }
+    /* whatever could not be forked is done here */
+    if (started * per < count && retval == 0) {
+	retval = check_range(vtk, path, started * per, count, num_joints,
+			     started ? seed : estimate,
+			     min_limit, max_limit, &part);
+	if (retval == 0)
+	    result_merge(result, &part.r);
+    }
+    return retval;
+}
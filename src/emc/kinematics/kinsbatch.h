@@ -0,0 +1,47 @@
+/********************************************************************
+* Description: kinsbatch.h
+*   User space evaluation of kinematics over whole paths
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************
+
+  kinsbatch_check() runs the inverse kinematics of a kins vtable over a
+  path of world poses, for the interpreter preview and offline checkers:
+  it returns the joint space extents of the path, and the poses where the
+  kins fail or a joint is out of its limits.
+
+  The work is split over 'nprocs' forked processes, not threads, since
+  most kins keep state in static variables.  Each process works through
+  its part of the path in batches, starting from 'estimate'; a part that
+  comes out on another joint solution at its first pose than the end of
+  the part before it is redone from there, so the result does not depend
+  on 'nprocs'.
+*/
+
+#ifndef KINSBATCH_H
+#define KINSBATCH_H
+
+#include "kinematics.h"		/* vtkins_t, kinsInverseBatch() */
+#include "emcmotcfg.h"		/* EMCMOT_MAX_JOINTS */
+
+typedef struct {
+    long count;			/* poses evaluated */
+    long failed;		/* poses where the kins failed */
+    long violations;		/* poses with a joint out of its limits */
+    long first_failed;		/* index of the first of these, -1: none */
+    long first_violation;
+    double min[EMCMOT_MAX_JOINTS];	/* joint extents of the good poses */
+    double max[EMCMOT_MAX_JOINTS];
+} kinsbatch_result_t;
+
+/* 'min_limit' and 'max_limit' may be NULL for no limits.  Returns 0, or
+   a negative errno if the work could not be started. */
+extern int kinsbatch_check(const vtkins_t * vtk,
+			   const EmcPose * path, long count,
+			   int num_joints, const double *estimate,
+			   const double *min_limit, const double *max_limit,
+			   int nprocs, kinsbatch_result_t * result);
+
+#endif
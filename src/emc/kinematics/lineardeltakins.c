@@ -20,7 +20,7 @@
 #include "rtapi_app.h"
 
 #include "lineardeltakins-common.h"
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 struct haldata
 {
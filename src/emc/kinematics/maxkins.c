@@ -27,7 +27,7 @@ struct haldata {
     hal_float_t *pivot_length;
 } *haldata;
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 MODULE_LICENSE("GPL");
 
@@ -24,7 +24,7 @@
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
 #include "hal.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 struct haldata {
     hal_float_t *a2, *a3, *d3, *d4;
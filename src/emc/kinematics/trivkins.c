@@ -19,7 +19,7 @@
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
 #include "hal.h"
 
-#define VTVERSION VTKINEMATICS_VERSION1
+#define VTVERSION VTKINEMATICS_VERSION2
 
 
 int kinematicsForward(const double *joints,
@@ -58,6 +58,46 @@ int kinematicsInverse(const EmcPose * pos,
     return 0;
 }
 
+long kinematicsForwardBatch(const double *joints,
+			    int joint_stride,
+			    EmcPose * pos,
+			    long count,
+			    const KINEMATICS_FORWARD_FLAGS * fflags,
+			    KINEMATICS_INVERSE_FLAGS * iflags,
+			    int *status)
+{
+    long i;
+
+    for (i = 0; i < count; i++) {
+	kinematicsForward(joints + i * joint_stride, &pos[i], 0, 0);
+	if (iflags)
+	    iflags[i] = 0;
+	if (status)
+	    status[i] = 0;
+    }
+    return 0;
+}
+
+long kinematicsInverseBatch(const EmcPose * pos,
+			    double *joints,
+			    int joint_stride,
+			    long count,
+			    const KINEMATICS_INVERSE_FLAGS * iflags,
+			    KINEMATICS_FORWARD_FLAGS * fflags,
+			    int *status)
+{
+    long i;
+
+    for (i = 0; i < count; i++) {
+	kinematicsInverse(&pos[i], joints + i * joint_stride, 0, 0);
+	if (fflags)
+	    fflags[i] = 0;
+	if (status)
+	    status[i] = 0;
+    }
+    return 0;
+}
+
 /* implemented for these kinematics as giving joints preference */
 int kinematicsHome(EmcPose * world,
 		   double *joint,
@@ -81,7 +121,9 @@ static vtkins_t vtk = {
     .kinematicsForward = kinematicsForward,
     .kinematicsInverse  = kinematicsInverse,
     // .kinematicsHome = kinematicsHome,
-    .kinematicsType = kinematicsType
+    .kinematicsType = kinematicsType,
+    .kinematicsForwardBatch = kinematicsForwardBatch,
+    .kinematicsInverseBatch = kinematicsInverseBatch
 };
 
 static int comp_id, vtable_id;
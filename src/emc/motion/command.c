@@ -68,6 +68,7 @@
 #include "motion_struct.h"
 #include "emcmotglb.h"
 #include "mot_priv.h"
+#include "volcomp.h"
 #include "rtapi_math.h"
 #include "motion_types.h"
 
@@ -227,7 +228,7 @@ int inRange(EmcPose pos, int id, char *move_type)
     }
 
     /* now fill in with real values, for joints that are used */
-    emcmotConfig->vtk->kinematicsInverse(&pos, joint_pos, &iflags, &fflags);
+    volcompInverse(&pos, joint_pos, &iflags, &fflags);
 
     for (joint_num = 0; joint_num < num_joints; joint_num++) {
 	/* point to joint data */
@@ -254,6 +255,206 @@ int inRange(EmcPose pos, int id, char *move_type)
     return in_range;
 }
 
+/* Queued move limit check.
+
+   inRange() only looks at the end point of a move.  With nonlinear
+   kinematics a joint can pass its limit between the end points of a
+   straight line, and with any kinematics an arc can bulge past a limit
+   its end points are well inside of.  Moves that are added to the TP
+   are therefore also put on a small ring, and check_queued_limits(),
+   called each servo cycle, runs the interior points of the queued
+   moves through inRange(), at most motion.limit-check-budget of them
+   per cycle.  The queue normally holds many moves, so a violation is
+   found and reported with its line number well before the machine
+   gets there.  motion.limit-check-samples sets the number of interior
+   points per move, at most LIMIT_CHECK_MAX_SAMPLES, 0 (the default)
+   turns the check off.  Nothing is sampled outside of that budget:
+   a move that finds the ring full goes unchecked and is counted in
+   motion.limit-check-skipped, and moves the TP is done with are
+   dropped from the ring unchecked.
+*/
+#define LIMIT_CHECK_RING 64
+#define LIMIT_CHECK_MAX_SAMPLES 100
+
+int abort_and_switchback(void);	/* below */
+
+typedef struct {
+    int id;			/* line number, for the error message */
+    unsigned long seq;		/* limit_check_added once it was queued */
+    char *move_type;
+    int circle;			/* non-zero: xyz is on 'arc' */
+    int spline;			/* non-zero: xyz is a Bezier curve */
+    EmcPose start;
+    EmcPose end;
+    PmCircle arc;
+    PmCartesian control[2];	/* inner control points of the spline */
+} limit_check_t;
+
+static limit_check_t limit_check_ring[LIMIT_CHECK_RING];
+static int limit_check_head, limit_check_tail;	/* in, out */
+static int limit_check_sample;	/* last sample taken at tail */
+static unsigned long limit_check_added;	/* segments ever put on the TP */
+static int limit_check_depth;	/* TP queue depth at the last look */
+
+/* moves go to the primary queue, so this is called wherever that queue
+   is aborted or cleared */
+void limit_check_flush(void)
+{
+    limit_check_tail = limit_check_head;
+    limit_check_sample = 0;
+}
+
+/* pose at fraction 'f' of the move */
+static void limit_check_pose(limit_check_t *m, double f, EmcPose *pos)
+{
+    EmcPose *a = &m->start, *b = &m->end;
+
+    if (m->circle) {
+	pmCirclePoint(&m->arc, f * m->arc.angle, &pos->tran);
+    } else if (m->spline) {
+	/* samples are even in the curve parameter, not in length */
+	double g = 1.0 - f;
+	double b0 = g * g * g, b1 = 3.0 * g * g * f;
+	double b2 = 3.0 * g * f * f, b3 = f * f * f;
+	pos->tran.x = b0 * a->tran.x + b1 * m->control[0].x +
+	    b2 * m->control[1].x + b3 * b->tran.x;
+	pos->tran.y = b0 * a->tran.y + b1 * m->control[0].y +
+	    b2 * m->control[1].y + b3 * b->tran.y;
+	pos->tran.z = b0 * a->tran.z + b1 * m->control[0].z +
+	    b2 * m->control[1].z + b3 * b->tran.z;
+    } else {
+	pos->tran.x = a->tran.x + f * (b->tran.x - a->tran.x);
+	pos->tran.y = a->tran.y + f * (b->tran.y - a->tran.y);
+	pos->tran.z = a->tran.z + f * (b->tran.z - a->tran.z);
+    }
+    pos->a = a->a + f * (b->a - a->a);
+    pos->b = a->b + f * (b->b - a->b);
+    pos->c = a->c + f * (b->c - a->c);
+    pos->u = a->u + f * (b->u - a->u);
+    pos->v = a->v + f * (b->v - a->v);
+    pos->w = a->w + f * (b->w - a->w);
+}
+
+/* the samples param, clamped so a check stays cheap */
+static int limit_check_samples(void)
+{
+    if (emcmot_hal_data->limit_check_samples > LIMIT_CHECK_MAX_SAMPLES) {
+	emcmot_hal_data->limit_check_samples = LIMIT_CHECK_MAX_SAMPLES;
+    }
+    return emcmot_hal_data->limit_check_samples;
+}
+
+/* Follows the depth of the primary queue.  Growth since the last look
+   is counted in limit_check_added, so limit_check_added minus the
+   depth is the number of segments the TP is done with.  Blends and
+   merges in the TP only shift this by a segment, which at worst keeps
+   a finished move on the ring for a little longer.
+*/
+static unsigned long limit_check_retired(void)
+{
+    int depth = emcmotConfig->vtp->tpQueueDepth(emcmotPrimQueue);
+
+    if (depth > limit_check_depth) {
+	limit_check_added += depth - limit_check_depth;
+    }
+    limit_check_depth = depth;
+    return limit_check_added - depth;
+}
+
+/* queue_limit_check() is called after a move was added to the TP.
+   'start' is the goal of the TP before the move was added, 'center'
+   and 'normal' are NULL for straight moves, 'control' points to the
+   two inner control points of a spline and is NULL otherwise.
+*/
+static void queue_limit_check(char *move_type, int id, EmcPose start,
+			      EmcPose end, PmCartesian *center,
+			      PmCartesian *normal, int turn,
+			      PmCartesian *control)
+{
+    limit_check_t *m;
+    int samples = limit_check_samples();
+    int next = (limit_check_head + 1) % LIMIT_CHECK_RING;
+
+    limit_check_retired();
+    if (samples <= 0) {
+	return;
+    }
+    /* joints are linear in the axes, the end points are enough */
+    if (center == NULL && control == NULL &&
+	kinType == KINEMATICS_IDENTITY) {
+	return;
+    }
+    if (next == limit_check_tail) {
+	/* behind by a full ring, this one goes unchecked */
+	emcmot_hal_data->limit_check_skipped++;
+	return;
+    }
+    m = &limit_check_ring[limit_check_head];
+    m->id = id;
+    m->seq = limit_check_added;
+    m->move_type = move_type;
+    m->start = start;
+    m->end = end;
+    m->circle = 0;
+    m->spline = 0;
+    if (control != NULL) {
+	m->control[0] = control[0];
+	m->control[1] = control[1];
+	m->spline = 1;
+    } else if (center != NULL) {
+	if (pmCircleInit(&m->arc, &start.tran, &end.tran, center, normal,
+			 turn) != 0) {
+	    /* the TP took it, so this does not happen; skip the check */
+	    return;
+	}
+	m->circle = 1;
+    }
+    limit_check_head = next;
+}
+
+/* check_queued_limits() is called by the controller each servo cycle.
+   A failed check aborts the queue, like a failed end point check of
+   the command handler.
+*/
+void check_queued_limits(void)
+{
+    int budget = emcmot_hal_data->limit_check_budget;
+    int samples = limit_check_samples();
+    unsigned long retired = limit_check_retired();
+    limit_check_t *m;
+    EmcPose pos;
+
+    if (limit_check_head == limit_check_tail) {
+	return;
+    }
+    if (samples <= 0 || limit_check_depth == 0) {
+	/* switched off, or moves are done or were aborted */
+	limit_check_flush();
+	return;
+    }
+    while (budget-- > 0 && limit_check_head != limit_check_tail) {
+	m = &limit_check_ring[limit_check_tail];
+	if ((long) (m->seq - retired) <= 0) {
+	    /* already run, too late to check it */
+	    limit_check_tail = (limit_check_tail + 1) % LIMIT_CHECK_RING;
+	    limit_check_sample = 0;
+	    budget++;
+	    continue;
+	}
+	limit_check_sample++;
+	limit_check_pose(m, (double) limit_check_sample / (samples + 1), &pos);
+	if (!inRange(pos, m->id, m->move_type)) {
+	    abort_and_switchback();
+	    SET_MOTION_ERROR_FLAG(1);
+	    return;
+	}
+	if (limit_check_sample >= samples) {
+	    limit_check_tail = (limit_check_tail + 1) % LIMIT_CHECK_RING;
+	    limit_check_sample = 0;
+	}
+    }
+}
+
 /* clearHomes() will clear the homed flags for joints that have moved
    since homing, outside coordinated control, for machines with no
    forward kinematics. This is used in conjunction with the rehomeAll
@@ -359,6 +560,7 @@ STATIC int is_feed_type(int motion_type)
 // is now 'done' (otherwise task will hang in RCS_EXEC).
 int abort_and_switchback(void)
 {
+    limit_check_flush();
     if (emcmotQueue == emcmotAltQueue) {
 	EmcPose where;
 	emcmotConfig->vtp->tpGetPos(emcmotAltQueue, &where);
@@ -388,6 +590,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
     double tmp1;
     emcmot_comp_entry_t *comp_entry;
     char issue_atspeed = 0;
+    EmcPose start;
     static int once = 1;
 
     check_stuff ( "before command_handler()" );
@@ -939,6 +1142,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                 emcmotStatus->atspeed_next_feed = 1;
             }
 	    /* append it to the emcmotDebug->tp */
+	    start = emcmotDebug->tp.goalPos;
 	    emcmotConfig->vtp->tpSetId(&emcmotDebug->tp, emcmotCommand->id);
 	    int res_addline = emcmotConfig->vtp->tpAddLine(&emcmotDebug->tp,
 							   emcmotCommand->pos,
@@ -955,6 +1159,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                     emcmotCommand->id, res_addline);
             emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
             emcmotConfig->vtp->tpAbort(&emcmotDebug->tp);
+            limit_check_flush();
             SET_MOTION_ERROR_FLAG(1);
             break;
         } else if (res_addline != 0) {
@@ -965,6 +1170,9 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                 emcmotStatus->atspeed_next_feed = 1;
             }
         } else {
+		queue_limit_check("Linear", emcmotCommand->id, start,
+				  emcmotCommand->pos, NULL, NULL, 0,
+				  NULL);
 		SET_MOTION_ERROR_FLAG(0);
 		/* set flag that indicates all joints need rehoming, if any
 		   joint is moved in joint mode, for machines with no forward
@@ -1002,6 +1210,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                 emcmotStatus->atspeed_next_feed = 0;
             }
 	    /* append it to the emcmotDebug->queue */
+	    start = emcmotQueue->goalPos;
 	    emcmotConfig->vtp->tpSetId(emcmotQueue, emcmotCommand->id);
 
 	    int res_addcircle = 
@@ -1028,6 +1237,71 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                 emcmotStatus->atspeed_next_feed = 1;
             }
         } else {
+		queue_limit_check("Circular", emcmotCommand->id, start,
+				  emcmotCommand->pos,
+				  &emcmotCommand->center,
+				  &emcmotCommand->normal,
+				  emcmotCommand->turn, NULL);
+		SET_MOTION_ERROR_FLAG(0);
+		/* set flag that indicates all joints need rehoming, if any
+		   joint is moved in joint mode, for machines with no forward
+		   kins */
+		rehomeAll = 1;
+	    }
+	    break;
+
+	case EMCMOT_SET_SPLINE:
+	    /* emcmotDebug->tp up a cubic spline move */
+	    /* requires coordinated mode, enable on, not on limits */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SPLINE");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError
+		    (_("need to be enabled, in coord mode for spline move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Spline")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do spline move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+            if(emcmotStatus->atspeed_next_feed) {
+                issue_atspeed = 1;
+                emcmotStatus->atspeed_next_feed = 0;
+            }
+	    /* append it to the emcmotDebug->queue */
+	    start = emcmotQueue->goalPos;
+	    emcmotConfig->vtp->tpSetId(emcmotQueue, emcmotCommand->id);
+
+	    int res_addspline =
+		emcmotConfig->vtp->tpAddSpline(emcmotQueue, emcmotCommand->pos,
+                            emcmotCommand->control[0], emcmotCommand->control[1],
+                            emcmotCommand->motion_type,
+                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
+                            emcmotCommand->acc, emcmotStatus->enables_new,
+                            issue_atspeed, emcmotCommand->tag);
+        if (res_addspline < 0) {
+            reportError(_("can't add spline move at line %d, error code %d"),
+                    emcmotCommand->id, res_addspline);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+        } else if (res_addspline != 0) {
+            if (issue_atspeed) {
+                emcmotStatus->atspeed_next_feed = 1;
+            }
+        } else {
+		queue_limit_check("Spline", emcmotCommand->id, start,
+				  emcmotCommand->pos, NULL, NULL, 0,
+				  emcmotCommand->control);
 		SET_MOTION_ERROR_FLAG(0);
 		/* set flag that indicates all joints need rehoming, if any
 		   joint is moved in joint mode, for machines with no forward
@@ -1724,6 +1998,21 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 		comp_entry[0].rev_trim = comp_entry[1].rev_trim;
 	    }
 	    joint->comp.entries++;
+	    /* keep track of even spacing, so the controller can index
+	       the table directly instead of searching it */
+	    n = joint->comp.entries;
+	    comp_entry = joint->comp.array;
+	    if (n == 2) {
+		joint->comp.uniform = 1;
+		joint->comp.inv_step =
+		    1.0 / (comp_entry[2].nominal - comp_entry[1].nominal);
+	    } else if (n > 2 && joint->comp.uniform) {
+		tmp1 = (comp_entry[n].nominal - comp_entry[n-1].nominal) *
+		    joint->comp.inv_step;
+		if (rtapi_fabs(tmp1 - 1.0) > 1e-6) {
+		    joint->comp.uniform = 0;
+		}
+	    }
 	    break;
 
         case EMCMOT_SET_OFFSET:
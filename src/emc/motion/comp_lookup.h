@@ -0,0 +1,72 @@
+/********************************************************************
+* Description: comp_lookup.h
+*   Interval lookup in the leadscrew compensation table of a joint,
+*   used by compute_screw_comp() in control.c.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+#ifndef COMP_LOOKUP_H
+#define COMP_LOOKUP_H
+
+#include "motion.h"
+
+/* comp_lookup() returns the entry of the interval 'pos' is in.  The
+   current entry and its neighbours are tried first, that is where the
+   joint is in all but the first cycle of a move.  After a jump, evenly
+   spaced tables are indexed directly, others are bisected.  The table
+   has sentinels at -DBL_MAX and +DBL_MAX, so the result is always one
+   of array[0] .. array[entries], also for +-inf and NaN.
+*/
+static inline emcmot_comp_entry_t *comp_lookup(emcmot_comp_t *comp,
+					       double pos)
+{
+    emcmot_comp_entry_t *e = comp->entry, *a = comp->array;
+    double idx;
+    int lo, hi, mid;
+
+    if (pos >= e->nominal) {
+	if (pos < (e+1)->nominal) {
+	    return e;
+	}
+	/* e+2 is past the upper sentinel when e is the last entry */
+	if (e < a + comp->entries && pos < (e+2)->nominal) {
+	    return e+1;
+	}
+    } else if (e > a && pos >= (e-1)->nominal) {
+	return e-1;
+    }
+    if (pos < a[1].nominal) {
+	return a;
+    }
+    if (comp->uniform) {
+	/* clamp before the cast, a position far off the table does not
+	   fit an int */
+	idx = (pos - a[1].nominal) * comp->inv_step;
+	if (!(idx < comp->entries - 1)) {
+	    idx = comp->entries - 1;
+	}
+	lo = 1 + (int) idx;
+	/* rounding can put it one off */
+	while (lo > 1 && pos < a[lo].nominal) {
+	    lo--;
+	}
+	while (lo < comp->entries && pos >= a[lo+1].nominal) {
+	    lo++;
+	}
+	return a + lo;
+    }
+    lo = 1;
+    hi = comp->entries + 1;
+    while (hi - lo > 1) {
+	mid = (lo + hi) / 2;
+	if (pos >= a[mid].nominal) {
+	    lo = mid;
+	} else {
+	    hi = mid;
+	}
+    }
+    return a + lo;
+}
+
+#endif /* COMP_LOOKUP_H */
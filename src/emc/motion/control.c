@@ -19,6 +19,8 @@
 #include "emcmotglb.h"
 #include "motion.h"
 #include "mot_priv.h"
+#include "volcomp.h"
+#include "comp_lookup.h"
 #include "rtapi_math.h"
 #include "tp.h"
 #include "tc.h"
@@ -29,6 +31,8 @@
 #define _(s) (s)
 
 extern int abort_and_switchback(void); // command.c
+extern void check_queued_limits(void); // command.c
+extern void limit_check_flush(void); // command.c
 
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
@@ -316,6 +320,8 @@ extern int emcmotController(void *arg,  const hal_funct_args_t *fa)
 check_stuff ( "before process_inputs()" );
     process_inputs();
 check_stuff ( "after process_inputs()" );
+    volcomp_update(emcmot_hal_data->volcomp_enable, GET_MOTION_ENABLE_FLAG());
+check_stuff ( "after volcomp_update()" );
     do_forward_kins();
 check_stuff ( "after do_forward_kins()" );
     process_probe_inputs();
@@ -332,6 +338,8 @@ check_stuff ( "after do_homing_sequence()" );
 check_stuff ( "after do_homing()" );
     get_pos_cmds(period);
 check_stuff ( "after get_pos_cmds()" );
+    check_queued_limits();
+check_stuff ( "after check_queued_limits()" );
     compute_screw_comp();
 check_stuff ( "after compute_screw_comp()" );
     output_to_hal();
@@ -888,7 +896,7 @@ static void do_forward_kins(void)
     switch (kinType) {
 
     case KINEMATICS_IDENTITY:
-	emcmotConfig->vtk->kinematicsForward(joint_pos, &emcmotStatus->carte_pos_fb, &fflags,
+	volcompForward(joint_pos, &emcmotStatus->carte_pos_fb, &fflags,
 	    &iflags);
 	if (checkAllHomed()) {
 	    emcmotStatus->carte_pos_fb_ok = 1;
@@ -906,7 +914,7 @@ static void do_forward_kins(void)
 	    }
 	    /* calculate Cartesean position feedback from joint pos fb */
 	    result =
-		emcmotConfig->vtk->kinematicsForward(joint_pos, &emcmotStatus->carte_pos_fb,
+		volcompForward(joint_pos, &emcmotStatus->carte_pos_fb,
 		&fflags, &iflags);
 	    /* check to make sure kinematics converged */
 	    if (result < 0) {
@@ -1012,6 +1020,7 @@ static void set_operating_mode(void)
     if (!emcmotDebug->enabling && GET_MOTION_ENABLE_FLAG()) {
 	/* clear out the motion emcmotDebug->queue and interpolators */
 	emcmotConfig->vtp->tpClear(emcmotQueue);
+	limit_check_flush();
 	for (joint_num = 0; joint_num < num_joints; joint_num++) {
 	    /* point to joint data */
 	    joint = &joints[joint_num];
@@ -1420,7 +1429,7 @@ static void get_pos_cmds(long period)
 	switch (kinType) {
 
 	case KINEMATICS_IDENTITY:
-	    emcmotConfig->vtk->kinematicsForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
+	    volcompForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
 	    if (checkAllHomed()) {
 		emcmotStatus->carte_pos_cmd_ok = 1;
 	    } else {
@@ -1437,7 +1446,7 @@ static void get_pos_cmds(long period)
 		}
 		/* calculate Cartesean position command from joint coarse pos cmd */
 		result =
-		    emcmotConfig->vtk->kinematicsForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
+		    volcompForward(positions, &emcmotStatus->carte_pos_cmd, &fflags, &iflags);
 		/* check to make sure kinematics converged */
 		if (result < 0) {
 		    /* error during kinematics calculations */
@@ -1472,7 +1481,7 @@ static void get_pos_cmds(long period)
 	    emcmotConfig->vtp->tpGetPos(emcmotQueue, &emcmotStatus->carte_pos_cmd);
 
 	    /* OUTPUT KINEMATICS - convert to joints in local array */
-	    emcmotConfig->vtk->kinematicsInverse(&emcmotStatus->carte_pos_cmd, positions,
+	    volcompInverse(&emcmotStatus->carte_pos_cmd, positions,
 						 &iflags, &fflags);
 	    /* copy to joint structures and spline them up */
 	    for (joint_num = 0; joint_num < num_joints; joint_num++) {
@@ -1615,7 +1624,7 @@ static void get_pos_cmds(long period)
 	    to compute the next positions of the joints */
 
 	/* OUTPUT KINEMATICS - convert to joints in local array */
-	emcmotConfig->vtk->kinematicsInverse(&emcmotStatus->carte_pos_cmd, positions,
+	volcompInverse(&emcmotStatus->carte_pos_cmd, positions,
 	    &iflags, &fflags);
 	/* copy to joint structures and spline them up */
 	for (joint_num = 0; joint_num < num_joints; joint_num++) {
@@ -1790,6 +1799,7 @@ Their exact contents and meaning are as follows:
 
 static void compute_screw_comp(void)
 {
+    long long int start = rtapi_get_time();
     int joint_num;
     emcmot_joint_t *joint;
     emcmot_comp_t *comp;
@@ -1810,12 +1820,7 @@ static void compute_screw_comp(void)
 	if ( comp->entries > 0 ) {
 	    /* there is data in the comp table, use it */
 	    /* first make sure we're in the right spot in the table */
-	    while ( joint->pos_cmd < comp->entry->nominal ) {
-		comp->entry--;
-	    }
-	    while ( joint->pos_cmd >= (comp->entry+1)->nominal ) {
-		comp->entry++;
-	    }
+	    comp->entry = comp_lookup(comp, joint->pos_cmd);
 	    /* now interpolate */
 	    dpos = joint->pos_cmd - comp->entry->nominal;
 	    if (joint->vel_cmd > 0.0) {
@@ -1970,6 +1975,10 @@ static void compute_screw_comp(void)
         /* backlash (and motor offset) will be applied to output later */
         /* end of joint loop */
     }
+    emcmot_hal_data->comp_time = rtapi_get_time() - start;
+    if (emcmot_hal_data->comp_time > emcmot_hal_data->comp_max_time) {
+	emcmot_hal_data->comp_max_time = emcmot_hal_data->comp_time;
+    }
 }
 
 /*! \todo FIXME - once the HAL refactor is done so that metadata isn't stored
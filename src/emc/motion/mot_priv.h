@@ -172,6 +172,19 @@ typedef struct {
     hal_u32_t last_period;	/* param: last period in clocks */
     hal_float_t last_period_ns;	/* param: last period in nanoseconds */
     hal_u32_t overruns;		/* param: count of RT overruns */
+    hal_s32_t comp_time;	/* param: screw comp time, ns */
+    hal_s32_t comp_max_time;	/* param: max screw comp time, ns */
+
+    // volumetric comp, see volcomp.c
+    hal_bit_t volcomp_enable;	/* param: apply the grid */
+    hal_bit_t volcomp_active;	/* param: grid is being applied */
+    hal_s32_t volcomp_time;	/* param: correction time per cycle, ns */
+    hal_s32_t volcomp_max_time;	/* param: max of volcomp_time, ns */
+
+    // queued move limit check, see command.c
+    hal_s32_t limit_check_samples;	/* param: interior points per move */
+    hal_s32_t limit_check_budget;	/* param: points checked per cycle */
+    hal_s32_t limit_check_skipped;	/* param: moves that found the ring full */
 
     hal_float_t *tooloffset_x;
     hal_float_t *tooloffset_y;
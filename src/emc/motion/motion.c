@@ -19,11 +19,12 @@
 #include "motion_debug.h"
 #include "motion_struct.h"
 #include "mot_priv.h"
+#include "volcomp.h"
 #include "rtapi_math.h"
 
 // vtable signatures
-#define VTKINS_VERSION VTKINEMATICS_VERSION1
-#define VTP_VERSION    VTTP_VERSION1
+#define VTKINS_VERSION VTKINEMATICS_VERSION2
+#define VTP_VERSION    VTTP_VERSION2
 
 // Mark strings for translation, but defer translation to userspace
 #define _(s) (s)
@@ -70,6 +71,8 @@ static char *kins = "trivkins";
 RTAPI_MP_STRING(kins, "kinematics vtable name");
 static char *tp = "tp";
 RTAPI_MP_STRING(tp, "tp vtable name");
+static int volcomp_nodes = 0;		/* volumetric comp grid size, 0 = none */
+RTAPI_MP_INT(volcomp_nodes, "max nodes of the volumetric comp grid");
 
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
@@ -250,6 +253,14 @@ int rtapi_app_main(void)
 	return -1;
     }
 
+    /* shared memory for the volumetric comp grid, if configured */
+    retval = volcomp_init(mot_comp_id, volcomp_nodes);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, _("MOTION: volcomp_init() failed\n"));
+	hal_exit(mot_comp_id);
+	return -1;
+    }
+
     /* set up for realtime execution of code */
     retval = init_threads();
     if (retval != 0) {
@@ -288,6 +299,7 @@ void rtapi_app_exit(void)
     hal_unreference_vtable(emcmotConfig->tp_vid);
 
     /* free shared memory */
+    volcomp_exit(mot_comp_id);
     retval = rtapi_shmem_delete(emc_shmem_id, mot_comp_id);
     if (retval < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -567,6 +579,51 @@ static int init_hal_io(void)
     if (retval != 0) {
 	return retval;
     }
+    retval =
+	hal_param_s32_new("motion.servo.comp-time", HAL_RO, &(emcmot_hal_data->comp_time), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.servo.comp-max-time", HAL_RW, &(emcmot_hal_data->comp_max_time), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_bit_new("motion.volcomp.enable", HAL_RW, &(emcmot_hal_data->volcomp_enable), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_bit_new("motion.volcomp.active", HAL_RO, &(emcmot_hal_data->volcomp_active), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.volcomp.time", HAL_RO, &(emcmot_hal_data->volcomp_time), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.volcomp.max-time", HAL_RW, &(emcmot_hal_data->volcomp_max_time), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.limit-check-samples", HAL_RW, &(emcmot_hal_data->limit_check_samples), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.limit-check-budget", HAL_RW, &(emcmot_hal_data->limit_check_budget), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
+    retval =
+	hal_param_s32_new("motion.limit-check-skipped", HAL_RW, &(emcmot_hal_data->limit_check_skipped), mot_comp_id);
+    if (retval != 0) {
+	return retval;
+    }
 
     retval = hal_pin_float_new("motion.tooloffset.x", HAL_OUT, &(emcmot_hal_data->tooloffset_x), mot_comp_id);
     if (retval != 0) {
@@ -683,6 +740,15 @@ static int init_hal_io(void)
 
     emcmot_hal_data->overruns = 0;
     emcmot_hal_data->last_period = 0;
+    emcmot_hal_data->comp_time = 0;
+    emcmot_hal_data->comp_max_time = 0;
+    emcmot_hal_data->volcomp_enable = 0;
+    emcmot_hal_data->volcomp_active = 0;
+    emcmot_hal_data->volcomp_time = 0;
+    emcmot_hal_data->volcomp_max_time = 0;
+    emcmot_hal_data->limit_check_samples = 0;
+    emcmot_hal_data->limit_check_budget = 4;
+    emcmot_hal_data->limit_check_skipped = 0;
 
     /* export joint pins and parameters */
     for (n = 0; n < num_joints; n++) {
@@ -1085,7 +1151,10 @@ static int init_comm_buffers(void)
 	joint->backlash = 0.0;
 
 	joint->comp.entries = 0;
+	joint->comp.array = emcmotStruct->comp_array[joint_num];
 	joint->comp.entry = &(joint->comp.array[0]);
+	joint->comp.uniform = 0;
+	joint->comp.inv_step = 0.0;
 	/* the compensation code has -DBL_MAX at one end of the table
 	   and +DBL_MAX at the other so _all_ commanded positions are
 	   guaranteed to be covered by the table */
@@ -178,6 +178,7 @@ extern "C" {
     EMCMOT_SET_OFFSET = 61,               /* set tool offsets */
     EMCMOT_SET_MAX_FEED_OVERRIDE = 62,
     EMCMOT_SETUP_ARC_BLENDS = 63,
+    EMCMOT_SET_SPLINE = 64,               /* queue up a cubic spline move */
     } cmd_code_t;
 
 /* this enum lists the possible results of a command */
@@ -212,6 +213,7 @@ extern "C" {
 	EmcPose pos;		/* line/circle endpt, or teleop vector */
 	PmCartesian center;	/* center for circle */
 	PmCartesian normal;	/* normal vec for circle */
+	PmCartesian control[2];	/* inner control points for spline */
 	int turn;		/* turns for circle or which rotary to unlock for a line */
 	double vel;		/* max velocity */
         double ini_maxvel;      /* max velocity allowed by machine
@@ -395,12 +397,13 @@ Suggestion: Split this in to an Error and a Status flag register..
     } emcmot_comp_entry_t; 
 
 
-#define EMCMOT_COMP_SIZE 256
+#define EMCMOT_COMP_SIZE 1024
     typedef struct {
 	int entries;		/* number of entries in the array */
 	emcmot_comp_entry_t *entry;  /* current entry in array */
-	emcmot_comp_entry_t array[EMCMOT_COMP_SIZE+2];
-	/* +2 because array has -HUGE_VAL and +HUGE_VAL entries at the ends */
+	int uniform;		/* non-zero if entries are evenly spaced */
+	double inv_step;	/* 1/spacing, if evenly spaced */
+	emcmot_comp_entry_t *array;	/* in emcmot_struct_t.comp_array */
     } emcmot_comp_t;
 
 /* motion controller states */
@@ -25,6 +25,10 @@
 	struct emcmot_error_t error;	/* ring buffer for error messages */
 	struct emcmot_debug_t debug;	/* Struct used to store RT status and debug
 				   data - 2nd largest block */
+	/* leadscrew comp tables, here rather than in the joints, which
+	   are in HAL memory; +2 because each table has -DBL_MAX and
+	   +DBL_MAX entries at the ends */
+	emcmot_comp_entry_t comp_array[EMCMOT_MAX_JOINTS][EMCMOT_COMP_SIZE+2];
     } emcmot_struct_t;
 
 
@@ -0,0 +1,223 @@
+/********************************************************************
+* Description: volcomp.c
+*   Volumetric (3D grid) error compensation.  A correction of the
+*   x, y, z position, interpolated trilinearly in a grid of measured
+*   errors, is added to the commanded position before the inverse
+*   kinematics, and removed from the feedback after the forward
+*   kinematics.  All Cartesian positions seen by the TP, teleop and
+*   task stay nominal, so switching modes does not jump.
+*
+*   The grid is loaded into shared memory by the 'volcomp' program,
+*   see volcomp.h.  Each correction reads the same eight nodes and
+*   does the same arithmetic, wherever the position is, so the cost
+*   per cycle is fixed; motion.volcomp.time reports it, summed over
+*   the forward and inverse corrections of a servo cycle.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+#include "rtapi_mbarrier.h"
+#include "hal.h"
+#include "motion.h"
+#include "mot_priv.h"
+#include "volcomp.h"
+
+static int shmem_id = -1;
+static volcomp_shmem_t *vc = 0;
+
+/* grid as picked up while motion was disabled */
+static int active = 0;
+static int num[3];
+static double origin[3];
+static double inv_step[3];
+
+/* correction time of the servo cycle in progress, ns */
+static long long cycle_time = 0;
+
+int volcomp_init(int comp_id, int max_nodes)
+{
+    void *ptr;
+    int retval;
+
+    if (max_nodes <= 0) {
+	/* not configured */
+	return 0;
+    }
+    shmem_id = rtapi_shmem_new(VOLCOMP_SHMEM_KEY, comp_id,
+			       sizeof(volcomp_shmem_t) +
+			       max_nodes * sizeof(vc->corr[0]));
+    if (shmem_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: volcomp rtapi_shmem_new failed, returned %d\n", shmem_id);
+	return -1;
+    }
+    retval = rtapi_shmem_getptr(shmem_id, &ptr, 0);
+    if (retval < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: volcomp rtapi_shmem_getptr failed, returned %d\n", retval);
+	rtapi_shmem_delete(shmem_id, comp_id);
+	shmem_id = -1;
+	return -1;
+    }
+    vc = ptr;
+    memset(vc, 0, sizeof(volcomp_shmem_t));
+    vc->max_nodes = max_nodes;
+    vc->magic = VOLCOMP_SHMEM_MAGIC;
+    return 0;
+}
+
+void volcomp_exit(int comp_id)
+{
+    if (shmem_id >= 0) {
+	rtapi_shmem_delete(shmem_id, comp_id);
+    }
+    shmem_id = -1;
+    vc = 0;
+    active = 0;
+}
+
+/* checks the grid header, and copies what the interpolation needs */
+static int volcomp_latch(void)
+{
+    volcomp_hdr_t *g = &vc->grid;
+    int n;
+
+    num[0] = g->nx;
+    num[1] = g->ny;
+    num[2] = g->nz;
+    for (n = 0; n < 3; n++) {
+	if (num[n] < 2 || num[n] > (int) vc->max_nodes || g->step[n] <= 0.0) {
+	    return 0;
+	}
+	origin[n] = g->origin[n];
+	inv_step[n] = 1.0 / g->step[n];
+    }
+    if ((long long) num[0] * num[1] * num[2] > vc->max_nodes) {
+	return 0;
+    }
+    return 1;
+}
+
+void volcomp_update(int enable, int motion_enabled)
+{
+    /* called first thing in the cycle, publish the last one */
+    emcmot_hal_data->volcomp_time = cycle_time;
+    if (emcmot_hal_data->volcomp_time > emcmot_hal_data->volcomp_max_time) {
+	emcmot_hal_data->volcomp_max_time = emcmot_hal_data->volcomp_time;
+    }
+    cycle_time = 0;
+    if (vc == 0) {
+	active = 0;
+	emcmot_hal_data->volcomp_active = 0;
+	return;
+    }
+    if (vc->request) {
+	/* the loader wants to write the grid; let go of it, but only
+	   while disabled, and stay off it until the load is done */
+	if (!motion_enabled || vc->ack) {
+	    active = 0;
+	    rtapi_smp_mb();
+	    vc->ack = 1;
+	}
+    } else {
+	vc->ack = 0;
+	if (!motion_enabled) {
+	    /* safe to switch grids, or to switch the comp on or off */
+	    rtapi_smp_mb();
+	    active = enable && vc->valid && volcomp_latch();
+	}
+    }
+    vc->in_use = active && motion_enabled;
+    emcmot_hal_data->volcomp_active = active;
+}
+
+/* trilinear interpolation, positions outside of the grid get the
+   correction at the nearest point on its boundary */
+static void volcomp_correction(const PmCartesian *p, PmCartesian *d)
+{
+    double pos[3], t[3], f, c[3];
+    int i[3], n, base, dy, dz;
+    float (*a)[3] = vc->corr;
+
+    pos[0] = p->x;
+    pos[1] = p->y;
+    pos[2] = p->z;
+    for (n = 0; n < 3; n++) {
+	f = (pos[n] - origin[n]) * inv_step[n];
+	f = (f < 0.0) ? 0.0 : f;
+	f = (f > num[n] - 1) ? num[n] - 1 : f;
+	i[n] = (int) f;
+	i[n] = (i[n] > num[n] - 2) ? num[n] - 2 : i[n];
+	t[n] = f - i[n];
+    }
+    dy = num[0];
+    dz = num[0] * num[1];
+    base = i[2] * dz + i[1] * dy + i[0];
+    for (n = 0; n < 3; n++) {
+	double c00 = a[base][n] + t[0] * (a[base + 1][n] - a[base][n]);
+	double c10 = a[base + dy][n] +
+	    t[0] * (a[base + dy + 1][n] - a[base + dy][n]);
+	double c01 = a[base + dz][n] +
+	    t[0] * (a[base + dz + 1][n] - a[base + dz][n]);
+	double c11 = a[base + dy + dz][n] +
+	    t[0] * (a[base + dy + dz + 1][n] - a[base + dy + dz][n]);
+	double c0 = c00 + t[1] * (c10 - c00);
+	double c1 = c01 + t[1] * (c11 - c01);
+	c[n] = c0 + t[2] * (c1 - c0);
+    }
+    d->x = c[0];
+    d->y = c[1];
+    d->z = c[2];
+}
+
+int volcompInverse(const EmcPose * world, double *joint,
+		   const KINEMATICS_INVERSE_FLAGS * iflags,
+		   KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    EmcPose pos;
+    PmCartesian d;
+    long long start;
+
+    if (!active) {
+	return emcmotConfig->vtk->kinematicsInverse(world, joint, iflags, fflags);
+    }
+    start = rtapi_get_time();
+    pos = *world;
+    volcomp_correction(&pos.tran, &d);
+    pos.tran.x += d.x;
+    pos.tran.y += d.y;
+    pos.tran.z += d.z;
+    cycle_time += rtapi_get_time() - start;
+    return emcmotConfig->vtk->kinematicsInverse(&pos, joint, iflags, fflags);
+}
+
+int volcompForward(const double *joint, EmcPose * world,
+		   const KINEMATICS_FORWARD_FLAGS * fflags,
+		   KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    PmCartesian actual, nominal, d;
+    int retval, n;
+    long long start;
+
+    retval = emcmotConfig->vtk->kinematicsForward(joint, world, fflags, iflags);
+    if (!active || retval < 0) {
+	return retval;
+    }
+    start = rtapi_get_time();
+    /* solve nominal + corr(nominal) = actual; the correction varies
+       slowly, two fixed point steps are plenty */
+    actual = world->tran;
+    nominal = actual;
+    for (n = 0; n < 2; n++) {
+	volcomp_correction(&nominal, &d);
+	nominal.x = actual.x - d.x;
+	nominal.y = actual.y - d.y;
+	nominal.z = actual.z - d.z;
+    }
+    world->tran = nominal;
+    cycle_time += rtapi_get_time() - start;
+    return retval;
+}
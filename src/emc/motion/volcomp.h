@@ -0,0 +1,83 @@
+/********************************************************************
+* Description: volcomp.h
+*   Volumetric (3D grid) error compensation of the motion controller:
+*   grid file format and the shared memory that connects the motion
+*   module to the 'volcomp' loader.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+#ifndef VOLCOMP_H
+#define VOLCOMP_H
+
+#include "rtapi_shmkeys.h"
+
+/* grid file, built offline from the measured errors
+
+   the file starts with a volcomp_hdr_t, followed by nx * ny * nz
+   nodes of three floats each: the dx, dy, dz correction at that node,
+   in machine units, host byte order.  x varies fastest, so node
+   (i, j, k) is at (k * ny + j) * nx + i, and is located at
+   origin + (i, j, k) * step.  The correction is added to the
+   commanded position before the inverse kinematics.
+*/
+
+#define VOLCOMP_HDR_MAGIC	"VOLCOMP"
+#define VOLCOMP_HDR_VERSION	1
+
+typedef struct {
+    char magic[8];		/* VOLCOMP_HDR_MAGIC */
+    __u32 version;		/* VOLCOMP_HDR_VERSION */
+    __u32 nx, ny, nz;		/* nodes per axis, at least 2 */
+    double origin[3];		/* position of node (0, 0, 0) */
+    double step[3];		/* node spacing, positive */
+} volcomp_hdr_t;
+
+/* the shared memory is created by motmod when it is loaded with
+   volcomp_nodes=N, and holds up to N nodes.  Loading is a handshake:
+
+   - 'volcomp' sets 'request' and waits for 'ack'
+   - motmod, once it sees 'request' while motion is disabled, stops
+     using the grid and sets 'ack'; while motion is enabled it goes
+     on applying the grid and does not answer
+   - after 'ack', 'volcomp' clears 'valid', copies the grid, sets
+     'valid' again and clears 'request'
+   - motmod clears 'ack', and picks up the grid the next time it
+     is disabled
+
+   'in_use' only reports whether motmod is applying a grid.
+*/
+
+#define VOLCOMP_SHMEM_MAGIC	0x564F4C43	/* "VOLC" */
+
+typedef struct {
+    __u32 magic;		/* VOLCOMP_SHMEM_MAGIC, set by motmod */
+    __u32 max_nodes;		/* capacity, set by motmod */
+    volatile __u32 valid;	/* grid is complete */
+    volatile __u32 request;	/* set by the loader before it writes */
+    volatile __u32 ack;		/* set by motmod, grid is released */
+    volatile __u32 in_use;	/* motmod is applying the grid */
+    volatile __u32 generation;	/* bumped by each load */
+    volcomp_hdr_t grid;
+    float corr[][3];
+} volcomp_shmem_t;
+
+#ifndef ULAPI
+#include "posemath.h"
+#include "kinematics.h"
+
+extern int volcomp_init(int comp_id, int max_nodes);
+extern void volcomp_exit(int comp_id);
+/* picks up a new grid while motion is disabled, call each cycle */
+extern void volcomp_update(int enable, int motion_enabled);
+/* kinematics with the correction applied, same arguments as the
+   kinematicsForward()/kinematicsInverse() of the kins module */
+extern int volcompInverse(const EmcPose * world, double *joint,
+			  const KINEMATICS_INVERSE_FLAGS * iflags,
+			  KINEMATICS_FORWARD_FLAGS * fflags);
+extern int volcompForward(const double *joint, EmcPose * world,
+			  const KINEMATICS_FORWARD_FLAGS * fflags,
+			  KINEMATICS_INVERSE_FLAGS * iflags);
+#endif
+
+#endif /* VOLCOMP_H */
@@ -0,0 +1,288 @@
+/********************************************************************
+* Description:  volcomp_usr.c
+*               Loads a volumetric compensation grid into the
+*               shared memory of the motion module.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** 'volcomp' copies a grid file, as described in volcomp.h, into the
+    shared memory that motmod creates when it is loaded with
+    volcomp_nodes=N.  The motion module picks the grid up the next
+    time it is disabled and motion.volcomp.enable is set.
+
+    Invoking:
+
+    volcomp [-N name] file	load 'file'
+    volcomp [-N name] -c	clear the grid
+    volcomp [-N name] -i	print the loaded grid's header
+
+    Loading or clearing asks the motion module to release the grid,
+    which it only does while it is disabled, and gives up after
+    -t seconds (default 1) if the machine stays on.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "volcomp.h"
+
+int comp_id = -1;	/* -1 means hal_init() not called yet */
+int shmem_id = -1;
+int exitval = 1;	/* program return code - 1 means error */
+int ignore_sig = 0;	/* used to flag critical regions */
+char comp_name[HAL_NAME_LEN+1];
+volcomp_shmem_t *requested = NULL;	/* grid release asked for */
+
+/* signal handler */
+static void quit(int sig)
+{
+    if ( ignore_sig ) {
+	return;
+    }
+    if ( requested != NULL ) {
+	requested->request = 0;
+    }
+    if ( shmem_id >= 0 ) {
+	rtapi_shmem_delete(shmem_id, comp_id);
+    }
+    if ( comp_id >= 0 ) {
+	hal_exit(comp_id);
+    }
+    exit(exitval);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: volcomp [-N name] [-t secs] file | -c | -i\n");
+}
+
+/* asks motion to let go of the grid, returns 0 once it has */
+static int request_grid(volcomp_shmem_t *vc, double timeout)
+{
+    struct timespec ts = { 0, 10 * 1000 * 1000 };
+    int n;
+
+    requested = vc;
+    vc->request = 1;
+    __sync_synchronize();
+    for ( n = 0 ; n * 0.01 < timeout ; n++ ) {
+	if ( vc->ack ) {
+	    __sync_synchronize();
+	    return 0;
+	}
+	nanosleep(&ts, NULL);
+    }
+    vc->request = 0;
+    requested = NULL;
+    return -1;
+}
+
+static void print_grid(const volcomp_hdr_t *g)
+{
+    printf("%u x %u x %u nodes, origin %g %g %g, step %g %g %g\n",
+	   g->nx, g->ny, g->nz, g->origin[0], g->origin[1], g->origin[2],
+	   g->step[0], g->step[1], g->step[2]);
+}
+
+/* maps 'fname' and checks the header, returns the mapping or NULL */
+static const volcomp_hdr_t *map_grid(const char *fname, size_t *len,
+				     unsigned max_nodes)
+{
+    const volcomp_hdr_t *g;
+    struct stat st;
+    unsigned long long nodes;
+    void *p;
+    int fd, n;
+
+    fd = open(fname, O_RDONLY);
+    if ( fd < 0 ) {
+	fprintf(stderr, "ERROR: can't open grid file '%s'\n", fname);
+	return NULL;
+    }
+    if ( fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(volcomp_hdr_t) ) {
+	fprintf(stderr, "ERROR: '%s' is too short for a grid file\n", fname);
+	close(fd);
+	return NULL;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( p == MAP_FAILED ) {
+	fprintf(stderr, "ERROR: can't map grid file '%s'\n", fname);
+	return NULL;
+    }
+    *len = st.st_size;
+    g = p;
+    if ( memcmp(g->magic, VOLCOMP_HDR_MAGIC, sizeof(VOLCOMP_HDR_MAGIC)) != 0 ||
+	 g->version != VOLCOMP_HDR_VERSION ) {
+	fprintf(stderr, "ERROR: '%s' is not a version %d grid file\n",
+		fname, VOLCOMP_HDR_VERSION);
+	goto bad;
+    }
+    if ( g->nx < 2 || g->ny < 2 || g->nz < 2 ) {
+	fprintf(stderr, "ERROR: grid needs at least 2 nodes per axis\n");
+	goto bad;
+    }
+    for ( n = 0 ; n < 3 ; n++ ) {
+	if ( !(g->step[n] > 0.0) ) {
+	    fprintf(stderr, "ERROR: grid step must be positive\n");
+	    goto bad;
+	}
+    }
+    nodes = (unsigned long long)g->nx * g->ny * g->nz;
+    if ( nodes > max_nodes ) {
+	fprintf(stderr, "ERROR: grid has %llu nodes, motmod was loaded "
+		"with volcomp_nodes=%u\n", nodes, max_nodes);
+	goto bad;
+    }
+    if ( *len < sizeof(volcomp_hdr_t) + nodes * 3 * sizeof(float) ) {
+	fprintf(stderr, "ERROR: '%s' is truncated\n", fname);
+	goto bad;
+    }
+    return g;
+bad:
+    munmap(p, *len);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    volcomp_shmem_t *vc;
+    const volcomp_hdr_t *g = NULL;
+    size_t len = 0;
+    unsigned long size;
+    char *name = NULL, *fname = NULL;
+    int clear = 0, info = 0;
+    double timeout = 1.0;
+    void *shmem_ptr;
+    int opt, retval;
+
+    while ( (opt = getopt(argc, argv, "N:t:ci")) != -1 ) {
+	switch ( opt ) {
+	case 'N':
+	    name = optarg;
+	    break;
+	case 't':
+	    timeout = atof(optarg);
+	    break;
+	case 'c':
+	    clear = 1;
+	    break;
+	case 'i':
+	    info = 1;
+	    break;
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if ( optind < argc ) {
+	fname = argv[optind];
+    }
+    if ( (fname != NULL) + clear + info != 1 ) {
+	usage();
+	exit(1);
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+
+    if ( name == NULL ) {
+	snprintf(comp_name, sizeof(comp_name), "volcomp%d", getpid());
+	name = comp_name;
+    }
+    ignore_sig = 1;
+    comp_id = hal_init(name);
+    ignore_sig = 0;
+    if ( comp_id < 0 ) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id);
+	goto out;
+    }
+    hal_ready(comp_id);
+
+    /* attach only, motmod creates the segment */
+    shmem_id = rtapi_shmem_new(VOLCOMP_SHMEM_KEY, comp_id, 0);
+    if ( shmem_id < 0 ) {
+	fprintf(stderr, "ERROR: motmod is not loaded with volcomp_nodes\n");
+	goto out;
+    }
+    retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, &size);
+    if ( retval < 0 ) {
+	fprintf(stderr, "ERROR: couldn't map user/RT shared memory\n");
+	goto out;
+    }
+    vc = shmem_ptr;
+    if ( size < sizeof(volcomp_shmem_t) || vc->magic != VOLCOMP_SHMEM_MAGIC ) {
+	fprintf(stderr, "ERROR: shared memory is not a volcomp grid\n");
+	goto out;
+    }
+    if ( (size - sizeof(volcomp_shmem_t)) / sizeof(vc->corr[0]) < vc->max_nodes ) {
+	fprintf(stderr, "ERROR: shared memory of %lu bytes is too small "
+		"for %u nodes\n", size, vc->max_nodes);
+	goto out;
+    }
+
+    if ( info ) {
+	if ( vc->valid ) {
+	    printf("grid %u: ", vc->generation);
+	    print_grid(&vc->grid);
+	} else {
+	    printf("no grid loaded\n");
+	}
+	printf("%s, capacity %u nodes\n", vc->in_use ? "in use" : "not in use",
+	       vc->max_nodes);
+	exitval = 0;
+	goto out;
+    }
+    if ( fname != NULL ) {
+	g = map_grid(fname, &len, vc->max_nodes);
+	if ( g == NULL ) {
+	    goto out;
+	}
+    }
+    if ( request_grid(vc, timeout) < 0 ) {
+	fprintf(stderr, "ERROR: motion did not release the grid, "
+		"turn the machine off first\n");
+	goto out;
+    }
+    ignore_sig = 1;
+    vc->valid = 0;
+    __sync_synchronize();
+    if ( g != NULL ) {
+	vc->grid = *g;
+	memcpy(vc->corr, g + 1,
+	       (size_t)g->nx * g->ny * g->nz * sizeof(vc->corr[0]));
+	vc->generation++;
+	__sync_synchronize();
+	vc->valid = 1;
+	printf("grid %u: ", vc->generation);
+	print_grid(g);
+    }
+    __sync_synchronize();
+    vc->request = 0;
+    requested = NULL;
+    ignore_sig = 0;
+    exitval = 0;
+
+out:
+    if ( g != NULL ) {
+	munmap((void *)g, len);
+    }
+    if ( shmem_id >= 0 ) {
+	rtapi_shmem_delete(shmem_id, comp_id);
+    }
+    if ( comp_id >= 0 ) {
+	hal_exit(comp_id);
+    }
+    return exitval;
+}
@@ -375,6 +375,9 @@ int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	((EMC_TRAJ_CIRCULAR_MOVE *) buffer)->update(cms);
 	break;
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	((EMC_TRAJ_SPLINE_MOVE *) buffer)->update(cms);
+	break;
     case EMC_TRAJ_RIGID_TAP_TYPE:
 	((EMC_TRAJ_RIGID_TAP *) buffer)->update(cms);
         break;
@@ -682,6 +685,8 @@ const char *emc_symbol_lookup(long type)
 	return "EMC_TRAJ_ABORT";
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	return "EMC_TRAJ_CIRCULAR_MOVE";
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	return "EMC_TRAJ_SPLINE_MOVE";
     case EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG_TYPE:
 	return "EMC_TRAJ_CLEAR_PROBE_TRIPPED_FLAG";
     case EMC_TRAJ_DELAY_TYPE:
@@ -1535,6 +1540,24 @@ void EMC_TRAJ_CIRCULAR_MOVE::update(CMS * cms)
 
 }
 
+/*
+*	NML/CMS Update function for EMC_TRAJ_SPLINE_MOVE
+*/
+void EMC_TRAJ_SPLINE_MOVE::update(CMS * cms)
+{
+
+    EMC_TRAJ_CMD_MSG::update(cms);
+    EmcPose_update(cms, &end);
+    cms->update(control1);
+    cms->update(control2);
+    cms->update(type);
+    cms->update(vel);
+    cms->update(ini_maxvel);
+    cms->update(acc);
+    cms->update(feed_mode);
+
+}
+
 /*
 *	NML/CMS Update function for EMC_TRAJ_SET_TERM_COND
 *	Automatically generated by NML CodeGen Java Applet.
@@ -801,6 +801,24 @@ class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
     int feed_mode;
 };
 
+// cubic Bezier curve from the current position to 'end'
+class EMC_TRAJ_SPLINE_MOVE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_SPLINE_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SPLINE_MOVE_TYPE,
+					    sizeof(EMC_TRAJ_SPLINE_MOVE)) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    EmcPose end;
+    PM_CARTESIAN control1;	// inner control points
+    PM_CARTESIAN control2;
+    int type;
+    double vel, ini_maxvel, acc;
+    int feed_mode;
+};
+
 class EMC_TRAJ_SET_TERM_COND:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_SET_TERM_COND():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SET_TERM_COND_TYPE,
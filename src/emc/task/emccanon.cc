@@ -1375,11 +1375,96 @@ biarc(int lineno, double p0x, double p0y, double tsx, double tsy,
 }
 
 
+/* A NURBS curve with k control points of order k, all of weight 1, is
+   a single Bezier curve: that is what G5 (cubic) and G5.1 (quadratic)
+   produce.  It goes to motion as one spline move, instead of a run of
+   biarcs.  Returns false if the curve is not of that kind, or has a
+   degenerate end tangent, so the caller falls back to biarcs. */
+static bool spline_feed(int lineno, std::vector<CONTROL_POINT> const &cp, unsigned int k)
+{
+    double small = 0.000001;
+    PM_CARTESIAN ctrl[4];
+
+    if ((k != 3 && k != 4) || cp.size() != k) {
+        return false;
+    }
+    for (unsigned int i = 0; i < k; i++) {
+        if (cp[i].W != 1) {
+            return false;
+        }
+    }
+
+    CANON_POSITION p = unoffset_and_unrotate_pos(canonEndPoint);
+    for (unsigned int i = 0; i < k; i++) {
+        ctrl[i] = PM_CARTESIAN(FROM_PROG_LEN(cp[i].X), FROM_PROG_LEN(cp[i].Y), p.z);
+        rotate_and_offset_xyz(ctrl[i]);
+    }
+    // the curve starts exactly where the last move ended
+    ctrl[0] = canonEndPoint.xyz();
+    if (k == 3) {
+        // raise the quadratic to a cubic with the same shape
+        ctrl[3] = ctrl[2];
+        ctrl[2] = ctrl[3] + (ctrl[1] - ctrl[3]) * (2.0 / 3.0);
+        ctrl[1] = ctrl[0] + (ctrl[1] - ctrl[0]) * (2.0 / 3.0);
+    }
+    if (mag(ctrl[1] - ctrl[0]) < small || mag(ctrl[3] - ctrl[2]) < small) {
+        return false;
+    }
+
+    // the tangent sweeps around, so use the slowest of the axes involved
+    double v_max = 0.0, a_max = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        double lo = ctrl[0][axis], hi = ctrl[0][axis];
+        for (int i = 1; i < 4; i++) {
+            lo = MIN(lo, ctrl[i][axis]);
+            hi = MAX(hi, ctrl[i][axis]);
+        }
+        if (hi - lo < small || !axis_valid(axis)) {
+            continue;
+        }
+        double v = FROM_EXT_LEN(axis_max_velocity[axis]);
+        double a = FROM_EXT_LEN(axis_max_acceleration[axis]);
+        v_max = v_max ? MIN(v_max, v) : v;
+        a_max = a_max ? MIN(a_max, a) : a;
+    }
+    if (v_max <= 0.0 || a_max <= 0.0) {
+        return false;
+    }
+
+    CANON_POSITION endpt = canonEndPoint;
+    endpt.set_xyz(ctrl[3]);
+
+    double vel = MIN(currentLinearFeedRate, v_max);
+    canon_debug("spline vel = %f, v_max = %f, a_max = %f\n", vel, v_max, a_max);
+
+    cartesian_move = 1;
+
+    EMC_TRAJ_SPLINE_MOVE splineMoveMsg;
+    splineMoveMsg.feed_mode = feed_mode;
+    splineMoveMsg.end = to_ext_pose(endpt);
+    splineMoveMsg.control1 = to_ext_len(ctrl[1]);
+    splineMoveMsg.control2 = to_ext_len(ctrl[2]);
+    splineMoveMsg.type = EMC_MOTION_TYPE_ARC;
+    splineMoveMsg.vel = toExtVel(vel);
+    splineMoveMsg.ini_maxvel = toExtVel(v_max);
+    splineMoveMsg.acc = toExtAcc(a_max);
+    if (vel) {
+        interp_list.set_line_number(lineno);
+        tag_and_send(splineMoveMsg, _tag);
+    }
+    canonUpdateEndPoint(endpt);
+    return true;
+}
+
 /* Canon calls */
 
 void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
     flush_segments();
 
+    if (spline_feed(lineno, nurbs_control_points, k)) {
+        return;
+    }
+
     unsigned int n = nurbs_control_points.size() - 1;
     double umax = n - k + 2;
     unsigned int div = nurbs_control_points.size()*4;
@@ -388,6 +388,7 @@ static EMC_TRAJ_SET_VELOCITY *emcTrajSetVelocityMsg;
 static EMC_TRAJ_SET_ACCELERATION *emcTrajSetAccelerationMsg;
 static EMC_TRAJ_LINEAR_MOVE *emcTrajLinearMoveMsg;
 static EMC_TRAJ_CIRCULAR_MOVE *emcTrajCircularMoveMsg;
+static EMC_TRAJ_SPLINE_MOVE *emcTrajSplineMoveMsg;
 static EMC_TRAJ_DELAY *emcTrajDelayMsg;
 static EMC_TRAJ_SET_TERM_COND *emcTrajSetTermCondMsg;
 static EMC_TRAJ_SET_SPINDLESYNC *emcTrajSetSpindlesyncMsg;
@@ -461,6 +462,7 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 #define operator_error_msg ((EMC_OPERATOR_ERROR *) cmd)
 #define linear_move ((EMC_TRAJ_LINEAR_MOVE *) cmd)
 #define circular_move ((EMC_TRAJ_CIRCULAR_MOVE *) cmd)
+#define spline_move ((EMC_TRAJ_SPLINE_MOVE *) cmd)
 
     while (il->len() > 0) {
 	cmd = il->get();
@@ -538,6 +540,39 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 	    }
 	    break;
 
+	case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	    if (spline_move->end.tran.x >
+		stat->motion.axis[0].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +X limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.y >
+		stat->motion.axis[1].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +Y limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.z >
+		stat->motion.axis[2].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +Z limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.x <
+		stat->motion.axis[0].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -X limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.y <
+		stat->motion.axis[1].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -Y limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.z <
+		stat->motion.axis[2].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -Z limit"), stat->task.command);
+		return -1;
+	    }
+	    break;
+
 	default:
 	    break;
 	}
@@ -546,6 +581,7 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
     return 0;
 
     // get rid of the compile-time cast shortcuts
+#undef spline_move
 #undef circular_move_msg
 #undef linear_move_msg
 #undef operator_error_msg
@@ -1488,6 +1524,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1814,6 +1851,17 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
                 emcTrajCircularMoveMsg->acc);
 	break;
 
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+    emcTrajUpdateTag(((EMC_TRAJ_SPLINE_MOVE *) cmd)->tag);
+	emcTrajSplineMoveMsg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+        retval = emcTrajSplineMove(emcTrajSplineMoveMsg->end,
+                emcTrajSplineMoveMsg->control1, emcTrajSplineMoveMsg->control2,
+                emcTrajSplineMoveMsg->type,
+                emcTrajSplineMoveMsg->vel,
+                emcTrajSplineMoveMsg->ini_maxvel,
+                emcTrajSplineMoveMsg->acc);
+	break;
+
     case EMC_TRAJ_PAUSE_TYPE:
 	emcStatus->task.task_paused = 1;
 	retval = emcTrajPause();
@@ -2377,6 +2425,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1046,6 +1046,43 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN control1,
+		      PM_CARTESIAN control2, int type, double vel, double ini_maxvel, double acc)
+{
+#ifdef ISNAN_TRAP
+    if (rtapi_isnan(end.tran.x) || rtapi_isnan(end.tran.y) || rtapi_isnan(end.tran.z) ||
+	rtapi_isnan(end.a) || rtapi_isnan(end.b) || rtapi_isnan(end.c) ||
+	rtapi_isnan(end.u) || rtapi_isnan(end.v) || rtapi_isnan(end.w) ||
+	rtapi_isnan(control1.x) || rtapi_isnan(control1.y) || rtapi_isnan(control1.z) ||
+	rtapi_isnan(control2.x) || rtapi_isnan(control2.y) || rtapi_isnan(control2.z)) {
+	printf("isnan error in emcTrajSplineMove()\n");
+	return 0;		// ignore it for now, just don't send it
+    }
+#endif
+
+    emcmotCommand.command = EMCMOT_SET_SPLINE;
+
+    emcmotCommand.pos = end;
+    emcmotCommand.motion_type = type;
+
+    emcmotCommand.control[0].x = control1.x;
+    emcmotCommand.control[0].y = control1.y;
+    emcmotCommand.control[0].z = control1.z;
+
+    emcmotCommand.control[1].x = control2.x;
+    emcmotCommand.control[1].y = control2.y;
+    emcmotCommand.control[1].z = control2.z;
+
+    emcmotCommand.id = localEmcTrajMotionId;
+    emcmotCommand.tag = localEmcTrajTag;
+
+    emcmotCommand.vel = vel;
+    emcmotCommand.ini_maxvel = ini_maxvel;
+    emcmotCommand.acc = acc;
+
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcTrajClearProbeTrippedFlag()
 {
     emcmotCommand.command = EMCMOT_CLEAR_PROBE_FLAGS;
@@ -1781,3 +1781,321 @@ double pmCircleEffectiveMinRadius(PmCircle const * const circle)
             effective_radius);
     return effective_radius;
 }
+
+
+/**
+ * Angle around the arc of a Circle9 from the total progress along the curve.
+ * Same as pmCircleAngleFromProgress, using the length stored by
+ * pmCircle9UpdateRates.
+ */
+double pmCircle9AngleFromProgress(PmCircle9 const * const circ9,
+        double progress)
+{
+    return pmCircleAngleFromParam(&circ9->xyz, &circ9->fit,
+            progress * circ9->inv_length);
+}
+
+
+/**
+ * Point on the XYZ part of a Circle9, given the angle around the arc with its
+ * cosine and sine.
+ * Same result as pmCirclePoint. Since rTan and rPerp both have the length of
+ * the radius, the spiral term is a scale of the radius vector, and needs no
+ * normalization.
+ */
+int pmCircle9Point(PmCircle9 const * const circ9, double angle,
+        double cos_angle, double sin_angle, PmCartesian * const out)
+{
+    PmCircle const * const circle = &circ9->xyz;
+    double scale = 1.0 + angle * circ9->spiral_rate;
+
+    out->x = (cos_angle * circle->rTan.x + sin_angle * circle->rPerp.x) * scale
+        + angle * circ9->dHelix.x + circle->center.x;
+    out->y = (cos_angle * circle->rTan.y + sin_angle * circle->rPerp.y) * scale
+        + angle * circ9->dHelix.y + circle->center.y;
+    out->z = (cos_angle * circle->rTan.z + sin_angle * circle->rPerp.z) * scale
+        + angle * circ9->dHelix.z + circle->center.z;
+    return TP_ERR_OK;
+}
+
+
+/**
+ * Find the cosine and sine of an angle, starting from the last angle stored
+ * in the cache.
+ * Within a segment the angle only changes by a small step each cycle, so the
+ * pair is rotated by the step, using series for the cosine and sine of the
+ * step (error of order 1e-15 for steps up to TC_ROTATION_MAX_STEP). The trig
+ * functions are called only for the first angle, for large steps, and every
+ * TC_ROTATION_ANCHOR_STEPS steps to keep rounding errors from accumulating.
+ */
+int pmRotationCacheEval(PmRotationCache * const rot, double angle,
+        double * const cos_out, double * const sin_out)
+{
+    double d = angle - rot->angle;
+
+    if (!rot->valid || rtapi_fabs(d) > TC_ROTATION_MAX_STEP ||
+            rot->steps >= TC_ROTATION_ANCHOR_STEPS) {
+        rot->cos_angle = rtapi_cos(angle);
+        rot->sin_angle = rtapi_sin(angle);
+        rot->steps = 0;
+        rot->valid = 1;
+    } else if (d != 0.0) {
+        double d2 = d * d;
+        double cd = 1.0 - d2 / 2.0 * (1.0 - d2 / 12.0 * (1.0 - d2 / 30.0 * (1.0 - d2 / 56.0)));
+        double sd = d * (1.0 - d2 / 6.0 * (1.0 - d2 / 20.0 * (1.0 - d2 / 42.0)));
+        double c = rot->cos_angle * cd - rot->sin_angle * sd;
+        double s = rot->sin_angle * cd + rot->cos_angle * sd;
+        rot->cos_angle = c;
+        rot->sin_angle = s;
+        rot->steps++;
+    }
+    rot->angle = angle;
+
+    *cos_out = rot->cos_angle;
+    *sin_out = rot->sin_angle;
+    return TP_ERR_OK;
+}
+
+
+/** @section splinefuncs Functions for cubic Bezier segments */
+
+/**
+ * First and second derivative of a cubic Bezier curve by its parameter t.
+ * Either output may be NULL.
+ */
+static void pmCartBezierDerivs(PmCartBezier const * const bez, double t,
+        PmCartesian * const d1, PmCartesian * const d2)
+{
+    PmCartesian a, b, c;
+    double u = 1.0 - t;
+
+    // Legs of the control polygon
+    pmCartCartSub(&bez->ctrl1, &bez->start, &a);
+    pmCartCartSub(&bez->ctrl2, &bez->ctrl1, &b);
+    pmCartCartSub(&bez->end, &bez->ctrl2, &c);
+
+    if (d1) {
+        d1->x = 3.0 * (u * u * a.x + 2.0 * u * t * b.x + t * t * c.x);
+        d1->y = 3.0 * (u * u * a.y + 2.0 * u * t * b.y + t * t * c.y);
+        d1->z = 3.0 * (u * u * a.z + 2.0 * u * t * b.z + t * t * c.z);
+    }
+    if (d2) {
+        d2->x = 6.0 * (u * (b.x - a.x) + t * (c.x - b.x));
+        d2->y = 6.0 * (u * (b.y - a.y) + t * (c.y - b.y));
+        d2->z = 6.0 * (u * (b.z - a.z) + t * (c.z - b.z));
+    }
+}
+
+/**
+ * Arc length of a Bezier curve between parameters t0 and t1.
+ * 5 point Gauss-Legendre quadrature of the speed |dP/dt|, which is exact for
+ * the polynomial part and plenty for the short intervals of the table.
+ */
+static double pmCartBezierArcLength(PmCartBezier const * const bez,
+        double t0, double t1)
+{
+    static const double node[5] = {0.0,
+        -0.5384693101056831, 0.5384693101056831,
+        -0.9061798459386640, 0.9061798459386640};
+    static const double weight[5] = {0.5688888888888889,
+        0.4786286704993665, 0.4786286704993665,
+        0.2369268850561891, 0.2369268850561891};
+    double mid = 0.5 * (t0 + t1);
+    double half = 0.5 * (t1 - t0);
+    double sum = 0.0;
+    double speed;
+    PmCartesian d1;
+    int k;
+
+    for (k = 0; k < 5; ++k) {
+        pmCartBezierDerivs(bez, mid + half * node[k], &d1, NULL);
+        pmCartMag(&d1, &speed);
+        sum += weight[k] * speed;
+    }
+    return half * sum;
+}
+
+/**
+ * Set up a cubic Bezier curve from its control points.
+ * Builds the arc length table used to run the curve at constant speed, and
+ * finds the largest curvature for the velocity limit.
+ */
+int pmCartBezierInit(PmCartBezier * const bez,
+        PmCartesian const * const start,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2,
+        PmCartesian const * const end)
+{
+    const int curvature_samples = 4 * TC_SPLINE_SAMPLES;
+    PmCartesian d1, d2, cross;
+    double t, speed, cross_mag;
+    int i;
+
+    bez->start = *start;
+    bez->ctrl1 = *ctrl1;
+    bez->ctrl2 = *ctrl2;
+    bez->end = *end;
+
+    bez->s[0] = 0.0;
+    for (i = 0; i <= TC_SPLINE_SAMPLES; ++i) {
+        t = (double)i / TC_SPLINE_SAMPLES;
+        if (i > 0) {
+            bez->s[i] = bez->s[i - 1] + pmCartBezierArcLength(bez,
+                    (double)(i - 1) / TC_SPLINE_SAMPLES, t);
+        }
+        pmCartBezierDerivs(bez, t, &d1, NULL);
+        pmCartMag(&d1, &bez->dsdt[i]);
+    }
+    bez->length = bez->s[TC_SPLINE_SAMPLES];
+    if (bez->length < TP_POS_EPSILON) {
+        return TP_ERR_FAIL;
+    }
+
+    // Curvature |P' x P''| / |P'|^3, sampled more finely than the table
+    bez->max_curvature = 0.0;
+    for (i = 0; i <= curvature_samples; ++i) {
+        t = (double)i / curvature_samples;
+        pmCartBezierDerivs(bez, t, &d1, &d2);
+        pmCartMag(&d1, &speed);
+        if (speed < TP_POS_EPSILON) {
+            // Degenerate control leg, no meaningful curvature here
+            continue;
+        }
+        pmCartCartCross(&d1, &d2, &cross);
+        pmCartMag(&cross, &cross_mag);
+        bez->max_curvature = rtapi_fmax(bez->max_curvature,
+                cross_mag / (speed * speed * speed));
+    }
+    tp_debug_print("Bezier length = %f, max curvature = %f\n",
+            bez->length, bez->max_curvature);
+    return TP_ERR_OK;
+}
+
+/**
+ * Point on a Bezier curve at parameter t (0..1).
+ */
+int pmCartBezierPoint(PmCartBezier const * const bez, double t,
+        PmCartesian * const out)
+{
+    double u = 1.0 - t;
+    double b0 = u * u * u;
+    double b1 = 3.0 * u * u * t;
+    double b2 = 3.0 * u * t * t;
+    double b3 = t * t * t;
+
+    out->x = b0 * bez->start.x + b1 * bez->ctrl1.x + b2 * bez->ctrl2.x + b3 * bez->end.x;
+    out->y = b0 * bez->start.y + b1 * bez->ctrl1.y + b2 * bez->ctrl2.y + b3 * bez->end.y;
+    out->z = b0 * bez->start.z + b1 * bez->ctrl1.z + b2 * bez->ctrl2.z + b3 * bez->end.z;
+    return TP_ERR_OK;
+}
+
+/**
+ * Unit tangent vector of a Bezier curve at parameter t (0..1).
+ * Where a control leg has zero length, the first derivative vanishes at the
+ * end point; the second derivative gives the direction there instead.
+ */
+int pmCartBezierTangent(PmCartBezier const * const bez, double t,
+        PmCartesian * const out)
+{
+    PmCartesian d1, d2;
+    double speed;
+
+    pmCartBezierDerivs(bez, t, &d1, &d2);
+    pmCartMag(&d1, &speed);
+    if (speed < TP_POS_EPSILON) {
+        // Second derivative points backwards at the end of the curve
+        if (t > 0.5) {
+            pmCartScalMultEq(&d2, -1.0);
+        }
+        return pmCartUnit(&d2, out);
+    }
+    return pmCartUnit(&d1, out);
+}
+
+/**
+ * Find the curve parameter for a distance along a Bezier curve.
+ * The table interval is found by bisection, then t(s) is interpolated by a
+ * cubic Hermite polynomial using the speed at the table points. Slopes are
+ * limited to 3 times the secant so that t(s) stays monotonic, even near a
+ * degenerate control leg. One Newton step on the exact arc length of the
+ * interval removes most of the remaining error.
+ */
+double pmCartBezierParamFromProgress(PmCartBezier const * const bez,
+        double progress)
+{
+    const double dt = 1.0 / TC_SPLINE_SAMPLES;
+    int lo = 0;
+    int hi = TC_SPLINE_SAMPLES;
+
+    if (progress <= 0.0) {
+        return 0.0;
+    }
+    if (progress >= bez->length) {
+        return 1.0;
+    }
+
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (bez->s[mid] > progress) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+
+    double h = bez->s[hi] - bez->s[lo];
+    double t0 = lo * dt;
+    if (h <= 0.0) {
+        return t0;
+    }
+    double u = (progress - bez->s[lo]) / h;
+
+    // Slopes dt/du at either end of the interval
+    double m_max = 3.0 * dt;
+    double m0 = (bez->dsdt[lo] * m_max > h) ? h / bez->dsdt[lo] : m_max;
+    double m1 = (bez->dsdt[hi] * m_max > h) ? h / bez->dsdt[hi] : m_max;
+
+    double u2 = u * u;
+    double u3 = u2 * u;
+    double t = t0 + dt * (3.0 * u2 - 2.0 * u3) +
+        m0 * (u3 - 2.0 * u2 + u) +
+        m1 * (u3 - u2);
+
+    // Newton step on s(t) - progress
+    PmCartesian d1;
+    double speed;
+    pmCartBezierDerivs(bez, t, &d1, NULL);
+    pmCartMag(&d1, &speed);
+    if (speed > TP_POS_EPSILON) {
+        double err = bez->s[lo] + pmCartBezierArcLength(bez, t0, t) - progress;
+        double t_new = t - err / speed;
+        // Stay inside the interval
+        if (t_new > t0 && t_new < t0 + dt) {
+            t = t_new;
+        }
+    }
+    return t;
+}
+
+/**
+ * Limit the velocity on a Bezier curve so that the normal acceleration at
+ * the tightest point stays within the normal share of the acceleration,
+ * like pmCircleActualMaxVel does for arcs.
+ */
+double pmCartBezierActualMaxVel(PmCartBezier const * const bez,
+        double v_max, double a_max, int parabolic)
+{
+    if (parabolic) {
+        a_max /= 2.0;
+    }
+    if (bez->max_curvature <= 0.0) {
+        return v_max;
+    }
+    double a_n_max = BLEND_ACC_RATIO_NORMAL * a_max;
+    double v_max_acc = pmSqrt(a_n_max / bez->max_curvature);
+    if (v_max_acc < v_max) {
+        tp_debug_print("Maxvel limited from %f to %f by spline curvature\n", v_max, v_max_acc);
+        return v_max_acc;
+    }
+    return v_max;
+}
@@ -235,4 +235,25 @@ double pmCircleAngleFromProgress(PmCircle const * const circle,
         double progress);
 double pmCircleLength(PmCircle const * const circle);
 double pmCircleEffectiveMinRadius(PmCircle const * const circle);
+double pmCircle9AngleFromProgress(PmCircle9 const * const circ9,
+        double progress);
+int pmCircle9Point(PmCircle9 const * const circ9, double angle,
+        double cos_angle, double sin_angle, PmCartesian * const out);
+int pmRotationCacheEval(PmRotationCache * const rot, double angle,
+        double * const cos_out, double * const sin_out);
+int pmCartBezierInit(PmCartBezier * const bez,
+        PmCartesian const * const start,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2,
+        PmCartesian const * const end);
+int pmCartBezierPoint(PmCartBezier const * const bez, double t,
+        PmCartesian * const out);
+int pmCartBezierTangent(PmCartBezier const * const bez, double t,
+        PmCartesian * const out);
+double pmCartBezierParamFromProgress(PmCartBezier const * const bez,
+        double progress);
+double pmCartBezierActualMaxVel(PmCartBezier const * const bez,
+        double v_max,
+        double a_max,
+        int parabolic);
 #endif
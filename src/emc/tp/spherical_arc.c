@@ -78,13 +78,35 @@ int arcInitFromPoints(SphericalArc * const arc, PmCartesian const * const start,
         return TP_ERR_GEOM;
     }
 
-    // Store sin of arc angle since it is reused many times for SLERP
+    // Store sin and cos of arc angle since they are reused many times for SLERP
     arc->Sangle = rtapi_sin(arc->angle);
+    arc->Cangle = rtapi_cos(arc->angle);
 
     return TP_ERR_OK;
 }
 
 int arcPoint(SphericalArc const * const arc, double progress, PmCartesian * const out)
+{
+    double angle_in = arcAngleFromProgress(arc, progress);
+    return arcPointRotated(arc, progress,
+            rtapi_cos(angle_in), rtapi_sin(angle_in), out);
+}
+
+/**
+ * Angle around the arc for a given progress, valid past the leading line
+ * part only.
+ */
+double arcAngleFromProgress(SphericalArc const * const arc, double progress)
+{
+    return (progress - arc->line_length) / arc->radius;
+}
+
+/**
+ * Same as arcPoint, with the cosine and sine of arcAngleFromProgress()
+ * supplied by the caller, so that they can be found incrementally.
+ */
+int arcPointRotated(SphericalArc const * const arc, double progress,
+        double cos_angle, double sin_angle, PmCartesian * const out)
 {
     //TODO pedantic
 
@@ -96,10 +118,11 @@ int arcPoint(SphericalArc const * const arc, double progress, PmCartesian * cons
         pmCartScalMult(&arc->uTan, net_progress, out);
         pmCartCartAdd(out, &arc->start, out);
     } else {
-        double angle_in = net_progress / arc->radius;
-        tc_debug_print("angle_in = %f, angle_total = %f\n", angle_in, arc->angle);
-        double scale0 = rtapi_sin(arc->angle - angle_in) / arc->Sangle;
-        double scale1 = rtapi_sin(angle_in) / arc->Sangle;
+        tc_debug_print("angle_in = %f, angle_total = %f\n",
+                net_progress / arc->radius, arc->angle);
+        // sin(angle - angle_in) = sin(angle)cos(angle_in) - cos(angle)sin(angle_in)
+        double scale0 = (arc->Sangle * cos_angle - arc->Cangle * sin_angle) / arc->Sangle;
+        double scale1 = sin_angle / arc->Sangle;
 
         PmCartesian interp0,interp1;
         pmCartScalMult(&arc->rStart, scale0, &interp0);
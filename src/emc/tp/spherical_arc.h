@@ -39,6 +39,7 @@ typedef struct {
     // Angle that the arc encloses
     double angle;
     double Sangle;
+    double Cangle;
     double line_length;
 } SphericalArc;
 
@@ -52,6 +53,11 @@ int arcInitFromVectors(SphericalArc * const arc, PmCartesian const * const vec0,
 
 int arcPoint(SphericalArc const * const arc, double angle_in, PmCartesian * const out);
 
+double arcAngleFromProgress(SphericalArc const * const arc, double progress);
+
+int arcPointRotated(SphericalArc const * const arc, double progress,
+        double cos_angle, double sin_angle, PmCartesian * const out);
+
 int arcNormalizedSlerp(SphericalArc const * const arc, double t, PmCartesian * const out);
 
 int arcLength(SphericalArc const * const arc, double * const length);
@@ -77,6 +77,9 @@ int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
         case TC_CIRCULAR:
             tcCircleStartAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            pmCartBezierTangent(&tc->coords.spline.xyz, 0.0, out);
+            break;
         case TC_SPHERICAL:
             return -1;
         default:
@@ -101,6 +104,9 @@ int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out)
         case TC_CIRCULAR:
             tcCircleEndAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            pmCartBezierTangent(&tc->coords.spline.xyz, 1.0, out);
+            break;
        case TC_SPHERICAL:
             return -1;
        default:
@@ -207,6 +213,9 @@ int tcGetStartTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const
         case TC_CIRCULAR:
             pmCircleTangentVector(&tc->coords.circle.xyz, 0.0, out);
             break;
+        case TC_SPLINE:
+            pmCartBezierTangent(&tc->coords.spline.xyz, 0.0, out);
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -230,6 +239,9 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
             pmCircleTangentVector(&tc->coords.circle.xyz,
                     tc->coords.circle.xyz.angle, out);
             break;
+        case TC_SPLINE:
+            pmCartBezierTangent(&tc->coords.spline.xyz, 1.0, out);
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -252,8 +264,8 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
  * @return	 EmcPose   returns a position (\ref EmcPose = datatype carrying XYZABC information
  */
 
-int tcGetPos(TC_STRUCT const * const tc, EmcPose * const out) {
-    tcGetPosReal(tc, TC_GET_PROGRESS, out);
+int tcGetPos(TC_STRUCT * const tc, EmcPose * const out) {
+    tcGetPosRotated(tc, TC_GET_PROGRESS, &tc->rotation, out);
     return 0;
 }
 
@@ -268,6 +280,18 @@ int tcGetEndpoint(TC_STRUCT const * const tc, EmcPose * const out) {
 }
 
 int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
+{
+    return tcGetPosRotated(tc, of_point, NULL, pos);
+}
+
+/**
+ * Position along a segment as tcGetPosReal.
+ * For circular and blend arc segments, the cosine and sine of the angle are
+ * found incrementally from the last call with the same rotation cache (see
+ * pmRotationCacheEval). With rot == NULL, they are computed directly.
+ */
+int tcGetPosRotated(TC_STRUCT const * const tc, int of_point,
+        PmRotationCache * const rot, EmcPose * const pos)
 {
     PmCartesian xyz;
     PmCartesian abc;
@@ -289,6 +313,9 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
 
     // Used for arc-length to angle conversion with spiral segments
     double angle = 0.0;
+    double cos_angle, sin_angle;
+    // Used for arc-length to parameter conversion with splines
+    double param = 0.0;
 
     switch (tc->motion_type){
         case TC_RIGIDTAP:
@@ -313,11 +340,17 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
                     &abc);
             break;
         case TC_CIRCULAR:
-            angle = pmCircleAngleFromProgress(&tc->coords.circle.xyz,
-                    &tc->coords.circle.fit,
-                    progress);
-            pmCirclePoint(&tc->coords.circle.xyz,
+            angle = pmCircle9AngleFromProgress(&tc->coords.circle, progress);
+            if (rot) {
+                pmRotationCacheEval(rot, angle, &cos_angle, &sin_angle);
+            } else {
+                cos_angle = rtapi_cos(angle);
+                sin_angle = rtapi_sin(angle);
+            }
+            pmCircle9Point(&tc->coords.circle,
                     angle,
+                    cos_angle,
+                    sin_angle,
                     &xyz);
             pmCartLinePoint(&tc->coords.circle.abc,
                     progress * tc->coords.circle.abc.tmag / tc->target,
@@ -326,9 +359,31 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
                     progress * tc->coords.circle.uvw.tmag / tc->target,
                     &uvw);
             break;
+        case TC_SPLINE:
+            param = pmCartBezierParamFromProgress(&tc->coords.spline.xyz,
+                    progress);
+            pmCartBezierPoint(&tc->coords.spline.xyz,
+                    param,
+                    &xyz);
+            pmCartLinePoint(&tc->coords.spline.abc,
+                    progress * tc->coords.spline.abc.tmag / tc->target,
+                    &abc);
+            pmCartLinePoint(&tc->coords.spline.uvw,
+                    progress * tc->coords.spline.uvw.tmag / tc->target,
+                    &uvw);
+            break;
         case TC_SPHERICAL:
-            arcPoint(&tc->coords.arc.xyz,
+            angle = arcAngleFromProgress(&tc->coords.arc.xyz, progress);
+            if (rot) {
+                pmRotationCacheEval(rot, angle, &cos_angle, &sin_angle);
+            } else {
+                cos_angle = rtapi_cos(angle);
+                sin_angle = rtapi_sin(angle);
+            }
+            arcPointRotated(&tc->coords.arc.xyz,
                     progress,
+                    cos_angle,
+                    sin_angle,
                     &xyz);
             abc = tc->coords.arc.abc;
             uvw = tc->coords.arc.uvw;
@@ -614,6 +669,7 @@ int pmCircle9Init(PmCircle9 * const circ9,
     int uvw_fail = pmCartLineInit(&circ9->uvw, &start_uvw, &end_uvw);
 
     int res_fit = findSpiralArcLengthFit(&circ9->xyz,&circ9->fit);
+    pmCircle9UpdateRates(circ9);
 
     if (xyz_fail || abc_fail || uvw_fail || res_fit) {
         rtapi_print_msg(RTAPI_MSG_ERR,"Failed to initialize Circle9, err codes %d, %d, %d, %d\n",
@@ -623,6 +679,30 @@ int pmCircle9Init(PmCircle9 * const circ9,
     return TP_ERR_OK;
 }
 
+/**
+ * Store the terms of the XYZ circle and its arc length fit that
+ * pmCircle9Point and pmCircle9AngleFromProgress need each cycle.
+ * Call again whenever the circle or the fit changes.
+ */
+int pmCircle9UpdateRates(PmCircle9 * const circ9)
+{
+    PmCircle const * const circle = &circ9->xyz;
+
+    if (circle->angle > 0.0) {
+        pmCartScalMult(&circle->rHelix, 1.0 / circle->angle, &circ9->dHelix);
+    } else {
+        circ9->dHelix.x = circ9->dHelix.y = circ9->dHelix.z = 0.0;
+    }
+    if (circle->angle > 0.0 && circle->radius > 0.0) {
+        circ9->spiral_rate = circle->spiral / (circle->angle * circle->radius);
+    } else {
+        circ9->spiral_rate = 0.0;
+    }
+    double length = pmCircle9Target(circ9);
+    circ9->inv_length = length > 0.0 ? 1.0 / length : 0.0;
+    return TP_ERR_OK;
+}
+
 double pmCircle9Target(PmCircle9 const * const circ9)
 {
 
@@ -633,6 +713,38 @@ double pmCircle9Target(PmCircle9 const * const circ9)
     return helical_length;
 }
 
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2)
+{
+    PmCartesian start_xyz, end_xyz;
+    PmCartesian start_uvw, end_uvw;
+    PmCartesian start_abc, end_abc;
+
+    emcPoseToPmCartesian(start, &start_xyz, &start_abc, &start_uvw);
+    emcPoseToPmCartesian(end, &end_xyz, &end_abc, &end_uvw);
+
+    int xyz_fail = pmCartBezierInit(&spline9->xyz, &start_xyz, ctrl1, ctrl2, &end_xyz);
+    //Initialize line parts of Spline9
+    int abc_fail = pmCartLineInit(&spline9->abc, &start_abc, &end_abc);
+    int uvw_fail = pmCartLineInit(&spline9->uvw, &start_uvw, &end_uvw);
+
+    if (xyz_fail || abc_fail || uvw_fail) {
+        rtapi_print_msg(RTAPI_MSG_ERR,"Failed to initialize Spline9, err codes %d, %d, %d\n",
+                xyz_fail, abc_fail, uvw_fail);
+        return TP_ERR_FAIL;
+    }
+    return TP_ERR_OK;
+}
+
+double pmSpline9Target(PmSpline9 const * const spline9)
+{
+    // ABC and UVW are slaved to the XYZ curve, like on arcs
+    return spline9->xyz.length;
+}
+
 /**
  * "Finalizes" a segment so that its length can't change.
  * By setting the finalized flag, we tell the optimizer that this segment's
@@ -659,6 +771,8 @@ int tcFinalizeLength(TC_STRUCT * const tc)
 
     if (tc->motion_type == TC_CIRCULAR) {
         tc->maxvel = pmCircleActualMaxVel(&tc->coords.circle.xyz, tc->maxvel, tc->maxaccel, parabolic);
+    } else if (tc->motion_type == TC_SPLINE) {
+        tc->maxvel = pmCartBezierActualMaxVel(&tc->coords.spline.xyz, tc->maxvel, tc->maxaccel, parabolic);
     }
 
     tcClampVelocityByLength(tc);
@@ -772,6 +886,7 @@ int tcSetCircleXYZ(TC_STRUCT * const tc, PmCircle const * const circ)
     tc->coords.circle.xyz = *circ;
     // Update the arc length fit to this new segment
     findSpiralArcLengthFit(&tc->coords.circle.xyz, &tc->coords.circle.fit);
+    pmCircle9UpdateRates(&tc->coords.circle);
 
     // compute the new total arc length using the fit and store as new
     // target distance
@@ -23,8 +23,10 @@
 
 int tcGetEndpoint(TC_STRUCT const * const tc, EmcPose * const out);
 int tcGetStartpoint(TC_STRUCT const * const tc, EmcPose * const out);
-int tcGetPos(TC_STRUCT const * const tc,  EmcPose * const out);
+int tcGetPos(TC_STRUCT * const tc,  EmcPose * const out);
 int tcGetPosReal(TC_STRUCT const * const tc, int of_endpoint,  EmcPose * const out);
+int tcGetPosRotated(TC_STRUCT const * const tc, int of_point,
+        PmRotationCache * const rot, EmcPose * const out);
 int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
 int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
 int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
@@ -59,6 +61,7 @@ int pmLine9Init(PmLine9 * const line9,
         EmcPose const * const start,
         EmcPose const * const end);
 
+int pmCircle9UpdateRates(PmCircle9 * const circ9);
 double pmCircle9Target(PmCircle9 const * const circ9);
 
 int pmCircle9Init(PmCircle9 * const circ9,
@@ -68,6 +71,14 @@ int pmCircle9Init(PmCircle9 * const circ9,
         PmCartesian const * const normal,
         int turn);
 
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2);
+
+double pmSpline9Target(PmSpline9 const * const spline9);
+
 int pmRigidTapInit(PmRigidTap * const tap,
         EmcPose const * const start,
         EmcPose const * const end);
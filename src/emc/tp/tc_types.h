@@ -35,7 +35,8 @@ typedef enum {
     TC_LINEAR = 1,
     TC_CIRCULAR = 2,
     TC_RIGIDTAP = 3,
-    TC_SPHERICAL = 4
+    TC_SPHERICAL = 4,
+    TC_SPLINE = 5
 } tc_motion_type_t;
 
 typedef enum {
@@ -66,6 +67,45 @@ typedef struct {
 } SpiralArcLengthFit;
 
 
+/**
+ * Cosine and sine of the angle last evaluated on an arc segment.
+ * Successive servo cycles move a short way along the arc, so the next pair
+ * is found by rotating this one through the small step (see
+ * pmRotationCacheEval). The pair is recomputed with the trig functions
+ * every TC_ROTATION_ANCHOR_STEPS steps, and for steps larger than
+ * TC_ROTATION_MAX_STEP.
+ */
+#define TC_ROTATION_ANCHOR_STEPS 64
+#define TC_ROTATION_MAX_STEP 0.1
+
+typedef struct {
+    double angle;
+    double cos_angle;
+    double sin_angle;
+    int steps;                  /* steps since the last exact evaluation */
+    int valid;
+} PmRotationCache;
+
+/**
+ * Cubic Bezier curve, with a table of arc length vs. curve parameter.
+ * Intervals of the parameter t are of equal size, so the table is indexed
+ * by t directly; the inverse (t from arc length) is interpolated between
+ * the entries.
+ */
+#define TC_SPLINE_SAMPLES 16
+
+typedef struct {
+    PmCartesian start;          /* control points */
+    PmCartesian ctrl1;
+    PmCartesian ctrl2;
+    PmCartesian end;
+    double s[TC_SPLINE_SAMPLES + 1];    /* arc length at t = i / TC_SPLINE_SAMPLES */
+    double dsdt[TC_SPLINE_SAMPLES + 1]; /* ds/dt at the same points */
+    double length;              /* total arc length */
+    double max_curvature;       /* largest curvature (1 / radius) */
+} PmCartBezier;
+
+
 /* structure for individual trajectory elements */
 
 typedef struct {
@@ -79,8 +119,18 @@ typedef struct {
     PmCartLine abc;
     PmCartLine uvw;
     SpiralArcLengthFit fit;
+    // Invariants of xyz and fit, see pmCircle9UpdateRates
+    PmCartesian dHelix;         /* helix advance per radian */
+    double spiral_rate;         /* relative change of radius per radian */
+    double inv_length;          /* 1 / helical length */
 } PmCircle9;
 
+typedef struct {
+    PmCartBezier xyz;
+    PmCartLine abc;
+    PmCartLine uvw;
+} PmSpline9;
+
 typedef struct {
     SphericalArc xyz;
     PmCartesian abc;
@@ -131,6 +181,8 @@ typedef struct {
     //Acceleration
     double maxaccel;        // accel calc'd by task
     
+    PmRotationCache rotation;   // last angle on a circle or blend arc
+
     int id;                 // segment's serial number
     struct state_tag_t tag; /* state tag corresponding to running motion */
 
@@ -139,11 +191,13 @@ typedef struct {
         PmCircle9 circle;
         PmRigidTap rigidtap;
         Arc9 arc;
+        PmSpline9 spline;
     } coords;
 
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
-                            // TC_RIGIDTAP (coords.rigidtap)
+                            // TC_RIGIDTAP (coords.rigidtap) or
+                            // TC_SPLINE (coords.spline)
     int active;            // this motion is being executed
     int canon_motion_type;  // this motion is due to which canon function?
     int term_cond;          // gcode requests continuous feed at the end of
@@ -76,6 +76,10 @@ STATIC inline double tpGetMaxTargetVel(
         TP_STRUCT const * const tp,
         TC_STRUCT const * const tc);
 
+STATIC inline double tpGetScaledAccel(
+        TP_STRUCT const * const tp,
+        TC_STRUCT const * const tc);
+
 
 STATIC int tpAdjustAccelForTangent(TP_STRUCT const * const,
         TC_STRUCT * const tc,
@@ -121,6 +125,12 @@ STATIC int tpRotaryMotionCheck(TP_STRUCT const * const tp, TC_STRUCT const * con
             } else {
                 return true;
             }
+        case TC_SPLINE:
+            if (tc->coords.spline.abc.tmag_zero && tc->coords.spline.uvw.tmag_zero) {
+                return false;
+            } else {
+                return true;
+            }
         case TC_SPHERICAL:
             return true;
         default:
@@ -210,13 +220,41 @@ STATIC double tpGetFeedScale(TP_STRUCT const * const tp,
         return 1.0;
     } else if (tc->is_blending) {
         //KLUDGE: Don't allow feed override to keep blending from overruning max velocity
-        return rtapi_fmin(get_net_feed_scale(tp->shared), 1.0);
+        return rtapi_fmin(tp->feed_scale, 1.0);
     } else {
-        return get_net_feed_scale(tp->shared);
+        return tp->feed_scale;
     }
 }
 
 
+/**
+ * Move the applied feed scale towards the requested net feed scale.
+ * The final velocities from the optimizer are planned against each
+ * segment's maxvel, which covers the highest feed override, so they stay
+ * valid when the override changes. What used to change instantly is the
+ * target velocity of the active segment, and with it the final velocity it
+ * has to reach at the next corner. An increase is rate limited so that the
+ * velocity change it causes uses at most TP_FEED_SCALE_ACC_RATIO of the
+ * segment's acceleration, leaving the rest for the path. A decrease, down
+ * to a feed hold, applies at once: the velocity then follows it at the
+ * full acceleration, as it always did, and a hold stops as short as before.
+ */
+STATIC void tpUpdateFeedScale(TP_STRUCT * const tp, TC_STRUCT const * const tc)
+{
+    double requested = get_net_feed_scale(tp->shared);
+    double v_nominal = tc->synchronized ? tc->target_vel : tc->reqvel;
+
+    if (requested <= tp->feed_scale || v_nominal < TP_VEL_EPSILON) {
+        tp->feed_scale = requested;
+        return;
+    }
+    double max_step = TP_FEED_SCALE_ACC_RATIO * tpGetScaledAccel(tp, tc) *
+        tp->cycleTime / v_nominal;
+    tp->feed_scale += rtapi_fmin(requested - tp->feed_scale, max_step);
+    tc_debug_print("feed scale = %f, requested %f\n", tp->feed_scale, requested);
+}
+
+
 /**
  * Get target velocity for a tc based on the trajectory planner state.
  * This gives the requested velocity, capped by the segments maximum velocity.
@@ -317,7 +355,8 @@ STATIC inline double tpGetScaledAccel(TP_STRUCT const * const tp,
     if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
         a_scale *= 0.5;
     }
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= BLEND_ACC_RATIO_TANGENTIAL;
     }
@@ -420,6 +459,7 @@ int tpClear(TP_STRUCT * const tp)
     tp->pausing = 0;
     tp->synchronized = 0;
     tp->uu_per_rev = 0.0;
+    tp->feed_scale = 1.0;
     set_spindleSync(tp->shared, 0);
     set_current_vel(tp->shared, 0.0);
     set_requested_vel(tp->shared, 0.0);
@@ -1793,7 +1833,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
     //FIXME this ratio is arbitrary, should be more easily tunable
     double acc_scale_max = pmCartAbsMax(&acc_scale);
     //KLUDGE lumping a few calculations together here
-    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR) {
+    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR ||
+            prev_tc->motion_type == TC_SPLINE || tc->motion_type == TC_SPLINE) {
         acc_scale_max /= BLEND_ACC_RATIO_TANGENTIAL;
     }
 
@@ -2045,6 +2086,98 @@ int tpAddCircle(TP_STRUCT * const tp,
     if (get_arcBlendEnable(tp->shared)){
         tpHandleBlendArc(tp, &tc);
         findSpiralArcLengthFit(&tc.coords.circle.xyz, &tc.coords.circle.fit);
+        pmCircle9UpdateRates(&tc.coords.circle);
+    }
+    tcCheckLastParabolic(&tc, prev_tc);
+    tcFinalizeLength(prev_tc);
+    tcFlagEarlyStop(prev_tc, &tc);
+
+    int retval = tpAddSegmentToQueue(tp, &tc, true);
+
+    tpRunOptimization(tp);
+    return retval;
+}
+
+
+/**
+ * Adds a cubic spline move from the end of the last move to this new
+ * position.
+ *
+ * @param end is the xyz/abc point of the destination.
+ * @param control1, control2 are the inner control points of the cubic
+ * Bezier curve in xyz.
+ *
+ * The whole curve is one segment, run at constant speed along its arc
+ * length. Splines join other segments by tangent or parabolic blending; no
+ * blend arcs are made for them.
+ */
+int tpAddSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian control1,
+        PmCartesian control2,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed,
+        struct state_tag_t tag)
+{
+    if (tpErrorCheck(tp)<0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp_info_print("== AddSpline ==\n");
+    tp_debug_print("ini_maxvel = %f\n",ini_maxvel);
+
+    TC_STRUCT tc = {0};
+
+    tcInit(&tc,
+            TC_SPLINE,
+            canon_motion_type,
+            tp->cycleTime,
+            enables,
+            atspeed);
+    tc.tag = tag;
+    // Setup any synced IO for this move
+    tpSetupSyncedIO(tp, &tc);
+
+    // Copy over state data from the trajectory planner
+    tcSetupState(&tc, tp);
+
+    // Setup spline geometry and its arc length table
+    int res_init = pmSpline9Init(&tc.coords.spline,
+            &tp->goalPos,
+            &end,
+            &control1,
+            &control2);
+
+    if (res_init) return res_init;
+
+    tc.target = pmSpline9Target(&tc.coords.spline);
+    if (tc.target < TP_POS_EPSILON) {
+        return TP_ERR_FAIL;
+    }
+    tp_debug_print("tc.target = %f\n",tc.target);
+    tc.nominal_length = tc.target;
+
+    double v_max_actual = pmCartBezierActualMaxVel(&tc.coords.spline.xyz, ini_maxvel, acc, false);
+
+    // Copy in motion parameters
+    tcSetupMotion(&tc,
+            vel,
+            v_max_actual,
+            acc);
+
+    //Reduce max velocity to match sample rate
+    tcClampVelocityByLength(&tc);
+
+    TC_STRUCT *prev_tc;
+    prev_tc = tcqLast(&tp->queue);
+
+    tpCheckCanonType(prev_tc, &tc);
+    if (get_arcBlendEnable(tp->shared)){
+        tpHandleBlendArc(tp, &tc);
     }
     tcCheckLastParabolic(&tc, prev_tc);
     tcFinalizeLength(prev_tc);
@@ -2511,6 +2644,8 @@ STATIC void tpHandleEmptyQueue(TP_STRUCT * const tp)
     tpUpdateMovementStatus(tp, NULL);
 
     tpResume(tp);
+    // nothing is moving, so the feed override can take effect at once
+    tp->feed_scale = get_net_feed_scale(tp->shared);
     // when not executing a move, use the current enable flags
     set_enables_queued(tp->shared,
 		       get_enables_new(tp->shared));
@@ -3227,6 +3362,8 @@ int tpRunCycle(TP_STRUCT * const tp, long period)
         }
     }
 
+    tpUpdateFeedScale(tp, tc);
+
     // Preprocess rigid tap move (handles threading direction reversals)
     if (tc->motion_type == TC_RIGIDTAP) {
         tpUpdateRigidTapState(tp, tc);
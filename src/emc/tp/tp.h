@@ -67,6 +67,17 @@ typedef int (*tpAddCircle_t)(TP_STRUCT * tp,
 			     unsigned char enables,
 			     char atspeed,
 			    struct state_tag_t tag);
+typedef int (*tpAddSpline_t)(TP_STRUCT * tp,
+			     EmcPose end,
+			     PmCartesian control1,
+			     PmCartesian control2,
+			     int type,
+			     double vel,
+			     double ini_maxvel,
+			     double acc,
+			     unsigned char enables,
+			     char atspeed,
+			    struct state_tag_t tag);
 typedef int (*tpRunCycle_t)(TP_STRUCT * tp, long period);
 typedef int (*tpPause_t)(TP_STRUCT * tp);
 typedef int (*tpResume_t)(TP_STRUCT * tp);
@@ -128,6 +139,8 @@ typedef struct {
     tpIsPaused_t	tpIsPaused;
     tpSnapshot_t	tpSnapshot;
     tcqFull_t           tcqFull;
+    // since VTTP_VERSION2
+    tpAddSpline_t	tpAddSpline;
 } vtp_t;
 
 
@@ -52,6 +52,10 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end, PmCartesian center,
 		PmCartesian normal, int turn, int type, double vel, double ini_maxvel,
 		double acc, unsigned char enables, char atspeed,struct state_tag_t tag);
 
+int tpAddSpline(TP_STRUCT * tp, EmcPose end, PmCartesian control1,
+		PmCartesian control2, int type, double vel, double ini_maxvel,
+		double acc, unsigned char enables, char atspeed,struct state_tag_t tag);
+
 int tpRunCycle(TP_STRUCT * tp, long period);
 
 int tpPause(TP_STRUCT * tp);
@@ -34,6 +34,10 @@
  * the end of the program */
 #define TP_QUEUE_THRESHOLD 3
 
+/* Fraction of a segment's acceleration that feed override increases may use,
+ * see tpUpdateFeedScale. */
+#define TP_FEED_SCALE_ACC_RATIO 0.5
+
 /* closeness to zero, for determining if a move is pure rotation */
 #define TP_PURE_ROTATION_EPSILON 1e-6
 
@@ -133,6 +137,7 @@ typedef struct {
     int velocity_mode; 	        /* TRUE if spindle sync is in velocity mode,
 				   FALSE if in position mode */
     double uu_per_rev;          /* user units per spindle revolution */
+    double feed_scale;          /* net feed scale as applied, rate limited */
 
     double old_spindlepos; // temporary in tpUpdateRigidTapState
 
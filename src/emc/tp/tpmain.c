@@ -5,7 +5,7 @@
 #include "tp.h"
 #include "tp_private.h"
 
-#define VTVERSION  VTTP_VERSION1
+#define VTVERSION  VTTP_VERSION2
 
 MODULE_AUTHOR("Michael Haberler");
 MODULE_DESCRIPTION("machinekit trajectory planner");
@@ -48,6 +48,7 @@ static vtp_t vtp = {
     .tpIsPaused        = tpIsPaused,
     .tpSnapshot        = tpSnapshot,
     .tcqFull           = tcqFull,
+    .tpAddSpline       = tpAddSpline,
 };
 
 static int comp_id, vtable_id;
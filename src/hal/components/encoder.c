@@ -28,6 +28,17 @@
     called in a high speed thread, at least twice the maximum desired
     count rate.  "encoder.capture-position" can be called at a much
     slower rate, and updates the output variables.
+
+    With 'port=1', the quadrature, index and latch inputs of all
+    channels come from one u32 pin, "encoder.port-in", as read from a
+    GPIO port in a single access.  Channel n uses bit 2n for phase A,
+    bit 2n+1 for phase B, bit 16+n for phase Z and bit 24+n for the
+    latch input; the per channel input pins are not exported.
+    "encoder.update-counters" then decodes all channels in one pass
+    on the packed word (see update_port()), and does per channel work
+    only for channels that counted, indexed or latched this period.
+    x4-mode and counter-mode are sampled by "encoder.capture-position"
+    in this mode, so a change takes effect after its next run.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -77,6 +88,8 @@ RTAPI_MP_INT(num_chan, "number of encoder channels");
 #define MAX_CHAN 8
 char *names[MAX_CHAN] = {0,};
 RTAPI_MP_ARRAY_STRING(names, MAX_CHAN, "names of encoder");
+static int port;
+RTAPI_MP_INT(port, "read all inputs from the packed encoder.port-in pin");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -135,7 +148,16 @@ typedef struct {
     int counts_since_timeout;	/* c:rw used for velocity calcs */
 } counter_t;
 
+/* state of the packed input word, 'port=1' only */
+typedef struct {
+    hal_u32_t *in;		/* u:r pin: packed input word */
+    __u32 old;			/* u:rw previous input word */
+    __u32 x4;			/* u:r c:w x4 mode, bit per channel */
+    __u32 ctr;			/* u:r c:w counter mode, bit per channel */
+} port_t;
+
 static __u32 timebase;		/* master timestamp for all counters */
+static port_t *port_data;
 
 /* pointer to array of counter_t structs in shmem, 1 per counter */
 static counter_t *counter_array;
@@ -183,6 +205,7 @@ static int comp_id;		/* component ID */
 
 static int export_encoder(counter_t * addr,char * prefix);
 static void update(void *arg, long period);
+static void update_port(void *arg, long period);
 static void capture(void *arg, long period);
 
 /***********************************************************************
@@ -233,6 +256,27 @@ int rtapi_app_main(void)
 	hal_exit(comp_id);
 	return -1;
     }
+    if (port) {
+	port_data = hal_malloc(sizeof(port_t));
+	if (port_data == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"ENCODER: ERROR: hal_malloc() failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	retval = hal_pin_u32_newf(HAL_IN, &(port_data->in), comp_id,
+	    "encoder.port-in");
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"ENCODER: ERROR: port pin export failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	*(port_data->in) = 0;
+	port_data->old = 0;
+	port_data->x4 = (1 << howmany) - 1;
+	port_data->ctr = 0;
+    }
     /* init master timestamp counter */
     timebase = 0;
     /* export all the variables for each counter */
@@ -283,8 +327,8 @@ int rtapi_app_main(void)
 	cntr->counts_since_timeout = 0;
     }
     /* export functions */
-    retval = hal_export_funct("encoder.update-counters", update,
-	counter_array, 0, 0, comp_id);
+    retval = hal_export_funct("encoder.update-counters",
+	port ? update_port : update, counter_array, 0, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "ENCODER: ERROR: count funct export failed\n");
@@ -390,6 +434,88 @@ static void update(void *arg, long period)
     /* done */
 }
 
+/* gather the even bits of the low half of 'w' into the low byte */
+static inline __u32 even_bits(__u32 w)
+{
+    w &= 0x5555;
+    w = (w | (w >> 1)) & 0x3333;
+    w = (w | (w >> 2)) & 0x0F0F;
+    w = (w | (w >> 4)) & 0x00FF;
+    return w;
+}
+
+/* Same as update(), for all channels at once on the packed port
+   word: each of the words below has bit n set for channel n.  The
+   counts are the ones of lut_x4, lut_x1 and lut_ctr, written as
+   logic on the old and new phases, which is all the state those
+   tables keep. */
+static void update_port(void *arg, long period)
+{
+    counter_t *cntr;
+    atomic *buf;
+    __u32 in, old, a, b, pa, pb, sa, sb, x, up, dn, z, latch, edge, ev;
+    int n;
+
+    cntr = arg;
+    in = *(port_data->in);
+    old = port_data->old;
+    if (in != old) {
+	port_data->old = in;
+	a = even_bits(in);
+	b = even_bits(in >> 1);
+	pa = even_bits(old);
+	pb = even_bits(old >> 1);
+	/* only one phase changed, both changing is a glitch */
+	sa = (a ^ pa) & ~(b ^ pb);
+	sb = (b ^ pb) & ~(a ^ pa);
+	x = a ^ b;
+	/* x4: A leading B counts up, B leading A counts down */
+	up = (sa & x) | (sb & ~x);
+	dn = (sa & ~x) | (sb & x);
+	/* x1: count on phase A edges with phase B low */
+	up = (up & port_data->x4) | (sa & a & ~b & ~port_data->x4);
+	dn = (dn & port_data->x4) | (sa & ~a & ~b & ~port_data->x4);
+	/* counter: rising edges of phase A */
+	up = (up & ~port_data->ctr) | (a & ~pa & port_data->ctr);
+	dn &= ~port_data->ctr;
+	/* rising edges of phase Z, and edges of the latch input */
+	z = (in >> 16) & ~(old >> 16) & 0xFF;
+	latch = (in >> 24) & 0xFF;
+	edge = latch ^ ((old >> 24) & 0xFF);
+	ev = up | dn | z | edge;
+	/* per channel work only where something happened */
+	while (ev) {
+	    n = __builtin_ffs(ev) - 1;
+	    ev &= ev - 1;
+	    if (n >= howmany) {
+		break;
+	    }
+	    buf = (atomic *) cntr[n].bp;
+	    if ((up | dn) & (1 << n)) {
+		*(cntr[n].raw_counts) += (up & (1 << n)) ? 1 : -1;
+		buf->raw_count = *(cntr[n].raw_counts);
+		buf->timestamp = timebase;
+		buf->count_detected = 1;
+	    }
+	    /* test for index enabled and rising edge on phase Z */
+	    if ((z & (1 << n)) && cntr[n].Zmask) {
+		buf->index_count = *(cntr[n].raw_counts);
+		buf->index_detected = 1;
+		cntr[n].Zmask = 0;
+	    }
+	    /* test for latch enabled and desired edge on latch input */
+	    if ((edge & (1 << n)) &&
+		((latch & (1 << n)) ? *(cntr[n].latch_rising) :
+		    *(cntr[n].latch_falling))) {
+		buf->latch_detected = 1;
+		buf->latch_count = *(cntr[n].raw_counts);
+	    }
+	}
+    }
+    /* increment main timestamp counter */
+    timebase += period;
+}
+
 
 static void capture(void *arg, long period)
 {
@@ -399,6 +525,7 @@ static void capture(void *arg, long period)
     __s32 delta_counts;
     __u32 delta_time;
     double vel, interp;
+    __u32 x4 = 0, ctr = 0;
 
     cntr = arg;
     for (n = 0; n < howmany; n++) {
@@ -428,6 +555,11 @@ static void capture(void *arg, long period)
 	} else {
 	    cntr->Zmask = 0;
 	}
+	/* mode pins, for update_port() */
+	if (port) {
+	    x4 |= (*(cntr->x4_mode) != 0) << n;
+	    ctr |= (*(cntr->counter_mode) != 0) << n;
+	}
 	/* done interacting with update() */
 	/* check for change in scale value */
 	if ( *(cntr->pos_scale) != cntr->old_scale ) {
@@ -511,6 +643,10 @@ static void capture(void *arg, long period)
 	/* move on to next channel */
 	cntr++;
     }
+    if (port) {
+	port_data->x4 = x4;
+	port_data->ctr = ctr;
+    }
     /* done */
 }
 
@@ -529,22 +665,24 @@ static int export_encoder(counter_t * addr,char * prefix)
     msg = rtapi_get_msg_level();
     rtapi_set_msg_level(RTAPI_MSG_WARN);
 
-    /* export pins for the quadrature inputs */
-    retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseA), comp_id,
-            "%s.phase-A", prefix);
-    if (retval != 0) {
-	return retval;
-    }
-    retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseB), comp_id,
-            "%s.phase-B", prefix);
-    if (retval != 0) {
-	return retval;
-    }
-    /* export pin for the index input */
-    retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseZ), comp_id,
-            "%s.phase-Z", prefix);
-    if (retval != 0) {
-	return retval;
+    /* export pins for the quadrature and index inputs, these are
+       bits of encoder.port-in with port=1 */
+    if (!port) {
+	retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseA), comp_id,
+		"%s.phase-A", prefix);
+	if (retval != 0) {
+	    return retval;
+	}
+	retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseB), comp_id,
+		"%s.phase-B", prefix);
+	if (retval != 0) {
+	    return retval;
+	}
+	retval = hal_pin_bit_newf(HAL_IN, &(addr->phaseZ), comp_id,
+		"%s.phase-Z", prefix);
+	if (retval != 0) {
+	    return retval;
+	}
     }
     /* export pin for the index enable input */
     retval = hal_pin_bit_newf(HAL_IO, &(addr->index_ena), comp_id,
@@ -559,10 +697,12 @@ static int export_encoder(counter_t * addr,char * prefix)
 	return retval;
     }
     /* export pins for position latching */
-    retval = hal_pin_bit_newf(HAL_IN, &(addr->latch_in), comp_id,
-            "%s.latch-input", prefix);
-    if (retval != 0) {
-	return retval;
+    if (!port) {
+	retval = hal_pin_bit_newf(HAL_IN, &(addr->latch_in), comp_id,
+		"%s.latch-input", prefix);
+	if (retval != 0) {
+	    return retval;
+	}
     }
     retval = hal_pin_bit_newf(HAL_IN, &(addr->latch_rising), comp_id,
             "%s.latch-rising", prefix);
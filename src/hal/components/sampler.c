@@ -22,6 +22,15 @@
 
     loadrt sampler depth=100 cfg=uffb
 
+    With 'ring=1' for a channel, samples are written as packed binary
+    records (see streamer.h) into a HAL record ring named 'sampler.N'
+    holding 'depth' records, instead of the fifo. 'halsampler' picks
+    the ring up automatically. Unlike the fifo, which overwrites the
+    oldest sample on overrun, a full ring drops the newest sample; the
+    gap shows in the sample numbers.
+
+    loadrt sampler depth=100000 cfg=ffffffffffffffffffff ring=1
+
 
 */
 
@@ -56,6 +65,7 @@
 #include "rtapi.h"              /* RTAPI realtime OS API */
 #include "rtapi_app.h"          /* RTAPI realtime module decls */
 #include "hal.h"                /* HAL public API decls */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
 #include "streamer.h"		/* decls and such for fifos */
 #include "rtapi_errno.h"
 #include "rtapi_string.h"
@@ -68,6 +78,8 @@ static char *cfg[MAX_SAMPLERS];	/* config string, no default */
 RTAPI_MP_ARRAY_STRING(cfg,MAX_SAMPLERS,"config string");
 static int depth[MAX_SAMPLERS];	/* depth of fifo, default 0 */
 RTAPI_MP_ARRAY_INT(depth,MAX_SAMPLERS,"fifo depth");
+static int ring[MAX_SAMPLERS];	/* use a HAL ring, default 0 */
+RTAPI_MP_ARRAY_INT(ring,MAX_SAMPLERS,"write packed records to HAL ring sampler.N");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -82,11 +94,14 @@ typedef struct {
     hal_bit_t *enable;		/* pin: enable sampling */
     hal_s32_t *overruns;	/* pin: number of overruns */
     hal_s32_t *sample_num;	/* pin: sample ID / timestamp */
+    ringbuffer_t ring;		/* ring=1: record ring */
+    int record_size;		/* ring=1: bytes per record */
 } sampler_t;
 
 /* other globals */
 static int comp_id;		/* component ID */
 static int shmem_id[MAX_SAMPLERS];
+static sampler_t *samplers[MAX_SAMPLERS];
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
@@ -95,6 +110,7 @@ static int shmem_id[MAX_SAMPLERS];
 static int parse_types(fifo_t *f, char *cfg);
 static int init_sampler(int num, fifo_t *tmp_fifo);
 static void sample(void *arg, long period);
+static void sample_ring(void *arg, long period);
 
 /***********************************************************************
 *                       INIT AND EXIT CODE                             *
@@ -118,7 +134,7 @@ int rtapi_app_main(void)
 	}
 	/* allow one extra "slot" for the sample number */
 	max_depth = MAX_SHMEM / (sizeof(shmem_data_t) * (tmp_fifo[n].num_pins + 1));
-	if ( depth[n] > max_depth ) {
+	if (( ring[n] == 0 ) && ( depth[n] > max_depth )) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"SAMPLER: ERROR: depth too large, max is %d\n", max_depth);
 	    return -ENOMEM;
@@ -163,11 +179,15 @@ void rtapi_app_exit(void)
 {
     int n;
 
-    /* free any shmem blocks */
+    /* free any shmem blocks and rings */
     for ( n = 0 ; n < MAX_SAMPLERS ; n++ ) {
 	if ( shmem_id[n] > 0 ) {
 	    rtapi_shmem_delete(shmem_id[n], comp_id);
 	}
+	if (( samplers[n] != NULL ) && ringbuffer_attached(&(samplers[n]->ring))) {
+	    hal_ring_detachf(&(samplers[n]->ring), "sampler.%d", n);
+	    hal_ring_deletef("sampler.%d", n);
+	}
     }
     hal_exit(comp_id);
 }
@@ -255,6 +275,71 @@ static void sample(void *arg, long period)
     *(samp->curr_depth) = newin - tmpout;
 }
 
+/* pack the pin values into a binary record, see streamer.h */
+static void pack_record(sampler_t *samp, unsigned char *rec)
+{
+    fifo_t *fifo = samp->fifo;
+    pin_data_t *pptr = (pin_data_t *)(samp+1);
+    real_t f;
+    __u32 u;
+    __s32 s;
+    int n;
+
+    u = (*samp->sample_num)++;
+    memcpy(rec, &u, sizeof(u));
+    rec += sizeof(u);
+    /* values are not aligned, so go through memcpy() */
+    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	switch ( fifo->type[n] ) {
+	case HAL_FLOAT:
+	    f = *(pptr->hfloat);
+	    memcpy(rec, &f, sizeof(f));
+	    rec += sizeof(f);
+	    break;
+	case HAL_BIT:
+	    *rec++ = *(pptr->hbit) ? 1 : 0;
+	    break;
+	case HAL_U32:
+	    u = *(pptr->hu32);
+	    memcpy(rec, &u, sizeof(u));
+	    rec += sizeof(u);
+	    break;
+	case HAL_S32:
+	    s = *(pptr->hs32);
+	    memcpy(rec, &s, sizeof(s));
+	    rec += sizeof(s);
+	    break;
+	default:
+	    break;
+	}
+	pptr++;
+    }
+}
+
+static void sample_ring(void *arg, long period)
+{
+    sampler_t *samp = arg;
+    ringheader_t *h = samp->ring.header;
+    void *rec;
+    size_t used;
+
+    if ( ! *(samp->enable) ) {
+	return;
+    }
+    if ( record_write_begin(&(samp->ring), &rec, samp->record_size) ) {
+	/* ring full: drop this sample, the reader sees the gap */
+	(*samp->sample_num)++;
+	(*samp->overruns)++;
+	*(samp->full) = 1;
+	return;
+    }
+    pack_record(samp, rec);
+    record_write_end(&(samp->ring), rec, samp->record_size);
+    *(samp->full) = 0;
+    used = (samp->ring.trailer->tail + h->size - h->head) % h->size;
+    *(samp->curr_depth) = used / record_space(samp->record_size);
+}
+
 /***********************************************************************
 *                   LOCAL FUNCTION DEFINITIONS                         *
 ************************************************************************/
@@ -397,28 +482,51 @@ static int init_sampler(int num, fifo_t *tmp_fifo)
     }
     /* export update function */
     rtapi_snprintf(buf, sizeof(buf), "sampler.%d", num);
-    retval = hal_export_funct(buf, sample, str, usefp, 0, comp_id);
+    retval = hal_export_funct(buf, ring[num] ? sample_ring : sample,
+			      str, usefp, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "SAMPLER: ERROR: function export failed\n");
 	return retval;
     }
-
-    /* alloc shmem for user/RT comms (fifo) */
-    size = sizeof(fifo_t) + (tmp_fifo->num_pins + 1) * tmp_fifo->depth * sizeof(shmem_data_t);
-    shmem_id[num] = rtapi_shmem_new(SAMPLER_SHMEM_KEY+num, comp_id, size);
-    if ( shmem_id[num] < 0 ) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "SAMPLEr: ERROR: couldn't allocate user/RT shared memory\n");
-	return -ENOMEM;
-    }
-    retval = rtapi_shmem_getptr(shmem_id[num], &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "SAMPLER: ERROR: couldn't map user/RT shared memory\n");
-	return -ENOMEM;
+    samplers[num] = str;
+
+    if ( ring[num] ) {
+	/* records go into a HAL ring, its scratchpad holds the fifo_t */
+	str->record_size = sampler_record_size(tmp_fifo);
+	size = record_space(str->record_size) * tmp_fifo->depth;
+	retval = hal_ring_newf(size, sizeof(fifo_t), 0, "sampler.%d", num);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SAMPLER: ERROR: couldn't create ring sampler.%d: %d\n",
+		num, retval);
+	    return retval;
+	}
+	retval = hal_ring_attachf(&(str->ring), NULL, "sampler.%d", num);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SAMPLER: ERROR: couldn't attach ring sampler.%d: %d\n",
+		num, retval);
+	    return retval;
+	}
+	fifo = str->ring.scratchpad;
+    } else {
+	/* alloc shmem for user/RT comms (fifo) */
+	size = sizeof(fifo_t) + (tmp_fifo->num_pins + 1) * tmp_fifo->depth * sizeof(shmem_data_t);
+	shmem_id[num] = rtapi_shmem_new(SAMPLER_SHMEM_KEY+num, comp_id, size);
+	if ( shmem_id[num] < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SAMPLEr: ERROR: couldn't allocate user/RT shared memory\n");
+	    return -ENOMEM;
+	}
+	retval = rtapi_shmem_getptr(shmem_id[num], &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SAMPLER: ERROR: couldn't map user/RT shared memory\n");
+	    return -ENOMEM;
+	}
+	fifo = shmem_ptr;
     }
-    fifo = shmem_ptr;
     str->fifo = fifo;
     /* copy data from temp_fifo */
     *fifo = *tmp_fifo;
@@ -20,7 +20,7 @@
 
     Invoking:
 
-    halsampler [-c chan_num] [-n num_samples] [-t]
+    halsampler [-c chan_num] [-n num_samples] [-t] [-b [-d]] [-N name] [file]
 
     'chan_num', if present, specifies the sampler channel to use.
     The default is channel zero.
@@ -32,6 +32,19 @@
     '-t' tells sampler to print the sample number at the start
     of each line.
 
+    '-b' writes binary output instead of text: a self-describing
+    header followed by packed records, see sampler_hdr_t in streamer.h.
+    Output is handed to a writer thread in large buffers, so capture
+    throughput is bounded by the disk rather than by formatting.
+    Lost samples are reported on stderr at exit; the gaps are visible
+    in the record sample numbers.
+
+    '-d' (with -b and a file name) writes the file with O_DIRECT,
+    bypassing the page cache.
+
+    If the realtime part was loaded with 'ring=1' for the channel,
+    samples are read from the HAL ring 'sampler.N' instead of the fifo.
+
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -59,6 +72,7 @@
     information, go to www.linuxcnc.org.
 */
 
+#define _GNU_SOURCE		/* O_DIRECT */
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -69,15 +83,43 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "hal.h"                /* HAL public API decls */
+#include "hal_priv.h"		/* halpr_find_pin_by_name() */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
 #include "streamer.h"
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+/* binary output: the main loop fills one buffer while the writer
+   thread writes the other one */
+#define WRITE_BUF_SIZE	(4 * 1024 * 1024)
+#define DIRECT_ALIGN	4096	/* O_DIRECT buffer, offset and size alignment */
+
+typedef struct {
+    int fd;
+    int direct;			/* O_DIRECT: pad the last block, then truncate */
+    char *buf[2];
+    size_t fill[2];
+    int cur;			/* buffer being filled */
+    int busy;			/* other buffer is being written */
+    int done;
+    int error;			/* errno of a failed write */
+    off_t total;		/* bytes handed to the writer */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} writer_t;
+
+static int writer_start(writer_t *w, int fd, int direct);
+static int writer_put(writer_t *w, const void *data, size_t size);
+static int writer_finish(writer_t *w);
+
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
 ************************************************************************/
@@ -87,6 +129,9 @@ int shmem_id = -1;
 int exitval = 1;	/* program return code - 1 means error */
 int ignore_sig = 0;	/* used to flag critical regions */
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of sampler */
+volatile sig_atomic_t stop = 0;	/* binary mode: finish the output and exit */
+int binary = 0;		/* binary output */
+ringbuffer_t ring;	/* ring=1 transport */
 
 /***********************************************************************
 *                            MAIN PROGRAM                              *
@@ -98,6 +143,11 @@ static void quit(int sig)
     if ( ignore_sig ) {
 	return;
     }
+    if ( binary ) {
+	/* let the main loop flush the output buffers */
+	stop = 1;
+	return;
+    }
     if ( shmem_id >= 0 ) {
 	rtapi_shmem_delete(shmem_id, comp_id);
     }
@@ -107,29 +157,219 @@ static void quit(int sig)
     exit(exitval);
 }
 
-#define BUF_SIZE 4000
+/* fill in the binary output header from the fifo description */
+static void fill_header(sampler_hdr_t *hdr, const fifo_t *fifo, int channel)
+{
+    char pname[HAL_NAME_LEN + 1];
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    int n;
+
+    memset(hdr, 0, sizeof(sampler_hdr_t));
+    strncpy(hdr->magic, SAMPLER_HDR_MAGIC, sizeof(hdr->magic));
+    hdr->version = SAMPLER_HDR_VERSION;
+    hdr->hdr_size = sizeof(sampler_hdr_t);
+    hdr->record_size = sampler_record_size(fifo);
+    hdr->num_pins = fifo->num_pins;
+    rtapi_mutex_get(&(hal_data->mutex));
+    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	hdr->type[n] = fifo->type[n];
+	/* name the value after the signal feeding the pin, if any */
+	snprintf(pname, sizeof(pname), "sampler.%d.pin.%d", channel, n);
+	pin = halpr_find_pin_by_name(pname);
+	if (( pin != NULL ) && ( pin->signal != 0 )) {
+	    sig = SHMPTR(pin->signal);
+	    strncpy(hdr->name[n], sig->name, HAL_NAME_LEN);
+	} else {
+	    strncpy(hdr->name[n], pname, HAL_NAME_LEN);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+/* convert between fifo slots and the packed record layout */
+static void pack(const fifo_t *fifo, __u32 sample, const shmem_data_t *buf,
+		 unsigned char *rec)
+{
+    memcpy(rec, &sample, sizeof(sample));
+    stream_pack_values(fifo, buf, rec + sizeof(sample));
+}
+
+static __u32 unpack(const fifo_t *fifo, const unsigned char *rec,
+		    shmem_data_t *buf)
+{
+    __u32 sample;
+
+    memcpy(&sample, rec, sizeof(sample));
+    stream_unpack_values(fifo, rec + sizeof(sample), buf);
+    return sample;
+}
+
+static void *writer_thread(void *arg)
+{
+    writer_t *w = arg;
+    char *p;
+    size_t left;
+    ssize_t n;
+    int b, error = 0;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+	while ( !w->busy && !w->done ) {
+	    pthread_cond_wait(&w->cond, &w->lock);
+	}
+	if ( !w->busy ) {
+	    break;
+	}
+	b = w->cur ^ 1;
+	pthread_mutex_unlock(&w->lock);
+	p = w->buf[b];
+	left = w->fill[b];
+	while (( left > 0 ) && !error ) {
+	    n = write(w->fd, p, left);
+	    if ( n < 0 ) {
+		if ( errno != EINTR ) {
+		    error = errno;
+		}
+		continue;
+	    }
+	    p += n;
+	    left -= n;
+	}
+	pthread_mutex_lock(&w->lock);
+	w->error = error;
+	w->fill[b] = 0;
+	w->busy = 0;
+	pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static int writer_start(writer_t *w, int fd, int direct)
+{
+    int n;
+
+    memset(w, 0, sizeof(writer_t));
+    w->fd = fd;
+    w->direct = direct;
+    for ( n = 0 ; n < 2 ; n++ ) {
+	/* aligned for O_DIRECT */
+	if ( posix_memalign((void **)&(w->buf[n]), DIRECT_ALIGN, WRITE_BUF_SIZE) ) {
+	    return -ENOMEM;
+	}
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    return -pthread_create(&w->thread, NULL, writer_thread, w);
+}
+
+/* hand the current buffer to the writer thread, waiting for the
+   previous one to be written */
+static int writer_flush(writer_t *w)
+{
+    int retval;
+
+    pthread_mutex_lock(&w->lock);
+    while ( w->busy ) {
+	pthread_cond_wait(&w->cond, &w->lock);
+    }
+    retval = -w->error;
+    w->busy = 1;
+    w->cur ^= 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    return retval;
+}
+
+static int writer_put(writer_t *w, const void *data, size_t size)
+{
+    const char *p = data;
+    size_t n;
+    int retval;
+
+    while ( size > 0 ) {
+	n = WRITE_BUF_SIZE - w->fill[w->cur];
+	if ( n > size ) {
+	    n = size;
+	}
+	memcpy(w->buf[w->cur] + w->fill[w->cur], p, n);
+	w->fill[w->cur] += n;
+	w->total += n;
+	p += n;
+	size -= n;
+	if ( w->fill[w->cur] == WRITE_BUF_SIZE ) {
+	    if (( retval = writer_flush(w) ) < 0) {
+		return retval;
+	    }
+	}
+    }
+    return 0;
+}
+
+static int writer_finish(writer_t *w)
+{
+    size_t pad;
+    int retval = 0;
+
+    if ( w->direct ) {
+	/* O_DIRECT writes whole blocks: pad, and truncate the file below */
+	pad = -w->fill[w->cur] & (DIRECT_ALIGN - 1);
+	memset(w->buf[w->cur] + w->fill[w->cur], 0, pad);
+	w->fill[w->cur] += pad;
+    }
+    if ( w->fill[w->cur] > 0 ) {
+	retval = writer_flush(w);
+    }
+    pthread_mutex_lock(&w->lock);
+    w->done = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    if ( w->error ) {
+	retval = -w->error;
+    }
+    if (( retval == 0 ) && w->direct && ( ftruncate(w->fd, w->total) < 0 )) {
+	retval = -errno;
+    }
+    free(w->buf[0]);
+    free(w->buf[1]);
+    return retval;
+}
 
 int main(int argc, char **argv)
 {
-    int n, channel, retval, size, tag;
+    int n, channel, retval, size, tag, direct, use_ring, outfd, writing;
     long int samples;
-    unsigned long this_sample;
+    unsigned long this_sample, lost;
+    __u32 sample32;
     char  *cp2;
     char *name = NULL;
+    char ringname[HAL_NAME_LEN + 1];
     void *shmem_ptr;
     fifo_t *fifo;
     shmem_data_t *data, *dptr, buf[MAX_PINS];
+    unsigned char rec[sizeof(__u32) + MAX_PINS * sizeof(real_t)];
+    const void *rptr;
+    size_t rsize;
     int tmpout, newout;
     struct timespec delay;
+    sampler_hdr_t hdr;
+    writer_t writer;
 
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
     tag = 0;
+    direct = 0;
+    use_ring = 0;
+    outfd = 1;
+    writing = 0;
+    lost = 0;
     samples = -1;  /* -1 means run forever */
     int  opt;
 
-    while ((opt = getopt(argc, argv, "tn:c:N:")) != -1) {
+    while ((opt = getopt(argc, argv, "tbdn:c:N:")) != -1) {
 	switch (opt) {
 	case 'c':
 	    channel = strtol(optarg, &cp2, 10);
@@ -151,10 +391,18 @@ int main(int argc, char **argv)
 	case 't':
 	    tag = 1;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
+	case 'd':
+	    direct = 1;
+	    break;
 	default: /* '?' */
 	    fprintf(stderr,"ERROR: unknown option '%c'\n", opt);
 	    fprintf(stderr,"valid options are:\n" );
 	    fprintf(stderr,"\t-t\t\ttag values with sample number\n" );
+	    fprintf(stderr,"\t-b\t\tbinary output\n" );
+	    fprintf(stderr,"\t-d\t\tbinary output to file with O_DIRECT\n" );
 	    fprintf(stderr,"\t-c <int>\t channel number\n" );
 	    fprintf(stderr,"\t-n <int>\t sample count\n" );
 	    fprintf(stderr,"\t-N <name>\t set HAL component name\n" );
@@ -162,16 +410,30 @@ int main(int argc, char **argv)
 	    exit(EXIT_FAILURE);
 	}
     }
+    if (direct && ((optind >= argc) || !binary)) {
+	fprintf(stderr, "ERROR: -d requires -b and a filename\n");
+	exit(1);
+    }
     if (optind < argc) {
 	int fd;
 	if(argc > optind+1) {
 	    fprintf(stderr, "ERROR: At most one filename may be specified\n");
 	    exit(1);
 	}
-	// make stdout be the named file
-	fd = open(argv[optind], O_WRONLY | O_CREAT, 0666);
-	close(1);
-	dup2(fd, 1);
+	if (binary) {
+	    outfd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC |
+			 (direct ? O_DIRECT : 0), 0666);
+	    if (outfd < 0) {
+		fprintf(stderr, "ERROR: can't open '%s': %s\n",
+			argv[optind], strerror(errno));
+		exit(1);
+	    }
+	} else {
+	    // make stdout be the named file
+	    fd = open(argv[optind], O_WRONLY | O_CREAT, 0666);
+	    close(1);
+	    dup2(fd, 1);
+	}
     }
 
     /* register signal handlers - if the process is killed
@@ -195,70 +457,159 @@ int main(int argc, char **argv)
 	goto out;
     }
     hal_ready(comp_id);
-    /* open shmem for user/RT comms (fifo) */
-    /* initial size is unknown, assume only the fifo structure */
-    shmem_id = rtapi_shmem_new(SAMPLER_SHMEM_KEY+channel, comp_id, sizeof(fifo_t));
-    if ( shmem_id < 0 ) {
-	fprintf(stderr, "ERROR: couldn't allocate user/RT shared memory\n");
-	goto out;
-    }
-    retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	fprintf(stderr, "ERROR: couldn't map user/RT shared memory\n");
-	goto out;
-    }
-    fifo = shmem_ptr;
-    if ( fifo->magic != FIFO_MAGIC_NUM ) {
-	fprintf(stderr, "ERROR: channel %d realtime part is not loaded\n", channel );
-	goto out;
-    }
-    /* now use data in fifo structure to calculate proper shmem size */
-    size = sizeof(fifo_t) + (1+fifo->num_pins) * fifo->depth * sizeof(shmem_data_t);
-    /* close shmem, re-open with proper size */
-    rtapi_shmem_delete(shmem_id, comp_id);
-    shmem_id = rtapi_shmem_new(SAMPLER_SHMEM_KEY+channel, comp_id, size);
-    if ( shmem_id < 0 ) {
-	fprintf(stderr, "ERROR: couldn't re-allocate user/RT shared memory\n");
-	goto out;
+
+    /* with ring=1, the realtime part writes records into a HAL ring */
+    snprintf(ringname, sizeof(ringname), "sampler.%d", channel);
+    rtapi_mutex_get(&(hal_data->mutex));
+    use_ring = (halpr_find_ring_by_name(ringname) != NULL);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if ( use_ring ) {
+	retval = hal_ring_attach(ringname, &ring, NULL);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't attach ring %s: %d\n",
+		    ringname, retval);
+	    use_ring = 0;
+	    goto out;
+	}
+	fifo = ring.scratchpad;
+	if ( fifo->magic != FIFO_MAGIC_NUM ) {
+	    fprintf(stderr, "ERROR: ring %s is not a sampler ring\n", ringname);
+	    goto out;
+	}
+	data = NULL;
+    } else {
+	/* open shmem for user/RT comms (fifo) */
+	/* initial size is unknown, assume only the fifo structure */
+	shmem_id = rtapi_shmem_new(SAMPLER_SHMEM_KEY+channel, comp_id, sizeof(fifo_t));
+	if ( shmem_id < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't allocate user/RT shared memory\n");
+	    goto out;
+	}
+	retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't map user/RT shared memory\n");
+	    goto out;
+	}
+	fifo = shmem_ptr;
+	if ( fifo->magic != FIFO_MAGIC_NUM ) {
+	    fprintf(stderr, "ERROR: channel %d realtime part is not loaded\n", channel );
+	    goto out;
+	}
+	/* now use data in fifo structure to calculate proper shmem size */
+	size = sizeof(fifo_t) + (1+fifo->num_pins) * fifo->depth * sizeof(shmem_data_t);
+	/* close shmem, re-open with proper size */
+	rtapi_shmem_delete(shmem_id, comp_id);
+	shmem_id = rtapi_shmem_new(SAMPLER_SHMEM_KEY+channel, comp_id, size);
+	if ( shmem_id < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't re-allocate user/RT shared memory\n");
+	    goto out;
+	}
+	retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't re-map user/RT shared memory\n");
+	    goto out;
+	}
+	fifo = shmem_ptr;
+	data = fifo->data;
     }
-    retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	fprintf(stderr, "ERROR: couldn't re-map user/RT shared memory\n");
+    if (( fifo->num_pins < 0 ) || ( fifo->num_pins > MAX_PINS )) {
+	fprintf(stderr, "ERROR: channel %d has an invalid pin count %d\n",
+		channel, fifo->num_pins );
 	goto out;
     }
-    fifo = shmem_ptr;
-    data = fifo->data;
-    while ( samples != 0 ) {
-	while ( fifo->in == fifo->out ) {
-            /* fifo empty, sleep for 10mS */
-	    delay.tv_sec = 0;
-	    delay.tv_nsec = 10000000;
-	    nanosleep(&delay,NULL);
-	}
-	/* make pointer to fifo entry */
-	tmpout = fifo->out;
-	newout = tmpout + 1;
-	if ( newout >= fifo->depth ) {
-	    newout = 0;
+    size = sampler_record_size(fifo);
+
+    if ( binary ) {
+	fill_header(&hdr, fifo, channel);
+	retval = writer_start(&writer, outfd, direct);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't start writer: %s\n", strerror(-retval));
+	    goto out;
 	}
-	dptr = &data[tmpout * (fifo->num_pins+1)];
-	/* read data from shmem into buffer */
-	for ( n = 0 ; n < fifo->num_pins ; n++ ) {
-	    buf[n] = *(dptr++);
+	writing = 1;
+	if (( retval = writer_put(&writer, &hdr, sizeof(hdr)) ) < 0) {
+	    goto write_error;
 	}
-	/* and read sample number */
-	this_sample = dptr->u;
-	if ( fifo->out != tmpout ) {
-	    /* the sample was overwritten while we were reading it */
-	    /* so ignore it */
-	    continue;
+    }
+
+    while (( samples != 0 ) && !stop ) {
+	if ( use_ring ) {
+	    if ( record_read(&ring, &rptr, &rsize) ) {
+		/* ring empty, sleep for 10mS, 1mS in binary mode */
+		delay.tv_sec = 0;
+		delay.tv_nsec = binary ? 1000000 : 10000000;
+		nanosleep(&delay,NULL);
+		continue;
+	    }
+	    if ( rsize != (size_t)size ) {
+		fprintf(stderr, "ERROR: ring %s record is %zu bytes, expected %d\n",
+			ringname, rsize, size );
+		record_shift(&ring);
+		if ( writing ) {
+		    /* keep what was captured so far */
+		    writer_finish(&writer);
+		}
+		goto out;
+	    }
+	    memcpy(rec, rptr, size);
+	    record_shift(&ring);
+	    if ( binary ) {
+		/* already in output format */
+		memcpy(&sample32, rec, sizeof(sample32));
+		this_sample = sample32;
+	    } else {
+		this_sample = unpack(fifo, rec, buf);
+	    }
 	} else {
-	    /* update 'out' for next sample */
-	    fifo->out = newout;
+	    if ( fifo->in == fifo->out ) {
+		/* fifo empty, sleep for 10mS, 1mS in binary mode */
+		delay.tv_sec = 0;
+		delay.tv_nsec = binary ? 1000000 : 10000000;
+		nanosleep(&delay,NULL);
+		continue;
+	    }
+	    /* make pointer to fifo entry */
+	    tmpout = fifo->out;
+	    newout = tmpout + 1;
+	    if ( newout >= fifo->depth ) {
+		newout = 0;
+	    }
+	    dptr = &data[tmpout * (fifo->num_pins+1)];
+	    /* read data from shmem into buffer */
+	    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+		buf[n] = *(dptr++);
+	    }
+	    /* and read sample number */
+	    this_sample = dptr->u;
+	    if ( fifo->out != tmpout ) {
+		/* the sample was overwritten while we were reading it */
+		/* so ignore it */
+		continue;
+	    } else {
+		/* update 'out' for next sample */
+		fifo->out = newout;
+	    }
+	    if ( binary ) {
+		pack(fifo, this_sample, buf, rec);
+	    }
+	}
+	/* sample numbers are 32 bits wide in the realtime part */
+	if ( (__u32)this_sample != (__u32)(fifo->last_sample + 1) ) {
+	    if ( binary ) {
+		lost += (__u32)(this_sample - fifo->last_sample - 1);
+	    } else {
+		printf ( "overrun\n" );
+	    }
 	}
-	if ( this_sample != ++(fifo->last_sample) ) {
-	    printf ( "overrun\n" );
-	    fifo->last_sample = this_sample;
+	fifo->last_sample = this_sample;
+	if ( binary ) {
+	    if (( retval = writer_put(&writer, rec, size) ) < 0) {
+		goto write_error;
+	    }
+	    if ( samples > 0 ) {
+		samples--;
+	    }
+	    continue;
 	}
 	if ( tag ) {
 	    printf ( "%ld ", this_sample );
@@ -291,11 +642,30 @@ int main(int argc, char **argv)
 	    samples--;
 	}
     }
+    if ( writing ) {
+	writing = 0;
+	if (( retval = writer_finish(&writer) ) < 0) {
+	    goto write_error;
+	}
+	if ( lost ) {
+	    fprintf(stderr, "halsampler: %lu samples lost to overruns\n", lost);
+	}
+    }
     /* run was succesfull */
     exitval = 0;
+    goto out;
+
+write_error:
+    fprintf(stderr, "ERROR: write failed: %s\n", strerror(-retval));
+    if ( writing ) {
+	writer_finish(&writer);
+    }
 
 out:
     ignore_sig = 1;
+    if ( use_ring ) {
+	hal_ring_detach(ringname, &ring);
+    }
     if ( shmem_id >= 0 ) {
 	rtapi_shmem_delete(shmem_id, comp_id);
     }
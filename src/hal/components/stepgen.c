@@ -303,8 +303,9 @@
 
 #include <float.h>
 #include "rtapi_math.h"
+#include "stepgen_core.h"	/* make_pulses state and kernel */
 
-#define MAX_CHAN 16
+#define MAX_CHAN STEPGEN_MAX_CHAN
 #define MAX_CYCLE 18
 #define USER_STEP_TYPE 13
 
@@ -324,26 +325,14 @@ RTAPI_MP_ARRAY_INT(user_step_type, MAX_CYCLE,
 *                STRUCTURES AND GLOBAL VARIABLES                       *
 ************************************************************************/
 
-/** This structure contains the runtime data for a single generator. */
-
-/* structure members are ordered to optimize caching for makepulses,
-   which runs in the fastest thread */
+/** This structure contains the runtime data for a single generator,
+    except for the state used by makepulses for every channel, which
+    is kept in the structure-of-arrays 'stepgen_core_t'. */
 
 typedef struct {
-    /* stuff that is both read and written by makepulses */
-    unsigned int timer1;	/* times out when step pulse should end */
-    unsigned int timer2;	/* times out when safe to change dir */
-    unsigned int timer3;	/* times out when safe to step in new dir */
-    int hold_dds;		/* prevents accumulator from updating */
-    long addval;		/* actual frequency generator add value */
-    volatile long long accum;	/* frequency generator accumulator */
-    hal_s32_t rawcount;		/* param: position feedback in counts */
-    int curr_dir;		/* current direction */
+    /* stuff that is read and written by makepulses for step types 1+ */
     int state;			/* current position in state table */
     /* stuff that is read but not written by makepulses */
-    hal_bit_t *enable;		/* pin for enable stepgen */
-    long target_addval;		/* desired freq generator add value */
-    long deltalim;		/* max allowed change per period */
     hal_u32_t step_len;		/* parameter: step pulse length */
     hal_u32_t dir_hold_dly;	/* param: direction hold time or delay */
     hal_u32_t dir_setup;	/* param: direction setup time */
@@ -376,6 +365,13 @@ typedef struct {
 /* ptr to array of stepgen_t structs in shared memory, 1 per channel */
 static stepgen_t *stepgen_array;
 
+/* ptr to makepulses state for all channels, in shared memory */
+static stepgen_core_t *core;
+
+/* channels with step types other than step/dir */
+static int num_other;
+static int other_chan[MAX_CHAN];
+
 /* lookup tables for stepping types 2 and higher - phase A is the LSB */
 
 static unsigned char master_lut[][MAX_CYCLE] = {
@@ -408,7 +404,7 @@ static unsigned char num_phases_lut[] =
 #define UP_PIN		0	/* output phase used for UP signal */
 #define DOWN_PIN	1	/* output phase used for DOWN signal */
 
-#define PICKOFF		28	/* bit location in DDS accum */
+#define PICKOFF		STEPGEN_PICKOFF	/* bit location in DDS accum */
 
 
 
@@ -492,12 +488,14 @@ int rtapi_app_main(void)
     }
     /* allocate shared memory for counter data */
     stepgen_array = hal_malloc(num_chan * sizeof(stepgen_t));
-    if (stepgen_array == 0) {
+    core = hal_malloc(sizeof(stepgen_core_t));
+    if ((stepgen_array == 0) || (core == 0)) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"STEPGEN: ERROR: hal_malloc() failed\n");
 	hal_exit(comp_id);
 	return -1;
     }
+    core->num_chan = num_chan;
     /* export all the variables for each pulse generator */
     for (n = 0; n < num_chan; n++) {
 	/* export all vars */
@@ -512,7 +510,7 @@ int rtapi_app_main(void)
     }
     /* export functions */
     retval = hal_export_funct("stepgen.make-pulses", make_pulses,
-	stepgen_array, 0, 0, comp_id);
+	core, 0, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "STEPGEN: ERROR: makepulses funct export failed\n");
@@ -558,131 +556,25 @@ void rtapi_app_exit(void)
 static void make_pulses(void *arg, long period)
 {
     stepgen_t *stepgen;
-    long old_addval, target_addval, new_addval, step_now;
-    int n, p;
+    int k, n, p;
     unsigned char outbits;
 
     /* store period so scaling constants can be (re)calculated */
     periodns = period;
-    /* point to stepgen data structures */
-    stepgen = arg;
 
-    for (n = 0; n < num_chan; n++) {
-	/* decrement "timing constraint" timers */
-	if ( stepgen->timer1 > 0 ) {
-	    if ( stepgen->timer1 > periodns ) {
-		stepgen->timer1 -= periodns;
-	    } else {
-		stepgen->timer1 = 0;
-	    }
-	}
-	if ( stepgen->timer2 > 0 ) {
-	    if ( stepgen->timer2 > periodns ) {
-		stepgen->timer2 -= periodns;
-	    } else {
-		stepgen->timer2 = 0;
-	    }
-	}
-	if ( stepgen->timer3 > 0 ) {
-	    if ( stepgen->timer3 > periodns ) {
-		stepgen->timer3 -= periodns;
-	    } else {
-		stepgen->timer3 = 0;
-		/* last timer timed out, cancel hold */
-		stepgen->hold_dds = 0;
-	    }
-	}
-	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
-	    /* update addval (ramping) */
-	    old_addval = stepgen->addval;
-	    target_addval = stepgen->target_addval;
-	    if (stepgen->deltalim != 0) {
-		/* implement accel/decel limit */
-		if (target_addval > (old_addval + stepgen->deltalim)) {
-		    /* new value is too high, increase addval as far as possible */
-		    new_addval = old_addval + stepgen->deltalim;
-		} else if (target_addval < (old_addval - stepgen->deltalim)) {
-		    /* new value is too low, decrease addval as far as possible */
-		    new_addval = old_addval - stepgen->deltalim;
-		} else {
-		    /* new value can be reached in one step - do it */
-		    new_addval = target_addval;
-		}
-	    } else {
-		/* go to new freq without any ramping */
-		new_addval = target_addval;
-	    }
-	    /* save result */
-	    stepgen->addval = new_addval;
-	    /* check for direction reversal */
-	    if (((new_addval >= 0) && (old_addval < 0)) ||
-		((new_addval < 0) && (old_addval >= 0))) {
-		/* reversal required, can we do so now? */
-		if ( stepgen->timer3 != 0 ) {
-		    /* no - hold everything until delays time out */
-		    stepgen->hold_dds = 1;
-		}
-	    }
-	}
-	/* update DDS */
-	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
-	    /* save current value of low half of accum */
-	    step_now = stepgen->accum;
-	    /* update the accumulator */
-	    stepgen->accum += stepgen->addval;
-	    /* test for changes in low half of accum */
-	    step_now ^= stepgen->accum;
-	    /* we only care about the pickoff bit */
-	    step_now &= (1L << PICKOFF);
-	    /* update rawcounts parameter */
-	    stepgen->rawcount = stepgen->accum >> PICKOFF;
-	} else {
-	    /* DDS is in hold, no steps */
-	    step_now = 0;
-	}
-	if ( stepgen->timer2 == 0 ) {
-	    /* update direction - do not change if addval = 0 */
-	    if ( stepgen->addval > 0 ) {
-		stepgen->curr_dir = 1;
-	    } else if ( stepgen->addval < 0 ) {
-		stepgen->curr_dir = -1;
-	    }
-	}
-	if ( step_now ) {
-	    /* (re)start various timers */
-	    /* timer 1 = time till end of step pulse */
-	    stepgen->timer1 = stepgen->step_len;
-	    /* timer 2 = time till allowed to change dir pin */
-	    stepgen->timer2 = stepgen->timer1 + stepgen->dir_hold_dly;
-	    /* timer 3 = time till allowed to step the other way */
-	    stepgen->timer3 = stepgen->timer2 + stepgen->dir_setup;
-	    if ( stepgen->step_type >= 2 ) {
-		/* update state */
-		stepgen->state += stepgen->curr_dir;
-		if ( stepgen->state < 0 ) {
-		    stepgen->state = stepgen->cycle_max;
-		} else if ( stepgen->state > stepgen->cycle_max ) {
-		    stepgen->state = 0;
-		}
-	    }
-	}
-	/* generate output, based on stepping type */
-	if (stepgen->step_type == 0) {
-	    /* step/dir output */
-	    if ( stepgen->timer1 != 0 ) {
-		 *(stepgen->phase[STEP_PIN]) = 1;
-	    } else {
-		 *(stepgen->phase[STEP_PIN]) = 0;
-	    }
-	    if ( stepgen->curr_dir < 0 ) {
-		 *(stepgen->phase[DIR_PIN]) = 1;
-	    } else {
-		 *(stepgen->phase[DIR_PIN]) = 0;
-	    }
-	} else if (stepgen->step_type == 1) {
+    /* timers, ramping and DDS for all channels at once */
+    stepgen_core_update(arg, periodns);
+    /* outputs for the step/dir channels */
+    stepgen_core_stepdir(arg);
+
+    /* outputs for the other stepping types */
+    for (k = 0; k < num_other; k++) {
+	n = other_chan[k];
+	stepgen = &(stepgen_array[n]);
+	if (stepgen->step_type == 1) {
 	    /* up/down */
-	    if ( stepgen->timer1 != 0 ) {
-		if ( stepgen->curr_dir < 0 ) {
+	    if ( core->timer1[n] != 0 ) {
+		if ( core->curr_dir[n] < 0 ) {
 		    *(stepgen->phase[UP_PIN]) = 0;
 		    *(stepgen->phase[DOWN_PIN]) = 1;
 		} else {
@@ -695,6 +587,15 @@ static void make_pulses(void *arg, long period)
 	    }
 	} else {
 	    /* step type 2 or greater */
+	    if ( core->step_now[n] ) {
+		/* update state */
+		stepgen->state += core->curr_dir[n];
+		if ( stepgen->state < 0 ) {
+		    stepgen->state = stepgen->cycle_max;
+		} else if ( stepgen->state > stepgen->cycle_max ) {
+		    stepgen->state = 0;
+		}
+	    }
 	    /* look up correct output pattern */
 	    outbits = (stepgen->lut)[stepgen->state];
 	    /* now output the phase bits */
@@ -705,28 +606,35 @@ static void make_pulses(void *arg, long period)
 		outbits >>= 1;
 	    }
 	}
-	/* move on to next step generator */
-	stepgen++;
     }
     /* done */
 }
 
+/* 'accum' is a long long, and its remotely possible that make_pulses
+   could change it half-way through a read. So we have a crude atomic
+   read routine */
+static long long read_accum(int n)
+{
+    volatile long long *accum = &(core->accum[n]);
+    long long accum_a, accum_b;
+
+    do {
+	accum_a = *accum;
+	accum_b = *accum;
+    } while ( accum_a != accum_b );
+    return accum_a;
+}
+
 static void update_pos(void *arg, long period)
 {
-    long long int accum_a, accum_b;
+    long long int accum_a;
     stepgen_t *stepgen;
     int n;
 
     stepgen = arg;
 
     for (n = 0; n < num_chan; n++) {
-	/* 'accum' is a long long, and its remotely possible that
-	   make_pulses could change it half-way through a read.
-	   So we have a crude atomic read routine */
-	do {
-	    accum_a = stepgen->accum;
-	    accum_b = stepgen->accum;
-	} while ( accum_a != accum_b );
+	accum_a = read_accum(n);
 	/* compute integer counts */
 	*(stepgen->count) = accum_a >> PICKOFF;
 	/* check for change in scale value */
@@ -767,7 +675,7 @@ static void update_freq(void *arg, long period)
     stepgen_t *stepgen;
     int n, newperiod;
     long min_step_period;
-    long long int accum_a, accum_b;
+    long long int accum_a;
     double pos_cmd, vel_cmd, curr_pos, curr_vel, avg_v, max_freq, max_ac;
     double match_ac, match_time, est_out, est_cmd, est_err, dp, dv, new_vel;
     double desired_freq;
@@ -859,16 +767,20 @@ static void update_freq(void *arg, long period)
 	    stepgen->old_dir_hold_dly = ulceil(stepgen->dir_hold_dly, periodns);
 	    stepgen->dir_hold_dly = stepgen->old_dir_hold_dly;
 	}
+	/* hand the validated timing to makepulses */
+	core->step_len[n] = stepgen->step_len;
+	core->dir_hold_dly[n] = stepgen->dir_hold_dly;
+	core->dir_setup[n] = stepgen->dir_setup;
 	/* test for disabled stepgen */
-	if (*stepgen->enable == 0) {
+	if (*(core->enable[n]) == 0) {
 	    /* disabled: keep updating old_pos_cmd (if in pos ctrl mode) */
 	    if ( stepgen->pos_mode ) {
 		stepgen->old_pos_cmd = *stepgen->pos_cmd * stepgen->pos_scale;
 	    }
 	    /* set velocity to zero */
 	    stepgen->freq = 0;
-	    stepgen->addval = 0;
-	    stepgen->target_addval = 0;
+	    core->addval[n] = 0;
+	    core->target_addval[n] = 0;
 	    /* and skip to next one */
 	    stepgen++;
 	    continue;
@@ -926,13 +838,7 @@ static void update_freq(void *arg, long period)
 	    /* calculate velocity command in counts/sec */
 	    vel_cmd = (pos_cmd - stepgen->old_pos_cmd) * recip_dt;
 	    stepgen->old_pos_cmd = pos_cmd;
-	    /* 'accum' is a long long, and its remotely possible that
-	       make_pulses could change it half-way through a read.
-	       So we have a crude atomic read routine */
-	    do {
-		accum_a = stepgen->accum;
-		accum_b = stepgen->accum;
-	    } while ( accum_a != accum_b );
+	    accum_a = read_accum(n);
 	    /* convert from fixed point to double, after subtracting
 	       the one-half step offset */
 	    curr_pos = (accum_a-(1<< (PICKOFF-1))) * (1.0 / (1L << PICKOFF));
@@ -1016,9 +922,9 @@ static void update_freq(void *arg, long period)
 	}
 	stepgen->freq = new_vel;
 	/* calculate new addval */
-	stepgen->target_addval = stepgen->freq * freqscale;
+	core->target_addval[n] = stepgen->freq * freqscale;
 	/* calculate new deltalim */
-	stepgen->deltalim = max_ac * accelscale;
+	core->deltalim[n] = max_ac * accelscale;
 	/* move on to next channel */
 	stepgen++;
     }
@@ -1041,7 +947,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
     rtapi_set_msg_level(RTAPI_MSG_WARN);
 
     /* export param variable for raw counts */
-    retval = hal_param_s32_newf(HAL_RO, &(addr->rawcount), comp_id,
+    retval = hal_param_s32_newf(HAL_RO, &(core->rawcount[num]), comp_id,
 	"stepgen.%d.rawcounts", num);
     if (retval != 0) { return retval; }
     /* export pin for counts captured by update() */
@@ -1062,7 +968,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
     }
     if (retval != 0) { return retval; }
     /* export pin for enable command */
-    retval = hal_pin_bit_newf(HAL_IN, &(addr->enable), comp_id,
+    retval = hal_pin_bit_newf(HAL_IN, &(core->enable[num]), comp_id,
 	"stepgen.%d.enable", num);
     if (retval != 0) { return retval; }
     /* export pin for scaled position captured by update() */
@@ -1116,6 +1022,9 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
 	    comp_id, "stepgen.%d.dir", num);
 	if (retval != 0) { return retval; }
 	*(addr->phase[DIR_PIN]) = 0;
+	core->step[num] = addr->phase[STEP_PIN];
+	core->dir[num] = addr->phase[DIR_PIN];
+	core->sd[core->num_sd++] = num;
     } else if (step_type == 1) {
 	/* up and down */
 	retval = hal_pin_bit_newf(HAL_OUT, &(addr->phase[UP_PIN]),
@@ -1126,6 +1035,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
 	    comp_id, "stepgen.%d.down", num);
 	if (retval != 0) { return retval; }
 	*(addr->phase[DOWN_PIN]) = 0;
+	other_chan[num_other++] = num;
     } else {
 	/* stepping types 2 and higher use a varying number of phase pins */
 	addr->num_phases = num_phases_lut[step_type - 2];
@@ -1135,6 +1045,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
 	    if (retval != 0) { return retval; }
 	    *(addr->phase[n]) = 0;
 	}
+	other_chan[num_other++] = num;
     }
     /* set default parameter values */
     addr->pos_scale = 1.0;
@@ -1170,20 +1081,24 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
 	addr->lut = &(master_lut[step_type - 2][0]);
     }
     /* init the step generator core to zero output */
-    addr->timer1 = 0;
-    addr->timer2 = 0;
-    addr->timer3 = 0;
-    addr->hold_dds = 0;
-    addr->addval = 0;
+    core->timer1[num] = 0;
+    core->timer2[num] = 0;
+    core->timer3[num] = 0;
+    core->hold_dds[num] = 0;
+    core->addval[num] = 0;
     /* accumulator gets a half step offset, so it will step half
        way between integer positions, not at the integer positions */
-    addr->accum = 1 << (PICKOFF-1);
-    addr->rawcount = 0;
-    addr->curr_dir = 0;
+    core->accum[num] = 1 << (PICKOFF-1);
+    core->rawcount[num] = 0;
+    core->curr_dir[num] = 0;
+    core->step_now[num] = 0;
     addr->state = 0;
-    *(addr->enable) = 0;
-    addr->target_addval = 0;
-    addr->deltalim = 0;
+    *(core->enable[num]) = 0;
+    core->target_addval[num] = 0;
+    core->deltalim[num] = 0;
+    core->step_len[num] = addr->step_len;
+    core->dir_hold_dly[num] = addr->dir_hold_dly;
+    core->dir_setup[num] = addr->dir_setup;
     /* other init */
     addr->printed_error = 0;
     addr->old_pos_cmd = 0.0;
@@ -0,0 +1,124 @@
+/********************************************************************
+* Description:  stepgen_core.h
+*               Channel state and the per-period kernel of the
+*               'stepgen' HAL component, kept as structure-of-arrays.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** make_pulses() runs in the base thread, so its inner loop is kept
+    free of per-channel branching: every channel goes through the
+    same timer, ramp and DDS arithmetic, with conditionals written as
+    selects, on arrays indexed by channel.  The compiler can turn that
+    into cmov/SIMD code.  Only the output stage depends on the step
+    type; step/dir channels, the common case, have a loop of their own
+    over 'sd[]', the other types are handled per channel in stepgen.c.
+
+    Everything here is read/written by make_pulses() in the fast
+    thread; update_freq() feeds target_addval, deltalim and the
+    validated timing values from the slow thread.
+*/
+#ifndef STEPGEN_CORE_H
+#define STEPGEN_CORE_H
+
+#define STEPGEN_MAX_CHAN	16
+#define STEPGEN_PICKOFF		28	/* bit location in DDS accum */
+
+typedef struct {
+    int num_chan;			/* channels in use */
+    int num_sd;				/* step/dir channels, in 'sd' */
+    int sd[STEPGEN_MAX_CHAN];
+    /* read and written by makepulses */
+    unsigned int timer1[STEPGEN_MAX_CHAN];	/* end of step pulse */
+    unsigned int timer2[STEPGEN_MAX_CHAN];	/* safe to change dir */
+    unsigned int timer3[STEPGEN_MAX_CHAN];	/* safe to step in new dir */
+    int hold_dds[STEPGEN_MAX_CHAN];	/* prevents accumulator from updating */
+    long addval[STEPGEN_MAX_CHAN];	/* actual frequency generator add value */
+    long long accum[STEPGEN_MAX_CHAN];	/* frequency generator accumulator */
+    int curr_dir[STEPGEN_MAX_CHAN];	/* current direction */
+    int step_now[STEPGEN_MAX_CHAN];	/* channel stepped this period */
+    /* read but not written by makepulses */
+    long target_addval[STEPGEN_MAX_CHAN];	/* desired add value */
+    long deltalim[STEPGEN_MAX_CHAN];	/* max allowed change per period */
+    unsigned int step_len[STEPGEN_MAX_CHAN];	/* validated timing, ns */
+    unsigned int dir_hold_dly[STEPGEN_MAX_CHAN];
+    unsigned int dir_setup[STEPGEN_MAX_CHAN];
+    /* HAL pins and params */
+    hal_bit_t *enable[STEPGEN_MAX_CHAN];	/* pin: enable stepgen */
+    hal_s32_t rawcount[STEPGEN_MAX_CHAN];	/* param: feedback in counts */
+    hal_bit_t *step[STEPGEN_MAX_CHAN];	/* pin: step, step/dir only */
+    hal_bit_t *dir[STEPGEN_MAX_CHAN];	/* pin: dir, step/dir only */
+} stepgen_core_t;
+
+/* timers, accel limited ramp and DDS for all channels */
+static inline void stepgen_core_update(stepgen_core_t *c, unsigned int period)
+{
+    int en[STEPGEN_MAX_CHAN];
+    int n, nchan = c->num_chan;
+
+    /* gather the enable pins first, so the main loop has no pointers */
+    for (n = 0; n < nchan; n++) {
+	en[n] = (*(c->enable[n]) != 0);
+    }
+    for (n = 0; n < nchan; n++) {
+	unsigned int t1 = c->timer1[n];
+	unsigned int t2 = c->timer2[n];
+	unsigned int t3 = c->timer3[n];
+	long old = c->addval[n];
+	long target = c->target_addval[n];
+	long lim = c->deltalim[n];
+	long hi = old + lim, lo = old - lim, new;
+	long long acc = c->accum[n], next;
+	int hold, active, sign, stepped;
+
+	/* decrement "timing constraint" timers */
+	t1 = (t1 > period) ? t1 - period : 0;
+	t2 = (t2 > period) ? t2 - period : 0;
+	t3 = (t3 > period) ? t3 - period : 0;
+	/* last timer timed out, cancel hold */
+	hold = c->hold_dds[n] & (t3 != 0);
+	active = (!hold) & en[n];
+	/* update addval (ramping), deltalim 0 means no limit */
+	new = (target > hi) ? hi : target;
+	new = (target < lo) ? lo : new;
+	new = lim ? new : target;
+	new = active ? new : old;
+	/* direction reversal: hold everything until delays time out */
+	hold |= active & ((new ^ old) < 0) & (t3 != 0);
+	active = (!hold) & en[n];
+	/* update DDS, a step is a toggle of the pickoff bit */
+	next = acc + (active ? new : 0);
+	stepped = (int)(((acc ^ next) >> STEPGEN_PICKOFF) & 1);
+	/* update direction when allowed - do not change if addval = 0 */
+	sign = (new > 0) - (new < 0);
+	c->curr_dir[n] = ((t2 == 0) & (sign != 0)) ? sign : c->curr_dir[n];
+	/* (re)start timers on a step */
+	t1 = stepped ? c->step_len[n] : t1;
+	t2 = stepped ? t1 + c->dir_hold_dly[n] : t2;
+	t3 = stepped ? t2 + c->dir_setup[n] : t3;
+	c->timer1[n] = t1;
+	c->timer2[n] = t2;
+	c->timer3[n] = t3;
+	c->hold_dds[n] = hold;
+	c->addval[n] = new;
+	c->accum[n] = next;
+	c->step_now[n] = stepped;
+    }
+    for (n = 0; n < nchan; n++) {
+	c->rawcount[n] = c->accum[n] >> STEPGEN_PICKOFF;
+    }
+}
+
+/* outputs of the step/dir channels */
+static inline void stepgen_core_stepdir(stepgen_core_t *c)
+{
+    int k, n;
+
+    for (k = 0; k < c->num_sd; k++) {
+	n = c->sd[k];
+	*(c->step[n]) = (c->timer1[n] != 0);
+	*(c->dir[n]) = (c->curr_dir[n] < 0);
+    }
+}
+
+#endif /* STEPGEN_CORE_H */
@@ -22,6 +22,14 @@
 
     loadrt streamer depth=100 cfg=uffb
 
+    With 'ring=1' for a channel, samples are read as packed binary
+    values (see streamer.h) from a HAL record ring named 'streamer.N'
+    sized for 'depth' samples, instead of the fifo. A ring record may
+    carry a block of samples, which 'halstreamer' uses to move data
+    with large writes. The depth limit of the fifo does not apply.
+
+    loadrt streamer depth=100000 cfg=ffff ring=1
+
 
 */
 
@@ -56,6 +64,7 @@
 #include "rtapi.h"              /* RTAPI realtime OS API */
 #include "rtapi_app.h"          /* RTAPI realtime module decls */
 #include "hal.h"                /* HAL public API decls */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
 #include "streamer.h"		/* decls and such for fifos */
 #include "rtapi_errno.h"
 #include "rtapi_string.h"
@@ -68,6 +77,8 @@ static char *cfg[MAX_STREAMERS];	/* config string, no default */
 RTAPI_MP_ARRAY_STRING(cfg,MAX_STREAMERS,"config string");
 static int depth[MAX_STREAMERS];	/* depth of fifo, default 0 */
 RTAPI_MP_ARRAY_INT(depth,MAX_STREAMERS,"fifo depth");
+static int ring[MAX_STREAMERS];	/* use a HAL ring, default 0 */
+RTAPI_MP_ARRAY_INT(ring,MAX_STREAMERS,"read packed values from HAL ring streamer.N");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -81,11 +92,15 @@ typedef struct {
     hal_bit_t *empty;		/* pin: underrun flag */
     hal_bit_t *enable;		/* pin: enable streaming */
     hal_s32_t *underruns;	/* pin: number of underruns */
+    ringbuffer_t ring;		/* ring=1: record ring */
+    int record_size;		/* ring=1: bytes per sample */
+    int rec_offset;		/* ring=1: next sample in current record */
 } streamer_t;
 
 /* other globals */
 static int comp_id;		/* component ID */
 static int shmem_id[MAX_STREAMERS];
+static streamer_t *streamers[MAX_STREAMERS];
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
@@ -94,6 +109,7 @@ static int shmem_id[MAX_STREAMERS];
 static int parse_types(fifo_t *f, char *cfg);
 static int init_streamer(int num, fifo_t *tmp_fifo);
 static void update(void *arg, long period);
+static void update_ring(void *arg, long period);
 
 /***********************************************************************
 *                       INIT AND EXIT CODE                             *
@@ -116,7 +132,7 @@ int rtapi_app_main(void)
 	    return -EINVAL;
 	}
 	max_depth = MAX_SHMEM / (sizeof(shmem_data_t) * tmp_fifo[n].num_pins);
-	if ( depth[n] > max_depth ) {
+	if (( ring[n] == 0 ) && ( depth[n] > max_depth )) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"STREAMER: ERROR: depth too large, max is %d\n", max_depth);
 	    return -ENOMEM;
@@ -161,11 +177,15 @@ void rtapi_app_exit(void)
 {
     int n;
 
-    /* free any shmem blocks */
+    /* free any shmem blocks and rings */
     for ( n = 0 ; n < MAX_STREAMERS ; n++ ) {
 	if ( shmem_id[n] > 0 ) {
 	    rtapi_shmem_delete(shmem_id[n], comp_id);
 	}
+	if (( streamers[n] != NULL ) && ringbuffer_attached(&(streamers[n]->ring))) {
+	    hal_ring_detachf(&(streamers[n]->ring), "streamer.%d", n);
+	    hal_ring_deletef("streamer.%d", n);
+	}
     }
     hal_exit(comp_id);
 }
@@ -248,6 +268,65 @@ static void update(void *arg, long period)
     fifo->out = tmpout;
 }
 
+static void update_ring(void *arg, long period)
+{
+    streamer_t *str = arg;
+    ringheader_t *h = str->ring.header;
+    fifo_t *fifo = str->fifo;
+    pin_data_t *pptr = (pin_data_t *)(str+1);
+    shmem_data_t values[MAX_PINS];
+    const void *data;
+    size_t size = 0, used;
+    int n;
+
+    if ( ! *(str->enable) ) {
+	return;
+    }
+    if (( record_read(&(str->ring), &data, &size) ) ||
+	( size < str->rec_offset + str->record_size )) {
+	if ( size > 0 ) {
+	    /* no whole sample left in this record, drop it */
+	    record_shift(&(str->ring));
+	    str->rec_offset = 0;
+	}
+	/* ring empty - log it, output pins retain current values */
+	(*str->underruns)++;
+	*(str->empty) = 1;
+	*(str->curr_depth) = 0;
+	return;
+    }
+    *(str->empty) = 0;
+    stream_unpack_values(fifo, (const unsigned char *)data + str->rec_offset,
+			 values);
+    str->rec_offset += str->record_size;
+    if ( str->rec_offset + str->record_size > size ) {
+	/* record consumed, on to the next one */
+	record_shift(&(str->ring));
+	str->rec_offset = 0;
+    }
+    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	switch ( fifo->type[n] ) {
+	case HAL_FLOAT:
+	    *(pptr->hfloat) = values[n].f;
+	    break;
+	case HAL_BIT:
+	    *(pptr->hbit) = values[n].b ? 1 : 0;
+	    break;
+	case HAL_U32:
+	    *(pptr->hu32) = values[n].u;
+	    break;
+	case HAL_S32:
+	    *(pptr->hs32) = values[n].s;
+	    break;
+	default:
+	    break;
+	}
+	pptr++;
+    }
+    used = (str->ring.trailer->tail + h->size - h->head) % h->size;
+    *(str->curr_depth) = used / str->record_size;
+}
+
 /***********************************************************************
 *                   LOCAL FUNCTION DEFINITIONS                         *
 ************************************************************************/
@@ -382,28 +461,52 @@ static int init_streamer(int num, fifo_t *tmp_fifo)
     }
     /* export update function */
     rtapi_snprintf(buf, sizeof(buf), "streamer.%d", num);
-    retval = hal_export_funct(buf, update, str, usefp, 0, comp_id);
+    retval = hal_export_funct(buf, ring[num] ? update_ring : update,
+			      str, usefp, 0, comp_id);
     if (retval != 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "STREAMER: ERROR: function export failed\n");
 	return retval;
     }
-
-    /* alloc shmem for user/RT comms (fifo) */
-    size = sizeof(fifo_t) + tmp_fifo->num_pins * tmp_fifo->depth * sizeof(shmem_data_t);
-    shmem_id[num] = rtapi_shmem_new(STREAMER_SHMEM_KEY+num, comp_id, size);
-    if ( shmem_id[num] < 0 ) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "STREAMER: ERROR: couldn't allocate user/RT shared memory\n");
-	return -ENOMEM;
-    }
-    retval = rtapi_shmem_getptr(shmem_id[num], &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "STREAMER: ERROR: couldn't map user/RT shared memory\n");
-	return -ENOMEM;
+    streamers[num] = str;
+
+    if ( ring[num] ) {
+	/* samples come from a HAL ring, its scratchpad holds the fifo_t */
+	str->record_size = stream_values_size(tmp_fifo);
+	str->rec_offset = 0;
+	size = record_space(str->record_size) * tmp_fifo->depth;
+	retval = hal_ring_newf(size, sizeof(fifo_t), 0, "streamer.%d", num);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"STREAMER: ERROR: couldn't create ring streamer.%d: %d\n",
+		num, retval);
+	    return retval;
+	}
+	retval = hal_ring_attachf(&(str->ring), NULL, "streamer.%d", num);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"STREAMER: ERROR: couldn't attach ring streamer.%d: %d\n",
+		num, retval);
+	    return retval;
+	}
+	fifo = str->ring.scratchpad;
+    } else {
+	/* alloc shmem for user/RT comms (fifo) */
+	size = sizeof(fifo_t) + tmp_fifo->num_pins * tmp_fifo->depth * sizeof(shmem_data_t);
+	shmem_id[num] = rtapi_shmem_new(STREAMER_SHMEM_KEY+num, comp_id, size);
+	if ( shmem_id[num] < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"STREAMER: ERROR: couldn't allocate user/RT shared memory\n");
+	    return -ENOMEM;
+	}
+	retval = rtapi_shmem_getptr(shmem_id[num], &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"STREAMER: ERROR: couldn't map user/RT shared memory\n");
+	    return -ENOMEM;
+	}
+	fifo = shmem_ptr;
     }
-    fifo = shmem_ptr;
     str->fifo = fifo;
     /* copy data from temp_fifo */
     *fifo = *tmp_fifo;
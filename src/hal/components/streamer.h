@@ -10,6 +10,7 @@
 *
 ********************************************************************/
 #include "rtapi_shmkeys.h"
+#include "rtapi_string.h"
 
 #define MAX_STREAMERS		8
 #define MAX_SAMPLERS		8
@@ -40,6 +41,95 @@ typedef struct {
     shmem_data_t data[];
 } fifo_t;
 
+/* binary capture format, as written by 'halsampler -b'
+
+   the file starts with a sampler_hdr_t, followed by records of
+   hdr.record_size bytes each: the sample number as a __u32, then the
+   pin values in pin order, packed without padding in host byte order:
+   float 8 bytes, s32 and u32 4 bytes, bit 1 byte.
+
+   a sampler loaded with ring=1 writes records of the same layout
+   into the HAL record ring 'sampler.N'. The ring scratchpad holds a
+   fifo_t describing the pin types.
+
+   'halstreamer -b' reads files of packed values in the same layout,
+   without the sample number, or sampler captures including the header.
+   A streamer loaded with ring=1 reads packed values from the HAL ring
+   'streamer.N'; a ring record may hold any number of samples.
+*/
+
+#define SAMPLER_HDR_MAGIC	"HALSAMP"
+#define SAMPLER_HDR_VERSION	1
+
+typedef struct {
+    char magic[8];		/* SAMPLER_HDR_MAGIC */
+    __u32 version;		/* SAMPLER_HDR_VERSION */
+    __u32 hdr_size;		/* offset of the first record */
+    __u32 record_size;		/* bytes per record */
+    __u32 num_pins;
+    __u32 type[MAX_PINS];	/* hal_type_t of each value */
+    char name[MAX_PINS][HAL_NAME_LEN + 1]; /* linked signal, or pin name */
+} sampler_hdr_t;
+
+static inline int sampler_value_size(hal_type_t type)
+{
+    switch (type) {
+    case HAL_FLOAT:
+	return sizeof(real_t);
+    case HAL_BIT:
+	return 1;
+    case HAL_U32:
+	return sizeof(__u32);
+    case HAL_S32:
+	return sizeof(__s32);
+    default:
+	return 0;
+    }
+}
+
+/* size of the packed pin values of one sample */
+static inline int stream_values_size(const fifo_t *f)
+{
+    int n, size = 0;
+
+    for (n = 0; n < f->num_pins; n++)
+	size += sampler_value_size(f->type[n]);
+    return size;
+}
+
+static inline int sampler_record_size(const fifo_t *f)
+{
+    return sizeof(__u32) + stream_values_size(f);
+}
+
+/* convert between fifo slots and packed values, returns the packed size
+   shmem_data_t members all start at the union address */
+static inline int stream_pack_values(const fifo_t *f, const shmem_data_t *buf,
+				     unsigned char *rec)
+{
+    int n, size, total = 0;
+
+    for (n = 0; n < f->num_pins; n++) {
+	size = sampler_value_size(f->type[n]);
+	memcpy(rec + total, &buf[n], size);
+	total += size;
+    }
+    return total;
+}
+
+static inline int stream_unpack_values(const fifo_t *f, const unsigned char *rec,
+				       shmem_data_t *buf)
+{
+    int n, size, total = 0;
+
+    for (n = 0; n < f->num_pins; n++) {
+	size = sampler_value_size(f->type[n]);
+	memcpy(&buf[n], rec + total, size);
+	total += size;
+    }
+    return total;
+}
+
 /* this struct lives in HAL shared memory */
 
 typedef union {
@@ -20,13 +20,25 @@
 
     Invoking:
 
-    halstreamer [chan_num]
+    halstreamer [-c chan_num] [-N name] [-b] [-r count] [file]
 
     'chan_num', if present, specifies the streamer channel to use.
     The default is channel zero.  Since hal_streamer takes its data
     from stdin, it will almost always either need to have stdin 
     redirected from a file, or have data piped into it from some
     other program.
+
+    '-b' reads binary input from 'file' instead of text: packed values
+    as described in streamer.h, typed per the 'cfg' string, or a
+    'halsampler -b' capture with matching types. The file is mapped in
+    windows and moved into the fifo or ring in blocks, so files larger
+    than the address space work.
+
+    '-r count' plays the input 'count' times, 0 repeats forever. The
+    input must be a file.
+
+    If the realtime part was loaded with 'ring=1' for the channel,
+    samples are written to the HAL ring 'streamer.N' instead of the fifo.
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -54,6 +66,7 @@
     information, go to www.linuxcnc.org.
 */
 
+#define _FILE_OFFSET_BITS 64	/* multi-GB input on 32 bit systems */
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -61,19 +74,36 @@
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "hal.h"                /* HAL public API decls */
+#include "hal_priv.h"		/* halpr_find_ring_by_name() */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
 #include "streamer.h"
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+/* binary input is mapped in windows of this size */
+#define MAP_WINDOW	(64 * 1024 * 1024)
+
+typedef struct {
+    int fd;
+    off_t fsize;
+    unsigned char *base;	/* current mapping */
+    off_t off;			/* file offset of base */
+    size_t len;
+} window_t;
+
+static const unsigned char *map_records(window_t *w, off_t pos, size_t len);
+
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
 ************************************************************************/
@@ -84,6 +114,8 @@ int exitval = 1;	/* program return code - 1 means error */
 int ignore_sig = 0;	/* used to flag critical regions */
 int linenumber=0;	/* used to print linenumber on errors */
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of streamer */
+ringbuffer_t ring;	/* ring=1 transport */
+int use_ring = 0;
 
 /***********************************************************************
 *                            MAIN PROGRAM                              *
@@ -106,24 +138,224 @@ static void quit(int sig)
 
 #define BUF_SIZE 4000
 
+static void wait_a_bit(void)
+{
+    struct timespec delay;
+
+    /* fifo or ring full, sleep for 10mS */
+    delay.tv_sec = 0;
+    delay.tv_nsec = 10000000;
+    nanosleep(&delay,NULL);
+}
+
+/* number of free fifo slots */
+static int fifo_space(fifo_t *fifo)
+{
+    int used = fifo->in - fifo->out;
+
+    if ( used < 0 ) {
+	used += fifo->depth;
+    }
+    return fifo->depth - 1 - used;
+}
+
+/* queue one sample parsed from text */
+static void put_sample(fifo_t *fifo, const shmem_data_t *vals)
+{
+    unsigned char rec[MAX_PINS * sizeof(real_t)];
+    shmem_data_t *dptr;
+    int size, tmpin, newin;
+
+    if ( use_ring ) {
+	size = stream_pack_values(fifo, vals, rec);
+	while ( record_write(&ring, rec, size) == EAGAIN ) {
+	    wait_a_bit();
+	}
+	return;
+    }
+    /* calculate _next_ value for in */
+    tmpin = fifo->in;
+    newin = tmpin + 1;
+    if ( newin >= fifo->depth ) {
+	newin = 0;
+    }
+    /* wait until there is space in the buffer */
+    while ( newin == fifo->out ) {
+	wait_a_bit();
+    }
+    dptr = &fifo->data[tmpin * fifo->num_pins];
+    memcpy(dptr, vals, fifo->num_pins * sizeof(shmem_data_t));
+    fifo->in = newin;
+}
+
+/* the mapping is moved along the file as needed, so only a window
+   is ever mapped */
+static const unsigned char *map_records(window_t *w, off_t pos, size_t len)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+
+    if (( w->base != NULL ) && ( pos >= w->off ) &&
+	( pos + (off_t)len <= w->off + (off_t)w->len )) {
+	return w->base + (pos - w->off);
+    }
+    if ( w->base != NULL ) {
+	munmap(w->base, w->len);
+	w->base = NULL;
+    }
+    w->off = pos & ~((off_t)pagesize - 1);
+    w->len = MAP_WINDOW;
+    if ( w->len < (pos - w->off) + len ) {
+	w->len = (pos - w->off) + len;
+    }
+    if ( w->off + (off_t)w->len > w->fsize ) {
+	w->len = w->fsize - w->off;
+    }
+    w->base = mmap(NULL, w->len, PROT_READ, MAP_SHARED, w->fd, w->off);
+    if ( w->base == MAP_FAILED ) {
+	w->base = NULL;
+	return NULL;
+    }
+    madvise(w->base, w->len, MADV_SEQUENTIAL);
+    return w->base + (pos - w->off);
+}
+
+/* stream a binary file, returns 0 on success */
+static int stream_binary(fifo_t *fifo, int fd, int repeat)
+{
+    struct stat st;
+    sampler_hdr_t hdr;
+    window_t w;
+    off_t start, i, nrec;
+    const unsigned char *p;
+    unsigned char *dst;
+    size_t stride, skip, vsize, block, k, j;
+    int n, tmpin, space, retval;
+
+    vsize = stream_values_size(fifo);
+    if ( fstat(fd, &st) < 0 ) {
+	fprintf(stderr, "ERROR: stat failed: %s\n", strerror(errno));
+	return -1;
+    }
+    /* a halsampler capture carries a header and sample numbers */
+    start = 0;
+    stride = vsize;
+    skip = 0;
+    if (( st.st_size >= (off_t)sizeof(hdr) ) &&
+	( pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) ) &&
+	( memcmp(hdr.magic, SAMPLER_HDR_MAGIC, sizeof(SAMPLER_HDR_MAGIC)) == 0 )) {
+	if ( hdr.num_pins != (__u32)fifo->num_pins ) {
+	    fprintf(stderr, "ERROR: capture has %u values, channel has %d pins\n",
+		    hdr.num_pins, fifo->num_pins);
+	    return -1;
+	}
+	for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	    if ( hdr.type[n] != (__u32)fifo->type[n] ) {
+		fprintf(stderr, "ERROR: capture value %d type mismatch\n", n);
+		return -1;
+	    }
+	}
+	start = hdr.hdr_size;
+	stride = hdr.record_size;
+	skip = sizeof(__u32);
+    }
+    nrec = (st.st_size - start) / stride;
+    if (( st.st_size - start ) % stride ) {
+	fprintf(stderr, "WARNING: ignoring %ld trailing bytes\n",
+		(long)(( st.st_size - start ) % stride));
+    }
+    if ( nrec == 0 ) {
+	return 0;
+    }
+    /* ring records carry blocks of samples, leave room for several */
+    if ( use_ring ) {
+	block = ring.header->size / 8 / vsize;
+    } else {
+	block = fifo->depth;
+    }
+    if ( block < 1 ) {
+	block = 1;
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.fd = fd;
+    w.fsize = st.st_size;
+    do {
+	for ( i = 0 ; i < nrec ; i += k ) {
+	    k = block;
+	    if (( nrec - i ) < (off_t)k ) {
+		k = nrec - i;
+	    }
+	    p = map_records(&w, start + i * stride, k * stride);
+	    if ( p == NULL ) {
+		fprintf(stderr, "ERROR: mmap failed: %s\n", strerror(errno));
+		return -1;
+	    }
+	    if ( use_ring ) {
+		while (( retval = record_write_begin(&ring, (void **)&dst,
+						     k * vsize) ) == EAGAIN ) {
+		    wait_a_bit();
+		}
+		if ( retval != 0 ) {
+		    fprintf(stderr, "ERROR: ring write of %zu bytes failed: %s\n",
+			    k * vsize, strerror(retval));
+		    munmap(w.base, w.len);
+		    return -1;
+		}
+		if ( stride == vsize ) {
+		    memcpy(dst, p, k * vsize);
+		} else {
+		    for ( j = 0 ; j < k ; j++ ) {
+			memcpy(dst + j * vsize, p + j * stride + skip, vsize);
+		    }
+		}
+		record_write_end(&ring, dst, k * vsize);
+		continue;
+	    }
+	    /* fifo: fill all free slots, then publish them at once */
+	    while (( space = fifo_space(fifo) ) == 0 ) {
+		wait_a_bit();
+	    }
+	    if ( (size_t)space < k ) {
+		k = space;
+	    }
+	    tmpin = fifo->in;
+	    for ( j = 0 ; j < k ; j++ ) {
+		stream_unpack_values(fifo, p + j * stride + skip,
+				     &fifo->data[tmpin * fifo->num_pins]);
+		if ( ++tmpin >= fifo->depth ) {
+		    tmpin = 0;
+		}
+	    }
+	    rtapi_smp_wmb();
+	    fifo->in = tmpin;
+	}
+    } while (( repeat == 0 ) || ( --repeat > 0 ));
+    if ( w.base != NULL ) {
+	munmap(w.base, w.len);
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
-    int n, channel, retval, size, line;
+    int n, channel, retval, size, line, binary, repeat, infd;
     char *cp,*cp2;
     char *name = NULL;
+    char ringname[HAL_NAME_LEN + 1];
     void *shmem_ptr;
     fifo_t *fifo;
-    shmem_data_t *data, *dptr;
+    shmem_data_t vals[MAX_PINS], *dptr;
     char buf[BUF_SIZE];
 	const char *errmsg;
-    int tmpin, newin;
-    struct timespec delay;
 
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
+    binary = 0;
+    repeat = 1;
+    infd = -1;
     int  opt;
-    while ((opt = getopt(argc, argv, "c:N:")) != -1) {
+    while ((opt = getopt(argc, argv, "bc:N:r:")) != -1) {
 	switch (opt) {
         case 'c':
 	    channel = strtol(optarg, &cp2, 10);
@@ -135,29 +367,49 @@ int main(int argc, char **argv)
 	case 'N':
 	    name = optarg;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
+	case 'r':
+	    repeat = strtol(optarg, &cp2, 10);
+	    if (( *cp2 ) || ( repeat < 0 )) {
+		fprintf(stderr,"ERROR: invalid repeat count '%s'\n", optarg );
+		exit(1);
+	    }
+	    break;
 	default: /* '?' */
 	    fprintf(stderr,"ERROR: unknown option '%c'\n", opt);
 	    fprintf(stderr,"valid options are:\n" );
 	    fprintf(stderr,"\t-c <int>\t channel number\n" );
 	    fprintf(stderr,"\t-N <name>\t set HAL component name\n" );
+	    fprintf(stderr,"\t-b\t\t binary input file\n" );
+	    fprintf(stderr,"\t-r <int>\t play input n times, 0 = forever\n" );
 	    exit(EXIT_FAILURE);
         }
     }
+    if (( binary || ( repeat != 1 )) && ( optind >= argc )) {
+	fprintf(stderr, "ERROR: -b and -r require a filename\n");
+	exit(1);
+    }
     if (optind < argc) {
         int fd;
 	if(argc > optind+1) {
             fprintf(stderr, "ERROR: At most one filename may be specified\n");
             exit(1);
         }
-	// make stdin be the named file
 	fd = open(argv[optind], O_RDONLY);
 	if (fd < 0) {
             fprintf(stderr, "ERROR: cannot open '%s' for reading: %s\n",
 		    argv[optind], strerror(errno));
             exit(1);
 	}
-	close(0);
-	dup2(fd, 0);
+	if (binary) {
+	    infd = fd;
+	} else {
+	    // make stdin be the named file
+	    close(0);
+	    dup2(fd, 0);
+	}
     }
 
     /* register signal handlers - if the process is killed
@@ -183,126 +435,150 @@ int main(int argc, char **argv)
 	goto out;
     }
     hal_ready(comp_id);
-    /* open shmem for user/RT comms (fifo) */
-    /* initial size is unknown, assume only the fifo structure */
-    shmem_id = rtapi_shmem_new(STREAMER_SHMEM_KEY+channel, comp_id, sizeof(fifo_t));
-    if ( shmem_id < 0 ) {
-	fprintf(stderr, "ERROR: couldn't allocate user/RT shared memory\n");
-	goto out;
-    }
-    retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	fprintf(stderr, "ERROR: couldn't map user/RT shared memory\n");
-	goto out;
-    }
-    fifo = shmem_ptr;
-    if ( fifo->magic != FIFO_MAGIC_NUM ) {
-	fprintf(stderr, "ERROR: channel %d realtime part is not loaded\n", channel );
-	goto out;
-    }
-    /* now use data in fifo structure to calculate proper shmem size */
-    size = sizeof(fifo_t) + fifo->num_pins * fifo->depth * sizeof(shmem_data_t);
-    /* close shmem, re-open with proper size */
-    rtapi_shmem_delete(shmem_id, comp_id);
-    shmem_id = rtapi_shmem_new(STREAMER_SHMEM_KEY+channel, comp_id, size);
-    if ( shmem_id < 0 ) {
-	fprintf(stderr, "ERROR: couldn't re-allocate user/RT shared memory\n");
-	goto out;
+
+    /* with ring=1, the realtime part reads from a HAL ring */
+    snprintf(ringname, sizeof(ringname), "streamer.%d", channel);
+    rtapi_mutex_get(&(hal_data->mutex));
+    use_ring = (halpr_find_ring_by_name(ringname) != NULL);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if ( use_ring ) {
+	retval = hal_ring_attach(ringname, &ring, NULL);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't attach ring %s: %d\n",
+		    ringname, retval);
+	    use_ring = 0;
+	    goto out;
+	}
+	fifo = ring.scratchpad;
+	if ( fifo->magic != FIFO_MAGIC_NUM ) {
+	    fprintf(stderr, "ERROR: ring %s is not a streamer ring\n", ringname);
+	    goto out;
+	}
+    } else {
+	/* open shmem for user/RT comms (fifo) */
+	/* initial size is unknown, assume only the fifo structure */
+	shmem_id = rtapi_shmem_new(STREAMER_SHMEM_KEY+channel, comp_id, sizeof(fifo_t));
+	if ( shmem_id < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't allocate user/RT shared memory\n");
+	    goto out;
+	}
+	retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't map user/RT shared memory\n");
+	    goto out;
+	}
+	fifo = shmem_ptr;
+	if ( fifo->magic != FIFO_MAGIC_NUM ) {
+	    fprintf(stderr, "ERROR: channel %d realtime part is not loaded\n", channel );
+	    goto out;
+	}
+	/* now use data in fifo structure to calculate proper shmem size */
+	size = sizeof(fifo_t) + fifo->num_pins * fifo->depth * sizeof(shmem_data_t);
+	/* close shmem, re-open with proper size */
+	rtapi_shmem_delete(shmem_id, comp_id);
+	shmem_id = rtapi_shmem_new(STREAMER_SHMEM_KEY+channel, comp_id, size);
+	if ( shmem_id < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't re-allocate user/RT shared memory\n");
+	    goto out;
+	}
+	retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
+	if ( retval < 0 ) {
+	    fprintf(stderr, "ERROR: couldn't re-map user/RT shared memory\n");
+	    goto out;
+	}
+	fifo = shmem_ptr;
     }
-    retval = rtapi_shmem_getptr(shmem_id, &shmem_ptr, 0);
-    if ( retval < 0 ) {
-	fprintf(stderr, "ERROR: couldn't re-map user/RT shared memory\n");
+
+    if ( binary ) {
+	if ( stream_binary(fifo, infd, repeat) == 0 ) {
+	    exitval = 0;
+	}
 	goto out;
     }
-    line = 1;
-    fifo = shmem_ptr;
-    data = fifo->data;
-    while ( fgets(buf, BUF_SIZE, stdin) ) {
-	/* calculate _next_ value for in */
-	tmpin = fifo->in;
-	newin = tmpin + 1;
-	if ( newin >= fifo->depth ) {
-	    newin = 0;
-	}
-	/* wait until there is space in the buffer */
-	while ( newin == fifo->out ) {
-            /* fifo full, sleep for 10mS */
-	    delay.tv_sec = 0;
-	    delay.tv_nsec = 10000000;
-	    nanosleep(&delay,NULL);
-	}
-	/* make pointer fifo entry */
-	dptr = &data[tmpin*fifo->num_pins];
-	/* parse input line, write results to fifo */
-	cp = buf;
-	errmsg = NULL;
-	for ( n = 0 ; n < fifo->num_pins ; n++ ) {
-	    /* strip leading whitespace */
-	    while ( isspace(*cp) ) {
-		cp++;
-	    }
-	    switch ( fifo->type[n] ) {
-	    case HAL_FLOAT:
-		dptr->f = strtod(cp, &cp2);
-		break;
-	    case HAL_BIT:
-		if ( *cp == '0' ) {
-		    dptr->b = 0;
-		    cp2 = cp + 1;
-		} else if ( *cp == '1' ) {
-		    dptr->b = 1;
-		    cp2 = cp + 1;
-		} else {
-		    errmsg = "bit value not 0 or 1";
-		    cp2 = cp;
+
+    do {
+	line = 1;
+	while ( fgets(buf, BUF_SIZE, stdin) ) {
+	    /* parse input line */
+	    dptr = vals;
+	    cp = buf;
+	    errmsg = NULL;
+	    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+		/* strip leading whitespace */
+		while ( isspace(*cp) ) {
+		    cp++;
 		}
-		break;
-	    case HAL_U32:
-		dptr->u = strtoul(cp, &cp2, 10);
-		break;
-	    case HAL_S32:
-		dptr->s = strtol(cp, &cp2, 10);
-		break;
-	    default:
-		/* better not happen */
-		goto out;
-	    }
-	    if ( errmsg == NULL ) {
-		/* no error yet, check for other possibilties */
-		/* whitespace separates fields, and there is a newline
-		   at the end... so if there is not space or newline at
-		   the end of a field, something is wrong. */
-		if ( *cp2 == '\0' ) {
-		    errmsg = "premature end of line";
-		} else if ( ! isspace(*cp2) ) {
-		    errmsg = "bad character";
+		switch ( fifo->type[n] ) {
+		case HAL_FLOAT:
+		    dptr->f = strtod(cp, &cp2);
+		    break;
+		case HAL_BIT:
+		    if ( *cp == '0' ) {
+			dptr->b = 0;
+			cp2 = cp + 1;
+		    } else if ( *cp == '1' ) {
+			dptr->b = 1;
+			cp2 = cp + 1;
+		    } else {
+			errmsg = "bit value not 0 or 1";
+			cp2 = cp;
+		    }
+		    break;
+		case HAL_U32:
+		    dptr->u = strtoul(cp, &cp2, 10);
+		    break;
+		case HAL_S32:
+		    dptr->s = strtol(cp, &cp2, 10);
+		    break;
+		default:
+		    /* better not happen */
+		    goto out;
+		}
+		if ( errmsg == NULL ) {
+		    /* no error yet, check for other possibilties */
+		    /* whitespace separates fields, and there is a newline
+		       at the end... so if there is not space or newline at
+		       the end of a field, something is wrong. */
+		    if ( *cp2 == '\0' ) {
+			errmsg = "premature end of line";
+		    } else if ( ! isspace(*cp2) ) {
+			errmsg = "bad character";
+		    }
+		}
+		/* test for any error */
+		if ( errmsg != NULL ) {
+		    /* abort loop on error */
+		    break;
 		}
+		/* advance pointers for next field */
+		dptr++;
+		cp = cp2;
 	    }
-	    /* test for any error */
 	    if ( errmsg != NULL ) {
-		/* abort loop on error */
-		break;
+		/* print message */
+		fprintf (stderr, "line %d, field %d: %s, skipping the line\n", line, n, errmsg );
+		/** TODO - decide whether to skip this line and continue, or
+		    abort the program.  Right now it skips the line. */
+	    } else {
+		/* good data, keep it */
+		put_sample(fifo, vals);
 	    }
-	    /* advance pointers for next field */
-	    dptr++;
-	    cp = cp2;
+	    line++;
 	}
-	if ( errmsg != NULL ) {
-	    /* print message */
-	    fprintf (stderr, "line %d, field %d: %s, skipping the line\n", line, n, errmsg );
-	    /** TODO - decide whether to skip this line and continue, or 
-		abort the program.  Right now it skips the line. */
-	} else {
-	    /* good data, keep it */
-	    fifo->in = newin;
+	/* play it again */
+	if (( repeat != 1 ) && ( fseek(stdin, 0, SEEK_SET) < 0 )) {
+	    fprintf(stderr, "ERROR: can't rewind input: %s\n", strerror(errno));
+	    goto out;
 	}
-	line++;
-    }
+    } while (( repeat == 0 ) || ( --repeat > 0 ));
     /* run was succesfull */
     exitval = 0;
 
 out:
     ignore_sig = 1;
+    if ( use_ring ) {
+	hal_ring_detach(ringname, &ring);
+    }
     if ( shmem_id >= 0 ) {
 	rtapi_shmem_delete(shmem_id, comp_id);
     }
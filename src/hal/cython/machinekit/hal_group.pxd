@@ -41,7 +41,6 @@ cdef extern from "hal_group.h" :
         hal_member_t  **member
         rtapi_atomic_type *changed
         int n_monitored
-        hal_data_u    *tracking
         unsigned long user_flags
         void *user_data
 
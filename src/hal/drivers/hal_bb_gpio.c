@@ -38,6 +38,7 @@ MODULE_LICENSE("GPL");
 
 #define HEADERS 			 2
 #define PINS_PER_HEADER  46
+#define GPIO_BANKS			 4
 
 typedef struct {
 	hal_bit_t* led_pins[4];
@@ -46,8 +47,26 @@ typedef struct {
 	hal_bit_t  *led_inv[4];
 	hal_bit_t  *input_inv[PINS_PER_HEADER * HEADERS];
 	hal_bit_t  *output_inv[PINS_PER_HEADER * HEADERS];
+	// packed=1: one word per GPIO bank, bit n = GPIO n of that bank
+	hal_u32_t *bank_in[GPIO_BANKS];
+	hal_u32_t *bank_in_inv[GPIO_BANKS];
+	hal_u32_t *bank_out[GPIO_BANKS];
+	hal_u32_t *bank_out_inv[GPIO_BANKS];
 } port_data_t;
 
+// the lines in use, so read_port() and write_port() touch each bank
+// register once per period instead of once per line
+typedef struct {
+	int index;			// into input_pins/output_pins
+	int bank;
+	unsigned int mask;	// the line's bit in the bank registers
+} bb_gpio_line;
+
+static bb_gpio_line in_lines[PINS_PER_HEADER * HEADERS];
+static bb_gpio_line out_lines[PINS_PER_HEADER * HEADERS];
+static int num_in_lines, num_out_lines;
+static unsigned int bank_in_mask[GPIO_BANKS], bank_out_mask[GPIO_BANKS];
+
 static port_data_t *port_data;
 
 static const char *modname = MODNAME;
@@ -70,6 +89,13 @@ RTAPI_MP_STRING(input_pins, "input pins, comma separated.  P8 pins add 800, P9 p
 static char *output_pins;
 RTAPI_MP_STRING(output_pins, "output pins, comma separated.  P8 pins add 800, P9 pins add 900");
 
+static int packed;
+RTAPI_MP_INT(packed, "1=packed pins per GPIO bank instead of a pin per line");
+
+static int export_input(int header, int pin);
+static int export_output(int header, int pin);
+static int export_banks(void);
+
 void configure_control_module() {
 	int fd = open("/dev/mem", O_RDWR);
 
@@ -239,27 +265,18 @@ int rtapi_app_main(void) {
 
 			data = NULL; // after the first call, subsequent calls to strtok need to be on NULL
 
-			// Add HAL pin
-			retval = hal_pin_bit_newf(HAL_OUT, &(port_data->input_pins[pin + (header - 8)*PINS_PER_HEADER]), comp_id, "bb_gpio.p%d.in-%02d", header, pin);
-
-			if(retval < 0) {
-				rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
-				hal_exit(comp_id);
-				return -1;
-			}
-
-			// Add HAL pin
-			retval = hal_pin_bit_newf(HAL_IN, &(port_data->input_inv[pin + (header - 8)*PINS_PER_HEADER]), comp_id, "bb_gpio.p%d.in-%02d.invert", header, pin);
+			in_lines[num_in_lines].index = pin + (header - 8)*PINS_PER_HEADER;
+			in_lines[num_in_lines].bank = bbpin->port_num;
+			in_lines[num_in_lines].mask = 1 << bbpin->pin_num;
+			bank_in_mask[(int)bbpin->port_num] |= 1 << bbpin->pin_num;
+			num_in_lines++;
 
-			if(retval < 0) {
-				rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+			// with packed=1, bank pins are exported below instead
+			if(!packed && export_input(header, pin) < 0) {
 				hal_exit(comp_id);
 				return -1;
 			}
 
-			// Initialize HAL pin
-			*(port_data->input_inv[pin + (header - 8)*PINS_PER_HEADER]) = 0;
-
 			int gpio_num = bbpin->port_num;
 			
 			// configure gpio port if necessary
@@ -311,27 +328,18 @@ int rtapi_app_main(void) {
 
 			data = NULL; // after the first call, subsequent calls to strtok need to be on NULL
 
-			// Add HAL pin
-			retval = hal_pin_bit_newf(HAL_IN, &(port_data->output_pins[pin + (header - 8)*PINS_PER_HEADER]), comp_id, "bb_gpio.p%d.out-%02d", header, pin);
-
-			if(retval < 0) {
-				rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
-				hal_exit(comp_id);
-				return -1;
-			}
+			out_lines[num_out_lines].index = pin + (header - 8)*PINS_PER_HEADER;
+			out_lines[num_out_lines].bank = bbpin->port_num;
+			out_lines[num_out_lines].mask = 1 << bbpin->pin_num;
+			bank_out_mask[(int)bbpin->port_num] |= 1 << bbpin->pin_num;
+			num_out_lines++;
 
-			// Add HAL pin
-			retval = hal_pin_bit_newf(HAL_IN, &(port_data->output_inv[pin + (header - 8)*PINS_PER_HEADER]), comp_id, "bb_gpio.p%d.out-%02d.invert", header, pin);
-
-			if(retval < 0) {
-				rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+			// with packed=1, bank pins are exported below instead
+			if(!packed && export_output(header, pin) < 0) {
 				hal_exit(comp_id);
 				return -1;
 			}
 
-			// Initialize HAL pin
-			*(port_data->output_inv[pin + (header - 8)*PINS_PER_HEADER]) = 0;
-
 			int gpio_num = bbpin->port_num;
 			
 			// configure gpio port if necessary
@@ -345,6 +353,10 @@ int rtapi_app_main(void) {
 		}
 	}
 
+	if(packed && export_banks() < 0) {
+		hal_exit(comp_id);
+		return -1;
+	}
 
 	// export functions
 	rtapi_snprintf(name, sizeof(name), "bb_gpio.write");
@@ -375,41 +387,128 @@ void rtapi_app_exit(void) {
 	hal_exit(comp_id);
 }
 
+static int export_input(int header, int pin) {
+	int index = pin + (header - 8)*PINS_PER_HEADER;
+	int retval;
+
+	// Add HAL pin
+	retval = hal_pin_bit_newf(HAL_OUT, &(port_data->input_pins[index]), comp_id, "bb_gpio.p%d.in-%02d", header, pin);
+
+	if(retval < 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+		return retval;
+	}
+
+	// Add HAL pin
+	retval = hal_pin_bit_newf(HAL_IN, &(port_data->input_inv[index]), comp_id, "bb_gpio.p%d.in-%02d.invert", header, pin);
+
+	if(retval < 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+		return retval;
+	}
+
+	// Initialize HAL pin
+	*(port_data->input_inv[index]) = 0;
+	return 0;
+}
+
+static int export_output(int header, int pin) {
+	int index = pin + (header - 8)*PINS_PER_HEADER;
+	int retval;
+
+	// Add HAL pin
+	retval = hal_pin_bit_newf(HAL_IN, &(port_data->output_pins[index]), comp_id, "bb_gpio.p%d.out-%02d", header, pin);
+
+	if(retval < 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+		return retval;
+	}
+
+	// Add HAL pin
+	retval = hal_pin_bit_newf(HAL_IN, &(port_data->output_inv[index]), comp_id, "bb_gpio.p%d.out-%02d.invert", header, pin);
+
+	if(retval < 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: pin p%d.%02d could not export pin, err: %d\n", modname, header, pin, retval);
+		return retval;
+	}
+
+	// Initialize HAL pin
+	*(port_data->output_inv[index]) = 0;
+	return 0;
+}
+
+// bank<N>.in-invert and bank<N>.out-invert are pins, like the per line
+// p<H>.in-<NN>.invert and userled<N>.invert pins of this driver
+static int export_banks(void) {
+	int n, retval = 0;
+
+	for(n=0; n<GPIO_BANKS; n++) {
+		if(bank_in_mask[n]) {
+			retval = hal_pin_u32_newf(HAL_OUT, &(port_data->bank_in[n]), comp_id, "bb_gpio.bank%d.in", n);
+			if(retval < 0) break;
+			retval = hal_pin_u32_newf(HAL_IN, &(port_data->bank_in_inv[n]), comp_id, "bb_gpio.bank%d.in-invert", n);
+			if(retval < 0) break;
+			*(port_data->bank_in_inv[n]) = 0;
+		}
+		if(bank_out_mask[n]) {
+			retval = hal_pin_u32_newf(HAL_IN, &(port_data->bank_out[n]), comp_id, "bb_gpio.bank%d.out", n);
+			if(retval < 0) break;
+			retval = hal_pin_u32_newf(HAL_IN, &(port_data->bank_out_inv[n]), comp_id, "bb_gpio.bank%d.out-invert", n);
+			if(retval < 0) break;
+			*(port_data->bank_out_inv[n]) = 0;
+		}
+	}
+	if(retval < 0)
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: bank %d could not export pin, err: %d\n", modname, n, retval);
+	return retval;
+}
+
 static void write_port(void *arg, long period) {
 	int i;
 	port_data_t *port = (port_data_t *)arg;
+	unsigned int set[GPIO_BANKS] = { 0 }, clr[GPIO_BANKS] = { 0 };
 
 	// set userled states
 	for(i=0; i<4; i++) {
 		if(port->led_pins[i] == NULL) continue; // short circuit if hal hasn't malloc'd a bit at this location
 
-		bb_gpio_pin pin = user_led_gpio_pins[i];
+		bb_gpio_pin *pin = &user_led_gpio_pins[i];
 
-		if(pin.claimed != 'O') continue; // if we somehow get here but the pin isn't claimed as output, short circuit
+		if(pin->claimed != 'O') continue; // if we somehow get here but the pin isn't claimed as output, short circuit
 
 		if((*port->led_pins[i] ^ *(port->led_inv[i])) == 0)
-			*(pin.port->clrdataout_reg) = (1 << pin.pin_num);
+			clr[(int)pin->port_num] |= (1 << pin->pin_num);
 		else
-			*(pin.port->setdataout_reg) = (1 << pin.pin_num);
+			set[(int)pin->port_num] |= (1 << pin->pin_num);
 	}
 
 	// set output states
-	for(i=1; i<=HEADERS*PINS_PER_HEADER; i++) {
-		if(port->output_pins[i] == NULL) continue; // short circuit if hal hasn't malloc'd a bit at this location
+	if(packed) {
+		for(i=0; i<GPIO_BANKS; i++) {
+			if(bank_out_mask[i] == 0) continue;
 
-		bb_gpio_pin pin;
+			unsigned int out = *(port->bank_out[i]) ^ *(port->bank_out_inv[i]);
 
-		if(i<PINS_PER_HEADER)
-			pin = p8_pins[i];
-		else 
-			pin = p9_pins[i - PINS_PER_HEADER];
-
-		if(pin.claimed != 'O') continue; // if we somehow get here but the pin isn't claimed as output, short circuit
+			set[i] |= out & bank_out_mask[i];
+			clr[i] |= ~out & bank_out_mask[i];
+		}
+	} else {
+		for(i=0; i<num_out_lines; i++) {
+			bb_gpio_line *line = &out_lines[i];
+
+			if((*port->output_pins[line->index] ^ *(port->output_inv[line->index])) == 0)
+				clr[line->bank] |= line->mask;
+			else
+				set[line->bank] |= line->mask;
+		}
+	}
 
-		if((*port->output_pins[i] ^ *(port->output_inv[i])) == 0)
-			*(pin.port->clrdataout_reg) = (1 << pin.pin_num);
-		else
-			*(pin.port->setdataout_reg) = (1 << pin.pin_num);
+	// one write per register and bank
+	for(i=0; i<GPIO_BANKS; i++) {
+		if(set[i])
+			*(gpio_ports[i]->setdataout_reg) = set[i];
+		if(clr[i])
+			*(gpio_ports[i]->clrdataout_reg) = clr[i];
 	}
 }
 
@@ -417,23 +516,26 @@ static void write_port(void *arg, long period) {
 static void read_port(void *arg, long period) {
 	int i;
 	port_data_t *port = (port_data_t *)arg;
+	unsigned int in[GPIO_BANKS];
 
-	// read input states
-	for(i=1; i<=HEADERS*PINS_PER_HEADER; i++) {
-		if(port->input_pins[i] == NULL) continue; // short circuit if hal hasn't malloc'd a bit at this location
-
-		bb_gpio_pin pin;
+	// one read per bank
+	for(i=0; i<GPIO_BANKS; i++) {
+		if(bank_in_mask[i])
+			in[i] = *(gpio_ports[i]->datain_reg);
+	}
 
-		if(i<PINS_PER_HEADER) {
-			pin = p8_pins[i];
-		} else {
-			pin = p9_pins[i - PINS_PER_HEADER];
+	// read input states
+	if(packed) {
+		for(i=0; i<GPIO_BANKS; i++) {
+			if(bank_in_mask[i])
+				*(port->bank_in[i]) = (in[i] ^ *(port->bank_in_inv[i])) & bank_in_mask[i];
 		}
+	} else {
+		for(i=0; i<num_in_lines; i++) {
+			bb_gpio_line *line = &in_lines[i];
 
-
-		if(!(pin.claimed == 'I' || pin.claimed == 'U' || pin.claimed == 'D')) continue; // if we get here but the pin isn't claimed as input, short circuit
-
-		*port->input_pins[i] = ((*(pin.port->datain_reg) & (1 << pin.pin_num))  >> pin.pin_num) ^ *(port->input_inv[i]);
+			*port->input_pins[line->index] = ((in[line->bank] & line->mask) != 0) ^ *(port->input_inv[line->index]);
+		}
 	}
 }
 
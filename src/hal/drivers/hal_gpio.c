@@ -78,6 +78,19 @@ static char *exclude = "0"; // all used
 RTAPI_MP_STRING(exclude, "exclude pins, 1=dont use");
 static unsigned exclude_map;
 
+// port level mode: one u32 pin each way instead of a pin per line
+static int packed = 0;
+RTAPI_MP_INT(packed, "1=packed port-in/port-out pins, bit n = GPIO n");
+
+// the lines in use, as bits of the GPLEV0/GPSET0/GPCLR0 registers
+static uint32_t in_mask, out_mask;
+
+typedef struct {
+    hal_u32_t *in;		// packed inputs, bit n = GPIO n
+    hal_u32_t *out;		// packed outputs, bit n = GPIO n
+} packed_port_t;
+static packed_port_t *packed_port;
+
 static int comp_id;		/* component ID */
 static unsigned char *pins, *gpios;
 hal_bit_t **port_data;
@@ -293,16 +306,41 @@ int rtapi_app_main(void)
       pinno = pins[n];
       if (dir_map & RTAPI_BIT(n)) {
 	bcm2835_gpio_fsel(gpios[n], BCM2835_GPIO_FSEL_OUTP);
+	out_mask |= RTAPI_BIT(gpios[n]);
+	if (packed)
+	  continue;
 	if ((retval = hal_pin_bit_newf(HAL_IN, &port_data[n],
 				       comp_id, "hal_gpio.pin-%02d-out", pinno)) < 0)
 	  break;
       } else {
 	bcm2835_gpio_fsel(gpios[n], BCM2835_GPIO_FSEL_INPT);
+	in_mask |= RTAPI_BIT(gpios[n]);
+	if (packed)
+	  continue;
 	if ((retval = hal_pin_bit_newf(HAL_OUT, &port_data[n],
 				       comp_id, "hal_gpio.pin-%02d-in", pinno)) < 0)
 	  break;
       }
     }
+    if ((retval >= 0) && packed) {
+      packed_port = hal_malloc(sizeof(packed_port_t));
+      if (packed_port == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+			"HAL_GPIO: ERROR: hal_malloc() failed\n");
+	hal_exit(comp_id);
+	return -1;
+      }
+      if (((retval = hal_pin_u32_newf(HAL_OUT, &packed_port->in,
+				      comp_id, "hal_gpio.port-in")) < 0) ||
+	  ((retval = hal_pin_u32_newf(HAL_IN, &packed_port->out,
+				      comp_id, "hal_gpio.port-out")) < 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+			"HAL_GPIO: ERROR: port pin export failed with err=%i\n",
+			retval);
+	hal_exit(comp_id);
+	return -1;
+      }
+    }
     if (retval < 0) {
       rtapi_print_msg(RTAPI_MSG_ERR,
 		      "HAL_GPIO: ERROR: pin %d export failed with err=%i\n", 
@@ -343,29 +381,40 @@ void rtapi_app_exit(void)
   hal_exit(comp_id);
 }
 
+// all lines are in bank 0, so the outputs take one write to GPSET0
+// and one to GPCLR0, and the inputs one read of GPLEV0
 static void write_port(void *arg, long period)
 {
+  uint32_t set = 0;
   int n;
 
-  for (n = 0; n < npins; n++) {
-    if (exclude_map & RTAPI_BIT(n)) 
-      continue;
-    if (dir_map & RTAPI_BIT(n)) {
-      if (*(port_data[n])) { 
-	bcm2835_gpio_set(gpios[n]);
-      } else {
-	bcm2835_gpio_clr(gpios[n]);
-      }
+  if (packed) {
+    set = *(packed_port->out);
+  } else {
+    for (n = 0; n < npins; n++) {
+      if ((dir_map & RTAPI_BIT(n)) && (~exclude_map & RTAPI_BIT(n)) &&
+	  *(port_data[n]))
+	set |= RTAPI_BIT(gpios[n]);
     }
   }
+  if (set & out_mask)
+    bcm2835_peri_write(gpio + BCM2835_GPSET0/4, set & out_mask);
+  if (~set & out_mask)
+    bcm2835_peri_write(gpio + BCM2835_GPCLR0/4, ~set & out_mask);
 }
 
 static void read_port(void *arg, long period)
 {
+  uint32_t value;
   int n;
 
+  value = bcm2835_peri_read(gpio + BCM2835_GPLEV0/4);
+  if (packed) {
+    *(packed_port->in) = value & in_mask;
+    return;
+  }
   for (n = 0; n < npins; n++) {
     if ((~dir_map & RTAPI_BIT(n)) && (~exclude_map & RTAPI_BIT(n)))
-      *port_data[n] = bcm2835_gpio_lev(gpios[n]);
+      *port_data[n] = (value >> gpios[n]) & 1;
   }
 }
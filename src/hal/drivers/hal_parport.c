@@ -47,6 +47,17 @@
     <portnum> is the port number, starting from zero.  <pinnum> is
     the physical pin number on the DB-25 connector.
 
+    With the module parameter 'packed=1', each port instead has one
+    u32 pin per direction, 'parport.<portnum>.port-in' and
+    'parport.<portnum>.port-out', laid out like the registers: bits
+    0-7 are data pins 2-9, bits 8-12 status pins 15, 13, 12, 10, 11
+    and bits 16-19 control pins 1, 14, 16, 17, with the hardware
+    inverters already compensated.  Polarity and reset are the u32
+    parameters 'parport.<portnum>.port-out-invert' and
+    'parport.<portnum>.port-out-reset', one bit per output.  The
+    read and write functions then do no per bit work at all; use
+    bitslice and bitmerge where single bits are needed.
+
     The realtime version of the driver exports two HAL functions for
     each port, 'parport.<portnum>.read' and 'parport.<portnum>.write'.
     It also exports two additional functions, 'parport.read-all' and
@@ -114,6 +125,8 @@ MODULE_DESCRIPTION("Parallel Port Driver for EMC HAL");
 MODULE_LICENSE("GPL");
 static char *cfg = "0x0278";	/* config string, default 1 output port at 278 */
 RTAPI_MP_STRING(cfg, "config string");
+static int packed = 0;		/* port-in/port-out words instead of bits */
+RTAPI_MP_INT(packed, "1=packed port-in/port-out pins instead of a pin per bit");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -138,6 +151,10 @@ typedef struct {
     hal_bit_t control_reset[4];	/* reset flag for output pins 1, 14, 16, 17 */
     hal_u32_t reset_time;       /* min ns between write and reset */
     hal_u32_t debug1, debug2;
+    hal_u32_t *port_in;		/* packed inputs, packed=1 only */
+    hal_u32_t *port_out;	/* packed outputs, packed=1 only */
+    hal_u32_t port_out_inv;	/* polarity of the packed outputs */
+    hal_u32_t port_out_reset;	/* reset flags of the packed outputs */
     long long write_time;
     unsigned char outdata;
     unsigned char reset_mask;       /* reset flag for pin 2..9 */
@@ -172,6 +189,8 @@ static void reset_port(void *arg, long period);
 static void write_port(void *arg, long period);
 static void read_all(void *arg, long period);
 static void write_all(void *arg, long period);
+static void read_packed(parport_t *port);
+static void write_packed(parport_t *port);
 
 /* 'pins_and_params()' does most of the work involved in setting up
    the driver.  It parses the command line (argv[]), then if the
@@ -184,6 +203,7 @@ static int pins_and_params(char *argv[]);
 
 static unsigned short parse_port_addr(char *cp);
 static int export_port(int portnum, parport_t * addr);
+static int export_packed(int portnum, parport_t * addr);
 static int export_input_pin(int portnum, int pin, hal_bit_t ** base, int n);
 static int export_output_pin(int portnum, int pin, hal_bit_t ** dbase,
     hal_bit_t * pbase, hal_bit_t * rbase, int n);
@@ -330,6 +350,10 @@ static void read_port(void *arg, long period)
     unsigned char indata, mask;
 
     port = arg;
+    if (packed) {
+	read_packed(port);
+	return;
+    }
     /* read the status port */
 #if defined(USE_PORTABLE_PARPORT_IO)
     indata = hal_parport_read_status(&port->portdata);
@@ -418,6 +442,10 @@ static void write_port(void *arg, long period)
     unsigned char outdata, mask;
 
     port = arg;
+    if (packed) {
+	write_packed(port);
+	return;
+    }
     /* are we using the data port for output? */
     if (port->data_dir == 0) {
 	int reset_mask=0, reset_val=0;
@@ -492,6 +520,87 @@ static void write_port(void *arg, long period)
     port->write_time_ctrl = rtapi_get_clocks();
 }
 
+/* bit layout of the packed words */
+#define PACKED_DATA_SHIFT	0
+#define PACKED_STATUS_SHIFT	8
+#define PACKED_CONTROL_SHIFT	16
+
+static void read_packed(parport_t *port)
+{
+    unsigned char indata;
+    hal_u32_t word;
+
+    /* the status port, with bit 7 (pin 11) inverter compensated */
+#if defined(USE_PORTABLE_PARPORT_IO)
+    indata = hal_parport_read_status(&port->portdata);
+#else
+    indata = inb(port->base_addr + 1);
+#endif
+    word = ((indata ^ 0x80) >> 3) << PACKED_STATUS_SHIFT;
+    if (port->data_dir != 0) {
+#if defined(USE_PORTABLE_PARPORT_IO)
+	indata = hal_parport_read_data(&port->portdata);
+#else
+	indata = inb(port->base_addr);
+#endif
+	word |= indata << PACKED_DATA_SHIFT;
+    }
+    if (port->use_control_in) {
+	/* correct for hardware inverters on pins 1, 14, & 17 */
+#if defined(USE_PORTABLE_PARPORT_IO)
+	indata = hal_parport_read_control(&port->portdata) ^ 0x0B;
+#else
+	indata = inb(port->base_addr + 2) ^ 0x0B;
+#endif
+	word |= (indata & 0x0F) << PACKED_CONTROL_SHIFT;
+    }
+    *(port->port_in) = word;
+}
+
+static void write_packed(parport_t *port)
+{
+    hal_u32_t word, reset, reset_val;
+    unsigned char outdata;
+
+    word = *(port->port_out) ^ port->port_out_inv;
+    reset = port->port_out_reset;
+    reset_val = reset & port->port_out_inv;
+    if (port->data_dir == 0) {
+	outdata = word >> PACKED_DATA_SHIFT;
+#if defined(USE_PORTABLE_PARPORT_IO)
+	hal_parport_write_data(&port->portdata, outdata);
+#else
+	outb(outdata, port->base_addr);
+#endif
+	port->write_time = rtapi_get_clocks();
+	port->reset_mask = reset >> PACKED_DATA_SHIFT;
+	port->reset_val = reset_val >> PACKED_DATA_SHIFT;
+	port->outdata = outdata;
+	/* control port byte, with direction bit clear */
+	outdata = 0x00;
+    } else {
+	/* control port byte, with direction bit set */
+	outdata = 0x20;
+    }
+    if (port->use_control_in) {
+	/* force those pins high */
+	outdata |= 0x0F;
+    } else {
+	outdata |= (word >> PACKED_CONTROL_SHIFT) & 0x0F;
+	port->reset_mask_ctrl = (reset >> PACKED_CONTROL_SHIFT) & 0x0F;
+	port->reset_val_ctrl = (reset_val >> PACKED_CONTROL_SHIFT) & 0x0F;
+	port->outdata_ctrl = outdata;
+    }
+    /* correct for hardware inverters on pins 1, 14, & 17 */
+    outdata ^= 0x0B;
+#if defined(USE_PORTABLE_PARPORT_IO)
+    hal_parport_write_control(&port->portdata, outdata);
+#else
+    outb(outdata, port->base_addr + 2);
+#endif
+    port->write_time_ctrl = rtapi_get_clocks();
+}
+
 void read_all(void *arg, long period)
 {
     parport_t *port;
@@ -667,6 +776,11 @@ static int export_port(int portnum, parport_t * port)
     rtapi_set_msg_level(RTAPI_MSG_WARN);
 
     retval = 0;
+    if (packed) {
+	retval = export_packed(portnum, port);
+	rtapi_set_msg_level(msg);
+	return retval;
+    }
     /* declare input pins (status port) */
     retval += export_input_pin(portnum, 15, port->status_in, 0);
     retval += export_input_pin(portnum, 13, port->status_in, 1);
@@ -732,6 +846,26 @@ static int export_port(int portnum, parport_t * port)
     return retval;
 }
 
+static int export_packed(int portnum, parport_t * port)
+{
+    int retval = 0;
+
+    retval += hal_pin_u32_newf(HAL_OUT, &port->port_in, comp_id,
+	    "parport.%d.port-in", portnum);
+    retval += hal_pin_u32_newf(HAL_IN, &port->port_out, comp_id,
+	    "parport.%d.port-out", portnum);
+    retval += hal_param_u32_newf(HAL_RW, &port->port_out_inv, comp_id,
+	    "parport.%d.port-out-invert", portnum);
+    retval += hal_param_u32_newf(HAL_RW, &port->port_out_reset, comp_id,
+	    "parport.%d.port-out-reset", portnum);
+    if (port->data_dir == 0) {
+	retval += hal_param_u32_newf(HAL_RW, &port->reset_time, comp_id,
+		"parport.%d.reset-time", portnum);
+	port->write_time = 0;
+    }
+    return retval;
+}
+
 static int export_input_pin(int portnum, int pin, hal_bit_t ** base, int n)
 {
     int retval;
@@ -91,6 +91,7 @@ void *write_packet_ptr = &write_packet;
 int write_packet_size = 0;
 int read_cnt = 0;
 int write_cnt = 0;
+static int read_pending = 0; // queued reads sent, reply not collected yet
 
 /// ethernet io functions
 
@@ -253,6 +254,12 @@ static int fetch_hwaddr(int sockfd, unsigned char buf[6]) {
     return 0;
 }
 
+// a board at a loopback address is a local stand-in, as used by the
+// tests: there is no interface to reserve and nothing to arp
+static int board_is_local(void) {
+    return (ntohl(server_addr.sin_addr.s_addr) >> 24) == IN_LOOPBACKNET;
+}
+
 static int init_net(void) {
     int ret;
 
@@ -274,7 +281,9 @@ static int init_net(void) {
         return -errno;
     }
 
-    if(use_iptables()) {
+    if(board_is_local()) {
+        LL_PRINT("board at loopback address %s, skipping iptables and arp setup\n", board_ip);
+    } else if(use_iptables()) {
         LL_PRINT("Using iptables for exclusive access to network interface\n")
         // firewall has to be open in order to successfully arp the board
         clear_iptables();
@@ -303,6 +312,8 @@ static int init_net(void) {
     }
 
     memset(&req, 0, sizeof(req));
+    if(board_is_local()) return 0;
+
     struct sockaddr_in *sin;
 
     sin = (struct sockaddr_in *) &req.arp_pa;
@@ -334,7 +345,7 @@ static int init_net(void) {
 }
 
 static int close_net(void) {
-    if(use_iptables()) clear_iptables();
+    if(!board_is_local() && use_iptables()) clear_iptables();
 
     if(req.arp_flags & ATF_PERM) {
         int ret = ioctl(sockfd, SIOCDARP, &req);
@@ -357,6 +368,8 @@ static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
 
 /// hm2_eth io functions
 
+static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this);
+
 static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
     int send, recv, i = 0;
     u8 tmp_buffer[size + 4];
@@ -364,6 +377,9 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int siz
 
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
+    // the reply to a split-phase read is in flight, it must not be
+    // taken for the reply to this one
+    if (read_pending) hm2_eth_receive_queued_reads(this);
     read_cnt++;
 
     LBP16_INIT_PACKET4(read_packet, CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr & 0xFFFF);
@@ -392,33 +408,64 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int siz
     return 1;  // success
 }
 
-static int hm2_eth_enqueue_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
+// The queued reads go out as one packet, and the reply is collected
+// separately, so hostmot2 can send the request early in the period and
+// run other functs while it is in flight (see hm2_tram_read_request()).
+// queue_read(.., -1) does both back to back.
+
+static long long read_sent_time;
+
+static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
+    int send;
+
     if (comm_active == 0) return 1;
-    if (size == 0) return 1;
-    if (size == -1) {
-        int send, recv, i = 0;
-        long long t1, t2;
-        u8 tmp_buffer[queue_buff_size];
+    if (read_pending) hm2_eth_receive_queued_reads(this);
+    if (queue_reads_count == 0) return 1;
 
-        read_cnt++;
-        send = eth_socket_send(sockfd, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*queue_reads_count, 0);
-        if(send < 0)
-            LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
-        t1 = rtapi_get_time();
-        do {
-            rtapi_delay(READ_PCK_DELAY_NS);
-            recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, queue_buff_size, 0);
-            t2 = rtapi_get_time();
-            i++;
-        } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
-        LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - t1);
+    read_cnt++;
+    send = eth_socket_send(sockfd, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*queue_reads_count, 0);
+    if(send < 0)
+        LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+    read_sent_time = rtapi_get_time();
+    read_pending = 1;
+    return 1;
+}
+
+static int hm2_eth_receive_queued_reads(hm2_lowlevel_io_t *this) {
+    int recv, i = 0;
+    long long t2;
+    u8 tmp_buffer[queue_buff_size];
 
+    if (comm_active == 0) return 1;
+    if (!read_pending) return 1;
+    read_pending = 0;
+
+    do {
+        recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, queue_buff_size, 0);
+        t2 = rtapi_get_time();
+        i++;
+        if (recv >= 0) break;
+        rtapi_delay(READ_PCK_DELAY_NS);
+    } while ((t2 - read_sent_time) < 200*1000*1000);
+    LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - read_sent_time);
+
+    if (recv >= 0) {
         for (i = 0; i < queue_reads_count; i++) {
             memcpy(queue_reads[i].buffer, &tmp_buffer[queue_reads[i].from], queue_reads[i].size);
         }
+    }
+
+    queue_reads_count = 0;
+    queue_buff_size = 0;
+    return recv >= 0;
+}
 
-        queue_reads_count = 0;
-        queue_buff_size = 0;
+static int hm2_eth_enqueue_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
+    if (comm_active == 0) return 1;
+    if (size == 0) return 1;
+    if (size == -1) {
+        hm2_eth_send_queued_reads(this);
+        hm2_eth_receive_queued_reads(this);
     } else {
         LBP16_INIT_PACKET4(queue_packets[queue_reads_count], CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr);
         queue_reads[queue_reads_count].buffer = buffer;
@@ -483,6 +530,7 @@ static int hm2_eth_enqueue_write(hm2_lowlevel_io_t *this, u32 addr, void *buffer
 
 static int hm2_eth_probe() {
     int ret, send, recv;
+    long long t1, t2;
     char board_name[16] = {0, };
     char llio_name[16] = {0, };
     hm2_eth_t *board;
@@ -491,7 +539,11 @@ static int hm2_eth_probe() {
     send = eth_socket_send(sockfd, (void*) &read_packet, sizeof(read_packet), 0);
     if(send < 0)
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
-    recv = eth_socket_recv(sockfd, (void*) &board_name, 16, 0);
+    t1 = rtapi_get_time();
+    do {
+        recv = eth_socket_recv(sockfd, (void*) &board_name, 16, 0);
+        t2 = rtapi_get_time();
+    } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
     if(recv < 0)
         LL_PRINT("ERROR: receiving packet: %s\n", strerror(errno));
 
@@ -581,6 +633,8 @@ static int hm2_eth_probe() {
     board->llio.write = hm2_eth_write;
     board->llio.queue_read = hm2_eth_enqueue_read;
     board->llio.queue_write = hm2_eth_enqueue_write;
+    board->llio.send_queued_reads = hm2_eth_send_queued_reads;
+    board->llio.receive_queued_reads = hm2_eth_receive_queued_reads;
 
     ret = hm2_register(&board->llio, config[boards_count]);
     if (ret != 0) {
@@ -58,6 +58,22 @@ RTAPI_MP_ARRAY_STRING(config, HM2_TEST_MAX_BOARDS, "config string for the AnyIO
 int test_pattern = 0;
 RTAPI_MP_INT(test_pattern, "The test pattern to show to the hostmot2 driver.");
 
+// these only apply to the behavioral model (test pattern 15)
+int sim_period_ns = 1000000;
+RTAPI_MP_INT(sim_period_ns, "Simulated time per TRAM read, in ns.");
+
+int sim_access_ns = 0;
+RTAPI_MP_INT(sim_access_ns, "Simulated bus cost per llio access, in ns.");
+
+int sim_word_ns = 0;
+RTAPI_MP_INT(sim_word_ns, "Simulated bus cost per 32-bit word transferred, in ns.");
+
+int sim_register_stride = 0x100;
+RTAPI_MP_INT(sim_register_stride, "Register stride of the simulated board, a multiple of 4 from 8 to 256.");
+
+int sim_sserial = 0;
+RTAPI_MP_INT(sim_sserial, "Model a smart-serial port with one remote on pins 22 and 23.");
+
 
 static int comp_id;
 
@@ -84,14 +100,63 @@ static void set32(hm2_test_t *me, u16 addr, u32 val) {
 //
 
 
+// burn the time a real bus would take for an access of 'size' bytes
+static void hm2_test_bus_delay(int size) {
+    long ns = sim_access_ns + (long)sim_word_ns * ((size + 3) / 4);
+    long max = rtapi_delay_max();
+
+    while (ns > 0) {
+        rtapi_delay((ns > max) ? max : ns);
+        ns -= max;
+    }
+}
+
+
 static int hm2_test_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
     hm2_test_t *me = this->private;
-    memcpy(buffer, &me->test_pattern.tp8[addr], size);
+    int i;
+
+    if (!me->model.enabled || (addr & 3) || (size & 3)) {
+        memcpy(buffer, &me->test_pattern.tp8[addr], size);
+        return 1;  // success
+    }
+
+    hm2_test_bus_delay(size);
+    for (i = 0; i < size / 4; i ++) {
+        ((u32 *)buffer)[i] = hm2_test_model_read32(me, addr + (i * 4));
+    }
+    if (me->model.hal) {
+        me->model.hal->reads ++;
+        me->model.hal->read_bytes += size;
+    }
     return 1;  // success
 }
 
 
 static int hm2_test_write(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
+    hm2_test_t *me = this->private;
+    int i;
+
+    if (!me->model.enabled) return 1;  // success
+
+    hm2_test_bus_delay(size);
+    for (i = 0; i < size / 4; i ++) {
+        hm2_test_model_write32(me, addr + (i * 4), ((u32 *)buffer)[i]);
+    }
+    if (me->model.hal) {
+        me->model.hal->writes ++;
+        me->model.hal->write_bytes += size;
+    }
+    return 1;  // success
+}
+
+
+// the end of a TRAM read is one tick of simulated time for the model
+static int hm2_test_queue_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
+    hm2_test_t *me = this->private;
+
+    if (size != -1) return hm2_test_read(this, addr, buffer, size);
+    hm2_test_model_tick(me, sim_period_ns);
     return 1;  // success
 }
 
@@ -561,6 +626,23 @@ int rtapi_app_main(void) {
             break;
         }
 
+
+        //
+        // a working board: the behavioral model in hm2_test_model.c
+        //
+
+        case HM2_TEST_MODEL_PATTERN: {
+            // two instances per register, and the modules are 0x1000 apart
+            if ((sim_register_stride & 3) || (sim_register_stride < 8) || (sim_register_stride > 0x100)) {
+                LL_ERR("invalid sim_register_stride %d\n", sim_register_stride);
+                hal_exit(comp_id);
+                return -EINVAL;
+            }
+            hm2_test_model_init(me, sim_register_stride, sim_sserial);
+            me->llio.queue_read = hm2_test_queue_read;
+            break;
+        }
+
         default: {
             LL_ERR("unknown test pattern %d", test_pattern);
 	    hal_exit(comp_id);
@@ -591,6 +673,15 @@ int rtapi_app_main(void) {
         return -EIO;
     }
 
+    if (me->model.enabled) {
+        r = hm2_test_model_export_hal(me, comp_id);
+        if (r < 0) {
+            hm2_unregister(&me->llio);
+            hal_exit(comp_id);
+            return r;
+        }
+    }
+
     THIS_PRINT("initialized hm2 test-pattern %d\n", test_pattern);
 
     hal_ready(comp_id);
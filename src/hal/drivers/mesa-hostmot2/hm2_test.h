@@ -22,6 +22,56 @@
 
 #define HM2_TEST_MAX_BOARDS (2)
 
+// test pattern 15 is a behavioral model of a small board, see hm2_test_model.c
+#define HM2_TEST_MODEL_PATTERN   (15)
+#define HM2_TEST_MODEL_ENCODERS  (2)
+#define HM2_TEST_MODEL_STEPGENS  (2)
+#define HM2_TEST_MODEL_PWMGENS   (2)
+#define HM2_TEST_MODEL_SSERIAL_ROM    (256)
+#define HM2_TEST_MODEL_SSERIAL_LOCAL  (256)
+#define HM2_TEST_MODEL_SSERIAL_NV     (16)
+
+typedef struct {
+    hal_float_t *pwm_duty[HM2_TEST_MODEL_PWMGENS];
+
+    // register traffic, and simulated time in TRAM reads
+    hal_u32_t ticks;
+    hal_u32_t reads;
+    hal_u32_t read_bytes;
+    hal_u32_t writes;
+    hal_u32_t write_bytes;
+
+    // the smart-serial remote, if modelled
+    hal_u32_t *sserial_cs;            // CS register at the last Do-It
+    hal_u32_t *sserial_output;        // process data received
+    hal_u32_t *sserial_nvunitnumber;  // nonvol value it reports
+} hm2_test_model_hal_t;
+
+typedef struct {
+    int enabled;
+    u32 reg_stride;     // RegisterStride0, the spacing of a module's registers
+    u64 time_ns;        // simulated time
+    u64 clocks;         // ClockLow cycles at time_ns
+    s64 wd_remaining;   // watchdog clocks left
+    u32 wd_status;
+    s64 accum[HM2_TEST_MODEL_STEPGENS];  // stepgen DDS, steps * 2^32
+    s32 enc_offset[HM2_TEST_MODEL_ENCODERS];
+    u16 enc_timestamp[HM2_TEST_MODEL_ENCODERS];
+
+    // smart-serial port 0, with one remote on channel 0
+    int sserial;
+    u32 ss_command;     // pending command, run by the next register read
+    u32 ss_data;        // data register, as read
+    u32 ss_user[3];     // interface registers 0-2, as read
+    u32 ss_transfers;   // process data Do-Its, the remote's input data
+    u8 ss_nonvol;       // remote's nonvolatile access mode
+    u8 ss_local[HM2_TEST_MODEL_SSERIAL_LOCAL];  // SSLBP local memory
+    u8 ss_rom[HM2_TEST_MODEL_SSERIAL_ROM];      // remote's discovery data
+    u8 ss_nv[HM2_TEST_MODEL_SSERIAL_NV];        // remote's EEPROM
+
+    hm2_test_model_hal_t *hal;
+} hm2_test_model_t;
+
 typedef struct {
     union {
         u8 tp8[64 * 1024];
@@ -29,5 +79,12 @@ typedef struct {
     } test_pattern;
 
     hm2_lowlevel_io_t llio;
+    hm2_test_model_t model;
 } hm2_test_t;
 
+void hm2_test_model_init(hm2_test_t *me, u32 reg_stride, int sserial);
+int hm2_test_model_export_hal(hm2_test_t *me, int comp_id);
+u32 hm2_test_model_read32(hm2_test_t *me, u16 addr);
+void hm2_test_model_write32(hm2_test_t *me, u16 addr, u32 val);
+void hm2_test_model_tick(hm2_test_t *me, long period_ns);
+
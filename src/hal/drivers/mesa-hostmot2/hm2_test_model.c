@@ -0,0 +1,555 @@
+
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+
+//
+//  Behavioral model of a small HostMot2 firmware, used by hm2_test test
+//  pattern 15.  The board has one 24-pin IOPort connector, a watchdog,
+//  and two instances each of encoder, stepgen and pwmgen:
+//
+//      pins  0-5    encoder 0 and 1 (A, B, Index)
+//      pins  6-9    stepgen 0 and 1 (Step, Dir)
+//      pins 10-15   pwmgen 0 and 1 (PWM, Dir, /Enable)
+//      pins 16-23   GPIO, pins 16-19 are wired to pins 20-23
+//
+//  With the sim_sserial parameter of hm2_test, pins 22 and 23 are
+//  smart-serial port 0 instead, with one remote on channel 0.  The
+//  remote speaks enough SSLBP for the hostmot2 setup, process data and
+//  nonvolatile parameter reads: it has a 16 bit output, a 16 bit input
+//  that counts its process data transfers, and two nonvolatile globals,
+//  nvwatchdogtimeout and nvunitnumber.
+//
+//  The register stride is set by the sim_register_stride parameter of
+//  hm2_test.  The default 0x100 keeps the registers of a module apart;
+//  with a stride of 8 the two instances of a register fill it, and the
+//  registers of a module follow each other with no gap, so hostmot2 can
+//  merge their TRAM regions into fewer bursts.
+//
+//  Time only moves when hm2_test_model_tick() is called, once per TRAM
+//  read, so a run is repeatable whatever the load on the host.  Each
+//  stepgen drives the encoder with the same number, like a motor with
+//  an encoder on it: the encoder counts one per step and latches the
+//  timestamp of the last step, so the hostmot2 encoder velocity
+//  estimate sees realistic data.  When the watchdog bites, the outputs
+//  stop, as on the real hardware.
+//
+
+#include "config.h"
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+
+#include "hal.h"
+
+#include "hostmot2.h"
+#include "hostmot2-lowlevel.h"
+#include "hm2_test.h"
+
+
+#define CLOCK_LOW       (50000000)
+#define CLOCK_HIGH      (100000000)
+#define NS_PER_CLOCK    (1000000000 / CLOCK_LOW)
+
+// needs 'me' in scope
+#define REG(base, r)    ((base) + ((r) * me->model.reg_stride))
+
+#define WD_BASE         (0x0C00)
+#define IOPORT_BASE     (0x1000)
+#define STEPGEN_BASE    (0x2000)
+#define ENCODER_BASE    (0x3000)
+#define PWMGEN_BASE     (0x4000)
+#define SSERIAL_BASE    (0x5000)
+
+#define MODEL_PINS      (24)
+
+
+static u32 get32(hm2_test_t *me, u16 addr) {
+    return me->test_pattern.tp32[addr/4];
+}
+
+static void set32(hm2_test_t *me, u16 addr, u32 val) {
+    me->test_pattern.tp32[addr/4] = val;
+}
+
+// 'strides' selects InstanceStride 0 (4) or 1 (0x40) in the high
+// nibble, the RegisterStride is always RegisterStride 0
+static void set_md(hm2_test_t *me, int index, u8 gtag, u8 version, u8 instances,
+                   u16 base, u8 num_registers, u8 strides, u32 multiple_registers) {
+    u16 addr = 0x440 + (index * 12);
+
+    // ClockLow
+    set32(me, addr + 0, gtag | (version << 8) | (1 << 16) | (instances << 24));
+    set32(me, addr + 4, base | (num_registers << 16) | (strides << 24));
+    set32(me, addr + 8, multiple_registers);
+}
+
+static void set_pd(hm2_test_t *me, int pin, u8 sec_pin, u8 sec_tag, u8 sec_unit) {
+    set32(me, 0x600 + (pin * 4),
+          sec_pin | (sec_tag << 8) | (sec_unit << 16) | (HM2_GTAG_IOPORT << 24));
+}
+
+
+//
+// the smart-serial remote's discovery data: a table of contents for the
+// process data (PTOC) and one for the globals (GTOC), each a zero
+// terminated list of record addresses
+//
+
+#define SSERIAL_PTOC    (0x10)
+#define SSERIAL_GTOC    (0x18)
+
+static void put16(u8 *p, u16 val) {
+    p[0] = val & 0xFF;
+    p[1] = val >> 8;
+}
+
+static void put32(u8 *p, u32 val) {
+    put16(p, val & 0xFFFF);
+    put16(p + 2, val >> 16);
+}
+
+static int sserial_record(u8 *rom, int addr, u8 type, u8 bits, u8 dir,
+                          u16 parm_addr, const char *unit, const char *name) {
+    rom[addr + 0] = LBP_DATA;
+    rom[addr + 1] = bits;
+    rom[addr + 2] = type;
+    rom[addr + 3] = dir;
+    // ParmMin and ParmMax stay 0, they don't matter for these types
+    memcpy(&rom[addr + 12], &parm_addr, 2);
+    addr += 14;
+    strcpy((char *)&rom[addr], unit);
+    addr += strlen(unit) + 1;
+    strcpy((char *)&rom[addr], name);
+    return addr + strlen(name) + 1;
+}
+
+static void sserial_init(hm2_test_t *me) {
+    hm2_test_model_t *m = &me->model;
+    int addr = 0x20;
+
+    m->ss_local[SSLBPMINORREVISIONLOC] = 43;
+    m->ss_local[SSLBPCHANNELSTARTLOC] = 0x40;
+    m->ss_local[SSLBPCHANNELSTRIDELOC] = 0x30;
+    put32(&m->ss_local[0x40 + 42], 2500000);   // channel 0 baud rate
+
+    put16(&m->ss_rom[SSERIAL_PTOC + 0], addr);
+    addr = sserial_record(m->ss_rom, addr, LBP_STREAM, 16, LBP_OUT, 0, "none", "output");
+    put16(&m->ss_rom[SSERIAL_PTOC + 2], addr);
+    addr = sserial_record(m->ss_rom, addr, LBP_STREAM, 16, LBP_IN, 0, "none", "input");
+
+    put16(&m->ss_rom[SSERIAL_GTOC + 0], addr);
+    addr = sserial_record(m->ss_rom, addr, LBP_NONVOL_UNSIGNED, 16, LBP_IN, 2, "ms", "nvwatchdogtimeout");
+    put16(&m->ss_rom[SSERIAL_GTOC + 2], addr);
+    sserial_record(m->ss_rom, addr, LBP_NONVOL_UNSIGNED, 32, LBP_IN, 4, "none", "nvunitnumber");
+
+    put16(&m->ss_nv[2], 50);    // nvwatchdogtimeout, nvunitnumber comes from its pin
+}
+
+
+void hm2_test_model_init(hm2_test_t *me, u32 reg_stride, int sserial) {
+    hm2_test_model_t *m = &me->model;
+    const char *name = "HOSTMOT2";
+    int i;
+
+    memset(m, 0, sizeof(hm2_test_model_t));
+    m->enabled = 1;
+    m->reg_stride = reg_stride;
+    m->sserial = sserial;
+
+    set32(me, HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+    memcpy(&me->test_pattern.tp8[HM2_ADDR_CONFIGNAME], name, 8);
+    set32(me, HM2_ADDR_IDROM_OFFSET, 0x400);
+
+    set32(me, 0x400, 2);            // standard idrom type
+    set32(me, 0x404, 0x40);         // Module Descriptors at 0x440
+    set32(me, 0x408, 0x200);        // Pin Descriptors at 0x600
+    memcpy(&me->test_pattern.tp8[0x40c], "HM2MODEL", 8);
+    set32(me, 0x41c, 1);            // IOPorts
+    set32(me, 0x420, MODEL_PINS);   // IOWidth
+    set32(me, 0x424, MODEL_PINS);   // PortWidth
+    set32(me, 0x428, CLOCK_LOW);
+    set32(me, 0x42c, CLOCK_HIGH);
+    set32(me, 0x430, 4);            // InstanceStride0
+    set32(me, 0x434, 0x40);         // InstanceStride1
+    set32(me, 0x438, reg_stride);   // RegisterStride0
+    set32(me, 0x43c, 4);            // RegisterStride1
+
+    set32(me, REG(WD_BASE, 0), 0x80000000);  // watchdog disabled until set up
+
+    set_md(me, 0, HM2_GTAG_WATCHDOG, 0, 1, WD_BASE, 3, 0x00, 0x0000);
+    set_md(me, 1, HM2_GTAG_IOPORT, 0, 1, IOPORT_BASE, 5, 0x00, 0x001F);
+    set_md(me, 2, HM2_GTAG_ENCODER, 2, HM2_TEST_MODEL_ENCODERS, ENCODER_BASE, 5, 0x00, 0x0003);
+    set_md(me, 3, HM2_GTAG_STEPGEN, 2, HM2_TEST_MODEL_STEPGENS, STEPGEN_BASE, 10, 0x00, 0x01FF);
+    set_md(me, 4, HM2_GTAG_PWMGEN, 0, HM2_TEST_MODEL_PWMGENS, PWMGEN_BASE, 5, 0x00, 0x0003);
+    if (sserial) {
+        set_md(me, 5, HM2_GTAG_SMARTSERIAL, 0, 1, SSERIAL_BASE, 6, 0x10, 0x003C);
+        sserial_init(me);
+    }
+    // the next MD is all zeros, the end of the list
+
+    for (i = 0; i < HM2_TEST_MODEL_ENCODERS; i ++) {
+        set_pd(me, (i * 3) + 0, 1, HM2_GTAG_ENCODER, i);    // A
+        set_pd(me, (i * 3) + 1, 2, HM2_GTAG_ENCODER, i);    // B
+        set_pd(me, (i * 3) + 2, 3, HM2_GTAG_ENCODER, i);    // Index
+    }
+    for (i = 0; i < HM2_TEST_MODEL_STEPGENS; i ++) {
+        set_pd(me, 6 + (i * 2) + 0, 0x81, HM2_GTAG_STEPGEN, i);  // Step
+        set_pd(me, 6 + (i * 2) + 1, 0x82, HM2_GTAG_STEPGEN, i);  // Dir
+    }
+    for (i = 0; i < HM2_TEST_MODEL_PWMGENS; i ++) {
+        set_pd(me, 10 + (i * 3) + 0, 0x81, HM2_GTAG_PWMGEN, i);  // PWM
+        set_pd(me, 10 + (i * 3) + 1, 0x82, HM2_GTAG_PWMGEN, i);  // Dir
+        set_pd(me, 10 + (i * 3) + 2, 0x83, HM2_GTAG_PWMGEN, i);  // /Enable
+    }
+    for (i = 16; i < MODEL_PINS; i ++) {
+        set_pd(me, i, 0, 0, 0);
+    }
+    if (sserial) {
+        set_pd(me, 22, 0x01, HM2_GTAG_SMARTSERIAL, 0);  // RX0
+        set_pd(me, 23, 0x81, HM2_GTAG_SMARTSERIAL, 0);  // TX0
+    }
+
+    me->llio.num_ioport_connectors = 1;
+    me->llio.pins_per_connector = MODEL_PINS;
+    me->llio.ioport_connector_name[0] = "P3";
+}
+
+
+int hm2_test_model_export_hal(hm2_test_t *me, int comp_id) {
+    hm2_test_model_t *m = &me->model;
+    int i, r;
+
+    m->hal = hal_malloc(sizeof(hm2_test_model_hal_t));
+    if (m->hal == NULL) {
+        LL_ERR("out of memory!\n");
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < HM2_TEST_MODEL_PWMGENS; i ++) {
+        r = hal_pin_float_newf(HAL_OUT, &(m->hal->pwm_duty[i]), comp_id,
+                               "%s.model.pwmgen.%02d.duty", me->llio.name, i);
+        if (r < 0) goto fail;
+        *m->hal->pwm_duty[i] = 0.0;
+    }
+
+    r = hal_param_u32_newf(HAL_RO, &(m->hal->ticks), comp_id,
+                           "%s.model.ticks", me->llio.name);
+    if (r < 0) goto fail;
+    r = hal_param_u32_newf(HAL_RO, &(m->hal->reads), comp_id,
+                           "%s.model.reads", me->llio.name);
+    if (r < 0) goto fail;
+    r = hal_param_u32_newf(HAL_RO, &(m->hal->read_bytes), comp_id,
+                           "%s.model.read-bytes", me->llio.name);
+    if (r < 0) goto fail;
+    r = hal_param_u32_newf(HAL_RO, &(m->hal->writes), comp_id,
+                           "%s.model.writes", me->llio.name);
+    if (r < 0) goto fail;
+    r = hal_param_u32_newf(HAL_RO, &(m->hal->write_bytes), comp_id,
+                           "%s.model.write-bytes", me->llio.name);
+    if (r < 0) goto fail;
+
+    if (m->sserial) {
+        r = hal_pin_u32_newf(HAL_OUT, &(m->hal->sserial_cs), comp_id,
+                             "%s.model.sserial.cs", me->llio.name);
+        if (r < 0) goto fail;
+        r = hal_pin_u32_newf(HAL_OUT, &(m->hal->sserial_output), comp_id,
+                             "%s.model.sserial.output", me->llio.name);
+        if (r < 0) goto fail;
+        r = hal_pin_u32_newf(HAL_IN, &(m->hal->sserial_nvunitnumber), comp_id,
+                             "%s.model.sserial.nvunitnumber", me->llio.name);
+        if (r < 0) goto fail;
+        *m->hal->sserial_cs = 0;
+        *m->hal->sserial_output = 0;
+    }
+
+    m->hal->ticks = 0;
+    m->hal->reads = 0;
+    m->hal->read_bytes = 0;
+    m->hal->writes = 0;
+    m->hal->write_bytes = 0;
+    return 0;
+
+fail:
+    LL_ERR("error adding model pins and params\n");
+    return r;
+}
+
+
+//
+// the encoders count the steps of the stepgen with the same number
+//
+
+static s32 encoder_count(hm2_test_model_t *m, int i) {
+    return (s32)(m->accum[i] >> 32) - m->enc_offset[i];
+}
+
+static u32 encoder_inputs(hm2_test_model_t *m, int i) {
+    // quadrature, one count per edge
+    static const u32 ab[4] = {0, HM2_ENCODER_INPUT_A,
+        HM2_ENCODER_INPUT_A | HM2_ENCODER_INPUT_B, HM2_ENCODER_INPUT_B};
+
+    return ab[encoder_count(m, i) & 3];
+}
+
+static u16 encoder_tsc(hm2_test_t *me, u64 clocks) {
+    u32 div = (get32(me, REG(ENCODER_BASE, 2)) & 0xFFFF) + 2;
+    return (u16)(clocks / div);
+}
+
+
+static u32 ioport_read(hm2_test_t *me) {
+    hm2_test_model_t *m = &me->model;
+    u32 ddr = get32(me, REG(IOPORT_BASE, 1));
+    u32 alt = get32(me, REG(IOPORT_BASE, 2));
+    u32 out = get32(me, REG(IOPORT_BASE, 0)) ^ get32(me, REG(IOPORT_BASE, 4));
+    u32 sec = 0, in = 0, driven;
+    int i;
+
+    // levels of the secondary outputs that are not pulse trains
+    for (i = 0; i < HM2_TEST_MODEL_STEPGENS; i ++) {
+        if ((s32)get32(me, REG(STEPGEN_BASE, 0) + (i * 4)) < 0) {
+            sec |= 1 << (6 + (i * 2) + 1);
+        }
+    }
+    for (i = 0; i < HM2_TEST_MODEL_PWMGENS; i ++) {
+        if (get32(me, REG(PWMGEN_BASE, 0) + (i * 4)) & 0x80000000) {
+            sec |= 1 << (10 + (i * 3) + 1);
+        }
+        if (!(get32(me, REG(PWMGEN_BASE, 4)) & (1 << i))) {
+            sec |= 1 << (10 + (i * 3) + 2);
+        }
+    }
+
+    // a bitten watchdog turns all outputs off
+    if (m->wd_status & 1) ddr = 0;
+    driven = ((out & ~alt) | (sec & alt)) & ddr;
+
+    for (i = 0; i < HM2_TEST_MODEL_ENCODERS; i ++) {
+        in |= (encoder_inputs(m, i) & 3) << (i * 3);
+    }
+    for (i = 0; i < 4; i ++) {
+        if (driven & (1 << (16 + i))) in |= 1 << (20 + i);
+        if (driven & (1 << (20 + i))) in |= 1 << (16 + i);
+    }
+
+    return (driven | (in & ~ddr)) & ((1 << MODEL_PINS) - 1);
+}
+
+
+//
+// the smart-serial port runs a command when the driver next reads one
+// of its registers, so a Do-It sees the CS and interface registers that
+// the same TRAM write sends after the command register
+//
+
+static u32 sserial_read_nv(hm2_test_model_t *m, u16 addr, int size) {
+    u32 val = 0;
+
+    if (m->ss_nonvol != LBPNONVOLEEPROM) return 0;  // volatile copies are 0
+    if (m->hal) put32(&m->ss_nv[4], *m->hal->sserial_nvunitnumber);
+    while (size -- > 0) {
+        if (addr + size < HM2_TEST_MODEL_SSERIAL_NV) {
+            val = (val << 8) | m->ss_nv[addr + size];
+        }
+    }
+    return val;
+}
+
+static void sserial_doit(hm2_test_t *me) {
+    hm2_test_model_t *m = &me->model;
+    u32 cs = get32(me, REG(SSERIAL_BASE, 2));
+    u32 out = get32(me, REG(SSERIAL_BASE, 3));
+    u16 addr = cs & 0xFFFF;
+
+    if (m->hal) *m->hal->sserial_cs = cs;
+
+    if (!(cs & 0x40000000)) {
+        // process data, the remote answers with its transfer count
+        m->ss_transfers ++;
+        m->ss_user[0] = m->ss_transfers & 0xFFFF;
+        if (m->hal) *m->hal->sserial_output = out & 0xFFFF;
+        return;
+    }
+
+    switch (cs & 0xFF000000) {
+        case 0x4C000000:
+            m->ss_user[0] = m->ss_rom[addr % HM2_TEST_MODEL_SSERIAL_ROM];
+            break;
+        case LBPNONVOL_flag | LBPWRITE:
+            m->ss_nonvol = out & 0xFF;
+            break;
+        case READ_REM_BYTE_CMD:
+            m->ss_user[0] = sserial_read_nv(m, addr, 1);
+            break;
+        case READ_REM_WORD_CMD:
+            m->ss_user[0] = sserial_read_nv(m, addr, 2);
+            break;
+        case READ_REM_LONG_CMD:
+            m->ss_user[0] = sserial_read_nv(m, addr, 4);
+            break;
+    }
+}
+
+static void sserial_command(hm2_test_t *me) {
+    hm2_test_model_t *m = &me->model;
+    u32 cmd = m->ss_command;
+    u16 local = cmd & (HM2_TEST_MODEL_SSERIAL_LOCAL - 1);
+
+    m->ss_command = 0;
+    switch (cmd & 0xF000) {
+        case READ_LOCAL_CMD:
+            m->ss_data = m->ss_local[local];
+            break;
+        case WRITE_LOCAL_CMD:
+            m->ss_local[local] = get32(me, REG(SSERIAL_BASE, 1)) & 0xFF;
+            break;
+        case 0x1000:    // Do-It
+            if (cmd & 1) sserial_doit(me);
+            m->ss_data = 0;     // no channel failed
+            break;
+        case 0x0000:
+            if ((cmd & 0x0900) == 0x0900 && (cmd & 1)) {
+                // start: the remote identifies itself
+                m->ss_user[0] = 0x00001234;     // serial number
+                memcpy(&m->ss_user[1], "7I99", 4);
+                m->ss_user[2] = (SSERIAL_GTOC << 16) | SSERIAL_PTOC;
+            }
+            break;  // stop, clear
+    }
+}
+
+
+u32 hm2_test_model_read32(hm2_test_t *me, u16 addr) {
+    hm2_test_model_t *m = &me->model;
+    int i;
+
+    if (m->sserial && addr >= SSERIAL_BASE && addr < REG(SSERIAL_BASE, 6)) {
+        if (m->ss_command) sserial_command(me);
+        if (addr == REG(SSERIAL_BASE, 0)) return 0;  // commands finish at once
+        if (addr == REG(SSERIAL_BASE, 1)) return m->ss_data;
+        if (addr == REG(SSERIAL_BASE, 2)) return 0;  // remote status, no errors
+        for (i = 0; i < 3; i ++) {
+            if (addr == REG(SSERIAL_BASE, 3 + i)) return m->ss_user[i];
+        }
+    }
+
+    if (addr == REG(WD_BASE, 1)) return m->wd_status;
+    if (addr == REG(IOPORT_BASE, 0)) return ioport_read(me);
+
+    if (addr >= REG(STEPGEN_BASE, 1)
+        && addr < REG(STEPGEN_BASE, 1) + (HM2_TEST_MODEL_STEPGENS * 4)) {
+        i = (addr - REG(STEPGEN_BASE, 1)) / 4;
+        return (u32)(m->accum[i] >> 16);
+    }
+
+    if (addr >= REG(ENCODER_BASE, 0)
+        && addr < REG(ENCODER_BASE, 0) + (HM2_TEST_MODEL_ENCODERS * 4)) {
+        i = (addr - REG(ENCODER_BASE, 0)) / 4;
+        return (encoder_count(m, i) & 0xFFFF) | (m->enc_timestamp[i] << 16);
+    }
+    if (addr >= REG(ENCODER_BASE, 1)
+        && addr < REG(ENCODER_BASE, 1) + (HM2_TEST_MODEL_ENCODERS * 4)) {
+        i = (addr - REG(ENCODER_BASE, 1)) / 4;
+        return (get32(me, addr) & HM2_ENCODER_CONTROL_MASK & ~0x8007)
+            | encoder_inputs(m, i);
+    }
+    if (addr == REG(ENCODER_BASE, 3)) return encoder_tsc(me, m->clocks);
+
+    return get32(me, addr);
+}
+
+
+void hm2_test_model_write32(hm2_test_t *me, u16 addr, u32 val) {
+    hm2_test_model_t *m = &me->model;
+    int i;
+
+    if (addr == REG(WD_BASE, 0)) {
+        m->wd_remaining = val & 0x7FFFFFFF;
+    } else if (addr == REG(WD_BASE, 1)) {
+        m->wd_status = val & 1;
+    } else if (addr == REG(WD_BASE, 2)) {
+        if ((val >> 24) == 0x5A) {
+            m->wd_remaining = get32(me, REG(WD_BASE, 0)) & 0x7FFFFFFF;
+        }
+        return;  // the reset register does not hold a value
+    } else if (m->sserial && addr == REG(SSERIAL_BASE, 0)) {
+        // bit 31 marks a write that the port ignores
+        if (!(val & 0x80000000)) m->ss_command = val;
+        return;
+    } else if (addr >= REG(ENCODER_BASE, 0)
+        && addr < REG(ENCODER_BASE, 0) + (HM2_TEST_MODEL_ENCODERS * 4)) {
+        // writing the counter clears it
+        i = (addr - REG(ENCODER_BASE, 0)) / 4;
+        m->enc_offset[i] = (s32)(m->accum[i] >> 32);
+        return;
+    }
+
+    set32(me, addr, val);
+}
+
+
+void hm2_test_model_tick(hm2_test_t *me, long period_ns) {
+    hm2_test_model_t *m = &me->model;
+    u64 clocks;
+    s64 dclk;
+    int i;
+
+    m->time_ns += period_ns;
+    clocks = m->time_ns / NS_PER_CLOCK;
+    dclk = clocks - m->clocks;
+    m->clocks = clocks;
+    if (m->hal) m->hal->ticks ++;
+
+    if (!(get32(me, REG(WD_BASE, 0)) & 0x80000000) && !(m->wd_status & 1)) {
+        m->wd_remaining -= dclk;
+        if (m->wd_remaining < 0) {
+            m->wd_status |= 1;
+        }
+    }
+    if (m->wd_status & 1) return;
+
+    for (i = 0; i < HM2_TEST_MODEL_STEPGENS; i ++) {
+        // 48 bit DDS, the accumulator register shows the top 32 bits
+        s32 rate = get32(me, REG(STEPGEN_BASE, 0) + (i * 4));
+        s64 old = m->accum[i];
+        s64 since;
+
+        m->accum[i] += (s64)rate * dclk;
+        if ((old >> 32) == (m->accum[i] >> 32)) continue;
+
+        // clocks since the last step boundary was crossed
+        if (rate > 0) {
+            since = (m->accum[i] & 0xFFFFFFFFLL) / rate;
+        } else {
+            since = (0x100000000LL - (m->accum[i] & 0xFFFFFFFFLL)) / -rate;
+        }
+        if (i < HM2_TEST_MODEL_ENCODERS) {
+            m->enc_timestamp[i] = encoder_tsc(me, clocks - since);
+        }
+    }
+
+    if (m->hal == NULL) return;
+    for (i = 0; i < HM2_TEST_MODEL_PWMGENS; i ++) {
+        u32 value = get32(me, REG(PWMGEN_BASE, 0) + (i * 4));
+        u32 mode = get32(me, REG(PWMGEN_BASE, 1) + (i * 4));
+        int bits = (((mode >> 3) & 3) == 3) ? 12 : 9 + (mode & 3);
+        double duty = (double)((value >> 16) & 0x7FFF) / (double)((1 << bits) - 1);
+
+        if (!(get32(me, REG(PWMGEN_BASE, 4)) & (1 << i))) duty = 0.0;
+        *m->hal->pwm_duty[i] = (value & 0x80000000) ? -duty : duty;
+    }
+}
@@ -75,6 +75,13 @@ struct hm2_lowlevel_io_struct {
     int (*queue_read)(hm2_lowlevel_io_t *self, u32 addr, void *buffer, int size);
     int (*queue_write)(hm2_lowlevel_io_t *self, u32 addr, void *buffer, int size);
 
+    // optional split-phase read: send_queued_reads() starts the reads
+    // queued so far and returns without waiting, receive_queued_reads()
+    // waits for the reply and fills the buffers.  If both are set,
+    // hostmot2 exports a read-request function.
+    int (*send_queued_reads)(hm2_lowlevel_io_t *self);
+    int (*receive_queued_reads)(hm2_lowlevel_io_t *self);
+
     // these are optional
     int (*program_fpga)(hm2_lowlevel_io_t *self,
 			const bitfile_t *bitfile,
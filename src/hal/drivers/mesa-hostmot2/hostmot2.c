@@ -60,6 +60,8 @@ RTAPI_MP_INT(use_serial_numbers, "Name cards by serial number, not enumeration o
 
 int sserial_baudrate = -1;
 RTAPI_MP_INT(sserial_baudrate, "Over-ride the standard smart-serial baud rate. For flashing remote firmware only.");
+int sserial_param_interval = 0;
+RTAPI_MP_INT(sserial_param_interval, "Servo periods between background smart-serial parameter reads, 0 to disable");
 
 u32 irq_period_nsec = 0;
 RTAPI_MP_INT(irq_period_nsec, "Rate to generate IRQ requests from the DPLL");
@@ -102,6 +104,19 @@ static int hm2_read(void *void_hm2, const hal_funct_args_t *fa) {
 }
 
 
+// split-phase llios only: send the TRAM reads now, hm2_read() collects
+// the reply, so the functs in between overlap the round trip
+static int hm2_read_request(void *void_hm2, const hal_funct_args_t *fa) {
+    hostmot2_t *hm2 = void_hm2;
+
+    // if there are comm problems, wait for the user to fix it
+    if ((*hm2->llio->io_error) != 0) return -1;
+
+    hm2_tram_read_request(hm2);
+    return 0;
+}
+
+
 static int hm2_write(void *void_hm2, const hal_funct_args_t *fa) {
     hostmot2_t *hm2 = void_hm2;
     long period = fa_actual_period(fa);
@@ -1175,6 +1190,7 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
     hm2->llio = llio;
     hm2->use_serial_numbers = use_serial_numbers;
     hm2->sserial.baudrate = sserial_baudrate;
+    hm2->sserial.param_interval = sserial_param_interval;
 
     INIT_LIST_HEAD(&hm2->tram_read_entries);
     INIT_LIST_HEAD(&hm2->tram_write_entries);
@@ -1480,6 +1496,11 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
         goto fail1;
     }
 
+    r = hm2_tram_export_hal(hm2);
+    if (r < 0) {
+        goto fail1;
+    }
+
 
     //
     // At this point, all register buffers have been allocated.
@@ -1631,6 +1652,24 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
 	    return r;
 	}
 
+	if (hm2->llio->send_queued_reads && hm2->llio->receive_queued_reads) {
+	    hal_export_xfunct_args_t read_request_args = {
+		.type = FS_XTHREADFUNC,
+		.funct.x = hm2_read_request,
+		.arg = hm2,
+		.uses_fp = 0,
+		.reentrant = 0,
+		.owner_id = hm2->llio->comp_id
+	    };
+	    if ((r = hal_export_xfunctf(&read_request_args,
+				    "%s.read-request",
+				    hm2->llio->name)) != 0) {
+		HM2_ERR("hal_export_xfunctf(%s.read-request) failed: %d\n",
+			hm2->llio->name, r);
+		return r;
+	    }
+	}
+
 	hal_export_xfunct_args_t write_args = {
 	    .type = FS_XTHREADFUNC,
 	    .funct.x = hm2_write,
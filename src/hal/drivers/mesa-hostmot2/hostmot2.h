@@ -1081,6 +1081,28 @@ typedef struct {
 } hm2_tram_entry_t;
 
 
+//
+// the TRAM entries as actually transferred: runs of entries that are
+// contiguous both in the FPGA and in the buffer are merged into one
+// burst, so each llio queue_read()/queue_write() moves as much as it can
+//
+
+#define HM2_TRAM_MAX_BURST (127 * sizeof(u32))  // LBP16 count field limit
+
+typedef struct {
+    u16 addr;
+    u16 size;
+    u32 *buffer;
+} hm2_tram_burst_t;
+
+typedef struct {
+    hal_u32_t read_time_ns;     // TRAM read phase of hm2_read()
+    hal_u32_t write_time_ns;    // TRAM write phase of hm2_write()
+    hal_u32_t read_bursts;      // number of llio reads per period
+    hal_u32_t write_bursts;     // number of llio writes per period
+} hm2_tram_stats_t;
+
+
 
 
 //
@@ -1138,6 +1160,13 @@ typedef struct {
     u32 *tram_write_buffer;
     u16 tram_write_size;
 
+    hm2_tram_burst_t *tram_read_bursts;
+    int num_tram_read_bursts;
+    hm2_tram_burst_t *tram_write_bursts;
+    int num_tram_write_bursts;
+    hm2_tram_stats_t *tram_stats;
+    int tram_read_pending;  // read-request sent, hm2_read() collects it
+
     // the hostmot2 "Functions"
     hm2_encoder_t encoder;
     hm2_encoder_t muxed_encoder;
@@ -1207,7 +1236,9 @@ int hm2_get_pktuart(hostmot2_t **hm2, char *name);
 int hm2_register_tram_read_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
 int hm2_register_tram_write_region(hostmot2_t *hm2, u16 addr, u16 size, u32 **buffer);
 int hm2_allocate_tram_regions(hostmot2_t *hm2);
+int hm2_tram_export_hal(hostmot2_t *hm2);
 int hm2_tram_read(hostmot2_t *hm2);
+int hm2_tram_read_request(hostmot2_t *hm2);
 int hm2_tram_write(hostmot2_t *hm2);
 void hm2_tram_cleanup(hostmot2_t *hm2);
 
@@ -1079,6 +1079,89 @@ int hm2_sserial_create_pins(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
     return 0;
 }
 
+// Background reads of the nonvolatile parameters, enabled by the
+// sserial_param_interval modparam.  Every param_interval servo periods one
+// remote gets a parameter command in its CS register instead of process
+// data, so a read costs that remote one update and nothing else; the
+// other remotes on the port and the thread time are not affected.  A
+// nonvol read takes three commands: nonvol access on, the read itself,
+// and back to normal access.
+
+static int hm2_sserial_next_nonvol(hm2_sserial_remote_t *chan, int i){
+    int n;
+    for (n = 0 ; n < chan->num_globals ; n++){
+        i = (i + 1) % chan->num_globals;
+        if (chan->globals[i].DataType == LBP_NONVOL_UNSIGNED
+            || chan->globals[i].DataType == LBP_NONVOL_SIGNED){
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void hm2_sserial_queue_param(hostmot2_t *hm2, hm2_sserial_instance_t *inst){
+    hm2_sserial_remote_t *chan = NULL;
+    hm2_sserial_data_t *global;
+    int n;
+    
+    if (hm2->sserial.param_interval <= 0) return;
+    if (++inst->param_timer < hm2->sserial.param_interval) return;
+    inst->param_timer = 0;
+    
+    // round-robin over the remotes that have something to read
+    for (n = 0 ; n < inst->num_remotes ; n++){
+        chan = &inst->remotes[inst->param_remote];
+        inst->param_remote = (inst->param_remote + 1) % inst->num_remotes;
+        if (chan->param_index >= 0) break;
+        chan = NULL;
+    }
+    if (chan == NULL) return;
+    
+    global = &chan->globals[chan->param_index];
+    switch (chan->param_step){
+        case 0: // nonvol access on
+            *chan->reg_cs_write = LBPNONVOL_flag | LBPWRITE;
+            *chan->reg_0_write = LBPNONVOLEEPROM;
+            break;
+        case 1:
+            switch (global->DataLength){
+                case 8:
+                    *chan->reg_cs_write = READ_REM_BYTE_CMD; break;
+                case 16:
+                    *chan->reg_cs_write = READ_REM_WORD_CMD; break;
+                default:
+                    *chan->reg_cs_write = READ_REM_LONG_CMD; break;
+            }
+            *chan->reg_cs_write += (u16)global->ParmAddr;
+            break;
+        case 2: // back to normal access
+            *chan->reg_cs_write = LBPNONVOL_flag | LBPWRITE;
+            *chan->reg_0_write = LBPNONVOLCLEAR;
+            break;
+    }
+    chan->param_busy = 1;
+}
+
+static void hm2_sserial_param_reply(hm2_sserial_remote_t *chan){
+    hm2_sserial_params_t *param = &chan->params[chan->param_index];
+    
+    chan->param_busy = 0;
+    chan->status = *chan->reg_cs_read;
+    if (chan->status & 0xFF) return; // failed transfer, repeat the step
+    
+    if (chan->param_step == 1){
+        if (chan->globals[chan->param_index].DataType == LBP_NONVOL_SIGNED){
+            param->s32_param = *chan->reg_0_read;
+        } else {
+            param->u32_param = *chan->reg_0_read;
+        }
+    }
+    if (++chan->param_step > 2){
+        chan->param_step = 0;
+        chan->param_index = hm2_sserial_next_nonvol(chan, chan->param_index);
+    }
+}
+
 int hm2_sserial_register_tram(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
 
     int r = 0;
@@ -1159,6 +1242,35 @@ int hm2_sserial_register_tram(hostmot2_t *hm2, hm2_sserial_remote_t *chan){
         chan->reg_2_write = NULL;
     }
     
+    // The background parameter reads send their commands through the CS
+    // register, and use interface 0 for the data in both directions
+    chan->param_index = -1;
+    if (hm2->sserial.param_interval > 0 && chan->num_globals > 0){
+        r = hm2_register_tram_write_region(hm2, chan->reg_cs_addr, sizeof(u32),
+                                           &(chan->reg_cs_write));
+        if (r < 0) {HM2_ERR("error registering tram write region for sserial"
+                            "CS register (%d)\n", r);
+            goto fail1;
+        }
+        if (chan->reg_0_read == NULL){
+            r = hm2_register_tram_read_region(hm2, chan->reg_0_addr, sizeof(u32),
+                                              &chan->reg_0_read);
+            if (r < 0) { HM2_ERR("error registering tram read region for sserial "
+                                 "interface 0 register (%d)\n", r);
+                goto fail1;
+            }
+        }
+        if (chan->reg_0_write == NULL){
+            r = hm2_register_tram_write_region(hm2, chan->reg_0_addr, sizeof(u32),
+                                               &(chan->reg_0_write));
+            if (r < 0) {HM2_ERR("error registering tram write region for sserial"
+                                "interface 0 register (%d)\n", r);
+                goto fail1;
+            }
+        }
+        chan->param_index = hm2_sserial_next_nonvol(chan, -1);
+    }
+    
     return 0;
     
 fail1:
@@ -1198,6 +1310,11 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 *inst->fault_count = 0;
                 doit_err_count = 0;
                 comm_err_flag = 0;
+                inst->param_timer = 0;
+                for (r = 0 ; r < inst->num_remotes ; r++){
+                    inst->remotes[r].param_step = 0;
+                    inst->remotes[r].param_busy = 0;
+                }
                 break;
             case 0x01: // normal running
                 if (!*inst->run){
@@ -1261,6 +1378,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 for (r = 0 ; r < inst->num_remotes ; r++ ) {
                     hm2_sserial_remote_t *chan = &inst->remotes[r];
                     bitcount = 0;
+                    if (chan->reg_cs_write) *chan->reg_cs_write = 0;
                     if (chan->reg_0_write) *chan->reg_0_write = 0;
                     if (chan->reg_1_write) *chan->reg_1_write = 0;
                     if (chan->reg_2_write) *chan->reg_2_write = 0;
@@ -1324,6 +1442,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                     }
                 }
                 
+                hm2_sserial_queue_param(hm2, inst);
                 *inst->command_reg_write = 0x1000 | inst->tag;
                 break;
  
@@ -1514,6 +1633,11 @@ void hm2_sserial_process_tram_read(hostmot2_t *hm2, long period){
         if (*inst->state != 0x01) continue ; // Only work on running instances
         for (c = 0 ; c < inst->num_remotes ; c++ ) {
             hm2_sserial_remote_t *chan = &inst->remotes[c];
+            if (chan->param_busy){
+                // the reply to a parameter command, not process data
+                if (*inst->command_reg_read == 0) hm2_sserial_param_reply(chan);
+                continue;
+            }
             hm2_sserial_read_pins(chan);
         }
     }
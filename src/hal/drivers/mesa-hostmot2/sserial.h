@@ -221,6 +221,9 @@ typedef struct {
     u32 data_written;
     u32 data2_written;
     u32 data3_written;
+    int param_index; // global refreshed next by the background reads
+    int param_step;  // step of the nonvol read sequence, 0 = idle
+    int param_busy;  // command sent, the reply is in the next TRAM read
     int myinst;
     char name[29];
     char raw_name[5];
@@ -248,12 +251,15 @@ typedef struct {
     hal_bit_t *run;
     hal_u32_t *state;
     u32 timer;
+    u32 param_timer; // servo periods since the last background param read
+    int param_remote; // remote served next
 } hm2_sserial_instance_t;
 
 typedef struct {
     u8 version;
     int baudrate;
     int num_instances; // number of active instances
+    int param_interval; // servo periods per background param read, 0 = off
     hm2_sserial_instance_t *instance ;
 } hm2_sserial_t;
 
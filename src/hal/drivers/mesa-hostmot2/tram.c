@@ -29,6 +29,8 @@
 #include "hal/drivers/mesa-hostmot2/hostmot2.h"
 
 
+static int hm2_tram_coalesce(hostmot2_t *hm2, struct list_head *entries, hm2_tram_burst_t **bursts, int *num_bursts);
+
 
 
 //
@@ -112,7 +114,7 @@ int hm2_allocate_tram_regions(hostmot2_t *hm2) {
         return -ENOMEM;
     }
     if(hm2->tram_read_size>old_tram_read_size)
-        memset(hm2->tram_read_buffer+old_tram_read_size, 0, hm2->tram_read_size-old_tram_read_size);
+        memset((u8*)hm2->tram_read_buffer+old_tram_read_size, 0, hm2->tram_read_size-old_tram_read_size);
 
     hm2->tram_write_buffer = (u32 *)krealloc(hm2->tram_write_buffer, hm2->tram_write_size, GFP_KERNEL);
     if (hm2->tram_write_buffer == NULL) {
@@ -120,7 +122,7 @@ int hm2_allocate_tram_regions(hostmot2_t *hm2) {
         return -ENOMEM;
     }
     if(hm2->tram_write_size>old_tram_write_size)
-        memset(hm2->tram_write_buffer+old_tram_write_size, 0, hm2->tram_write_size-old_tram_write_size);
+        memset((u8*)hm2->tram_write_buffer+old_tram_write_size, 0, hm2->tram_write_size-old_tram_write_size);
 
     HM2_DBG("buffer address %p\n", &hm2->tram_write_buffer);
     HM2_DBG("Translation RAM read buffer:\n");
@@ -140,20 +142,164 @@ int hm2_allocate_tram_regions(hostmot2_t *hm2) {
         offset += tram_entry->size;
         HM2_DBG("    addr=0x%04x, size=%d, buffer=%p\n", tram_entry->addr, tram_entry->size, *tram_entry->buffer);
     }
-    
+
+    if (hm2_tram_coalesce(hm2, &hm2->tram_read_entries, &hm2->tram_read_bursts, &hm2->num_tram_read_bursts) < 0) {
+        return -ENOMEM;
+    }
+    if (hm2_tram_coalesce(hm2, &hm2->tram_write_entries, &hm2->tram_write_bursts, &hm2->num_tram_write_bursts) < 0) {
+        return -ENOMEM;
+    }
+    HM2_DBG(
+        "Translation RAM: %d read bursts, %d write bursts\n",
+        hm2->num_tram_read_bursts,
+        hm2->num_tram_write_bursts
+    );
+    if (hm2->tram_stats != NULL) {
+        hm2->tram_stats->read_bursts = hm2->num_tram_read_bursts;
+        hm2->tram_stats->write_bursts = hm2->num_tram_write_bursts;
+    }
+
     return 0;
 }
 
 
-int hm2_tram_read(hostmot2_t *hm2) {
-    static u32 tram_read_iteration = 0;
+//
+// Builds the burst list for a TRAM entry list.  The entries keep their
+// registration order, which some modules rely on (the encoder reads the
+// timestamp counter before the counters, sserial writes its data
+// registers before the command register that starts the transfer), so
+// only neighbours that continue each other are merged.  The buffers are
+// laid out in registration order too, so such neighbours are contiguous
+// on both sides.
+//
+
+static int hm2_tram_coalesce(hostmot2_t *hm2, struct list_head *entries, hm2_tram_burst_t **bursts, int *num_bursts) {
     struct list_head *ptr;
+    hm2_tram_burst_t *b = NULL;
+    int n = 0;
 
-    list_for_each(ptr, &hm2->tram_read_entries) {
+    list_for_each(ptr, entries) {
+        n ++;
+    }
+
+    if (*bursts != NULL) kfree(*bursts);
+    *bursts = NULL;
+    *num_bursts = 0;
+    if (n == 0) return 0;
+
+    *bursts = kmalloc(n * sizeof(hm2_tram_burst_t), GFP_KERNEL);
+    if (*bursts == NULL) {
+        HM2_ERR("out of memory!\n");
+        return -ENOMEM;
+    }
+
+    list_for_each(ptr, entries) {
         hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
 
-        if (!hm2->llio->queue_read(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_read_iteration);
+        if (
+            (b != NULL)
+            && (tram_entry->addr == b->addr + b->size)
+            && (*tram_entry->buffer == (u32*)((u8*)b->buffer + b->size))
+            && (b->size + tram_entry->size <= HM2_TRAM_MAX_BURST)
+        ) {
+            b->size += tram_entry->size;
+            continue;
+        }
+        b = &(*bursts)[(*num_bursts)++];
+        b->addr = tram_entry->addr;
+        b->size = tram_entry->size;
+        b->buffer = *tram_entry->buffer;
+    }
+
+    return 0;
+}
+
+
+int hm2_tram_export_hal(hostmot2_t *hm2) {
+    int r;
+
+    hm2->tram_stats = (hm2_tram_stats_t *)hal_malloc(sizeof(hm2_tram_stats_t));
+    if (hm2->tram_stats == NULL) {
+        HM2_ERR("out of memory!\n");
+        return -ENOMEM;
+    }
+
+    r = hal_param_u32_newf(HAL_RO, &hm2->tram_stats->read_time_ns, hm2->llio->comp_id, "%s.tram.read_time_ns", hm2->llio->name);
+    r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->write_time_ns, hm2->llio->comp_id, "%s.tram.write_time_ns", hm2->llio->name);
+    r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->read_bursts, hm2->llio->comp_id, "%s.tram.read_bursts", hm2->llio->name);
+    r += hal_param_u32_newf(HAL_RO, &hm2->tram_stats->write_bursts, hm2->llio->comp_id, "%s.tram.write_bursts", hm2->llio->name);
+    if (r < 0) {
+        HM2_ERR("error adding tram params, aborting\n");
+        return -EINVAL;
+    }
+
+    hm2->tram_stats->read_time_ns = 0;
+    hm2->tram_stats->write_time_ns = 0;
+    hm2->tram_stats->read_bursts = hm2->num_tram_read_bursts;
+    hm2->tram_stats->write_bursts = hm2->num_tram_write_bursts;
+
+    return 0;
+}
+
+
+//
+// Split-phase TRAM read, for llios that support it: hm2_tram_read_request()
+// sends the reads, the next hm2_tram_read() only collects the reply.  The
+// read time param then covers just the wait for the reply.
+//
+
+int hm2_tram_read_request(hostmot2_t *hm2) {
+    int i;
+
+    if (hm2->llio->send_queued_reads == NULL) return -EINVAL;
+    if (hm2->tram_read_pending) return 0;
+
+    for (i = 0; i < hm2->num_tram_read_bursts; i ++) {
+        hm2_tram_burst_t *b = &hm2->tram_read_bursts[i];
+
+        if (!hm2->llio->queue_read(hm2->llio, b->addr, b->buffer, b->size)) {
+            HM2_ERR("TRAM read request error! (addr=0x%04x, size=%d)\n", b->addr, b->size);
+            return -EIO;
+        }
+    }
+
+    if (!hm2->llio->send_queued_reads(hm2->llio)) {
+        HM2_ERR("TRAM read request error sending reads!\n");
+        return -EIO;
+    }
+    hm2->tram_read_pending = 1;
+
+    return 0;
+}
+
+
+int hm2_tram_read(hostmot2_t *hm2) {
+    static u32 tram_read_iteration = 0;
+    long long t0 = rtapi_get_time();
+    int i;
+
+    if (hm2->tram_read_pending) {
+        hm2->tram_read_pending = 0;
+        if (!hm2->llio->receive_queued_reads(hm2->llio)) {
+            // the buffers still hold the last period's data
+            HM2_ERR("TRAM read error collecting reply! iter=%u)\n",
+                tram_read_iteration);
+            *hm2->llio->io_error = 1;
+            tram_read_iteration ++;
+            return -EIO;
+        }
+        tram_read_iteration ++;
+        if (hm2->tram_stats != NULL) {
+            hm2->tram_stats->read_time_ns = rtapi_get_time() - t0;
+        }
+        return 0;
+    }
+
+    for (i = 0; i < hm2->num_tram_read_bursts; i ++) {
+        hm2_tram_burst_t *b = &hm2->tram_read_bursts[i];
+
+        if (!hm2->llio->queue_read(hm2->llio, b->addr, b->buffer, b->size)) {
+            HM2_ERR("TRAM read error! (addr=0x%04x, size=%d, iter=%u)\n", b->addr, b->size, tram_read_iteration);
             return -EIO;
         }
     }
@@ -164,19 +310,24 @@ int hm2_tram_read(hostmot2_t *hm2) {
     }
     tram_read_iteration ++;
 
+    if (hm2->tram_stats != NULL) {
+        hm2->tram_stats->read_time_ns = rtapi_get_time() - t0;
+    }
+
     return 0;
 }
 
 
 int hm2_tram_write(hostmot2_t *hm2) {
     static u32 tram_write_iteration = 0;
-    struct list_head *ptr;
+    long long t0 = rtapi_get_time();
+    int i;
 
-    list_for_each(ptr, &hm2->tram_write_entries) {
-        hm2_tram_entry_t *tram_entry = list_entry(ptr, hm2_tram_entry_t, list);
+    for (i = 0; i < hm2->num_tram_write_bursts; i ++) {
+        hm2_tram_burst_t *b = &hm2->tram_write_bursts[i];
 
-        if (!hm2->llio->queue_write(hm2->llio, tram_entry->addr, *tram_entry->buffer, tram_entry->size)) {
-            HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", tram_entry->addr, tram_entry->size, tram_write_iteration);
+        if (!hm2->llio->queue_write(hm2->llio, b->addr, b->buffer, b->size)) {
+            HM2_ERR("TRAM write error! (addr=0x%04x, size=%d, iter=%u)\n", b->addr, b->size, tram_write_iteration);
             return -EIO;
         }
     }
@@ -187,6 +338,10 @@ int hm2_tram_write(hostmot2_t *hm2) {
     }
     tram_write_iteration ++;
 
+    if (hm2->tram_stats != NULL) {
+        hm2->tram_stats->write_time_ns = rtapi_get_time() - t0;
+    }
+
     return 0;
 }
 
@@ -208,5 +363,7 @@ void hm2_tram_cleanup(hostmot2_t *hm2) {
     // free the tram buffers
     if (hm2->tram_read_buffer != NULL) kfree(hm2->tram_read_buffer);
     if (hm2->tram_write_buffer != NULL) kfree(hm2->tram_write_buffer);
+    if (hm2->tram_read_bursts != NULL) kfree(hm2->tram_read_bursts);
+    if (hm2->tram_write_bursts != NULL) kfree(hm2->tram_write_bursts);
 }
 
@@ -231,6 +231,18 @@ int hal_xinit(const int type,
 	};
 	if ((retval = hal_export_xfunctf( &di, "delinst")) < 0)
 	    return retval;
+
+	// signal write detection, see hal_sigmark()
+	hal_export_xfunct_args_t sm = {
+	    .type = FS_XTHREADFUNC,
+	    .funct.x = hal_sigmark,
+	    .arg = NULL,
+	    .uses_fp = 0,
+	    .reentrant = 0,
+	    .owner_id = lib_module_id
+	};
+	if ((retval = hal_export_xfunctf( &sm, "sigmark")) < 0)
+	    return retval;
 #endif
 	retval = hal_ready(lib_module_id);
 	if (retval)
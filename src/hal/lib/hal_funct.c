@@ -239,22 +239,29 @@ int hal_call_usrfunct(const char *name, const int argc, const char **argv, int *
 int hal_add_funct_to_thread(const char *funct_name,
 			    const char *thread_name, int position)
 {
-    hal_funct_t *funct;
-    hal_list_t *list_root, *list_entry;
-    int n;
-    hal_funct_entry_t *funct_entry;
-
     CHECK_HALDATA();
     CHECK_LOCK(HAL_LOCK_CONFIG);
     CHECK_STR(funct_name);
     CHECK_STR(thread_name);
 
-    HALDBG("adding function '%s' to thread '%s'", funct_name, thread_name);
     {
-	hal_thread_t *thread __attribute__((cleanup(halpr_autorelease_mutex)));
+	WITH_HAL_MUTEX();
+	return halpr_add_funct_to_thread(funct_name, thread_name, position);
+    }
+}
 
-	/* get mutex before accessing data structures */
-	rtapi_mutex_get(&(hal_data->mutex));
+// the HAL mutex must be held by the caller
+int halpr_add_funct_to_thread(const char *funct_name,
+			      const char *thread_name, int position)
+{
+    hal_funct_t *funct;
+    hal_list_t *list_root, *list_entry;
+    int n;
+    hal_funct_entry_t *funct_entry;
+
+    HALDBG("adding function '%s' to thread '%s'", funct_name, thread_name);
+    {
+	hal_thread_t *thread;
 
 	/* make sure position is valid */
 	if (position == 0) {
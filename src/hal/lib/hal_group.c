@@ -510,11 +510,15 @@ static int cgroup_size_cb(int level, hal_group_t **groups, hal_member_t *member,
 			  void *cb_data)
 {
     hal_compiled_group_t *tc = cb_data;
+    hal_sig_t *sig = SHMPTR(member->sig_member_ptr);
+
     tc->n_members++;
     if ((member->userarg1 & MEMBER_MONITOR_CHANGE) ||
 	// the toplevel group flags are relevant, no the nested ones:
-	(groups[0]->userarg2 & GROUP_MONITOR_ALL_MEMBERS))
+	(groups[0]->userarg2 & GROUP_MONITOR_ALL_MEMBERS)) {
 	tc->n_monitored++;
+	tc->vm[sig->type].n++;
+    }
     return 0;
 }
 
@@ -522,13 +526,23 @@ static int cgroup_init_members_cb(int level, hal_group_t **groups, hal_member_t
 				  void *cb_data)
 {
     hal_compiled_group_t *tc = cb_data;
+    hal_sig_t *sig = SHMPTR(member->sig_member_ptr);
+    hal_vmatch_t *vm;
+    int k;
 
     tc->member[tc->mbr_index] = member;
-    tc->mbr_index++;
     if ((member->userarg1 & MEMBER_MONITOR_CHANGE) ||
 	(groups[0]->userarg2 & GROUP_MONITOR_ALL_MEMBERS)) {
+	vm = &tc->vm[sig->type];
+	k = vm->n++;
+	vm->index[k] = tc->mbr_index;
+	vm->value[k] = SHMPTR(sig->data_ptr);
+	vm->sig[k] = sig;
+	if (sig->type == HAL_FLOAT)
+	    vm->eps_index[k] = member->eps_index;
 	tc->mon_index++;
     }
+    tc->mbr_index++;
     return 0;
 }
 
@@ -536,7 +550,7 @@ static int cgroup_init_members_cb(int level, hal_group_t **groups, hal_member_t
 // must be called with hal_data lock aquired by caller
 int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 {
-    int result;
+    int result, t;
     hal_compiled_group_t *tc;
     hal_group_t *grp;
 
@@ -563,6 +577,14 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 	 malloc(sizeof(hal_member_t  *) * tc->n_members )) == NULL)
 	NOMEM("%d hal_members",  tc->n_members);
 
+    // size the per-type change detection arrays
+    // the second pass fills them in, counting up again
+    for (t = HAL_BIT; t < HAL_VMATCH_TYPES; t++) {
+	if (hal_vmatch_alloc(&tc->vm[t], t, 1))
+	    NOMEM("%d group members of type %d", tc->vm[t].n, t);
+	tc->vm[t].n = 0;
+    }
+
     tc->mbr_index = 0;
     tc->mon_index = 0;
 
@@ -585,10 +607,6 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
     // to cause a report, or only changed members should be included in a periodic report
     if ((grp->userarg2 & (GROUP_REPORT_ON_CHANGE|GROUP_REPORT_CHANGED_MEMBERS)) ||
 	(tc->n_monitored  > 0)) {
-	if ((tc->tracking =
-	     malloc(sizeof(hal_data_u) * tc->n_monitored )) == NULL)
-	    return -ENOMEM;
-	memset(tc->tracking, 0, sizeof(hal_data_u) * tc->n_monitored);
 	if ((tc->changed =
 	     malloc(RTAPI_BITMAP_BYTES(tc->n_members))) == NULL)
 	    return -ENOMEM;
@@ -596,9 +614,14 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
     } else {
 	// nothing to track
 	tc->n_monitored = 0;
-	tc->tracking = NULL;
 	tc->changed = NULL;
     }
+    // the first match compares all values, whether or not 'sigmark'
+    // ran since, so members which already hold non-default values
+    // are reported
+    tc->matched = 0;
+    tc->sigmark_runs = hal_data->sigmark_runs;
+    tc->sig_generation = hal_data->sig_generation;
 
     tc->magic = CGROUP_MAGIC;
     tc->group = grp;
@@ -647,18 +670,169 @@ int hal_cgroup_apply(hal_compiled_group_t *cg, int handle, hal_type_t type, hal_
 	dp->u = value.u;
 	break;
     }
+    hal_sig_written(sig);
+    return 0;
+}
+
+
+// the compare loops below have no control flow besides the loop itself,
+// so the compiler can vectorize them. Tracking values and changed bits
+// are only touched if something changed, which is the rare case.
+#define VMATCH_COMPARE(ctype, differs)				\
+    do {								\
+	const ctype *restrict cur = vm->current;			\
+	ctype *restrict trk = vm->tracking;				\
+	for (k = 0; k < n; k++) {					\
+	    flag[k] = (differs);					\
+	    nchanged += flag[k];					\
+	}								\
+	if (nchanged)							\
+	    for (k = 0; k < n; k++)					\
+		trk[k] = flag[k] ? cur[k] : trk[k];			\
+    } while (0)
+
+int hal_vmatch_compare(hal_vmatch_t *vm, hal_type_t type, unsigned long *changed)
+{
+    int k, n = vm->n, nchanged = 0;
+    __u8 *restrict flag = vm->flag;
+    real_t *restrict eps = vm->epsilon;
+
+    switch (type) {
+    case HAL_BIT:
+	VMATCH_COMPARE(hal_bool, cur[k] != trk[k]);
+	break;
+    case HAL_FLOAT:
+	// epsilon[] may be changed at any time, so pick up the current values
+	for (k = 0; k < n; k++)
+	    eps[k] = hal_data->epsilon[vm->eps_index[k]];
+	VMATCH_COMPARE(real_t, HAL_FABS(cur[k] - trk[k]) > eps[k]);
+	break;
+    case HAL_S32:
+	VMATCH_COMPARE(__s32, cur[k] != trk[k]);
+	break;
+    case HAL_U32:
+	VMATCH_COMPARE(__u32, cur[k] != trk[k]);
+	break;
+    default:
+	HALERR("BUG: invalid type %d", type);
+	return -EINVAL;
+    }
+    if (nchanged)
+	for (k = 0; k < n; k++)
+	    if (flag[k])
+		RTAPI_BIT_SET(changed, vm->index[k]);
+    return nchanged;
+}
+
+int hal_vmatch_alloc(hal_vmatch_t *vm, hal_type_t type, int with_sigs)
+{
+    size_t vsize;
+    int n = vm->n;
+
+    if (n == 0)
+	return 0;
+    switch (type) {
+    case HAL_BIT:
+	vsize = sizeof(hal_bool);
+	break;
+    case HAL_FLOAT:
+	vsize = sizeof(real_t);
+	break;
+    case HAL_S32:
+	vsize = sizeof(__s32);
+	break;
+    case HAL_U32:
+	vsize = sizeof(__u32);
+	break;
+    default:
+	return -EINVAL;
+    }
+    // zeroed tracking values cause an initial report of all
+    // members with a non-zero value
+    vm->index = calloc(n, sizeof(int));
+    vm->current = calloc(n, vsize);
+    vm->tracking = calloc(n, vsize);
+    vm->flag = calloc(n, sizeof(__u8));
+    if (!vm->index || !vm->current || !vm->tracking || !vm->flag)
+	return -ENOMEM;
+    if (type == HAL_FLOAT) {
+	vm->eps_index = calloc(n, sizeof(__u8));
+	vm->epsilon = calloc(n, sizeof(real_t));
+	if (!vm->eps_index || !vm->epsilon)
+	    return -ENOMEM;
+    }
+    if (with_sigs) {
+	vm->value = calloc(n, sizeof(void *));
+	vm->sig = calloc(n, sizeof(hal_sig_t *));
+	vm->generation = calloc(n, sizeof(__u32));
+	if (!vm->value || !vm->sig || !vm->generation)
+	    return -ENOMEM;
+    }
     return 0;
 }
 
+void hal_vmatch_free(hal_vmatch_t *vm)
+{
+    free(vm->index);
+    free(vm->current);
+    free(vm->tracking);
+    free(vm->flag);
+    free(vm->eps_index);
+    free(vm->epsilon);
+    free(vm->value);
+    free(vm->sig);
+    free(vm->generation);
+    memset(vm, 0, sizeof(hal_vmatch_t));
+}
+
+// collect the current values of the monitored signals of one type.
+// with use_gen set, signals not written since the last match keep
+// their tracking value, and so compare unchanged.
+static void cgroup_gather(hal_vmatch_t *vm, hal_type_t type, int use_gen)
+{
+    int k, n = vm->n;
+    __u8 *written = vm->flag;
+    __u32 gen;
+
+    for (k = 0; k < n; k++) {
+	gen = vm->sig[k]->generation;
+	written[k] = !use_gen || (gen != vm->generation[k]);
+	vm->generation[k] = gen;
+    }
+    switch (type) {
+    case HAL_BIT: {
+	hal_bool *cur = vm->current, *trk = vm->tracking;
+	for (k = 0; k < n; k++)
+	    cur[k] = written[k] ? *((hal_bit_t *) vm->value[k]) : trk[k];
+	break;
+    }
+    case HAL_FLOAT: {
+	real_t *cur = vm->current, *trk = vm->tracking;
+	for (k = 0; k < n; k++)
+	    cur[k] = written[k] ? *((hal_float_t *) vm->value[k]) : trk[k];
+	break;
+    }
+    case HAL_S32: {
+	__s32 *cur = vm->current, *trk = vm->tracking;
+	for (k = 0; k < n; k++)
+	    cur[k] = written[k] ? *((hal_s32_t *) vm->value[k]) : trk[k];
+	break;
+    }
+    case HAL_U32: {
+	__u32 *cur = vm->current, *trk = vm->tracking;
+	for (k = 0; k < n; k++)
+	    cur[k] = written[k] ? *((hal_u32_t *) vm->value[k]) : trk[k];
+	break;
+    }
+    default:
+	break;
+    }
+}
 
 int hal_cgroup_match(hal_compiled_group_t *cg)
 {
-    int i, monitor, nchanged = 0, m = 0;
-    hal_sig_t *sig;
-    hal_bit_t halbit;
-    hal_s32_t hals32;
-    hal_u32_t halu32;
-    hal_float_t halfloat,delta;
+    int t, monitor, use_gen, retval, nchanged = 0;
+    __u32 runs, gen;
 
     HAL_ASSERT(cg->magic ==  CGROUP_MAGIC);
 
@@ -671,51 +845,29 @@ int hal_cgroup_match(hal_compiled_group_t *cg)
     // report.
     if (monitor) {
 	RTAPI_ZERO_BITMAP(cg->changed, cg->n_members);
-	for (i = 0; i < cg->n_members; i++) {
-	    if (!((cg->member[i]->userarg1 &  MEMBER_MONITOR_CHANGE) ||
-		  (cg->group->userarg2 &  GROUP_MONITOR_ALL_MEMBERS)))
+
+	// if the 'sigmark' funct ran since the last match, every write up to
+	// its last pass is reflected in the signal write generations: if the
+	// global generation did not move, nothing changed, and members whose
+	// generation did not move can be skipped. Writes after its last pass
+	// are picked up on the next match. Without 'sigmark' running, fall
+	// back to comparing all values.
+	runs = hal_data->sigmark_runs;
+	gen = hal_data->sig_generation;
+	use_gen = cg->matched && (runs != cg->sigmark_runs);
+	cg->matched = 1;
+	cg->sigmark_runs = runs;
+	if (use_gen && (gen == cg->sig_generation))
+	    return 0;
+	cg->sig_generation = gen;
+
+	for (t = HAL_BIT; t < HAL_VMATCH_TYPES; t++) {
+	    if (cg->vm[t].n == 0)
 		continue;
-	    sig = SHMPTR(cg->member[i]->sig_member_ptr);
-	    switch (sig->type) {
-	    case HAL_BIT:
-		halbit = *((hal_bit_t *) SHMPTR(sig->data_ptr));
-		if (cg->tracking[m].b != halbit) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    cg->tracking[m].b = halbit;
-		}
-		break;
-	    case HAL_FLOAT:
-		halfloat = *((hal_float_t *) SHMPTR(sig->data_ptr));
-		delta = HAL_FABS(halfloat - cg->tracking[m].f);
-		if (delta > hal_data->epsilon[cg->member[i]->eps_index]) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    cg->tracking[m].f = halfloat;
-		}
-		break;
-	    case HAL_S32:
-		hals32 =  *((hal_s32_t *) SHMPTR(sig->data_ptr));
-		if (cg->tracking[m].s != hals32) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    cg->tracking[m].s = hals32;
-		}
-		break;
-	    case HAL_U32:
-		halu32 =  *((hal_u32_t *) SHMPTR(sig->data_ptr));
-		if (cg->tracking[m].u != halu32) {
-		    nchanged++;
-		    RTAPI_BIT_SET(cg->changed, i);
-		    cg->tracking[m].u = halu32;
-		}
-		break;
-	    default:
-		HALERR("BUG: detect_changes(%s): invalid type for signal %s: %d",
-		       cg->group->name, sig->name, sig->type);
-		return -EINVAL;
-	    }
-	    m++;
+	    cgroup_gather(&cg->vm[t], t, use_gen);
+	    if ((retval = hal_vmatch_compare(&cg->vm[t], t, cg->changed)) < 0)
+		return retval;
+	    nchanged += retval;
 	}
 	return nchanged;
     } else
@@ -749,10 +901,12 @@ int hal_cgroup_report(hal_compiled_group_t *cg, group_report_callback_t report_c
 
 int hal_cgroup_free(hal_compiled_group_t *cgroup)
 {
+    int t;
+
     if (cgroup == NULL)
 	return -ENOENT;
-    if (cgroup->tracking)
-	free(cgroup->tracking);
+    for (t = 0; t < HAL_VMATCH_TYPES; t++)
+	hal_vmatch_free(&cgroup->vm[t]);
     if (cgroup->changed)
 	free(cgroup->changed);
     if (cgroup->member)
@@ -26,6 +26,25 @@ typedef struct {
 } hal_group_t;
 
 
+// change detection for the monitored members of one type.
+// compiled groups and comps keep one of these per HAL type, so the
+// compare pass is a tight loop over contiguous arrays of a single type
+// rather than a per-member switch on the type.
+#define HAL_VMATCH_TYPES (HAL_U32 + 1)  // indexed by hal_type_t
+
+typedef struct {
+    int n;                       // number of members of this type
+    int *index;                  // position in member[]/pin[] and the changed bitmap
+    void *current;               // current values, gathered before compare
+    void *tracking;              // last reported values
+    __u8 *flag;                  // compare result, 1 if changed
+    __u8 *eps_index;             // HAL_FLOAT: index into hal_data->epsilon[]
+    real_t *epsilon;             // HAL_FLOAT: thresholds, gathered before compare
+    void **value;                // cgroups: location of the signal value
+    hal_sig_t **sig;             // cgroups: signal, for the write generation
+    __u32 *generation;           // cgroups: last seen write generation
+} hal_vmatch_t;
+
 #define CGROUP_MAGIC  0xbeef7411
 typedef struct {
     int magic;
@@ -36,7 +55,10 @@ typedef struct {
     hal_member_t  **member;      // all members (nesting resolved)
     unsigned long *changed;      // bitmap
     int n_monitored;             // count of pins to monitor for change
-    hal_data_u    *tracking;     // tracking values of monitored pins
+    hal_vmatch_t  vm[HAL_VMATCH_TYPES]; // monitored members, by type
+    __u32         sig_generation; // hal_data->sig_generation as of last match
+    __u32         sigmark_runs;   // hal_data->sigmark_runs as of last match
+    int           matched;        // zero until the first match
     unsigned long user_flags;    // uninterpreted by HAL code
     void *user_data;             // uninterpreted by HAL code
 } hal_compiled_group_t;
@@ -118,8 +140,22 @@ static inline int hal_cgroup_timer(hal_compiled_group_t *cgroup)
     return cgroup->group->userarg1;
 }
 extern int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup);
+
+// returns the number of changed monitored members.
+// if the 'sigmark' funct runs in a thread, unchanged members are skipped
+// by their write generation, and an idle group costs a single compare;
+// otherwise all monitored values are compared.
 extern int hal_cgroup_match(hal_compiled_group_t *cgroup);
 
+// type-partitioned change detection support, shared with hal_rcomp.c
+// hal_vmatch_alloc() sizes the arrays for vm->n members of 'type';
+// hal_vmatch_compare() compares vm->current against vm->tracking, sets
+// the changed bits, updates tracking and returns the number of changes.
+extern int hal_vmatch_alloc(hal_vmatch_t *vm, hal_type_t type, int with_sigs);
+extern int hal_vmatch_compare(hal_vmatch_t *vm, hal_type_t type,
+			      unsigned long *changed);
+extern void hal_vmatch_free(hal_vmatch_t *vm);
+
 // given a cgroup which returned a non-zero value from hal_cgroup_match(),
 // generate a report.
 // the report callback is called for the following phases:
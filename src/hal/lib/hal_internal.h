@@ -31,6 +31,10 @@ void unlink_pin(hal_pin_t * pin);
 
 void free_pin_struct(hal_pin_t * pin);
 
+#ifdef RTAPI
+int hal_sigmark(void *arg, const hal_funct_args_t *fa);
+#endif
+
 RTAPI_END_DECLS
 
 #endif /* HAL_INTERNAL_H */
@@ -376,4 +376,9 @@ EXPORT_SYMBOL(halpr_find_comp_by_id);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
 
+// unlocked variants of the config API
+EXPORT_SYMBOL(halpr_signal_new);
+EXPORT_SYMBOL(halpr_link);
+EXPORT_SYMBOL(halpr_add_funct_to_thread);
+
 #endif /* rtapi */
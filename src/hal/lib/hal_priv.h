@@ -231,6 +231,10 @@ typedef struct {
     int inst_free_ptr;          // list of freed instance descriptors
 
     double epsilon[MAX_EPSILON];
+
+    // signal write generations, see hal_sig_t.generation
+    volatile __u32 sig_generation;  // bumped along with any signal generation
+    volatile __u32 sigmark_runs;    // bumped by each 'sigmark' pass
 } hal_data_t;
 
 
@@ -310,6 +314,12 @@ typedef struct {
     int writers;		/* number of output pins linked */
     int bidirs;			/* number of I/O pins linked */
     int handle;                // unique ID
+    // write generation: bumped whenever a write is known or detected,
+    // so readers can skip unchanged signals. Writers through the HAL API
+    // bump it directly; writes through pins are detected by the 'sigmark'
+    // funct comparing the value against 'shadow'.
+    volatile __u32 generation;
+    hal_data_u shadow;          // value as of the last 'sigmark' pass
     char name[HAL_NAME_LEN + 1];	/* signal name */
 } hal_sig_t;
 
@@ -562,7 +572,7 @@ typedef struct {
    meaningfull error messages in case of a mismatch.
 */
 #include "rtapi_shmkeys.h"
-#define HAL_VER   0x0000000C	/* version code */
+#define HAL_VER   0x0000000D	/* version code */
 
 /* These pointers are set by hal_init() to point to the shmem block
    and to the master data structure. All access should use these
@@ -575,6 +585,15 @@ typedef struct {
 extern char *hal_shmem_base;
 extern hal_data_t *hal_data;
 
+// a signal value was written: bump its write generation.
+// Not atomic - concurrent writers may lose an increment, but the
+// generation will still differ from the one any reader saw before.
+static inline void hal_sig_written(hal_sig_t *sig)
+{
+    sig->generation++;
+    hal_data->sig_generation++;
+}
+
 /***********************************************************************
 *            PRIVATE HAL FUNCTIONS - NOT PART OF THE API               *
 ************************************************************************/
@@ -598,6 +617,17 @@ extern hal_thread_t *halpr_find_thread_by_name(const char *name);
 extern hal_funct_t *halpr_find_funct_by_name(const char *name);
 extern hal_inst_t *halpr_find_inst_by_name(const char *name);
 
+/** Unlocked variants of hal_signal_new(), hal_link() and
+    hal_add_funct_to_thread(). The caller must hold the HAL mutex
+    and is responsible for the HAL lock (hal_get_lock()) checks.
+    This permits a sequence of configuration changes to be
+    applied under a single acquisition of the mutex.
+*/
+extern int halpr_signal_new(const char *name, hal_type_t type);
+extern int halpr_link(const char *pin_name, const char *sig_name);
+extern int halpr_add_funct_to_thread(const char *funct_name,
+				     const char *thread_name, int position);
+
 // observers needed in haltalk
 // I guess we better come up with generic iterators for this kind of thing
 
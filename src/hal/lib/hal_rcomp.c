@@ -298,7 +298,7 @@ int hal_retrieve_pinstate(const char *comp_name,
 int hal_compile_comp(const char *name, hal_compiled_comp_t **ccomp)
 {
    hal_compiled_comp_t *tc;
-   int pincount = 0;
+   int pincount = 0, t;
 
    CHECK_HALDATA();
    CHECK_STRLEN(name, HAL_NAME_LEN);
@@ -307,6 +307,7 @@ int hal_compile_comp(const char *name, hal_compiled_comp_t **ccomp)
        int next, n;
        hal_comp_t *owner;
        hal_pin_t *pin;
+       hal_vmatch_t *vm;
 
        rtapi_mutex_get(&(hal_data->mutex));
 
@@ -344,17 +345,12 @@ int hal_compile_comp(const char *name, hal_compiled_comp_t **ccomp)
        // alloc pin array
        if ((tc->pin = malloc(sizeof(hal_pin_t *) * tc->n_pins)) == NULL)
 	   return -ENOMEM;
-       // alloc tracking value array
-       if ((tc->tracking =
-	    malloc(sizeof(hal_data_u) * tc->n_pins )) == NULL)
-	   return -ENOMEM;
        // alloc change bitmap
        if ((tc->changed =
 	    malloc(RTAPI_BITMAP_BYTES(tc->n_pins))) == NULL)
 	    return -ENOMEM;
 
        memset(tc->pin, 0, sizeof(hal_pin_t *) * tc->n_pins);
-       memset(tc->tracking, 0, sizeof(hal_data_u) * tc->n_pins);
        RTAPI_ZERO_BITMAP(tc->changed,tc->n_pins);
 
        // fill in pin array
@@ -364,11 +360,28 @@ int hal_compile_comp(const char *name, hal_compiled_comp_t **ccomp)
 	   pin = SHMPTR(next);
 	   owner = halpr_find_owning_comp(pin->owner_id);
 	   if ((owner->comp_id == comp->comp_id) &&
-	       !(pin->flags & PIN_DO_NOT_TRACK))
+	       !(pin->flags & PIN_DO_NOT_TRACK)) {
+	       tc->vm[pin->type].n++;
 	       tc->pin[n++] = pin;
+	   }
 	   next = pin->next_ptr;
        }
        assert(n == tc->n_pins);
+
+       // partition the tracked pins by type for hal_ccomp_match()
+       for (t = HAL_BIT; t < HAL_VMATCH_TYPES; t++) {
+	   if (hal_vmatch_alloc(&tc->vm[t], t, 0))
+	       return -ENOMEM;
+	   tc->vm[t].n = 0;
+       }
+       for (n = 0; n < tc->n_pins; n++) {
+	   pin = tc->pin[n];
+	   vm = &tc->vm[pin->type];
+	   vm->index[vm->n] = n;
+	   if (pin->type == HAL_FLOAT)
+	       vm->eps_index[vm->n] = pin->eps_index;
+	   vm->n++;
+       }
        tc->magic = CCOMP_MAGIC;
        *ccomp = tc;
    }
@@ -376,68 +389,58 @@ int hal_compile_comp(const char *name, hal_compiled_comp_t **ccomp)
    return 0;
 }
 
+// value location of a pin, which changes as the pin is linked or unlinked
+static inline hal_data_u *pin_value(hal_pin_t *pin)
+{
+    if (pin->signal != 0) {
+	hal_sig_t *sig = SHMPTR(pin->signal);
+	return (hal_data_u *)SHMPTR(sig->data_ptr);
+    }
+    return (hal_data_u *)(hal_shmem_base + SHMOFF(&(pin->dummysig)));
+}
+
 int hal_ccomp_match(hal_compiled_comp_t *cc)
 {
-    int i, nchanged = 0;
-    hal_bit_t halbit;
-    hal_s32_t hals32;
-    hal_u32_t halu32;
-    hal_float_t halfloat,delta;
-    hal_pin_t *pin;
-    hal_sig_t *sig;
-    void *data_ptr;
+    int t, k, retval, nchanged = 0;
+    hal_vmatch_t *vm;
 
     assert(cc->magic ==  CCOMP_MAGIC);
     RTAPI_ZERO_BITMAP(cc->changed, cc->n_pins);
 
-    for (i = 0; i < cc->n_pins; i++) {
-	pin = cc->pin[i];
-	if (pin->signal != 0) {
-	    sig = SHMPTR(pin->signal);
-	    data_ptr = SHMPTR(sig->data_ptr);
-	} else {
-	    data_ptr = hal_shmem_base + SHMOFF(&(pin->dummysig));
-	}
-
-	switch (pin->type) {
-	case HAL_BIT:
-	    halbit = *((char *) data_ptr);
-	    if (cc->tracking[i].b != halbit) {
-		nchanged++;
-		RTAPI_BIT_SET(cc->changed, i);
-		cc->tracking[i].b = halbit;
-	    }
+    // gather the current values per type, then compare in one pass
+    for (t = HAL_BIT; t < HAL_VMATCH_TYPES; t++) {
+	vm = &cc->vm[t];
+	if (vm->n == 0)
+	    continue;
+	switch (t) {
+	case HAL_BIT: {
+	    hal_bool *cur = vm->current;
+	    for (k = 0; k < vm->n; k++)
+		cur[k] = pin_value(cc->pin[vm->index[k]])->b;
 	    break;
-	case HAL_FLOAT:
-	    halfloat = *((hal_float_t *) data_ptr);
-	    delta = HAL_FABS(halfloat - cc->tracking[i].f);
-	    if (delta > hal_data->epsilon[pin->eps_index]) {
-		nchanged++;
-		RTAPI_BIT_SET(cc->changed, i);
-		cc->tracking[i].f = halfloat;
-	    }
+	}
+	case HAL_FLOAT: {
+	    real_t *cur = vm->current;
+	    for (k = 0; k < vm->n; k++)
+		cur[k] = pin_value(cc->pin[vm->index[k]])->f;
 	    break;
-	case HAL_S32:
-	    hals32 =  *((hal_s32_t *) data_ptr);
-	    if (cc->tracking[i].s != hals32) {
-		nchanged++;
-		RTAPI_BIT_SET(cc->changed, i);
-		cc->tracking[i].s = hals32;
-	    }
+	}
+	case HAL_S32: {
+	    __s32 *cur = vm->current;
+	    for (k = 0; k < vm->n; k++)
+		cur[k] = pin_value(cc->pin[vm->index[k]])->s;
 	    break;
-	case HAL_U32:
-	    halu32 =  *((hal_u32_t *) data_ptr);
-	    if (cc->tracking[i].u != halu32) {
-		nchanged++;
-		RTAPI_BIT_SET(cc->changed, i);
-		cc->tracking[i].u = halu32;
-	    }
+	}
+	case HAL_U32: {
+	    __u32 *cur = vm->current;
+	    for (k = 0; k < vm->n; k++)
+		cur[k] = pin_value(cc->pin[vm->index[k]])->u;
 	    break;
-	default:
-	    HALERR("BUG: hal_ccomp_match(%s): invalid type for pin %s: %d",
-		   cc->comp->name, pin->name, pin->type);
-	    return -EINVAL;
 	}
+	}
+	if ((retval = hal_vmatch_compare(vm, t, cc->changed)) < 0)
+	    return retval;
+	nchanged += retval;
     }
     return nchanged;
 }
@@ -447,9 +450,7 @@ int hal_ccomp_report(hal_compiled_comp_t *cc,
 		     void *cb_data, int report_all)
 {
     int retval, i;
-    hal_data_u *data_ptr;
     hal_pin_t *pin;
-    hal_sig_t *sig;
 
     if (!report_cb)
 	return 0;
@@ -459,14 +460,8 @@ int hal_ccomp_report(hal_compiled_comp_t *cc,
     for (i = 0; i < cc->n_pins; i++) {
 	if (report_all || RTAPI_BIT_TEST(cc->changed, i)) {
 	    pin = cc->pin[i];
-	    if (pin->signal != 0) {
-		sig = SHMPTR(pin->signal);
-		data_ptr = (hal_data_u *)SHMPTR(sig->data_ptr);
-	    } else {
-		data_ptr = (hal_data_u *)(hal_shmem_base + SHMOFF(&(pin->dummysig)));
-	    }
 	    if ((retval = report_cb(REPORT_PIN, cc, pin,
-				    data_ptr, cb_data)) < 0)
+				    pin_value(pin), cb_data)) < 0)
 		return retval;
 	}
     }
@@ -475,11 +470,13 @@ int hal_ccomp_report(hal_compiled_comp_t *cc,
 
 int hal_ccomp_free(hal_compiled_comp_t *cc)
 {
+    int t;
+
     if (cc == NULL)
 	return 0;
     assert(cc->magic ==  CCOMP_MAGIC);
-    if (cc->tracking)
-	free(cc->tracking);
+    for (t = 0; t < HAL_VMATCH_TYPES; t++)
+	hal_vmatch_free(&cc->vm[t]);
     if (cc->changed)
 	free(cc->changed);
     if (cc->pin)
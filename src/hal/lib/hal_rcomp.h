@@ -2,6 +2,7 @@
 #define _HAL_RCOMP_H
 
 #include <rtapi.h>
+#include <hal_group.h>  // hal_vmatch_t
 
 RTAPI_BEGIN_DECLS
 
@@ -13,7 +14,7 @@ typedef struct {
     int n_pins;
     hal_pin_t  **pin;           // all members (nesting resolved)
     unsigned long *changed;     // bitmap
-    hal_data_u    *tracking;    // tracking values of monitored pins
+    hal_vmatch_t  vm[HAL_VMATCH_TYPES]; // tracked pins, by type
     void *user_data;             // uninterpreted by HAL code
     unsigned long user_flags;    // uninterpreted by HAL code
 } hal_compiled_comp_t;
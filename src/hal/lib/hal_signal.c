@@ -16,19 +16,25 @@ static void free_sig_struct(hal_sig_t * sig);
 
 int hal_signal_new(const char *name, hal_type_t type)
 {
-
-    int *prev, next, cmp;
-    hal_sig_t *new, *ptr;
-
     CHECK_HALDATA();
     CHECK_LOCK(HAL_LOCK_CONFIG);
     CHECK_STRLEN(name, HAL_NAME_LEN);
 
     {
-	void *data_addr  __attribute__((cleanup(halpr_autorelease_mutex)));
+	WITH_HAL_MUTEX();
+	return halpr_signal_new(name, type);
+    }
+}
 
-	/* get mutex before accessing shared data */
-	rtapi_mutex_get(&(hal_data->mutex));
+// the HAL mutex must be held by the caller
+int halpr_signal_new(const char *name, hal_type_t type)
+{
+
+    int *prev, next, cmp;
+    hal_sig_t *new, *ptr;
+
+    {
+	void *data_addr;
 
 	HALDBG("creating signal '%s'", name);
 
@@ -163,23 +169,28 @@ int hal_signal_delete(const char *name)
 
 int hal_link(const char *pin_name, const char *sig_name)
 {
-    hal_sig_t *sig;
-    hal_comp_t *comp;
-    void **data_ptr_addr, *data_addr;
-
-
     CHECK_HALDATA();
     CHECK_LOCK(HAL_LOCK_CONFIG);
     CHECK_STRLEN(pin_name, HAL_NAME_LEN);
     CHECK_STRLEN(sig_name, HAL_NAME_LEN);
 
+    {
+	WITH_HAL_MUTEX();
+	return halpr_link(pin_name, sig_name);
+    }
+}
+
+// the HAL mutex must be held by the caller
+int halpr_link(const char *pin_name, const char *sig_name)
+{
+    hal_sig_t *sig;
+    hal_comp_t *comp;
+    void **data_ptr_addr, *data_addr;
+
     HALDBG("linking pin '%s' to '%s'", pin_name, sig_name);
 
     {
-	hal_pin_t *pin  __attribute__((cleanup(halpr_autorelease_mutex)));
-
-	/* get mutex before accessing data structures */
-	rtapi_mutex_get(&(hal_data->mutex));
+	hal_pin_t *pin;
 
 	/* locate the pin */
 	pin = halpr_find_pin_by_name(pin_name);
@@ -260,6 +271,7 @@ int hal_link(const char *pin_name, const char *sig_name)
 			      pin->name, pin->type);
 		return -EINVAL;
 	    }
+	    hal_sig_written(sig);
 	}
 
 	/* update the signal's reader/writer/bidir counts */
@@ -353,6 +365,8 @@ static hal_sig_t *alloc_sig_struct(void)
 	p->readers = 0;
 	p->writers = 0;
 	p->bidirs = 0;
+	p->generation = 0;
+	memset(&p->shadow, 0, sizeof(hal_data_u));
 	p->name[0] = '\0';
     }
     return p;
@@ -382,3 +396,41 @@ static void free_sig_struct(hal_sig_t * sig)
     sig->next_ptr = hal_data->sig_free_ptr;
     hal_data->sig_free_ptr = SHMOFF(sig);
 }
+
+#ifdef RTAPI
+// the 'sigmark' funct: writes through pins bypass the HAL API, so
+// detect them by comparing each signal against its shadow value and
+// bump the write generation on a difference. Values are compared
+// bitwise, so no FPU is needed.
+//
+// Add it to the thread which writes the signals of interest, or any
+// thread running at least as fast as the readers poll. As threads do
+// with their funct lists, this walks the signal list without the HAL
+// mutex; a concurrent newsig/delsig may cause a signal to be skipped
+// for one pass, which only delays detection of its change.
+int hal_sigmark(void *arg, const hal_funct_args_t *fa)
+{
+    int next;
+    hal_sig_t *sig;
+    size_t size;
+    void *dp;
+
+    for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	switch (sig->type) {
+	case HAL_BIT:   size = sizeof(hal_bit_t);   break;
+	case HAL_S32:   size = sizeof(hal_s32_t);   break;
+	case HAL_U32:   size = sizeof(hal_u32_t);   break;
+	case HAL_FLOAT: size = sizeof(hal_float_t); break;
+	default: continue;
+	}
+	dp = SHMPTR(sig->data_ptr);
+	if (memcmp(dp, &sig->shadow, size)) {
+	    memcpy(&sig->shadow, dp, size);
+	    hal_sig_written(sig);
+	}
+    }
+    hal_data->sigmark_runs++;
+    return 0;
+}
+#endif
@@ -93,6 +93,8 @@ int echo_mode = 0;
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of halcmd */
 flavor_ptr current_flavor;
 int autoload = 1;  // on newinst, if comp not loaded, loadrt it
+int batch_mode = 0;
+int timing_mode = 0;
 
 static void quit(int);
 
@@ -201,6 +203,7 @@ struct halcmd_command halcmd_commands[] = {
     {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS },
     {"list",    FUNCT(do_list_cmd),    A_ONE | A_PLUS },
     {"loadrt",  FUNCT(do_loadrt_cmd),  A_ONE | A_PLUS },
+    {"loadrts", FUNCT(do_loadrts_cmd), A_ONE | A_PLUS },
     {"loadusr", FUNCT(do_loadusr_cmd), A_PLUS | A_TILDE },
     {"lock",    FUNCT(do_lock_cmd),    A_ONE | A_OPTIONAL },
     {"log",     FUNCT(do_log_cmd),     A_TWO | A_OPTIONAL},
@@ -208,6 +211,7 @@ struct halcmd_command halcmd_commands[] = {
     {"newsig",  FUNCT(do_newsig_cmd),  A_TWO },
     {"ping",    FUNCT(do_ping_cmd), A_ZERO },
     {"save",    FUNCT(do_save_cmd),    A_TWO | A_OPTIONAL | A_TILDE },
+    {"snapshot", FUNCT(do_snapshot_cmd), A_TWO | A_TILDE },
     {"setexact_for_test_suite_only", FUNCT(do_setexact_cmd), A_ZERO },
     {"setp",    FUNCT(do_setp_cmd),    A_TWO },
     {"sets",    FUNCT(do_sets_cmd),    A_TWO },
@@ -516,24 +520,174 @@ static int parse_cmd1(char **argv) {
     }
 }
 
+/***********************************************************************
+*                       BATCHING AND TIMING                            *
+************************************************************************/
+
+typedef enum {
+    BATCH_NONE,    // needs all queued RPCs done and the HAL mutex free
+    BATCH_RPC,     // may be queued for rtapi_app
+    BATCH_LOCKED,  // may run while the HAL mutex is held
+} batch_kind_t;
+
+static batch_kind_t batch_kind(const char *cmd)
+{
+    static const char *rpc[] = { "loadrt", "newinst", "newthread", NULL };
+    static const char *locked[] = { "net", "setp", "sets", "addf",
+				    "linkps", "linksp", "newsig", NULL };
+    const char **s;
+
+    for (s = rpc; *s; s++)
+	if (strcmp(cmd, *s) == 0)
+	    return BATCH_RPC;
+    for (s = locked; *s; s++)
+	if (strcmp(cmd, *s) == 0)
+	    return BATCH_LOCKED;
+    return BATCH_NONE;
+}
+
+typedef struct {
+    int count;
+    double total, max;
+} timing_t;
+
+static int batch_errors;  // failed batched commands, not yet counted
+static timing_t *command_timing;  // indexed like halcmd_commands[]
+static timing_t phase_timing[TIMING_PHASES];
+static int phase_items[TIMING_PHASES];
+static const char *phase_names[TIMING_PHASES] = {
+    "<rtapi_app batch>",
+    "<HAL mutex held>",
+};
+
+double halcmd_timestamp(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void timing_add(timing_t *t, double elapsed)
+{
+    t->count++;
+    t->total += elapsed;
+    if (elapsed > t->max)
+	t->max = elapsed;
+}
+
+void halcmd_timing_phase(halcmd_phase_t phase, double start, int count)
+{
+    if (!timing_mode)
+	return;
+    timing_add(&phase_timing[phase], halcmd_timestamp() - start);
+    phase_items[phase] += count;
+}
+
+void halcmd_print_timing(void)
+{
+    int i;
+    double total = 0.0;
+
+    if (!timing_mode || !command_timing)
+	return;
+    fprintf(stderr, "halcmd timing (msec):\n");
+    fprintf(stderr, "  %-20s %8s %12s %12s\n", "command", "count", "total", "max");
+    for (i = 0; i < halcmd_ncommands; i++) {
+	timing_t *t = &command_timing[i];
+	if (!t->count)
+	    continue;
+	total += t->total;
+	fprintf(stderr, "  %-20s %8d %12.3f %12.3f\n",
+		halcmd_commands[i].name, t->count,
+		t->total * 1e3, t->max * 1e3);
+    }
+    for (i = 0; i < TIMING_PHASES; i++) {
+	timing_t *t = &phase_timing[i];
+	if (!t->count)
+	    continue;
+	fprintf(stderr, "  %-20s %8d %12.3f %12.3f  (%d commands)\n",
+		phase_names[i], t->count,
+		t->total * 1e3, t->max * 1e3, phase_items[i]);
+    }
+    fprintf(stderr, "  %-20s %8s %12.3f\n", "all commands", "", total * 1e3);
+}
+
 int halcmd_parse_cmd(char *tokens[])
 {
     int retval;
     static int first_time = 1;
+    struct halcmd_command *command = NULL;
+    double start = 0.0;
 
     if(first_time) {
         /* ensure that commands is sorted when it is searched later */
         qsort(halcmd_commands, halcmd_ncommands,
                 sizeof(struct halcmd_command), sort_command);
+        if (timing_mode)
+            command_timing = calloc(halcmd_ncommands, sizeof(timing_t));
         first_time = 0;
     }
 
+    if (tokens[0] && tokens[0][0])
+	command = bsearch(tokens[0], halcmd_commands, halcmd_ncommands,
+			  sizeof(struct halcmd_command), compare_command);
+
     hal_flag = 1;
+    if (batch_mode) {
+	// complete any batch this command can not be part of
+	batch_kind_t kind = command ? batch_kind(command->name) : BATCH_NONE;
+
+	if (kind != BATCH_LOCKED)
+	    halcmd_batch_unlock();
+	// failures are reported against the batched lines, this
+	// command still runs and returns its own result
+	if (kind != BATCH_RPC)
+	    batch_errors += halcmd_batch_flush();
+    }
+    if (timing_mode)
+	start = halcmd_timestamp();
+
     retval = parse_cmd1(tokens);
-    hal_flag = 0;
+
+    if (command && command_timing)
+	timing_add(&command_timing[command - halcmd_commands],
+		   halcmd_timestamp() - start);
+    // the signal handler must not call hal_exit() while
+    // a locked batch holds the HAL mutex
+    hal_flag = halcmd_batch_locked();
     return retval;
 }
 
+// complete any pending batch, returns the number of errors
+int halcmd_batch_end(void)
+{
+    int errors;
+
+    if (!batch_mode)
+	return 0;
+    hal_flag = 1;
+    halcmd_batch_unlock();
+    errors = halcmd_batch_flush() + halcmd_batch_errors();
+    hal_flag = 0;
+    return errors;
+}
+
+// returns the number of batched commands which failed since the last call
+int halcmd_batch_errors(void)
+{
+    int errors = batch_errors;
+
+    batch_errors = 0;
+    return errors;
+}
+
+// release the HAL mutex of a locked batch, before input may block
+void halcmd_batch_yield(void)
+{
+    halcmd_batch_unlock();
+    hal_flag = 0;
+}
+
 /* tokenize() sets an array of pointers to each non-whitespace
    token in the input line.  It expects that variable substitution
    and comment removal have already been done, and that any
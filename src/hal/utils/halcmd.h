@@ -52,6 +52,24 @@ extern void halcmd_shutdown(void);
 extern int prompt_mode, echo_mode, errorcount, halcmd_done;
 extern int halcmd_preprocess_line ( char *line, char **tokens);
 
+// -B: coalesce commands, see halcmd_commands.c
+extern int batch_mode;
+// -T: report time spent per command and phase on exit
+extern int timing_mode;
+
+typedef enum {
+    TIMING_RPC_BATCH,   // batched requests to rtapi_app
+    TIMING_HAL_LOCKED,  // HAL mutex held across batched commands
+    TIMING_PHASES
+} halcmd_phase_t;
+
+extern double halcmd_timestamp(void);
+extern void halcmd_timing_phase(halcmd_phase_t phase, double start, int count);
+extern void halcmd_print_timing(void);
+extern int halcmd_batch_end(void);
+extern int halcmd_batch_errors(void);
+extern void halcmd_batch_yield(void);
+
 void halcmd_info(const char *format,...) __attribute__((format(printf,1,2)));
 void halcmd_output(const char *format,...) __attribute__((format(printf,1,2)));
 void halcmd_warning(const char *format,...) __attribute__((format(printf,1,2)));
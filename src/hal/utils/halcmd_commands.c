@@ -70,6 +70,204 @@
 const char *logpath = "/var/log/linuxcnc.log";
 
 static int unloadrt_comp(char *mod_name);
+
+/***********************************************************************
+*                          BATCH MODE (-B)                             *
+************************************************************************/
+
+// In batch mode, two kinds of coalescing happen:
+//
+// consecutive loadrt (of legacy modules), newinst and newthread commands
+// are queued and sent to rtapi_app as a single MT_RTAPI_APP_BATCH request
+// when the first command which depends on their outcome is parsed.
+// Errors are reported against the line which queued the failing command.
+//
+// consecutive net, setp, sets, addf, linkps/linksp and newsig commands
+// are executed while holding the HAL mutex, which is acquired once by
+// the first of them and released before any other command executes.
+// Other HAL users see either none or all of these changes.
+
+typedef enum {
+    PENDING_LOADRT,
+    PENDING_NEWINST,
+    PENDING_NEWTHREAD,
+} pending_type_t;
+
+typedef struct {
+    pending_type_t type;
+    char *name;        // module, instance or thread name
+    char *args;        // loadrt: module args as recorded in comp->insmod_args
+    char *filename;
+    int linenumber;
+} pending_t;
+
+static pending_t *pending;
+static int npending, pending_size;
+static int batch_mutex_held;
+static double batch_mutex_since;
+
+static void batch_defer(pending_type_t type, const char *name, const char *args)
+{
+    if (npending == pending_size) {
+	pending_size = pending_size ? pending_size * 2 : 32;
+	pending = realloc(pending, pending_size * sizeof(pending_t));
+	if (pending == NULL) {
+	    fprintf(stderr, "halcmd: out of memory\n");
+	    exit(1);
+	}
+    }
+    pending_t *p = &pending[npending++];
+    p->type = type;
+    p->name = strdup(name);
+    p->args = args ? strdup(args) : NULL;
+    p->filename = strdup(halcmd_get_filename() ? halcmd_get_filename() : "");
+    p->linenumber = halcmd_get_linenumber();
+    rtapi_batch_begin();
+}
+
+static bool batch_pending(pending_type_t type)
+{
+    int i;
+    for (i = 0; i < npending; i++)
+	if (pending[i].type == type)
+	    return true;
+    return false;
+}
+
+static int loadrt_finish(char *mod_name, char *arg_string);
+
+// report the outcome of a queued command against its source line
+static void batch_result(int index, int retcode, const char *errmsg, void *arg)
+{
+    pending_t *p = &pending[index];
+    int *errors = arg;
+    const char *fname = halcmd_get_filename();
+    int line = halcmd_get_linenumber();
+    char *saved_fname = strdup(fname ? fname : "");
+
+    halcmd_set_filename(p->filename);
+    halcmd_set_linenumber(p->linenumber);
+
+    if (retcode) {
+	(*errors)++;
+	switch (p->type) {
+	case PENDING_LOADRT:
+	    halcmd_error("insmod failed, returned %d:\n%s\n"
+			 "See %s for more information.\n",
+			 retcode, errmsg, logpath);
+	    break;
+	case PENDING_NEWINST:
+	    halcmd_error("newinst %s: rc=%d\n%s\n", p->name, retcode, errmsg);
+	    break;
+	case PENDING_NEWTHREAD:
+	    halcmd_error("newthread %s: %s\n", p->name, errmsg);
+	    break;
+	}
+    } else if (p->type == PENDING_LOADRT) {
+	if (loadrt_finish(p->name, p->args))
+	    (*errors)++;
+    }
+    halcmd_set_filename(saved_fname);
+    halcmd_set_linenumber(line);
+    free(saved_fname);
+}
+
+// send any queued rtapi_app commands, returns the number of failed commands
+int halcmd_batch_flush(void)
+{
+    int i, errors = 0;
+    double start;
+
+    if (npending == 0)
+	return 0;
+    start = halcmd_timestamp();
+    rtapi_batch_flush(batch_result, &errors);
+    halcmd_timing_phase(TIMING_RPC_BATCH, start, npending);
+
+    for (i = 0; i < npending; i++) {
+	free(pending[i].name);
+	free(pending[i].args);
+	free(pending[i].filename);
+    }
+    npending = 0;
+    return errors;
+}
+
+int halcmd_batch_locked(void)
+{
+    return batch_mutex_held;
+}
+
+void halcmd_batch_unlock(void)
+{
+    if (batch_mutex_held) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	batch_mutex_held = 0;
+	halcmd_timing_phase(TIMING_HAL_LOCKED, batch_mutex_since, 1);
+    }
+}
+
+// mutex handling for commands which may run as part of a locked batch
+static void batch_mutex_get(void)
+{
+    if (!batch_mode) {
+	rtapi_mutex_get(&(hal_data->mutex));
+	return;
+    }
+    if (!batch_mutex_held) {
+	rtapi_mutex_get(&(hal_data->mutex));
+	batch_mutex_held = 1;
+	batch_mutex_since = halcmd_timestamp();
+    }
+}
+
+static void batch_mutex_give(void)
+{
+    if (!batch_mode)
+	rtapi_mutex_give(&(hal_data->mutex));
+}
+
+// the unlocked halpr_* functions skip the HAL lock check
+static int batch_check_config_lock(void)
+{
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	halcmd_error("HAL is locked, configuration changes are not permitted\n");
+	return -EPERM;
+    }
+    return 0;
+}
+
+static int batch_signal_new(const char *name, hal_type_t type)
+{
+    int retval;
+    if (!batch_mutex_held)
+	return hal_signal_new(name, type);
+    if ((retval = batch_check_config_lock()))
+	return retval;
+    return halpr_signal_new(name, type);
+}
+
+static int batch_link(const char *pin, const char *sig)
+{
+    int retval;
+    if (!batch_mutex_held)
+	return hal_link(pin, sig);
+    if ((retval = batch_check_config_lock()))
+	return retval;
+    return halpr_link(pin, sig);
+}
+
+static int batch_add_funct_to_thread(const char *func, const char *thread,
+				     int position)
+{
+    int retval;
+    if (!batch_mutex_held)
+	return hal_add_funct_to_thread(func, thread, position);
+    if ((retval = batch_check_config_lock()))
+	return retval;
+    return halpr_add_funct_to_thread(func, thread, position);
+}
+
 static void print_comp_info(char **patterns);
 static void print_inst_info(char **patterns);
 static void print_vtable_info(char **patterns);
@@ -235,7 +433,9 @@ int do_linkps_cmd(char *pin, char *sig)
 {
     int retval;
 
-    retval = hal_link(pin, sig);
+    if (batch_mode)
+	batch_mutex_get();
+    retval = batch_link(pin, sig);
     if (retval == 0) {
 	/* print success message */
         halcmd_info("Pin '%s' linked to signal '%s'\n", pin, sig);
@@ -337,7 +537,9 @@ int do_addf_cmd(char *func, char *thread, char **opt) {
 
     if(position_str && *position_str) position = atoi(position_str);
 
-    retval = hal_add_funct_to_thread(func, thread, position);
+    if (batch_mode)
+	batch_mutex_get();
+    retval = batch_add_funct_to_thread(func, thread, position);
     if(retval == 0) {
         halcmd_info("Function '%s' added to thread '%s'\n",
                     func, thread);
@@ -482,14 +684,14 @@ int do_net_cmd(char *signal, char *pins[]) {
     hal_sig_t *sig;
     int i, retval;
 
-    rtapi_mutex_get(&(hal_data->mutex));
+    batch_mutex_get();
     /* see if signal already exists */
     sig = halpr_find_sig_by_name(signal);
 
     /* verify that everything matches up (pin types, etc) */
     retval = preflight_net_cmd(signal, sig, pins);
     if(retval < 0) {
-        rtapi_mutex_give(&(hal_data->mutex));
+        batch_mutex_give();
         return retval;
     }
 
@@ -500,21 +702,21 @@ int do_net_cmd(char *signal, char *pins[]) {
                     "Signal name '%s' must not be the same as a pin.  "
                     "Did you omit the signal name?\n",
 		signal);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    batch_mutex_give();
 	    return -ENOENT;
 	}
     }
     if(!sig) {
         /* Create the signal with the type of the first pin */
         hal_pin_t *pin = halpr_find_pin_by_name(pins[0]);
-        rtapi_mutex_give(&(hal_data->mutex));
+        batch_mutex_give();
         if(!pin) {
             return -ENOENT;
         }
-        retval = hal_signal_new(signal, pin->type);
+        retval = batch_signal_new(signal, pin->type);
     } else {
 	/* signal already exists */
-        rtapi_mutex_give(&(hal_data->mutex));
+        batch_mutex_give();
     }
     /* add pins to signal */
     for(i=0; retval == 0 && pins[i] && *pins[i]; i++) {
@@ -528,14 +730,16 @@ int do_newsig_cmd(char *name, char *type)
 {
     int retval;
 
+    if (batch_mode)
+	batch_mutex_get();
     if (strcasecmp(type, "bit") == 0) {
-	retval = hal_signal_new(name, HAL_BIT);
+	retval = batch_signal_new(name, HAL_BIT);
     } else if (strcasecmp(type, "float") == 0) {
-	retval = hal_signal_new(name, HAL_FLOAT);
+	retval = batch_signal_new(name, HAL_FLOAT);
     } else if (strcasecmp(type, "u32") == 0) {
-	retval = hal_signal_new(name, HAL_U32);
+	retval = batch_signal_new(name, HAL_U32);
     } else if (strcasecmp(type, "s32") == 0) {
-	retval = hal_signal_new(name, HAL_S32);
+	retval = batch_signal_new(name, HAL_S32);
     } else {
 	halcmd_error("Unknown signal type '%s'\n", type);
 	retval = -EINVAL;
@@ -615,13 +819,13 @@ int do_setp_cmd(char *name, char *value)
 
     halcmd_info("setting parameter '%s' to '%s'\n", name, value);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    batch_mutex_get();
     /* search param list for name */
     param = halpr_find_param_by_name(name);
     if (param == 0) {
         pin = halpr_find_pin_by_name(name);
         if(pin == 0) {
-            rtapi_mutex_give(&(hal_data->mutex));
+            batch_mutex_give();
             halcmd_error("parameter or pin '%s' not found\n", name);
             return -EINVAL;
         } else {
@@ -629,12 +833,12 @@ int do_setp_cmd(char *name, char *value)
             /* found it */
             type = pin->type;
             if ((pin->dir == HAL_OUT) && (comp->state != COMP_UNBOUND)) {
-                rtapi_mutex_give(&(hal_data->mutex));
+                batch_mutex_give();
                 halcmd_error("pin '%s' is not writable\n", name);
                 return -EINVAL;
             }
             if(pin->signal != 0) {
-                rtapi_mutex_give(&(hal_data->mutex));
+                batch_mutex_give();
                 halcmd_error("pin '%s' is connected to a signal\n", name);
                 return -EINVAL;
             }
@@ -646,7 +850,7 @@ int do_setp_cmd(char *name, char *value)
         type = param->type;
         /* is it read only? */
         if (param->dir == HAL_RO) {
-            rtapi_mutex_give(&(hal_data->mutex));
+            batch_mutex_give();
             halcmd_error("param '%s' is not writable\n", name);
             return -EINVAL;
         }
@@ -655,7 +859,7 @@ int do_setp_cmd(char *name, char *value)
 
     retval = set_common(type, d_ptr, value);
 
-    rtapi_mutex_give(&(hal_data->mutex));
+    batch_mutex_give();
     if (retval == 0) {
 	/* print success message */
         if(param) {
@@ -788,17 +992,17 @@ int do_sets_cmd(char *name, char *value)
 
     rtapi_print_msg(RTAPI_MSG_DBG, "setting signal '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    batch_mutex_get();
     /* search signal list for name */
     sig = halpr_find_sig_by_name(name);
     if (sig == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	batch_mutex_give();
 	halcmd_error("signal '%s' not found\n", name);
 	return -EINVAL;
     }
     /* found it - does it have a writer? */
     if (sig->writers > 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	batch_mutex_give();
 	halcmd_error("signal '%s' already has writer(s)\n", name);
 	return -EINVAL;
     }
@@ -806,7 +1010,9 @@ int do_sets_cmd(char *name, char *value)
     type = sig->type;
     d_ptr = SHMPTR(sig->data_ptr);
     retval = set_common(type, d_ptr, value);
-    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval == 0)
+	hal_sig_written(sig);
+    batch_mutex_give();
     if (retval == 0) {
 	/* print success message */
 	halcmd_info("Signal '%s' set to %s\n", name, value);
@@ -1132,27 +1338,22 @@ bool inst_name_exists(char *name)
     }
 }
 
-int loadrt(char *mod_name, char *args[])
+// make the args that were passed to the module into a single string
+static void loadrt_argstring(char *args[], char *arg_string)
 {
-    char *cp1;
-    int n, retval;
-    char arg_string[MAX_CMD_LEN+1];
-
-    retval = rtapi_loadrt(rtapi_instance, mod_name, (const char **)args);
-    if ( retval != 0 ) {
-	halcmd_error("insmod failed, returned %d:\n%s\n"
-		     "See %s for more information.\n",
-		     retval, rtapi_rpcerror(), logpath);
-	return -1;
-    }
-
-    // make the args that were passed to the module into a single string
-    n = 0;
+    int n = 0;
     arg_string[0] = '\0';
     while ( args[n] && args[n][0] != '\0' ) {
 	strncat(arg_string, args[n++], MAX_CMD_LEN);
 	strncat(arg_string, " ", MAX_CMD_LEN);
     }
+}
+
+// record the module args with the newly loaded component
+static int loadrt_finish(char *mod_name, char *arg_string)
+{
+    char *cp1;
+
     // allocate HAL shmem for the string
     cp1 = hal_malloc(strlen(arg_string)+1);
     if ( cp1 == NULL ) {
@@ -1178,6 +1379,36 @@ int loadrt(char *mod_name, char *args[])
     return 0;
 }
 
+int loadrt(char *mod_name, char *args[])
+{
+    int retval;
+    char arg_string[MAX_CMD_LEN+1];
+
+    // anything queued must complete first
+    if (halcmd_batch_flush())
+	return -1;
+
+    retval = rtapi_loadrt(rtapi_instance, mod_name, (const char **)args);
+    if ( retval != 0 ) {
+	halcmd_error("insmod failed, returned %d:\n%s\n"
+		     "See %s for more information.\n",
+		     retval, rtapi_rpcerror(), logpath);
+	return -1;
+    }
+    loadrt_argstring(args, arg_string);
+    return loadrt_finish(mod_name, arg_string);
+}
+
+// batch mode: queue the load, completed by halcmd_batch_flush()
+static int loadrt_deferred(char *mod_name, char *args[])
+{
+    char arg_string[MAX_CMD_LEN+1];
+
+    loadrt_argstring(args, arg_string);
+    batch_defer(PENDING_LOADRT, mod_name, arg_string);
+    return rtapi_loadrt(rtapi_instance, mod_name, (const char **)args);
+}
+
 static int loadrt_cmd(const bool instantiate, // true if called from do_newinst
 		      char *mod_name,
 		      char *args[])
@@ -1219,9 +1450,15 @@ static int loadrt_cmd(const bool instantiate, // true if called from do_newinst
     // just loadrt the comp
     if (!(instantiable && instantiate)) {
 	// legacy components
+	if (batch_mode && instantiate)
+	    return loadrt_deferred(mod_name, args);
         return loadrt(mod_name, args);
     }
 
+    // the instance checks below need any queued loads completed
+    if (halcmd_batch_flush())
+	return -1;
+
     // from here on: only instantiable comps to be considered
     // a singleton might be instantiable too (once only)
     //
@@ -1346,6 +1583,37 @@ int do_loadrt_cmd(char *mod_name, char *args[])
     return loadrt_cmd(true, mod_name, args);
 }
 
+// load a set of independent modules, without args, in a single
+// rtapi_app request. rtapi_app reads and links the module objects in
+// parallel, then runs each rtapi_app_main() in the order given.
+// Instantiable modules are loaded but not instantiated.
+int do_loadrts_cmd(char *mod_name, char *args[])
+{
+    char *noargs[] = { NULL };
+    int i, retval;
+
+    if (hal_get_lock() & HAL_LOCK_LOAD) {
+	halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	return -EPERM;
+    }
+    if (halcmd_batch_flush())
+	return -1;
+
+    // mod_name is the first module of the set, args[] the others
+    for (i = -1; (i < 0) || (args[i] && *args[i]); i++) {
+	char *name = (i < 0) ? mod_name : args[i];
+	if (module_loaded(name)) {
+	    halcmd_error("module '%s' already loaded\n", name);
+	    return -EEXIST;
+	}
+    }
+    for (i = -1; (i < 0) || (args[i] && *args[i]); i++) {
+	if ((retval = loadrt_deferred((i < 0) ? mod_name : args[i], noargs)))
+	    return retval;
+    }
+    return halcmd_batch_flush() ? -1 : 0;
+}
+
 
 int do_delsig_cmd(char *mod_name)
 {
@@ -3701,10 +3969,16 @@ cstatus_t classify_comp(const char *comp)
 int do_newinst_cmd(char *comp, char *inst, char *args[])
 {
     int retval;
-    cstatus_t status = classify_comp(comp);
+    cstatus_t status;
     char *argv[] = { NULL};
     bool singleton = false;
 
+    // classifying the component needs queued loads completed;
+    // queued newinst and newthread commands do not matter
+    if (batch_pending(PENDING_LOADRT) && halcmd_batch_flush())
+	return -1;
+    status = classify_comp(comp);
+
     switch (status) {
     case CS_NOT_LOADED:
 	if (autoload) {
@@ -3750,6 +4024,8 @@ int do_newinst_cmd(char *comp, char *inst, char *args[])
     //  as the component.  If created by newinst, it could have any name.
     //  Try to prevent more than one singleton being created using newinst afterwards.
     if (singleton) {
+	if (halcmd_batch_flush())
+	    return -1;
 	WITH_HAL_MUTEX();
         hal_comp_t *existing_comp = halpr_find_comp_by_name(comp);
         if (inst_name_exists(comp) || inst_count(existing_comp)) {
@@ -3758,6 +4034,8 @@ int do_newinst_cmd(char *comp, char *inst, char *args[])
 	}
     }
 
+    if (batch_mode)
+	batch_defer(PENDING_NEWINST, inst, NULL);
     retval = rtapi_newinst(rtapi_instance, comp, inst, (const char **)args);
     if (retval) {
 	halcmd_error("rc=%d\n%s", retval, rtapi_rpcerror());
@@ -4066,6 +4344,584 @@ static void save_threads(FILE *dst)
     rtapi_mutex_give(&(hal_data->mutex));
 }
 
+/***********************************************************************
+*                        NETLIST SNAPSHOTS                             *
+************************************************************************/
+
+// 'snapshot save <file>' writes the netlist - RT modules with their
+// args, instances, threads, aliases, signals, links, funct order and
+// all writable values - to a compact binary file.
+//
+// 'snapshot restore <file>' recreates it with two rtapi_app requests
+// (modules, then instances and threads) followed by a single HAL mutex
+// hold for signals, links, values and funct order - instead of one
+// round trip or lock per command as when sourcing the .hal files.
+//
+// The file is a header followed by records, each a one byte kind and
+// kind-specific fields: strings as u16 length + bytes, values as raw
+// hal_data_u. It is meant for restarting the same build on the same
+// machine, not as a portable exchange format.
+//
+// Restoring over a live session skips what already exists, so it also
+// brings back the values of a running configuration.
+//
+// Not covered: userspace components (their pins are linked if they
+// exist at restore time), instance args (not recorded by HAL, restore
+// warns for each instance it recreates), rings, groups and remote
+// components.
+
+#define SNAP_MAGIC   "HALSNAP"
+#define SNAP_VERSION 1
+
+typedef enum {
+    SNAP_END = 0,
+    SNAP_MODULE,       // name, insmod args
+    SNAP_INST,         // comp name, instance name
+    SNAP_THREAD,       // name, period, cpu, uses_fp, flags
+    SNAP_PIN_ALIAS,    // original name, alias
+    SNAP_PARAM_ALIAS,  // original name, alias
+    SNAP_SIGNAL,       // name, type, value
+    SNAP_LINK,         // pin, signal
+    SNAP_PIN,          // name, type, value - unlinked, writable pins
+    SNAP_PARAM,        // name, type, value - writable params
+    SNAP_FUNCT,        // funct, thread - in thread execution order
+} snap_kind_t;
+
+typedef struct {
+    char magic[8];
+    __u32 version;
+    __u32 value_size;  // sizeof(hal_data_u) of the writer
+} snap_header_t;
+
+// a decoded record
+typedef struct {
+    snap_kind_t kind;
+    char name[MAX_CMD_LEN+1];
+    char name2[MAX_CMD_LEN+1];  // second name, or module args
+    __s32 type;
+    hal_data_u value;
+    __s32 period, cpu, uses_fp, flags;
+} snap_rec_t;
+
+typedef struct {
+    const unsigned char *buf;
+    size_t size, pos;
+} snap_reader_t;
+
+static void snap_put_u8(FILE *f, __u8 v)
+{
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void snap_put_s32(FILE *f, __s32 v)
+{
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void snap_put_str(FILE *f, const char *s)
+{
+    __u16 len = strlen(s);
+    fwrite(&len, sizeof(len), 1, f);
+    fwrite(s, len, 1, f);
+}
+
+static void snap_put_value(FILE *f, hal_type_t type, const void *value)
+{
+    hal_data_u v;
+
+    memset(&v, 0, sizeof(v));
+    switch (type) {
+    case HAL_BIT:   v.b = *((hal_bit_t *) value);   break;
+    case HAL_FLOAT: v.f = *((hal_float_t *) value); break;
+    case HAL_S32:   v.s = *((hal_s32_t *) value);   break;
+    case HAL_U32:   v.u = *((hal_u32_t *) value);   break;
+    default: break;
+    }
+    snap_put_s32(f, type);
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void snap_store_value(hal_type_t type, void *d_ptr, const hal_data_u *v)
+{
+    switch (type) {
+    case HAL_BIT:   *((hal_bit_t *) d_ptr) = v->b;   break;
+    case HAL_FLOAT: *((hal_float_t *) d_ptr) = v->f; break;
+    case HAL_S32:   *((hal_s32_t *) d_ptr) = v->s;   break;
+    case HAL_U32:   *((hal_u32_t *) d_ptr) = v->u;   break;
+    default: break;
+    }
+}
+
+static int snap_get(snap_reader_t *r, void *dst, size_t n)
+{
+    if (r->pos + n > r->size)
+	return -1;
+    memcpy(dst, r->buf + r->pos, n);
+    r->pos += n;
+    return 0;
+}
+
+static int snap_get_str(snap_reader_t *r, char *dst)
+{
+    __u16 len;
+
+    if (snap_get(r, &len, sizeof(len)) || (len > MAX_CMD_LEN))
+	return -1;
+    if (snap_get(r, dst, len))
+	return -1;
+    dst[len] = '\0';
+    return 0;
+}
+
+// decode the next record; returns 1 for a record, 0 at the end, -1 on error
+static int snap_next(snap_reader_t *r, snap_rec_t *rec)
+{
+    __u8 kind;
+    int err = 0;
+
+    if (snap_get(r, &kind, sizeof(kind)))
+	return -1;
+    rec->kind = kind;
+    switch (rec->kind) {
+    case SNAP_END:
+	return 0;
+    case SNAP_MODULE:
+    case SNAP_INST:
+    case SNAP_PIN_ALIAS:
+    case SNAP_PARAM_ALIAS:
+    case SNAP_LINK:
+    case SNAP_FUNCT:
+	err = snap_get_str(r, rec->name) || snap_get_str(r, rec->name2);
+	break;
+    case SNAP_THREAD:
+	err = snap_get_str(r, rec->name) ||
+	    snap_get(r, &rec->period, sizeof(rec->period)) ||
+	    snap_get(r, &rec->cpu, sizeof(rec->cpu)) ||
+	    snap_get(r, &rec->uses_fp, sizeof(rec->uses_fp)) ||
+	    snap_get(r, &rec->flags, sizeof(rec->flags));
+	break;
+    case SNAP_SIGNAL:
+    case SNAP_PIN:
+    case SNAP_PARAM:
+	err = snap_get_str(r, rec->name) ||
+	    snap_get(r, &rec->type, sizeof(rec->type)) ||
+	    snap_get(r, &rec->value, sizeof(rec->value));
+	break;
+    default:
+	return -1;
+    }
+    return err ? -1 : 1;
+}
+
+static int comp_id_cmp(const void *a, const void *b)
+{
+    const hal_comp_t *ca = *(const hal_comp_t **) a;
+    const hal_comp_t *cb = *(const hal_comp_t **) b;
+    return ca->comp_id - cb->comp_id;
+}
+
+static int snapshot_save(char *filename)
+{
+    snap_header_t hdr;
+    hal_comp_t *comp, **comps;
+    hal_inst_t *inst;
+    hal_thread_t *tptr;
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    hal_param_t *param;
+    hal_oldname_t *oldname;
+    int next, n, i;
+    FILE *dst;
+
+    dst = fopen(filename, "w");
+    if (dst == NULL) {
+	halcmd_error("Can't open snapshot file '%s': %s\n",
+		     filename, strerror(errno));
+	return -1;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    strncpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+    hdr.version = SNAP_VERSION;
+    hdr.value_size = sizeof(hal_data_u);
+    fwrite(&hdr, sizeof(hdr), 1, dst);
+
+    {
+	WITH_HAL_MUTEX();
+
+	// RT modules loaded by loadrt, in loading (comp_id) order
+	for (n = 0, next = hal_data->comp_list_ptr; next; next = comp->next_ptr) {
+	    comp = SHMPTR(next);
+	    n++;
+	}
+	comps = malloc((n + 1) * sizeof(hal_comp_t *));
+	if (comps == NULL) {
+	    fclose(dst);
+	    halcmd_error("snapshot: out of memory\n");
+	    return -ENOMEM;
+	}
+	for (n = 0, next = hal_data->comp_list_ptr; next; next = comp->next_ptr) {
+	    comp = SHMPTR(next);
+	    if ((comp->type == TYPE_RT) && comp->insmod_args)
+		comps[n++] = comp;
+	}
+	qsort(comps, n, sizeof(hal_comp_t *), comp_id_cmp);
+	for (i = 0; i < n; i++) {
+	    snap_put_u8(dst, SNAP_MODULE);
+	    snap_put_str(dst, comps[i]->name);
+	    snap_put_str(dst, SHMPTR(comps[i]->insmod_args));
+	}
+	free(comps);
+
+	for (next = hal_data->inst_list_ptr; next; next = inst->next_ptr) {
+	    inst = SHMPTR(next);
+	    comp = halpr_find_comp_by_id(inst->comp_id);
+	    if ((comp == NULL) || (comp->insmod_args == 0))
+		continue;
+	    snap_put_u8(dst, SNAP_INST);
+	    snap_put_str(dst, comp->name);
+	    snap_put_str(dst, inst->name);
+	}
+
+	for (next = hal_data->thread_list_ptr; next; next = tptr->next_ptr) {
+	    tptr = SHMPTR(next);
+	    snap_put_u8(dst, SNAP_THREAD);
+	    snap_put_str(dst, tptr->name);
+	    snap_put_s32(dst, tptr->period);
+	    snap_put_s32(dst, tptr->cpu_id);
+	    snap_put_s32(dst, tptr->uses_fp);
+	    snap_put_s32(dst, tptr->flags);
+	}
+
+	for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	    pin = SHMPTR(next);
+	    if (pin->oldname == 0)
+		continue;
+	    oldname = SHMPTR(pin->oldname);
+	    snap_put_u8(dst, SNAP_PIN_ALIAS);
+	    snap_put_str(dst, oldname->name);
+	    snap_put_str(dst, pin->name);
+	}
+	for (next = hal_data->param_list_ptr; next; next = param->next_ptr) {
+	    param = SHMPTR(next);
+	    if (param->oldname == 0)
+		continue;
+	    oldname = SHMPTR(param->oldname);
+	    snap_put_u8(dst, SNAP_PARAM_ALIAS);
+	    snap_put_str(dst, oldname->name);
+	    snap_put_str(dst, param->name);
+	}
+
+	for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	    sig = SHMPTR(next);
+	    snap_put_u8(dst, SNAP_SIGNAL);
+	    snap_put_str(dst, sig->name);
+	    snap_put_value(dst, sig->type, SHMPTR(sig->data_ptr));
+	}
+
+	for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	    pin = SHMPTR(next);
+	    if (pin->signal) {
+		sig = SHMPTR(pin->signal);
+		snap_put_u8(dst, SNAP_LINK);
+		snap_put_str(dst, pin->name);
+		snap_put_str(dst, sig->name);
+	    } else if (pin->dir != HAL_OUT) {
+		snap_put_u8(dst, SNAP_PIN);
+		snap_put_str(dst, pin->name);
+		snap_put_value(dst, pin->type, &pin->dummysig);
+	    }
+	}
+
+	for (next = hal_data->param_list_ptr; next; next = param->next_ptr) {
+	    param = SHMPTR(next);
+	    if (param->dir == HAL_RO)
+		continue;
+	    snap_put_u8(dst, SNAP_PARAM);
+	    snap_put_str(dst, param->name);
+	    snap_put_value(dst, param->type, SHMPTR(param->data_ptr));
+	}
+
+	for (next = hal_data->thread_list_ptr; next; next = tptr->next_ptr) {
+	    hal_list_t *list_root, *list_entry;
+
+	    tptr = SHMPTR(next);
+	    list_root = &(tptr->funct_list);
+	    for (list_entry = list_next(list_root); list_entry != list_root;
+		 list_entry = list_next(list_entry)) {
+		hal_funct_entry_t *fentry = (hal_funct_entry_t *) list_entry;
+		hal_funct_t *funct = SHMPTR(fentry->funct_ptr);
+		snap_put_u8(dst, SNAP_FUNCT);
+		snap_put_str(dst, funct->name);
+		snap_put_str(dst, tptr->name);
+	    }
+	}
+    }
+    snap_put_u8(dst, SNAP_END);
+
+    i = ferror(dst);
+    if (fclose(dst) || i) {
+	halcmd_error("error writing snapshot file '%s'\n", filename);
+	return -EIO;
+    }
+    halcmd_info("snapshot saved to '%s'\n", filename);
+    return 0;
+}
+
+// true if 'funct' already runs in 'thread', so a restore over a live
+// session leaves it where it is. Call with the HAL mutex held.
+static bool snap_funct_in_thread(const char *funct, const char *thread)
+{
+    hal_thread_t *tptr = halpr_find_thread_by_name(thread);
+    hal_list_t *list_root, *list_entry;
+
+    if (tptr == NULL)
+	return false;
+    list_root = &(tptr->funct_list);
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	 list_entry = list_next(list_entry)) {
+	hal_funct_entry_t *fentry = (hal_funct_entry_t *) list_entry;
+	hal_funct_t *fptr = SHMPTR(fentry->funct_ptr);
+	if (strcmp(fptr->name, funct) == 0)
+	    return true;
+    }
+    return false;
+}
+
+// the lock-held part of restore: everything except modules, instances,
+// threads and aliases. Returns the number of records not restored.
+//
+// Signal values are stored in a second pass: linking a pin copies its
+// dummysig into the signal, which would overwrite a value already set.
+static int snapshot_restore_locked(snap_reader_t *r)
+{
+    snap_rec_t rec;
+    size_t start = r->pos;
+    int retval, errors = 0;
+
+    WITH_HAL_MUTEX();
+
+    while ((retval = snap_next(r, &rec)) > 0) {
+	switch (rec.kind) {
+	case SNAP_SIGNAL:
+	    {
+		hal_sig_t *sig = halpr_find_sig_by_name(rec.name);
+		if (sig == NULL) {
+		    if (halpr_signal_new(rec.name, rec.type)) {
+			halcmd_error("snapshot: newsig %s failed\n", rec.name);
+			errors++;
+			break;
+		    }
+		    sig = halpr_find_sig_by_name(rec.name);
+		}
+		if (sig->type != rec.type) {
+		    halcmd_error("snapshot: signal '%s' type mismatch\n", rec.name);
+		    errors++;
+		}
+	    }
+	    break;
+
+	case SNAP_LINK:
+	    if (halpr_link(rec.name, rec.name2)) {
+		halcmd_error("snapshot: linking '%s' to '%s' failed\n",
+			     rec.name, rec.name2);
+		errors++;
+	    }
+	    break;
+
+	case SNAP_PIN:
+	    {
+		hal_pin_t *pin = halpr_find_pin_by_name(rec.name);
+		if ((pin == NULL) || (pin->type != rec.type) || pin->signal) {
+		    halcmd_error("snapshot: cannot set pin '%s'\n", rec.name);
+		    errors++;
+		    break;
+		}
+		snap_store_value(pin->type, &pin->dummysig, &rec.value);
+	    }
+	    break;
+
+	case SNAP_PARAM:
+	    {
+		hal_param_t *param = halpr_find_param_by_name(rec.name);
+		if ((param == NULL) || (param->type != rec.type) ||
+		    (param->dir == HAL_RO)) {
+		    halcmd_error("snapshot: cannot set param '%s'\n", rec.name);
+		    errors++;
+		    break;
+		}
+		snap_store_value(param->type, SHMPTR(param->data_ptr), &rec.value);
+	    }
+	    break;
+
+	case SNAP_FUNCT:
+	    if (snap_funct_in_thread(rec.name, rec.name2))
+		break;
+	    if (halpr_add_funct_to_thread(rec.name, rec.name2, -1)) {
+		halcmd_error("snapshot: addf %s %s failed\n",
+			     rec.name, rec.name2);
+		errors++;
+	    }
+	    break;
+
+	default:
+	    break;
+	}
+    }
+    if (retval < 0)
+	return -1;
+
+    // second pass: signal values, now that all links are in place
+    r->pos = start;
+    while ((retval = snap_next(r, &rec)) > 0) {
+	hal_sig_t *sig;
+
+	if (rec.kind != SNAP_SIGNAL)
+	    continue;
+	sig = halpr_find_sig_by_name(rec.name);
+	if ((sig == NULL) || (sig->type != rec.type))
+	    continue;  // already reported
+	snap_store_value(sig->type, SHMPTR(sig->data_ptr), &rec.value);
+	hal_sig_written(sig);
+    }
+    return (retval < 0) ? -1 : errors;
+}
+
+static int snapshot_restore(char *filename)
+{
+    snap_header_t hdr;
+    snap_reader_t r;
+    snap_rec_t rec;
+    struct stat sb;
+    unsigned char *buf;
+    char *argv[MAX_ARGS + 1];
+    int fd, retval = 0, errors = 0;
+    size_t start;
+
+    if (hal_get_lock() & (HAL_LOCK_LOAD|HAL_LOCK_CONFIG)) {
+	halcmd_error("HAL is locked, restoring a snapshot is not permitted\n");
+	return -EPERM;
+    }
+    fd = open(filename, O_RDONLY);
+    if ((fd < 0) || fstat(fd, &sb)) {
+	halcmd_error("Can't open snapshot file '%s': %s\n",
+		     filename, strerror(errno));
+	if (fd >= 0)
+	    close(fd);
+	return -1;
+    }
+    buf = malloc(sb.st_size);
+    if ((buf == NULL) || (read(fd, buf, sb.st_size) != sb.st_size)) {
+	halcmd_error("error reading snapshot file '%s'\n", filename);
+	close(fd);
+	free(buf);
+	return -EIO;
+    }
+    close(fd);
+
+    r.buf = buf;
+    r.size = sb.st_size;
+    r.pos = 0;
+    if (snap_get(&r, &hdr, sizeof(hdr)) ||
+	strncmp(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic)) ||
+	(hdr.version != SNAP_VERSION) ||
+	(hdr.value_size != sizeof(hal_data_u))) {
+	halcmd_error("'%s' is not a compatible HAL snapshot\n", filename);
+	free(buf);
+	return -EINVAL;
+    }
+    start = r.pos;
+
+    // pass 1: all modules in a single rtapi_app request
+    if (halcmd_batch_flush())
+	goto fail;
+    while ((retval = snap_next(&r, &rec)) > 0) {
+	char *s;
+	int argc = 0;
+
+	if ((rec.kind != SNAP_MODULE) || module_loaded(rec.name))
+	    continue;
+	for (s = strtok(rec.name2, " "); s && (argc < MAX_ARGS); s = strtok(NULL, " "))
+	    argv[argc++] = s;
+	argv[argc] = NULL;
+	loadrt_deferred(rec.name, argv);
+    }
+    if ((retval < 0) || halcmd_batch_flush())
+	goto fail;
+
+    // pass 2: instances and threads in a second request
+    r.pos = start;
+    argv[0] = NULL;
+    while ((retval = snap_next(&r, &rec)) > 0) {
+	if ((rec.kind == SNAP_INST) && !inst_name_exists(rec.name2)) {
+	    halcmd_warning("snapshot: instance '%s' of '%s' is recreated with"
+			   " default args, instance args are not recorded\n",
+			   rec.name2, rec.name);
+	    batch_defer(PENDING_NEWINST, rec.name2, NULL);
+	    rtapi_newinst(rtapi_instance, rec.name, rec.name2, (const char **)argv);
+	}
+	if (rec.kind == SNAP_THREAD) {
+	    bool exists;
+	    {
+		WITH_HAL_MUTEX();
+		exists = (halpr_find_thread_by_name(rec.name) != NULL);
+	    }
+	    if (exists)
+		continue;
+	    batch_defer(PENDING_NEWTHREAD, rec.name, NULL);
+	    rtapi_newthread(rtapi_instance, rec.name, rec.period,
+			    rec.cpu, rec.uses_fp, rec.flags);
+	}
+    }
+    if ((retval < 0) || halcmd_batch_flush())
+	goto fail;
+
+    // pass 3: aliases, which rename objects referred to below
+    r.pos = start;
+    while ((retval = snap_next(&r, &rec)) > 0) {
+	if (rec.kind == SNAP_PIN_ALIAS)
+	    retval = hal_pin_alias(rec.name, rec.name2);
+	else if (rec.kind == SNAP_PARAM_ALIAS)
+	    retval = hal_param_alias(rec.name, rec.name2);
+	else
+	    continue;
+	if (retval) {
+	    halcmd_error("snapshot: alias %s %s failed\n", rec.name, rec.name2);
+	    errors++;
+	}
+    }
+
+    // pass 4: everything else under a single HAL mutex hold
+    r.pos = start;
+    retval = snapshot_restore_locked(&r);
+    if (retval < 0)
+	goto fail;
+    errors += retval;
+    free(buf);
+
+    if (errors) {
+	halcmd_error("snapshot '%s': %d items not restored\n", filename, errors);
+	return -EINVAL;
+    }
+    halcmd_info("snapshot '%s' restored\n", filename);
+    return 0;
+
+ fail:
+    if (retval < 0)
+	halcmd_error("snapshot file '%s' is corrupt\n", filename);
+    free(buf);
+    return -EINVAL;
+}
+
+int do_snapshot_cmd(char *op, char *filename)
+{
+    if (strcmp(op, "save") == 0)
+	return snapshot_save(filename);
+    if (strcmp(op, "restore") == 0)
+	return snapshot_restore(filename);
+    halcmd_error("Unknown 'snapshot' operation '%s'\n", op);
+    return -EINVAL;
+}
+
 int do_setexact_cmd() {
     int retval = 0;
     rtapi_mutex_get(&(hal_data->mutex));
@@ -4130,6 +4986,8 @@ int do_newthread_cmd(char *name, char *args[])
 	halcmd_info("specifying 'nowait' without 'posix' makes it easy to lock up RT\n");
     }
 
+    if (batch_mode)
+	batch_defer(PENDING_NEWTHREAD, name, NULL);
     retval = rtapi_newthread(rtapi_instance, name, per, cpu, (int)use_fp, flags);
     if (retval)
 	halcmd_error("%s\n",rtapi_rpcerror());
@@ -4163,6 +5021,19 @@ int do_help_cmd(char *command)
 	printf("  Creates another instance of previously loaded module\n" );
 	printf("  'modname', nameing it 'instname'.\n");
 #endif
+    } else if (strcmp(command, "loadrts") == 0) {
+	printf("loadrts modname [modname ...]\n");
+	printf("  Loads several independent realtime HAL modules without\n");
+	printf("  args. rtapi_app reads and links the modules in parallel,\n");
+	printf("  then starts them in the order given. Instantiable modules\n");
+	printf("  are loaded but not instantiated.\n");
+    } else if (strcmp(command, "snapshot") == 0) {
+	printf("snapshot save|restore filename\n");
+	printf("  'save' writes the realtime netlist (modules, instances,\n");
+	printf("  threads, aliases, signals, links, funct order, pin and\n");
+	printf("  param values) to a binary file. 'restore' recreates it\n");
+	printf("  with a few bulk operations, much faster than re-running\n");
+	printf("  the .hal files. Userspace components are not saved.\n");
     } else if (strcmp(command, "unload") == 0) {
 	printf("unload compname\n");
 	printf("  Unloads HAL module 'compname', whether user space or realtime.\n");
@@ -4358,6 +5229,7 @@ static void print_help_commands(void)
     printf("Use 'help <command>' for more details about each command\n");
     printf("Available commands:\n");
     printf("  loadrt              Load realtime module(s)\n");
+    printf("  loadrts             Load several realtime modules in parallel\n");
     printf("  loadusr             Start user space program\n");
     printf("  waitusr             Waits for userspace component to exit\n");
     printf("  unload              Unload realtime module or terminate userspace component\n");
@@ -4377,6 +5249,7 @@ static void print_help_commands(void)
     printf("  source              Execute commands from another .hal file\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
+    printf("  snapshot            Save/restore config as a binary snapshot\n");
     printf("  start, stop         Start/stop realtime threads\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
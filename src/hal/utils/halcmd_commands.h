@@ -45,6 +45,11 @@
 
 #define MAX_ARGS 20 // max number of args to automatic instantiation by names
 
+// batch mode support, see halcmd -B
+extern int halcmd_batch_flush(void);
+extern int halcmd_batch_locked(void);
+extern void halcmd_batch_unlock(void);
+
 extern int do_addf_cmd(char *funct, char *thread, char *tokens[]);
 extern int do_alias_cmd(char *pinparam, char *name, char *alias);
 extern int do_unalias_cmd(char *pinparam, char *name);
@@ -79,6 +84,7 @@ extern int do_source_cmd(char *type);
 extern int do_status_cmd(char *type);
 extern int do_delsig_cmd(char *mod_name);
 extern int do_loadrt_cmd(char *mod_name, char *args[]);
+extern int do_loadrts_cmd(char *mod_name, char *args[]);
 extern int do_unlinkp_cmd(char *mod_name);
 extern int do_unload_cmd(char *mod_name);
 extern int do_unloadrt_cmd(char *mod_name);
@@ -86,6 +92,7 @@ extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *arg1, char *arg2);
 extern int do_save_cmd(char *type, char *filename);
+extern int do_snapshot_cmd(char *op, char *filename);
 extern int do_setexact_cmd(void);
 extern int do_sleep_cmd(char *naptime);
 
@@ -48,10 +48,10 @@
 static int argno;
 
 static const char *command_table[] = {
-    "loadrt", "loadusr", "unload", "lock", "unlock",
+    "loadrt", "loadrts", "loadusr", "unload", "lock", "unlock",
     "linkps", "linksp", "linkpp", "unlinkp",
     "net", "newsig", "delsig", "getp", "gets", "setp", "sets", "sete", "ptype", "stype",
-    "addf", "delf", "show", "list", "status", "save", "source",
+    "addf", "delf", "show", "list", "status", "save", "snapshot", "source",
     "start", "stop", "quit", "exit", "help", "alias", "unalias", 
     "newg"," delg", "newm", "delm",
     "newring","delring","ringdump","ringwrite","ringread",
@@ -868,6 +868,8 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
         return func(text, loadusr_generator);
     } else if(startswith(buffer, "loadrt ") && argno == 1) {
         result = func(text, loadrt_generator);
+    } else if(startswith(buffer, "loadrts ")) {
+        result = func(text, loadrt_generator);
     } else if(startswith(buffer, "delg ") && argno == 1) {
         result = func(text, group_generator);
     } else if(startswith(buffer, "delm ") && argno == 1) {
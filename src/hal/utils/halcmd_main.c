@@ -103,7 +103,7 @@ int main(int argc, char **argv)
     keep_going = 0;
     /* start parsing the command line, options first */
     while(1) {
-        c = getopt(argc, argv, "+RCfi:kqQsvVhu:U:P");
+        c = getopt(argc, argv, "+BRCfi:kqQsvVhu:U:PT");
         if(c == -1) break;
         switch(c) {
             case 'R':
@@ -156,6 +156,14 @@ int main(int argc, char **argv)
 	    case 'P':
                 proto_debug = 1;
 		break;
+	    case 'B':
+		/* -B = batch mode: coalesce commands */
+		batch_mode = 1;
+		break;
+	    case 'T':
+		/* -T = print timing summary on exit */
+		timing_mode = 1;
+		break;
 	    case 'C':
                 cl = getenv("COMP_LINE");
                 cw = getenv("COMP_POINT");
@@ -277,6 +285,11 @@ int main(int argc, char **argv)
             }
         }
     } else {
+	/* a locked batch must not hold the HAL mutex while reading
+	   blocks on a terminal or pipe */
+	struct stat st;
+	int input_blocks = fstat(fileno(srcfile), &st) || !S_ISREG(st.st_mode);
+
 	/* read command line(s) from 'srcfile' */
 	while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
 	    char *tokens[MAX_TOK+1];
@@ -305,12 +318,20 @@ int main(int argc, char **argv)
 	    if ( retval != 0 ) {
 		errorcount++;
 	    }
+	    /* batched commands which failed on this line's behalf */
+	    errorcount += halcmd_batch_errors();
 	    if (( errorcount > 0 ) && ( keep_going == 0 )) {
 		/* exit from loop */
 		break;
 	    }
+	    if (input_blocks) {
+		halcmd_batch_yield();
+	    }
 	}
     }
+    /* complete anything still queued in batch mode */
+    errorcount += halcmd_batch_end();
+    halcmd_print_timing();
     /* all done */
     halcmd_shutdown();
     if ( errorcount > 0 ) {
@@ -390,6 +411,12 @@ static void print_help_general(int showR)
     printf("\nUsage:   halcmd [options] [cmd [args]]\n\n");
     printf("\n         halcmd [options] -f [filename]\n\n");
     printf("options:\n\n");
+    printf("  -B             Batch mode - coalesce consecutive loadrt/newinst/\n");
+    printf("                 newthread commands into a single request to rtapi_app,\n");
+    printf("                 and run consecutive net/setp/sets/addf/newsig/linkps\n");
+    printf("                 commands under a single HAL mutex acquisition\n");
+    printf("                 (per line when reading from a pipe or terminal).\n");
+    printf("                 Errors are reported once the batch completes.\n");
     printf("  -e             echo the commands from stdin to stderr\n");
     printf("  -f [filename]  Read commands from 'filename', not command\n");
     printf("                 line.  If no filename, read from stdin.\n");
@@ -405,6 +432,7 @@ static void print_help_general(int showR)
     printf("  -R             Release mutex (for crash recovery only).\n");
     }
     printf("  -s             Script friendly - don't print headers on output.\n");
+    printf("  -T             Timing - print time spent per command and phase on exit.\n");
     printf("  -v             Verbose - print result of every command.\n");
     printf("  -V             Very verbose - print lots of junk.\n");
     printf("  -h             Help - print this help screen and exit.\n\n");
@@ -3,6 +3,7 @@
 
 #include <czmq.h>
 #include <string.h>
+#include <errno.h>
 #include "ll-zeroconf.hh"
 #include "mk-zeroconf.hh"
 #include "mk-zeroconf-types.h"
@@ -17,6 +18,12 @@ using namespace google::protobuf;
 
 static pb::Container command, reply;
 
+// batch mode: commands are collected in 'batch' instead of being
+// sent one by one, and sent as a single MT_RTAPI_APP_BATCH request
+// by rtapi_batch_flush()
+static pb::Container batch;
+static int batching;
+
 static zctx_t *z_context;
 static void *z_command;
 static int timeout = 5000;
@@ -63,6 +70,69 @@ int rtapi_rpc(void *socket, pb::Container &tx, pb::Container &rx)
 }
 
 
+// send 'command', or queue it if batching
+// a queued command always succeeds - errors are reported by rtapi_batch_flush()
+static int rtapi_command(void)
+{
+    if (batching) {
+	pb::RTAPICommand *cmd = batch.add_rtapibatch();
+	cmd->CopyFrom(command.rtapicmd());
+	cmd->set_type(command.type());
+	return 0;
+    }
+    int retval = rtapi_rpc(z_command, command, reply);
+    if (retval)
+	return retval;
+    return reply.retcode();
+}
+
+void rtapi_batch_begin(void)
+{
+    batching = 1;
+}
+
+int rtapi_batch_size(void)
+{
+    return batch.rtapibatch_size();
+}
+
+int rtapi_batch_flush(rtapi_batch_result_t result, void *arg)
+{
+    int n = batch.rtapibatch_size();
+    int retval = 0;
+
+    batching = 0;
+    if (n == 0)
+	return 0;
+
+    batch.set_type(pb::MT_RTAPI_APP_BATCH);
+    // allow each element the normal per-request timeout
+    zsocket_set_rcvtimeo (z_command, timeout * n * ZMQ_POLL_MSEC);
+    retval = rtapi_rpc(z_command, batch, reply);
+    zsocket_set_rcvtimeo (z_command, timeout * ZMQ_POLL_MSEC);
+    batch.Clear();
+    if (retval) {
+	// transport failure - report all as failed
+	for (int i = 0; i < n; i++)
+	    result(i, retval, errormsg.c_str(), arg);
+	return retval;
+    }
+    // elements executed are echoed with their retcode, in order;
+    // rtapi_app stops at the first failure
+    for (int i = 0; i < n; i++) {
+	if (i < reply.rtapibatch_size()) {
+	    const pb::RTAPICommand &r = reply.rtapibatch(i);
+	    std::string notes = pbconcat(r.note(), "\n");
+	    result(i, r.retcode(), notes.c_str(), arg);
+	} else {
+	    result(i, -ECANCELED,
+		   i == reply.rtapibatch_size() ? errormsg.c_str() :
+		   "not executed due to previous error", arg);
+	}
+    }
+    return reply.retcode();
+}
+
 int rtapi_callfunc(int instance,
 		   const char *func,
 		   const char **args)
@@ -106,10 +176,7 @@ int rtapi_newinst(int instance,
 	    cmd->add_argv(args[argc]);
 	    argc++;
 	}
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return rtapi_command();
 }
 
 int rtapi_delinst(int instance,
@@ -143,10 +210,7 @@ static int rtapi_loadop(pb::ContainerType type, int instance, const char *modnam
 	    cmd->add_argv(args[argc]);
 	    argc++;
 	}
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return rtapi_command();
 }
 
 int rtapi_loadrt(int instance, const char *modname, const char **args)
@@ -202,10 +266,7 @@ int rtapi_newthread(int instance, const char *name, int period, int cpu, int use
     cmd->set_use_fp(use_fp);
     cmd->set_flags(flags);
 
-    int retval = rtapi_rpc(z_command, command, reply);
-    if (retval)
-	return retval;
-    return reply.retcode();
+    return rtapi_command();
 }
 
 int rtapi_delthread(int instance, const char *name)
@@ -24,6 +24,17 @@ extern "C" {
 		      const char *instname);
     const char *rtapi_rpcerror(void);
 
+    // batch mode: after rtapi_batch_begin(), rtapi_loadrt(), rtapi_newinst()
+    // and rtapi_newthread() are queued and return 0 immediately.
+    // rtapi_batch_flush() sends them to rtapi_app in a single request,
+    // calls 'result' once per queued command in order, and ends batch mode.
+    // Returns the retcode of the first failing command, or 0.
+    typedef void (*rtapi_batch_result_t)(int index, int retcode,
+					 const char *errmsg, void *arg);
+    void rtapi_batch_begin(void);
+    int rtapi_batch_size(void);
+    int rtapi_batch_flush(rtapi_batch_result_t result, void *arg);
+
     extern int proto_debug;
 #ifdef __cplusplus
 }
@@ -0,0 +1,398 @@
+/** This file, 'halscope_stream.c', is a command line client of
+    'scope_rt' that streams channels continuously through the
+    'scope.stream' ring instead of the single shot capture buffer,
+    and runs them through the pipeline in 'scope_stream.c'.
+
+    Invoking:
+
+    halscope_stream [-t thread] [-m mult] [-T chan,level,rise|fall]
+                    [-p pre] [-n post] [-d columns] [-o file] name...
+
+    'name' is a pin, signal or parameter, up to 16 of them. scope_rt
+    must be loaded with 'stream_size=N' and must not be in use by
+    halscope. If the sample function is not linked to a thread yet,
+    '-t' names the thread; it is unlinked again on exit.
+
+    With '-T', the trigger is evaluated on the stream, on channel
+    'chan' (1-based, in the order given). The run ends 'post' samples
+    after the trigger; '-p' samples before it are kept. Without '-T',
+    the run ends after 'post' samples, or on SIGINT/SIGTERM.
+
+    '-o' writes the window as a columnar binary file, see
+    scope_export_hdr_t in scope_stream.h. '-d' prints a min/max
+    decimation of the window in 'columns' lines to stdout, as a
+    display would draw it.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private API decls */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
+#include "scope_stream.h"
+
+/***********************************************************************
+*                         GLOBAL VARIABLES                             *
+************************************************************************/
+
+static int comp_id = -1;	/* -1 means hal_init() not called yet */
+static int shm_id = -1;		/* -1 means shmem not allocated yet */
+static scope_shm_control_t *ctrl_shm;
+static ringbuffer_t ring;
+static int stop = 0;		/* set by the signal handler */
+static int linked = 0;		/* we linked scope.sample to a thread */
+
+static char names[16][HAL_NAME_LEN + 1];
+
+/***********************************************************************
+*                            LOCAL CODE                                *
+************************************************************************/
+
+static void quit(int sig)
+{
+    stop = 1;
+}
+
+static void wait_a_bit(void)
+{
+    struct timespec delay;
+
+    delay.tv_sec = 0;
+    delay.tv_nsec = 1000000;
+    nanosleep(&delay, NULL);
+}
+
+/* point channel 'n' at a pin, signal or parameter, mutex held */
+static int set_channel(int n, const char *name)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+    hal_type_t type;
+
+    if ((pin = halpr_find_pin_by_name(name)) != NULL) {
+	type = pin->type;
+	if (pin->signal == 0) {
+	    /* pin is unlinked, get data from dummysig */
+	    ctrl_shm->data_offset[n] = SHMOFF(&(pin->dummysig));
+	} else {
+	    sig = SHMPTR(pin->signal);
+	    ctrl_shm->data_offset[n] = sig->data_ptr;
+	}
+    } else if ((sig = halpr_find_sig_by_name(name)) != NULL) {
+	type = sig->type;
+	ctrl_shm->data_offset[n] = sig->data_ptr;
+    } else if ((param = halpr_find_param_by_name(name)) != NULL) {
+	type = param->type;
+	ctrl_shm->data_offset[n] = param->data_ptr;
+    } else {
+	fprintf(stderr, "ERROR: no pin, signal or parameter '%s'\n", name);
+	return -ENOENT;
+    }
+    ctrl_shm->data_type[n] = type;
+    switch (type) {
+    case HAL_BIT:
+	ctrl_shm->data_len[n] = sizeof(hal_bit_t);
+	break;
+    case HAL_FLOAT:
+	ctrl_shm->data_len[n] = sizeof(hal_float_t);
+	break;
+    case HAL_S32:
+	ctrl_shm->data_len[n] = sizeof(hal_s32_t);
+	break;
+    case HAL_U32:
+	ctrl_shm->data_len[n] = sizeof(hal_u32_t);
+	break;
+    default:
+	fprintf(stderr, "ERROR: '%s' has an unsupported type\n", name);
+	return -EINVAL;
+    }
+    return 0;
+}
+
+/* sample period in seconds, 0 if the thread is unknown */
+static double sample_period(int mult)
+{
+    hal_thread_t *thread;
+    double period = 0.0;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    thread = halpr_find_thread_by_name(ctrl_shm->thread_name);
+    if (thread != NULL) {
+	period = thread->period * 1e-9 * mult;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return period;
+}
+
+static void print_decimated(scope_stream_t *s, long long from, long long to,
+    int npix)
+{
+    double *min, *max;
+    int chan, i, level = 0;
+
+    min = malloc(s->nchan * npix * sizeof(double));
+    max = malloc(s->nchan * npix * sizeof(double));
+    if ((min == NULL) || (max == NULL)) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	goto out;
+    }
+    for (chan = 0; chan < s->nchan; chan++) {
+	level = scope_stream_minmax(s, chan, from, to, npix,
+	    min + chan * npix, max + chan * npix);
+	if (level < 0) {
+	    fprintf(stderr, "ERROR: range not stored: %s\n", strerror(-level));
+	    goto out;
+	}
+    }
+    printf("# %lld samples in %d columns, level %d\n", to - from, npix,
+	level);
+    for (i = 0; i < npix; i++) {
+	for (chan = 0; chan < s->nchan; chan++) {
+	    printf("%g %g ", min[chan * npix + i], max[chan * npix + i]);
+	}
+	printf("\n");
+    }
+out:
+    free(min);
+    free(max);
+}
+
+int main(int argc, char **argv)
+{
+    scope_stream_t s;
+    const scope_stream_rec_t *rec;
+    hal_type_t types[16];
+    char *thread = NULL, *cp;
+    char *outfile = NULL;
+    void *shm_base;
+    size_t size;
+    long long pre = 0, post = 10000, from, to;
+    __u32 seq = 0;
+    int opt, n, nchan, retval, mult = 1, npix = 0, exitval = 1;
+    int trig_chan = -1, trig_edge = 1;
+    double trig_level = 0.0;
+
+    while ((opt = getopt(argc, argv, "t:m:T:p:n:d:o:")) != -1) {
+	switch (opt) {
+	case 't':
+	    thread = optarg;
+	    break;
+	case 'm':
+	    mult = atoi(optarg);
+	    break;
+	case 'T':
+	    /* chan,level,rise|fall */
+	    trig_chan = strtol(optarg, &cp, 10) - 1;
+	    if (*cp == ',') {
+		trig_level = strtod(cp + 1, &cp);
+	    }
+	    if (*cp == ',') {
+		trig_edge = (strcmp(cp + 1, "fall") != 0);
+	    }
+	    break;
+	case 'p':
+	    pre = atoll(optarg);
+	    break;
+	case 'n':
+	    post = atoll(optarg);
+	    break;
+	case 'd':
+	    npix = atoi(optarg);
+	    break;
+	case 'o':
+	    outfile = optarg;
+	    break;
+	default:
+	    fprintf(stderr, "usage: halscope_stream [-t thread] [-m mult] "
+		"[-T chan,level,rise|fall] [-p pre] [-n post] [-d columns] "
+		"[-o file] name...\n");
+	    exit(1);
+	}
+    }
+    nchan = argc - optind;
+    if ((nchan < 1) || (nchan > 16) || (mult < 1) || (pre < 0) ||
+	(post < 1) || (trig_chan >= nchan)) {
+	fprintf(stderr, "ERROR: 1 to 16 channels, mult >= 1, post >= 1, "
+	    "trigger on one of the channels\n");
+	exit(1);
+    }
+
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+
+    comp_id = hal_init("halscope_stream");
+    if (comp_id < 0) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id);
+	goto out;
+    }
+    hal_ready(comp_id);
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    retval = (halpr_find_ring_by_name(SCOPE_STREAM_RING) != NULL);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (!retval) {
+	fprintf(stderr, "ERROR: no ring " SCOPE_STREAM_RING
+	    ", load scope_rt with stream_size=N\n");
+	goto out;
+    }
+    shm_id = rtapi_shmem_new(SCOPE_SHM_KEY, comp_id, 0);
+    if ((shm_id < 0) || (rtapi_shmem_getptr(shm_id, &shm_base, 0) < 0)) {
+	fprintf(stderr, "ERROR: failed to map scope shared memory\n");
+	goto out;
+    }
+    if (((scope_shm_control_t *) shm_base)->state != IDLE) {
+	fprintf(stderr, "ERROR: scope_rt is in use\n");
+	goto out;
+    }
+    ctrl_shm = shm_base;
+    retval = hal_ring_attach(SCOPE_STREAM_RING, &ring, NULL);
+    if (retval < 0) {
+	goto out;
+    }
+    if (ctrl_shm->thread_name[0] == '\0') {
+	if (thread == NULL) {
+	    fprintf(stderr, "ERROR: scope.sample is not linked, use -t\n");
+	    goto out;
+	}
+	if (hal_add_funct_to_thread("scope.sample", thread, -1) < 0) {
+	    goto out;
+	}
+	snprintf(ctrl_shm->thread_name, HAL_NAME_LEN, "%s", thread);
+	linked = 1;
+    }
+
+    /* configure the channels */
+    rtapi_mutex_get(&(hal_data->mutex));
+    for (n = 0; n < 16; n++) {
+	ctrl_shm->data_len[n] = 0;
+    }
+    retval = 0;
+    for (n = 0; (n < nchan) && (retval == 0); n++) {
+	snprintf(names[n], sizeof(names[n]), "%s", argv[optind + n]);
+	retval = set_channel(n, names[n]);
+	types[n] = ctrl_shm->data_type[n];
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval) {
+	goto out;
+    }
+    /* keep the trigger window and a bit of history at full resolution */
+    retval = scope_stream_init(&s, nchan, types,
+	(pre + post < 65536) ? 65536 : pre + post + 1, SCOPE_STREAM_LEVELS);
+    if (retval) {
+	fprintf(stderr, "ERROR: scope_stream_init: %s\n", strerror(-retval));
+	goto out;
+    }
+    record_flush(&ring);
+    ctrl_shm->mult = mult;
+    ctrl_shm->sample_len = nchan;
+    ctrl_shm->stream = 1;
+    ctrl_shm->state = INIT;
+
+    while (!stop) {
+	if ((trig_chan >= 0) && (s.trig.at >= 0) &&
+	    (s.samples >= s.trig.at + post)) {
+	    break;
+	}
+	if ((trig_chan < 0) && (s.samples >= post)) {
+	    break;
+	}
+	if (record_read(&ring, (const void **) &rec, &size)) {
+	    wait_a_bit();
+	    continue;
+	}
+	if (rec->seq != seq) {
+	    /* realtime side dropped samples on a full ring */
+	    scope_stream_gap(&s, (__u32) (rec->seq - seq));
+	}
+	seq = rec->seq + 1;
+	scope_stream_push(&s, rec->data);
+	record_shift(&ring);
+	/* arm the trigger once the pre-trigger samples are in */
+	if ((trig_chan >= 0) && (s.trig.chan < 0) && (s.samples >= pre)) {
+	    scope_stream_trigger(&s, trig_chan, trig_level, trig_edge);
+	}
+    }
+    ctrl_shm->state = RESET;
+
+    if ((trig_chan >= 0) && (s.trig.at >= 0)) {
+	from = s.trig.at - pre;
+	to = s.trig.at + post;
+    } else {
+	from = (s.samples > pre + post) ? s.samples - pre - post : 0;
+	to = s.samples;
+    }
+    if (to > s.samples) {
+	/* interrupted before the end of the window */
+	to = s.samples;
+    }
+    fprintf(stderr, "halscope_stream: %lld samples, %lld lost, trigger %lld\n",
+	s.samples, s.lost, s.trig.at);
+    exitval = 0;
+    if ((outfile != NULL) && (to > from)) {
+	retval = scope_stream_export(&s, outfile, from, to, names,
+	    sample_period(mult));
+	if (retval < 0) {
+	    fprintf(stderr, "ERROR: writing '%s': %s\n", outfile,
+		strerror(-retval));
+	    exitval = 1;
+	}
+    }
+    if ((npix > 0) && (to > from)) {
+	print_decimated(&s, from, to, npix);
+    }
+    scope_stream_free(&s);
+
+out:
+    if (ctrl_shm != NULL) {
+	/* give scope_rt a few periods to see RESET before unlinking */
+	for (n = 0; (n < 100) && (ctrl_shm->state != IDLE); n++) {
+	    wait_a_bit();
+	}
+	ctrl_shm->stream = 0;
+	if (linked) {
+	    hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
+	    ctrl_shm->thread_name[0] = '\0';
+	}
+    }
+    if (ringbuffer_attached(&ring)) {
+	hal_ring_detach(SCOPE_STREAM_RING, &ring);
+    }
+    if (shm_id >= 0) {
+	rtapi_shmem_delete(shm_id, comp_id);
+    }
+    if (comp_id >= 0) {
+	hal_exit(comp_id);
+    }
+    return exitval;
+}
@@ -36,6 +36,7 @@
 #include <rtapi_app.h>		/* RTAPI realtime module decls */
 #include <hal.h>		/* HAL public API decls */
 #include "hal_priv.h"	/* HAL private API decls */
+#include "hal_ring.h"		/* HAL ringbuffer decls */
 #include "scope_rt.h"		/* scope related declarations */
 #include "rtapi_string.h"
 
@@ -47,6 +48,8 @@ MODULE_LICENSE("GPL");
 long num_samples = 16000;
 long shm_size;
 RTAPI_MP_LONG(num_samples, "Number of samples in the shared memory block")
+long stream_size = 0;
+RTAPI_MP_LONG(stream_size, "Size of the '" SCOPE_STREAM_RING "' ring in bytes, 0 = none")
 
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
@@ -62,6 +65,7 @@ scope_shm_control_t *ctrl_shm;	/* ptr to shared mem control struct */
 static int comp_id;		/* component ID */
 static int shm_id;		/* shared memory ID */
 static scope_rt_control_t ctrl_struct;	/* realtime control structure */
+static ringbuffer_t stream_ring;	/* stream_size > 0: sample ring */
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
@@ -72,6 +76,8 @@ static void init_shm_control_struct(void);
 
 static void sample(void *arg, long period);
 static void capture_sample(void);
+static scope_data_t *capture_to(scope_data_t *dest);
+static void stream_sample(void);
 static int check_trigger(void);
 
 /***********************************************************************
@@ -112,6 +118,20 @@ int rtapi_app_main(void)
     ctrl_rt = &ctrl_struct;
     init_rt_control_struct(shm_base);
 
+    if (stream_size > 0) {
+	retval = hal_ring_new(SCOPE_STREAM_RING, stream_size, 0, 0);
+	if (retval == 0) {
+	    retval = hal_ring_attach(SCOPE_STREAM_RING, &stream_ring, NULL);
+	}
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE_RT: ERROR: failed to create ring " SCOPE_STREAM_RING "\n");
+	    rtapi_shmem_delete(shm_id, comp_id);
+	    hal_exit(comp_id);
+	    return -1;
+	}
+    }
+
     /* export scope data sampling function */
     retval = hal_export_funct("scope.sample", sample, NULL, 0, 0, comp_id);
     if (retval != 0) {
@@ -132,6 +152,10 @@ void rtapi_app_exit(void)
 	/* need to unlink it before we release the scope shared memory */
 	hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
     }
+    if (ringbuffer_attached(&stream_ring)) {
+	hal_ring_detach(SCOPE_STREAM_RING, &stream_ring);
+	hal_ring_delete(SCOPE_STREAM_RING);
+    }
     rtapi_shmem_delete(shm_id, comp_id);
     hal_exit(comp_id);
 }
@@ -180,7 +204,17 @@ static void sample(void *arg, long period)
 	    ctrl_rt->data_len[n] = ctrl_shm->data_len[n];
 	}
 	/* set next state */
-	ctrl_shm->state = PRE_TRIG;
+	if (ctrl_shm->stream && ringbuffer_attached(&stream_ring)) {
+	    ctrl_rt->stream_seq = 0;
+	    ctrl_shm->overruns = 0;
+	    ctrl_shm->state = STREAM;
+	} else {
+	    ctrl_shm->state = PRE_TRIG;
+	}
+	break;
+    case STREAM:
+	/* no trigger here, runs until the user sets RESET */
+	stream_sample();
 	break;
     case PRE_TRIG:
 	/* acquire a sample */
@@ -239,10 +273,42 @@ static void sample(void *arg, long period)
 
 static void capture_sample(void)
 {
-    scope_data_t *dest;
+    capture_to(&(ctrl_rt->buffer[ctrl_shm->curr]));
+    /* increment sample pointer */
+    ctrl_shm->curr += ctrl_shm->sample_len;
+    /* is there room in the buffer for another sample? */
+    if ((ctrl_shm->curr + ctrl_shm->sample_len) > ctrl_shm->buf_len) {
+	/* no, wrap back to beginning of buffer */
+	ctrl_shm->curr = 0;
+    }
+}
+
+static void stream_sample(void)
+{
+    scope_stream_rec_t *rec;
+    size_t size;
+
+    size = sizeof(scope_stream_rec_t) +
+	ctrl_shm->sample_len * sizeof(scope_data_t);
+    if (record_write_begin(&stream_ring, (void **) &rec, size)) {
+	/* ring full: drop this sample, the reader sees the gap */
+	ctrl_shm->overruns++;
+	ctrl_rt->stream_seq++;
+	return;
+    }
+    rec->seq = ctrl_rt->stream_seq++;
+    rec->pad = 0;
+    /* clear unused slots, fewer channels than sample_len may be on */
+    memset(rec->data, 0, ctrl_shm->sample_len * sizeof(scope_data_t));
+    capture_to(rec->data);
+    record_write_end(&stream_ring, rec, size);
+}
+
+/* store the enabled channels at 'dest', returns the next free slot */
+static scope_data_t *capture_to(scope_data_t *dest)
+{
     int n;
 
-    dest = &(ctrl_rt->buffer[ctrl_shm->curr]);
     /* loop through all channels to acquire data */
     for (n = 0; n < 16; n++) {
 	/* capture 1, 2, or 4 bytes, based on data size */
@@ -270,13 +336,7 @@ static void capture_sample(void)
 	    break;
 	}
     }
-    /* increment sample pointer */
-    ctrl_shm->curr += ctrl_shm->sample_len;
-    /* is there room in the buffer for another sample? */
-    if ((ctrl_shm->curr + ctrl_shm->sample_len) > ctrl_shm->buf_len) {
-	/* no, wrap back to beginning of buffer */
-	ctrl_shm->curr = 0;
-    }
+    return dest;
 }
 
 // TODO: type-independent way to get high bit
@@ -44,6 +44,12 @@
 
 #define SCOPE_NUM_SAMPLES_DEFAULT 16000
 
+/* with 'stream_size=N', scope_rt creates a record ring of N bytes
+   under this name. In the STREAM state every sample is written to it
+   as one scope_stream_rec_t; triggering, decimation and storage are
+   left to the reader (see scope_stream.h). */
+#define SCOPE_STREAM_RING "scope.stream"
+
 typedef enum {
     IDLE = 0,			/* waiting for run command */
     INIT,			/* run command received */
@@ -51,7 +57,8 @@ typedef enum {
     TRIG_WAIT,			/* waiting for trigger */
     POST_TRIG,			/* acquiring post-trigger data */
     DONE,			/* data acquisition complete */
-    RESET			/* data acquisition interrupted */
+    RESET,			/* data acquisition interrupted */
+    STREAM			/* streaming samples into the ring */
 } scope_state_t;
 
 /* this struct holds a single value - one sample of one channel */
@@ -91,6 +98,16 @@ typedef struct {
     int data_offset[16];	/* U data addr in shmem for each channel */
     hal_type_t data_type[16];	/* U data type for each channel */
     char data_len[16];		/* U data size, 0 if not to be acquired */
+    int stream;			/* U INIT leads to STREAM, not PRE_TRIG */
+    int overruns;		/* R samples dropped, stream ring full */
 } scope_shm_control_t;
 
+/* one streamed sample: the values of the channels with a non-zero
+   data_len, in channel order */
+typedef struct {
+    __u32 seq;			/* sample number, gaps mean overruns */
+    __u32 pad;
+    scope_data_t data[];
+} scope_stream_rec_t;
+
 #endif /* HALSC_SHM_H */
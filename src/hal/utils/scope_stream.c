@@ -0,0 +1,390 @@
+/** This file, 'scope_stream.c', implements the user space pipeline
+    for samples streamed by 'scope_rt', see 'scope_stream.h'.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "scope_stream.h"
+
+/***********************************************************************
+*                   LOCAL FUNCTION DEFINITIONS                         *
+************************************************************************/
+
+static double to_double(hal_type_t type, const scope_data_t *d)
+{
+    switch (type) {
+    case HAL_BIT:
+	return d->d_u8 ? 1.0 : 0.0;
+    case HAL_FLOAT:
+	return d->d_real;
+    case HAL_S32:
+	return d->d_s32;
+    case HAL_U32:
+	return d->d_u32;
+    default:
+	return 0.0;
+    }
+}
+
+static long long bucket_len(int l)
+{
+    long long n = 1;
+
+    while (l-- > 0) {
+	n *= SCOPE_STREAM_FACTOR;
+    }
+    return n;
+}
+
+static void merge(scope_minmax_t *dst, const scope_minmax_t *src)
+{
+    if (src->min < dst->min) {
+	dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+	dst->max = src->max;
+    }
+}
+
+/* feed one summary of the level below into level 'l' */
+static void level_add(scope_stream_t *s, int l, const scope_minmax_t *v)
+{
+    scope_level_t *lv = &(s->level[l]);
+    int n;
+
+    if (lv->fill == 0) {
+	memcpy(lv->acc, v, s->nchan * sizeof(scope_minmax_t));
+    } else {
+	for (n = 0; n < s->nchan; n++) {
+	    merge(&(lv->acc[n]), &(v[n]));
+	}
+    }
+    if (++lv->fill < SCOPE_STREAM_FACTOR) {
+	return;
+    }
+    /* bucket complete, store and pass it up */
+    memcpy(&(lv->mm[(lv->count % s->cap) * s->nchan]), lv->acc,
+	s->nchan * sizeof(scope_minmax_t));
+    lv->count++;
+    lv->fill = 0;
+    if (l + 1 < s->levels) {
+	level_add(s, l + 1, lv->acc);
+    }
+}
+
+static int raw_stored(scope_stream_t *s, long long n)
+{
+    return (n >= 0) && (n < s->samples) && (n >= s->samples - s->cap);
+}
+
+static int bucket_stored(scope_stream_t *s, int l, long long b)
+{
+    scope_level_t *lv = &(s->level[l]);
+
+    return (b >= 0) && (b < lv->count) && (b >= lv->count - s->cap);
+}
+
+/* min/max over [a, b) using level 'l' for whole buckets and the
+   levels below for the partial buckets at either end */
+static int reduce(scope_stream_t *s, int chan, int l, long long a,
+    long long b, scope_minmax_t *r)
+{
+    long long len, fb, lb, n;
+    scope_minmax_t *mm;
+
+    if (a >= b) {
+	return 0;
+    }
+    if (l == 0) {
+	if (!raw_stored(s, a) || !raw_stored(s, b - 1)) {
+	    return -ENOENT;
+	}
+	for (n = a; n < b; n++) {
+	    double v = scope_stream_value(s, chan, n);
+	    if (v < r->min) {
+		r->min = v;
+	    }
+	    if (v > r->max) {
+		r->max = v;
+	    }
+	}
+	return 0;
+    }
+    len = bucket_len(l);
+    fb = (a + len - 1) / len;
+    lb = b / len;
+    if (lb > s->level[l].count) {
+	lb = s->level[l].count;
+    }
+    if ((fb >= lb) || !bucket_stored(s, l, fb)) {
+	/* no whole bucket in range */
+	if (reduce(s, chan, l - 1, a, b, r) == 0) {
+	    return 0;
+	}
+	/* finer levels are gone, widen to the enclosing bucket */
+	if (!bucket_stored(s, l, a / len)) {
+	    return -ENOENT;
+	}
+	merge(r, &(s->level[l].mm[((a / len) % s->cap) * s->nchan + chan]));
+	return 0;
+    }
+    /* partial buckets: finer levels, else widen to the whole bucket */
+    if (reduce(s, chan, l - 1, a, fb * len, r) < 0) {
+	if (!bucket_stored(s, l, fb - 1)) {
+	    return -ENOENT;
+	}
+	merge(r, &(s->level[l].mm[((fb - 1) % s->cap) * s->nchan + chan]));
+    }
+    for (n = fb; n < lb; n++) {
+	mm = &(s->level[l].mm[(n % s->cap) * s->nchan + chan]);
+	merge(r, mm);
+    }
+    if (reduce(s, chan, l - 1, lb * len, b, r) < 0) {
+	if (!bucket_stored(s, l, lb)) {
+	    return -ENOENT;
+	}
+	merge(r, &(s->level[l].mm[(lb % s->cap) * s->nchan + chan]));
+    }
+    return 0;
+}
+
+/***********************************************************************
+*                       PUBLIC FUNCTIONS                               *
+************************************************************************/
+
+int scope_stream_init(scope_stream_t *s, int nchan, const hal_type_t *type,
+    int cap, int levels)
+{
+    int l;
+
+    if ((nchan < 1) || (nchan > 16) || (cap < 1) ||
+	(levels < 1) || (levels > SCOPE_STREAM_LEVELS)) {
+	return -EINVAL;
+    }
+    memset(s, 0, sizeof(*s));
+    s->nchan = nchan;
+    memcpy(s->type, type, nchan * sizeof(hal_type_t));
+    s->cap = cap;
+    s->levels = levels;
+    s->trig.chan = -1;
+    s->trig.at = -1;
+    s->raw = malloc(cap * nchan * sizeof(double));
+    if (s->raw == NULL) {
+	return -ENOMEM;
+    }
+    for (l = 1; l < levels; l++) {
+	s->level[l].mm = malloc(cap * nchan * sizeof(scope_minmax_t));
+	s->level[l].acc = malloc(nchan * sizeof(scope_minmax_t));
+	if ((s->level[l].mm == NULL) || (s->level[l].acc == NULL)) {
+	    scope_stream_free(s);
+	    return -ENOMEM;
+	}
+    }
+    return 0;
+}
+
+void scope_stream_free(scope_stream_t *s)
+{
+    int l;
+
+    free(s->raw);
+    s->raw = NULL;
+    for (l = 1; l < SCOPE_STREAM_LEVELS; l++) {
+	free(s->level[l].mm);
+	free(s->level[l].acc);
+	s->level[l].mm = NULL;
+	s->level[l].acc = NULL;
+    }
+}
+
+void scope_stream_trigger(scope_stream_t *s, int chan, double level, int edge)
+{
+    s->trig.chan = ((chan >= 0) && (chan < s->nchan)) ? chan : -1;
+    s->trig.level = level;
+    s->trig.edge = edge;
+    s->trig.compare = -1;
+    s->trig.at = -1;
+}
+
+static void push_values(scope_stream_t *s, const double *v)
+{
+    scope_minmax_t mm[16];
+    scope_stream_trig_t *t = &(s->trig);
+    int n, compare;
+
+    memcpy(&(s->raw[(s->samples % s->cap) * s->nchan]), v,
+	s->nchan * sizeof(double));
+    if ((t->chan >= 0) && (t->at < 0)) {
+	/* for bits, the trigger level is ignored */
+	if (s->type[t->chan] == HAL_BIT) {
+	    compare = (v[t->chan] != 0.0);
+	} else {
+	    compare = (v[t->chan] > t->level);
+	}
+	if ((t->compare >= 0) && (compare != t->compare) &&
+	    (compare == t->edge)) {
+	    t->at = s->samples;
+	}
+	t->compare = compare;
+    }
+    s->samples++;
+    if (s->levels > 1) {
+	for (n = 0; n < s->nchan; n++) {
+	    mm[n].min = mm[n].max = v[n];
+	}
+	level_add(s, 1, mm);
+    }
+}
+
+void scope_stream_push(scope_stream_t *s, const scope_data_t *data)
+{
+    double v[16];
+    int n;
+
+    for (n = 0; n < s->nchan; n++) {
+	v[n] = to_double(s->type[n], &(data[n]));
+    }
+    push_values(s, v);
+}
+
+void scope_stream_gap(scope_stream_t *s, long long n)
+{
+    double v[16];
+
+    if (s->samples == 0) {
+	memset(v, 0, sizeof(v));
+    } else {
+	memcpy(v, &(s->raw[((s->samples - 1) % s->cap) * s->nchan]),
+	    s->nchan * sizeof(double));
+    }
+    s->lost += n;
+    while (n-- > 0) {
+	push_values(s, v);
+    }
+}
+
+double scope_stream_value(scope_stream_t *s, int chan, long long n)
+{
+    return s->raw[(n % s->cap) * s->nchan + chan];
+}
+
+long long scope_stream_oldest(scope_stream_t *s, int l)
+{
+    long long oldest;
+
+    if (l == 0) {
+	oldest = s->samples - s->cap;
+    } else {
+	oldest = (s->level[l].count - s->cap) * bucket_len(l);
+    }
+    return (oldest < 0) ? 0 : oldest;
+}
+
+int scope_stream_minmax(scope_stream_t *s, int chan, long long from,
+    long long to, int npix, double *min, double *max)
+{
+    long long p0, p1, span;
+    scope_minmax_t r;
+    int l, i, retval;
+
+    if ((chan < 0) || (chan >= s->nchan) || (npix < 1) || (from >= to)) {
+	return -EINVAL;
+    }
+    /* coarsest level with at least one bucket per column */
+    span = to - from;
+    l = 0;
+    while ((l + 1 < s->levels) && (bucket_len(l + 1) * npix <= span)) {
+	l++;
+    }
+    for (i = 0; i < npix; i++) {
+	p0 = from + span * i / npix;
+	p1 = from + span * (i + 1) / npix;
+	if (p1 <= p0) {
+	    p1 = p0 + 1;
+	}
+	r.min = 1e300;
+	r.max = -1e300;
+	retval = reduce(s, chan, l, p0, p1, &r);
+	if (retval < 0) {
+	    return retval;
+	}
+	min[i] = r.min;
+	max[i] = r.max;
+    }
+    return l;
+}
+
+int scope_stream_export(scope_stream_t *s, const char *filename,
+    long long from, long long to, char names[][HAL_NAME_LEN + 1],
+    double period)
+{
+    scope_export_hdr_t hdr;
+    double buf[1024];
+    long long n;
+    int chan, k;
+    FILE *fp;
+
+    if ((from >= to) || !raw_stored(s, from) || !raw_stored(s, to - 1)) {
+	return -ENOENT;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SCOPE_EXPORT_MAGIC, sizeof(hdr.magic));
+    hdr.version = SCOPE_EXPORT_VERSION;
+    hdr.hdr_size = sizeof(hdr);
+    hdr.nchan = s->nchan;
+    hdr.first = from;
+    hdr.rows = to - from;
+    hdr.trigger = s->trig.at;
+    hdr.period = period;
+    for (chan = 0; chan < s->nchan; chan++) {
+	hdr.type[chan] = s->type[chan];
+	strncpy(hdr.name[chan], names[chan], HAL_NAME_LEN);
+    }
+    fp = fopen(filename, "wb");
+    if (fp == NULL) {
+	return -errno;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+	goto fail;
+    }
+    /* one column per channel, so a channel can be read in one go */
+    for (chan = 0; chan < s->nchan; chan++) {
+	k = 0;
+	for (n = from; n < to; n++) {
+	    buf[k++] = scope_stream_value(s, chan, n);
+	    if ((k == 1024) || (n == to - 1)) {
+		if (fwrite(buf, sizeof(double), k, fp) != (size_t)k) {
+		    goto fail;
+		}
+		k = 0;
+	    }
+	}
+    }
+    if (fclose(fp) != 0) {
+	return -errno;
+    }
+    return 0;
+
+fail:
+    k = -errno;
+    fclose(fp);
+    return k;
+}
@@ -0,0 +1,124 @@
+#ifndef SCOPE_STREAM_H
+#define SCOPE_STREAM_H
+/** This file, 'scope_stream.h', declares the user space pipeline
+    for samples streamed by 'scope_rt' through the 'scope.stream'
+    ring (see scope_shm.h).  Unlike the single shot capture buffer,
+    the stream runs continuously, so history length is limited only
+    by what the reader keeps:
+
+    - level 0 keeps the most recent 'cap' samples at full resolution.
+    - level n (n > 0) keeps 'cap' min/max buckets, each summarizing
+      SCOPE_STREAM_FACTOR^n samples.  Zooming out to long histories
+      reads a coarse level instead of millions of raw samples.
+    - triggers are evaluated on every pushed sample in user space,
+      with the same level/edge semantics as the realtime trigger.
+    - a window of level 0 can be exported as a columnar binary file.
+
+    No GTK and no HAL calls, so the pipeline can be used by any
+    reader of the ring.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "scope_shm.h"
+
+#define SCOPE_STREAM_FACTOR  8	/* samples per bucket, per level */
+#define SCOPE_STREAM_LEVELS  8	/* 8^7 = 2M samples per top bucket */
+
+#define SCOPE_EXPORT_MAGIC   "HALSCOPE"
+#define SCOPE_EXPORT_VERSION 1
+
+typedef struct {
+    double min, max;
+} scope_minmax_t;
+
+typedef struct {
+    long long count;		/* buckets completed so far */
+    int fill;			/* samples in the open bucket */
+    scope_minmax_t *mm;		/* cap * nchan, circular */
+    scope_minmax_t *acc;	/* nchan, the open bucket */
+} scope_level_t;
+
+typedef struct {
+    int chan;			/* trigger channel, -1 = no trigger */
+    double level;		/* trigger level, ignored for bits */
+    int edge;			/* 0 = falling edge, 1 = rising edge */
+    int compare;		/* previous compare result */
+    long long at;		/* trigger sample, -1 = not yet */
+} scope_stream_trig_t;
+
+typedef struct {
+    int nchan;
+    hal_type_t type[16];
+    int cap;			/* samples or buckets kept per level */
+    int levels;
+    long long samples;		/* samples pushed */
+    long long lost;		/* samples reported as gaps */
+    double *raw;		/* level 0, cap * nchan, circular */
+    scope_level_t level[SCOPE_STREAM_LEVELS];
+    scope_stream_trig_t trig;
+} scope_stream_t;
+
+/* layout of an exported file: this header, then 'nchan' columns of
+   'rows' doubles each, in channel order */
+typedef struct {
+    char magic[8];		/* SCOPE_EXPORT_MAGIC, not terminated */
+    __u32 version;
+    __u32 hdr_size;		/* offset of the first column */
+    __u32 nchan;
+    __u32 pad;
+    __s64 first;		/* sample number of row 0 */
+    __s64 rows;
+    __s64 trigger;		/* sample number of the trigger, or -1 */
+    double period;		/* seconds between samples, 0 = unknown */
+    __u32 type[16];
+    char name[16][HAL_NAME_LEN + 1];
+} scope_export_hdr_t;
+
+/* 'cap' samples at full resolution, plus 'levels' - 1 decimated
+   levels. Returns 0 or -errno */
+extern int scope_stream_init(scope_stream_t *s, int nchan,
+			     const hal_type_t *type, int cap, int levels);
+extern void scope_stream_free(scope_stream_t *s);
+
+/* arm the trigger on 'chan', -1 disarms */
+extern void scope_stream_trigger(scope_stream_t *s, int chan,
+				 double level, int edge);
+
+/* append one sample of 'nchan' values as captured by scope_rt */
+extern void scope_stream_push(scope_stream_t *s, const scope_data_t *data);
+
+/* account for 'n' samples dropped by the realtime side; the last
+   sample is repeated so sample numbers stay aligned with time */
+extern void scope_stream_gap(scope_stream_t *s, long long n);
+
+/* value of 'chan' at sample 'n', which must still be in level 0 */
+extern double scope_stream_value(scope_stream_t *s, int chan, long long n);
+
+/* oldest sample number still kept at level 'l' */
+extern long long scope_stream_oldest(scope_stream_t *s, int l);
+
+/* min/max of 'chan' over samples [from, to) in 'npix' columns, for
+   display. Uses the coarsest level that still resolves a column.
+   Returns the level used, or -ENOENT if the range is not stored */
+extern int scope_stream_minmax(scope_stream_t *s, int chan,
+			       long long from, long long to, int npix,
+			       double *min, double *max);
+
+/* write samples [from, to) as a columnar file, returns 0 or -errno */
+extern int scope_stream_export(scope_stream_t *s, const char *filename,
+			       long long from, long long to,
+			       char names[][HAL_NAME_LEN + 1], double period);
+
+#endif /* SCOPE_STREAM_H */
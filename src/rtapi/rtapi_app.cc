@@ -62,6 +62,10 @@
 #include <syslog_async.h>
 #include <limits.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 #include <inifile.h>
 
 #include <czmq.h>
@@ -536,6 +540,143 @@ static int do_callfunc_cmd(int instance,
 
 
 
+// parallel module loading
+//
+// when a MT_RTAPI_APP_BATCH request contains several loadrt commands,
+// the module objects are read and dlopen'ed by a pool of worker threads
+// before the batch is executed. Module parameters and rtapi_app_main()
+// are still handled serially on the main thread in batch order, so HAL
+// registration order is unchanged.
+//
+// glibc serializes the link step of concurrent dlopen() calls, so the
+// gain is mostly from overlapping the file I/O, which dominates on
+// boards booting from SD cards. A module which fails to dlopen() in a
+// worker - for instance because it needs symbols from a module later
+// in the same batch - is retried, and any error reported, by do_load_cmd().
+
+#define MAX_PRELOAD_THREADS 8
+
+struct preload_t {
+    void *handle;
+    double t_read;     // msec reading the object file
+    double t_dlopen;   // msec in dlopen()
+};
+
+// dlopen'ed by preload_modules(), rtapi_app_main() not called yet
+static std::map<string, preload_t> preloaded;
+
+struct preload_job_t {
+    string name;
+    preload_t result;
+};
+
+struct preload_ctx_t {
+    std::vector<preload_job_t> jobs;
+    int next;
+};
+
+static double msec_since(const struct timespec &start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 +
+	(now.tv_nsec - start.tv_nsec) * 1e-6;
+}
+
+// pull the module object into the page cache
+static void prefetch_module(const string &name)
+{
+    char path[PATH_MAX];
+    struct stat sb;
+
+    if (get_rtapi_config(path, "RTLIB_DIR", PATH_MAX) != 0)
+	return;
+    string fname = string(path) + "/" + flavor->name + "/" + name + flavor->mod_ext;
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+	return; // dlopen() will search the rpath
+    if (fstat(fd, &sb) == 0)
+	readahead(fd, 0, sb.st_size);
+    close(fd);
+}
+
+static void *preload_worker(void *arg)
+{
+    preload_ctx_t *ctx = (preload_ctx_t *) arg;
+    int i;
+
+    while ((i = __sync_fetch_and_add(&ctx->next, 1)) < (int) ctx->jobs.size()) {
+	preload_job_t &job = ctx->jobs[i];
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	prefetch_module(job.name);
+	job.result.t_read = msec_since(start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	job.result.handle = dlopen((job.name + flavor->mod_ext).c_str(),
+				   RTLD_GLOBAL|RTLD_NOW);
+	job.result.t_dlopen = msec_since(start);
+    }
+    return NULL;
+}
+
+static void preload_modules(const std::vector<string> &names)
+{
+    preload_ctx_t ctx;
+    pthread_t tids[MAX_PRELOAD_THREADS];
+    struct timespec start;
+    int nthreads, started = 0;
+
+    if (kernel_threads(flavor) || (names.size() < 2))
+	return;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ctx.next = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+	preload_job_t job;
+	job.name = names[i];
+	job.result.handle = NULL;
+	job.result.t_read = job.result.t_dlopen = 0.0;
+	ctx.jobs.push_back(job);
+    }
+    nthreads = std::min((int) names.size(), MAX_PRELOAD_THREADS);
+    nthreads = std::min(nthreads, (int) sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (int i = 0; i < nthreads; i++) {
+	if (pthread_create(&tids[i], NULL, preload_worker, &ctx))
+	    break;
+	started++;
+    }
+    // if no thread could be started, do the work here
+    if (!started)
+	preload_worker(&ctx);
+    for (int i = 0; i < started; i++)
+	pthread_join(tids[i], NULL);
+
+    int n = 0;
+    for (size_t i = 0; i < ctx.jobs.size(); i++) {
+	if (ctx.jobs[i].result.handle == NULL) {
+	    dlerror(); // retried and reported by do_load_cmd()
+	    continue;
+	}
+	preloaded[ctx.jobs[i].name] = ctx.jobs[i].result;
+	n++;
+    }
+    rtapi_print_msg(RTAPI_MSG_DBG, "preloaded %d/%zu modules in %.1fms using %d threads\n",
+		    n, names.size(), msec_since(start), started);
+}
+
+// drop modules preloaded but not started, e.g. after a failed batch
+static void discard_preloaded(void)
+{
+    std::map<string, preload_t>::iterator it;
+
+    for (it = preloaded.begin(); it != preloaded.end(); it++)
+	dlclose(it->second.handle);
+    preloaded.clear();
+}
+
 static int do_load_cmd(int instance,
 		       string name,
 		       pbstringarray_t args,
@@ -558,9 +699,24 @@ static int do_load_cmd(int instance,
 	    }
 	    return retval;
 	} else {
+	    struct timespec start;
+	    double t_read = 0.0, t_dlopen, t_args, t_main;
+	    bool parallel = false;
+	    std::map<string, preload_t>::iterator pre = preloaded.find(name);
+
 	    strncpy(module_name, (name + flavor->mod_ext).c_str(),
 		    PATH_MAX);
-	    module = modules[name] = dlopen(module_name, RTLD_GLOBAL |RTLD_NOW);
+	    if (pre != preloaded.end()) {
+		module = modules[name] = pre->second.handle;
+		t_read = pre->second.t_read;
+		t_dlopen = pre->second.t_dlopen;
+		parallel = true;
+		preloaded.erase(pre);
+	    } else {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		module = modules[name] = dlopen(module_name, RTLD_GLOBAL |RTLD_NOW);
+		t_dlopen = msec_since(start);
+	    }
 	    if (!module) {
 		string errmsg(dlerror());
 
@@ -596,12 +752,17 @@ static int do_load_cmd(int instance,
 	    }
 	    int result;
 
+	    clock_gettime(CLOCK_MONOTONIC, &start);
 	    result = do_module_args(module, args, RTAPI_MP_SYMPREFIX, pbreply);
 	    if(result < 0) { dlclose(module); return -1; }
+	    t_args = msec_since(start);
 
 	    // need to call rtapi_app_main with as root
 	    // RT thread creation and hardening requires this
-	    if ((result = start()) < 0) {
+	    clock_gettime(CLOCK_MONOTONIC, &start);
+	    result = start();
+	    t_main = msec_since(start);
+	    if (result < 0) {
 		note_printf(pbreply, "rtapi_app_main(%s): %d %s\n",
 			    name.c_str(), result, strerror(-result));
 		modules.erase(modules.find(name));
@@ -611,6 +772,11 @@ static int do_load_cmd(int instance,
 
 	    rtapi_print_msg(RTAPI_MSG_DBG, "%s: loaded from %s\n",
 			    name.c_str(), module_name);
+	    rtapi_print_msg(RTAPI_MSG_INFO,
+			    "%s: startup read=%.1fms dlopen=%.1fms args=%.1fms"
+			    " rtapi_app_main=%.1fms%s\n",
+			    name.c_str(), t_read, t_dlopen, t_args, t_main,
+			    parallel ? " (preloaded)" : "");
 	    return 0;
 	}
     } else {
@@ -787,31 +953,12 @@ static int attach_global_segment()
 }
 
 
-// handle commands from zmq socket
-static int rtapi_request(zloop_t *loop, zmq_pollitem_t *poller, void *arg)
+// execute a single request, filling in pbreply
+// returns -1 on an unknown command type
+static int dispatch_request(const pb::Container &pbreq,
+			    pb::Container &pbreply,
+			    bool &force_exit)
 {
-    zmsg_t *r = zmsg_recv(poller->socket);
-    char *origin = zmsg_popstr (r);
-    zframe_t *request_frame  = zmsg_pop (r);
-    static bool force_exit = false;
-
-    pb::Container pbreq, pbreply;
-
-    if (!pbreq.ParseFromArray(zframe_data(request_frame),
-			      zframe_size(request_frame))) {
-	rtapi_print_msg(RTAPI_MSG_ERR, "cant decode request from %s (size %zu)",
-			origin ? origin : "NULL",
-			zframe_size(request_frame));
-	zmsg_destroy(&r);
-	return 0;
-    }
-    if (debug) {
-	string buffer;
-	if (TextFormat::PrintToString(pbreq, &buffer)) {
-	    fprintf(stderr, "request: %s\n",buffer.c_str());
-	}
-    }
-
     pbreply.set_type(pb::MT_RTAPI_APP_REPLY);
 
     switch (pbreq.type()) {
@@ -982,20 +1129,108 @@ static int rtapi_request(zloop_t *loop, zmq_pollitem_t *poller, void *arg)
 	}
 	break;
 
+    case pb::MT_RTAPI_APP_BATCH:
+	// execute the batched commands in order, stop at the first failure
+	// each element's retcode and notes are returned in reply.rtapibatch
+	pbreply.set_retcode(0);
+	{
+	    // read and link the modules to be loaded in parallel
+	    std::vector<string> load;
+	    for (int i = 0; i < pbreq.rtapibatch_size(); i++) {
+		const pb::RTAPICommand &cmd = pbreq.rtapibatch(i);
+		if ((cmd.type() != pb::MT_RTAPI_APP_LOADRT) || !cmd.has_modname())
+		    continue;
+		std::map<string, void*>::iterator m = modules.find(cmd.modname());
+		if (((m == modules.end()) || (m->second == NULL)) &&
+		    (std::find(load.begin(), load.end(), cmd.modname()) == load.end()))
+		    load.push_back(cmd.modname());
+	    }
+	    preload_modules(load);
+	}
+	for (int i = 0; i < pbreq.rtapibatch_size(); i++) {
+	    const pb::RTAPICommand &cmd = pbreq.rtapibatch(i);
+	    pb::Container subreq, subreply;
+
+	    if (!cmd.has_type() || (cmd.type() == pb::MT_RTAPI_APP_BATCH) ||
+		(cmd.type() == pb::MT_RTAPI_APP_EXIT)) {
+		note_printf(pbreply, "batch element %d: invalid command type", i);
+		pbreply.set_retcode(-EINVAL);
+		break;
+	    }
+	    subreq.set_type(cmd.type());
+	    subreq.mutable_rtapicmd()->CopyFrom(cmd);
+	    subreq.mutable_rtapicmd()->clear_type();
+
+	    if (dispatch_request(subreq, subreply, force_exit) < 0) {
+		note_printf(pbreply, "batch element %d: unkown command type %d",
+			    i, (int) cmd.type());
+		pbreply.set_retcode(-EINVAL);
+		break;
+	    }
+	    pb::RTAPICommand *result = pbreply.add_rtapibatch();
+	    result->set_instance(cmd.instance());
+	    result->set_type(cmd.type());
+	    result->set_retcode(subreply.retcode());
+	    result->mutable_note()->CopyFrom(subreply.note());
+
+	    if (subreply.retcode()) {
+		pbreply.set_retcode(subreply.retcode());
+		break;
+	    }
+	}
+	discard_preloaded();
+	break;
+
     default:
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"unkown command type %d)",
 			(int) pbreq.type());
+	return -1;
+    }
+    return 0;
+}
+
+// handle commands from zmq socket
+static int rtapi_request(zloop_t *loop, zmq_pollitem_t *poller, void *arg)
+{
+    zmsg_t *r = zmsg_recv(poller->socket);
+    char *origin = zmsg_popstr (r);
+    zframe_t *request_frame  = zmsg_pop (r);
+    static bool force_exit = false;
+
+    pb::Container pbreq, pbreply;
+
+    if (!pbreq.ParseFromArray(zframe_data(request_frame),
+			      zframe_size(request_frame))) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "cant decode request from %s (size %zu)",
+			origin ? origin : "NULL",
+			zframe_size(request_frame));
 	zmsg_destroy(&r);
 	return 0;
+    }
+    if (debug) {
+	string buffer;
+	if (TextFormat::PrintToString(pbreq, &buffer)) {
+	    fprintf(stderr, "request: %s\n",buffer.c_str());
+	}
+    }
 
-
+    if (dispatch_request(pbreq, pbreply, force_exit) < 0) {
+	zmsg_destroy(&r);
+	return 0;
     }
+
     // log accumulated notes
     for (int i = 0; i < pbreply.note_size(); i++) {
 	rtapi_print_msg(pbreply.retcode() ? RTAPI_MSG_ERR : RTAPI_MSG_DBG,
 			pbreply.note(i).c_str());
     }
+    for (int i = 0; i < pbreply.rtapibatch_size(); i++) {
+	const pb::RTAPICommand &result = pbreply.rtapibatch(i);
+	for (int j = 0; j < result.note_size(); j++)
+	    rtapi_print_msg(result.retcode() ? RTAPI_MSG_ERR : RTAPI_MSG_DBG,
+			    result.note(j).c_str());
+    }
 
     // TODO: extract + attach error message
 
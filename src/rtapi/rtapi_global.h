@@ -116,7 +116,7 @@ typedef struct {
 
 } global_data_t;
 
-#define GLOBAL_LAYOUT_VERSION 42   // bump on layout changes of global_data_t
+#define GLOBAL_LAYOUT_VERSION 43   // bump on layout changes of global_data_t
 
 // use global_data->magic to reflect rtapi_msgd state
 #define GLOBAL_INITIALIZING  0x0eadbeefU
@@ -22,16 +22,178 @@
 #include "rtapi_export.h"
 #include "rtapi_bitops.h"
 
-// this is straight from the malloc code in:
-// K&R The C Programming Language, Edition 2, pages 185-189
-// adapted to use offsets relative to the heap descriptor
+// a TLSF (two-level segregated fit) allocator, see rtapi_heap_private.h
+// all links are offsets relative to the heap descriptor
 // so it can be used in as a shared memory resident malloc
+//
+// rtapi_malloc() and rtapi_free() execute in bounded time: no list is
+// walked, the suitable free list is found through two bitmap lookups.
+// This makes the heap usable from RT threads, provided contention
+// on the heap mutex is kept low.
 
 // scoped lock helper
 static void malloc_autorelease_mutex(rtapi_atomic_type **mutex) {
     rtapi_mutex_give(*mutex);
 }
 
+// bit scan helpers - index of least/most significant set bit
+static inline int heap_ffs(unsigned word)
+{
+    return __builtin_ffs(word) - 1;
+}
+
+static inline int heap_fls(size_t size)
+{
+    return (int) (sizeof(unsigned long) * RTAPI_CHAR_BIT) - 1 -
+	__builtin_clzl((unsigned long) size);
+}
+
+static inline rtapi_malloc_hdr_t *block_hdr(struct rtapi_heap *h, size_t b)
+{
+    return heap_ptr(h, b);
+}
+
+static inline struct rtapi_free_links *block_links(struct rtapi_heap *h, size_t b)
+{
+    return heap_ptr(h, b + RTAPI_HEAP_HDR_SIZE);
+}
+
+static inline size_t block_size(struct rtapi_heap *h, size_t b)
+{
+    return block_hdr(h, b)->s.size & ~((size_t) RTAPI_HEAP_FLAGS);
+}
+
+static inline void block_set_size(struct rtapi_heap *h, size_t b, size_t size)
+{
+    rtapi_malloc_hdr_t *hdr = block_hdr(h, b);
+    hdr->s.size = size | (hdr->s.size & RTAPI_HEAP_FLAGS);
+}
+
+static inline size_t block_next(struct rtapi_heap *h, size_t b)
+{
+    return b + RTAPI_HEAP_HDR_SIZE + block_size(h, b);
+}
+
+static inline void block_set_flag(struct rtapi_heap *h, size_t b, size_t flag, int on)
+{
+    rtapi_malloc_hdr_t *hdr = block_hdr(h, b);
+    if (on)
+	hdr->s.size |= flag;
+    else
+	hdr->s.size &= ~flag;
+}
+
+static inline int block_test_flag(struct rtapi_heap *h, size_t b, size_t flag)
+{
+    return (block_hdr(h, b)->s.size & flag) != 0;
+}
+
+// mark a block free/used and tell the physically next block
+static void block_mark(struct rtapi_heap *h, size_t b, int free)
+{
+    size_t next = block_next(h, b);
+    block_set_flag(h, b, RTAPI_HEAP_BLOCK_FREE, free);
+    block_set_flag(h, next, RTAPI_HEAP_PREV_FREE, free);
+    if (free)
+	block_hdr(h, next)->s.prev_phys = b;
+}
+
+// map a block size to its free list
+static void mapping_insert(size_t size, int *fli, int *sli)
+{
+    int fl, sl;
+    if (size < RTAPI_HEAP_SMALL_BLOCK) {
+	fl = 0;
+	sl = (int) size / (RTAPI_HEAP_SMALL_BLOCK / RTAPI_HEAP_SL_COUNT);
+    } else {
+	fl = heap_fls(size);
+	sl = (int) (size >> (fl - RTAPI_HEAP_SL_LOG2)) ^ RTAPI_HEAP_SL_COUNT;
+	fl -= (RTAPI_HEAP_FL_SHIFT - 1);
+    }
+    *fli = fl;
+    *sli = sl;
+}
+
+// map a request size to the first list whose blocks all satisfy it
+static void mapping_search(size_t size, int *fli, int *sli)
+{
+    if (size >= RTAPI_HEAP_SMALL_BLOCK) {
+	size_t round = (((size_t) 1) << (heap_fls(size) - RTAPI_HEAP_SL_LOG2)) - 1;
+	size += round;
+    }
+    mapping_insert(size, fli, sli);
+}
+
+static void remove_free_block(struct rtapi_heap *h, size_t b, int fl, int sl)
+{
+    struct rtapi_free_links *l = block_links(h, b);
+
+    if (l->next_free)
+	block_links(h, l->next_free)->prev_free = l->prev_free;
+    if (l->prev_free)
+	block_links(h, l->prev_free)->next_free = l->next_free;
+
+    if (h->blocks[fl][sl] == b) {
+	h->blocks[fl][sl] = l->next_free;
+	if (l->next_free == 0) {
+	    h->sl_bitmap[fl] &= ~(1U << sl);
+	    if (h->sl_bitmap[fl] == 0)
+		h->fl_bitmap &= ~(1U << fl);
+	}
+    }
+}
+
+static void insert_free_block(struct rtapi_heap *h, size_t b)
+{
+    int fl, sl;
+    struct rtapi_free_links *l = block_links(h, b);
+
+    mapping_insert(block_size(h, b), &fl, &sl);
+    l->next_free = h->blocks[fl][sl];
+    l->prev_free = 0;
+    if (l->next_free)
+	block_links(h, l->next_free)->prev_free = b;
+    h->blocks[fl][sl] = b;
+    h->fl_bitmap |= (1U << fl);
+    h->sl_bitmap[fl] |= (1U << sl);
+}
+
+static void unlink_block(struct rtapi_heap *h, size_t b)
+{
+    int fl, sl;
+    mapping_insert(block_size(h, b), &fl, &sl);
+    remove_free_block(h, b, fl, sl);
+}
+
+// find a non-empty list at or above (fl,sl), 0 if none
+static size_t search_suitable_block(struct rtapi_heap *h, int *fli, int *sli)
+{
+    int fl = *fli;
+    int sl = *sli;
+
+    if (fl >= RTAPI_HEAP_FL_COUNT)
+	return 0;
+
+    unsigned sl_map = h->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+	unsigned fl_map = h->fl_bitmap & (~0U << (fl + 1));
+	if (!fl_map)
+	    return 0;
+	fl = heap_ffs(fl_map);
+	sl_map = h->sl_bitmap[fl];
+    }
+    sl = heap_ffs(sl_map);
+    *fli = fl;
+    *sli = sl;
+    return h->blocks[fl][sl];
+}
+
+static inline size_t adjust_request(size_t nbytes)
+{
+    size_t size = (nbytes + RTAPI_HEAP_ALIGN - 1) & ~((size_t) RTAPI_HEAP_ALIGN - 1);
+    return (size < RTAPI_HEAP_MIN_BLOCK) ? RTAPI_HEAP_MIN_BLOCK : size;
+}
+
 void rtapi_free(struct rtapi_heap *h, void *);
 
 void *rtapi_malloc(struct rtapi_heap *h, size_t nbytes)
@@ -39,73 +201,77 @@ void *rtapi_malloc(struct rtapi_heap *h, size_t nbytes)
     unsigned long *m __attribute__((cleanup(malloc_autorelease_mutex))) = &h->mutex;
     rtapi_mutex_get(m);
 
-    rtapi_malloc_hdr_t *p, *prevp;
-    size_t nunits  = (nbytes + sizeof(rtapi_malloc_hdr_t) - 1) / sizeof(rtapi_malloc_hdr_t) + 1;
-
-    // heaps are explicitly initialized, see rtapi_heap_init()
-    // if ((prevp = h->freep) == NULL) {	// no free list yet
-    // 	h->base.s.ptr = h->freep = prevp = &h->base;
-    // 	h->base.s.size = 0;
-    // }
-    rtapi_malloc_hdr_t *freep = heap_ptr(h, h->free_p);
-
-    prevp = freep;
-    for (p = heap_ptr(h, prevp->s.next); ; prevp = p, p = heap_ptr(h, p->s.next)) {
-	if (p->s.size >= nunits) {	/* big enough */
-	    if (p->s.size == nunits)	/* exactly */
-		prevp->s.next = p->s.next;
-	    else {				/* allocate tail end */
-		p->s.size -= nunits;
-		p += p->s.size;
-		p->s.size = nunits;
-	    }
-	    h->free_p = heap_off(h, prevp);
-	    return (void *)(p+1);
-	}
-	if (p == freep)	{	/* wrapped around free list */
-	    //rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_malloc: out of memory (size=%zu arena=%zu)", nbytes, h->arena_size);
-	    //if ((p = morecore(nunits)) == NULL)
-	    return NULL;	/* none left */
-	}
+    int fl, sl;
+    size_t size = adjust_request(nbytes);
+
+    if (size >= ((size_t) 1 << RTAPI_HEAP_FL_MAX)) {
+	h->failures++;
+	return NULL;
+    }
+    mapping_search(size, &fl, &sl);
+    size_t b = search_suitable_block(h, &fl, &sl);
+    if (b == 0) {
+	// out of memory, or too fragmented to satisfy request
+	h->failures++;
+	return NULL;
+    }
+    remove_free_block(h, b, fl, sl);
+
+    size_t bsize = block_size(h, b);
+    if (bsize >= size + RTAPI_HEAP_HDR_SIZE + RTAPI_HEAP_MIN_BLOCK) {
+	// split, return the remainder to the free lists
+	size_t rest = b + RTAPI_HEAP_HDR_SIZE + size;
+	block_hdr(h, rest)->s.size = bsize - size - RTAPI_HEAP_HDR_SIZE;
+	block_set_size(h, b, size);
+	block_mark(h, rest, 1);
+	insert_free_block(h, rest);
     }
+    block_mark(h, b, 0);
+
+    h->allocs++;
+    h->in_use += block_size(h, b);
+    if (h->in_use > h->in_use_max)
+	h->in_use_max = h->in_use;
+
+    return heap_ptr(h, b + RTAPI_HEAP_HDR_SIZE);
 }
 
 void rtapi_free(struct rtapi_heap *h,void *ap)
 {
+    if (ap == NULL)
+	return;
+
     unsigned long *m __attribute__((cleanup(malloc_autorelease_mutex))) = &h->mutex;
     rtapi_mutex_get(m);
 
-    rtapi_malloc_hdr_t *bp, *p;
-    rtapi_malloc_hdr_t *freep =  heap_ptr(h,h->free_p);
+    size_t b = heap_off(h, ap) - RTAPI_HEAP_HDR_SIZE;
 
-    bp = (rtapi_malloc_hdr_t *)ap - 1;	// point to block header
-    for (p = freep; !(bp > p && bp < (rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next)); p = heap_ptr(h,p->s.next))
-	if (p >= (rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next) &&
-	    (bp > p || bp < (rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))) {
-	    // freed block at start or end of arena
-	    //rtapi_print_msg(RTAPI_MSG_DBG, "freed block at start or end of arena");
-	    break;
-	}
+    h->frees++;
+    h->in_use -= block_size(h, b);
 
-    if (bp + bp->s.size == ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))) { // join to upper neighbor
-	bp->s.size += ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))->s.size;
-	bp->s.next = ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))->s.next;
-	//rtapi_print_msg(RTAPI_MSG_DBG, "join upper");
-    } else
-	bp->s.next = p->s.next;
-    if (p + p->s.size == bp) {		/* join to lower nbr */
-	p->s.size += bp->s.size;
-	p->s.next = bp->s.next;
-	//rtapi_print_msg(RTAPI_MSG_DBG, "join lower");
-    } else
-	p->s.next = heap_off(h,bp);
-    h->free_p = heap_off(h,p);
+    // join to upper neighbor
+    size_t next = block_next(h, b);
+    if (block_test_flag(h, next, RTAPI_HEAP_BLOCK_FREE)) {
+	unlink_block(h, next);
+	block_set_size(h, b, block_size(h, b) + RTAPI_HEAP_HDR_SIZE +
+		       block_size(h, next));
+    }
+    // join to lower neighbor
+    if (block_test_flag(h, b, RTAPI_HEAP_PREV_FREE)) {
+	size_t prev = block_hdr(h, b)->s.prev_phys;
+	unlink_block(h, prev);
+	block_set_size(h, prev, block_size(h, prev) + RTAPI_HEAP_HDR_SIZE +
+		       block_size(h, b));
+	b = prev;
+    }
+    block_mark(h, b, 1);
+    insert_free_block(h, b);
 }
 
 size_t rtapi_allocsize(void *ap)
 {
     rtapi_malloc_hdr_t *p = (rtapi_malloc_hdr_t *) ap - 1;
-    return p->s.size * sizeof (rtapi_malloc_hdr_t);
+    return p->s.size & ~((size_t) RTAPI_HEAP_FLAGS);
 }
 
 void *rtapi_calloc(struct rtapi_heap *h, size_t nelem, size_t elsize)
@@ -119,6 +285,8 @@ void *rtapi_calloc(struct rtapi_heap *h, size_t nelem, size_t elsize)
 
 void *rtapi_realloc(struct rtapi_heap *h, void *ptr, size_t size)
 {
+    if (ptr == NULL)
+	return rtapi_malloc(h, size);
     void *p = rtapi_malloc (h, size);
     if (!p)
         return (p);
@@ -130,82 +298,77 @@ void *rtapi_realloc(struct rtapi_heap *h, void *ptr, size_t size)
 
 size_t rtapi_print_freelist(struct rtapi_heap *h)
 {
-    size_t free = 0;
-    rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h,h->free_p);
-    prevp = freep;
-    for (p = heap_ptr(h,prevp->s.next); ; prevp = p, p = heap_ptr(h,p->s.next)) {
-	if (p->s.size) {
-	    //rtapi_print_msg(RTAPI_MSG_DBG, "%d at %p", p->s.size * sizeof(rtapi_malloc_hdr_t),(void *)(p + 1));
-	    free += p->s.size;
-	}
-	if (p == freep) {
-	    //rtapi_print_msg(RTAPI_MSG_DBG, "end of free list %p",p);
-	    return free;
-	}
-    }
+    struct rtapi_heap_stat hs;
+    rtapi_heap_status(h, &hs);
+    return hs.total_avail;
 }
 
 int rtapi_heap_addmem(struct rtapi_heap *h, void *space, size_t size)
 {
     if (space < (void*) h) return -EINVAL;
     if (size < RTAPI_HEAP_MIN_ALLOC) return -EINVAL;
-    rtapi_malloc_hdr_t *arena = space;
-    arena->s.size = size / sizeof(rtapi_malloc_hdr_t);
-    rtapi_free(h, (void *) (arena + 1));
+
+    unsigned long *m __attribute__((cleanup(malloc_autorelease_mutex))) = &h->mutex;
+    rtapi_mutex_get(m);
+
+    // carve the arena into one free block plus a zero-sized, used
+    // sentinel block at the end which stops coalescing
+    size_t start = heap_off(h, space);
+    size_t aligned = (start + RTAPI_HEAP_ALIGN - 1) & ~((size_t) RTAPI_HEAP_ALIGN - 1);
+    size_t avail = (size - (aligned - start)) & ~((size_t) RTAPI_HEAP_ALIGN - 1);
+    size_t bsize = avail - 2 * RTAPI_HEAP_HDR_SIZE;
+
+    if (bsize >= ((size_t) 1 << RTAPI_HEAP_FL_MAX))
+	return -EINVAL;
+
+    block_hdr(h, aligned)->s.size = bsize;  // prev used - nothing to merge
+    size_t sentinel = block_next(h, aligned);
+    block_hdr(h, sentinel)->s.size = 0;
+    block_mark(h, aligned, 1);
+    insert_free_block(h, aligned);
+
+    h->arena_size += size;
     return 0;
 }
 
 int rtapi_heap_init(struct rtapi_heap *heap)
 {
-    heap->base.s.next = 0; // because the first element in the heap ist the header
-    heap->free_p = 0;      // and free list sentinel
-    heap->base.s.size = 0;
-    heap->mutex = 0;
-    heap->arena_size = 0;
+    memset(heap, 0, sizeof(struct rtapi_heap));
     return 0;
 }
 
 size_t rtapi_heap_status(struct rtapi_heap *h, struct rtapi_heap_stat *hs)
 {
+    unsigned long *m __attribute__((cleanup(malloc_autorelease_mutex))) = &h->mutex;
+    rtapi_mutex_get(m);
+
     hs->total_avail = 0;
     hs->fragments = 0;
     hs->largest = 0;
 
-    rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h, h->free_p);
-    prevp = freep;
-    for (p = heap_ptr(h, prevp->s.next); ; prevp = p, p = heap_ptr(h, p->s.next)) {
-	if (p->s.size) {
-	    hs->fragments++;
-	    hs->total_avail += p->s.size;
-	    if (p->s.size > hs->largest)
-		hs->largest = p->s.size;
-	}
-	if (p == freep) {
-	    hs->total_avail *= sizeof(rtapi_malloc_hdr_t);
-	    hs->largest *= sizeof(rtapi_malloc_hdr_t);
-	    return hs->largest;
-	}
-    }
-}
-
-#if 0 // assumes rtapi_print_msg() and hence RTAPI
-size_t rtapi_print_freelist(struct rtapi_heap *h)
-{
-    size_t free = 0;
-    rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h,h->free_p);
-    prevp = freep;
-    for (p = heap_ptr(h,prevp->s.next); ; prevp = p, p = heap_ptr(h,p->s.next)) {
-	if (p->s.size) {
-	    rtapi_print_msg(RTAPI_MSG_DBG, "%d at %p", p->s.size * sizeof(rtapi_malloc_hdr_t),(void *)(p + 1));
-	    free += p->s.size;
-	}
-	if (p == freep) {
-	    rtapi_print_msg(RTAPI_MSG_DBG, "end of free list %p",p);
-	    return free;
+    int fl, sl;
+    for (fl = 0; fl < RTAPI_HEAP_FL_COUNT; fl++) {
+	if (!(h->fl_bitmap & (1U << fl)))
+	    continue;
+	for (sl = 0; sl < RTAPI_HEAP_SL_COUNT; sl++) {
+	    size_t b;
+	    for (b = h->blocks[fl][sl]; b; b = block_links(h, b)->next_free) {
+		size_t size = block_size(h, b);
+		hs->fragments++;
+		hs->total_avail += size;
+		if (size > hs->largest)
+		    hs->largest = size;
+	    }
 	}
     }
+    hs->arena_size = h->arena_size;
+    hs->in_use = h->in_use;
+    hs->in_use_max = h->in_use_max;
+    hs->allocs = h->allocs;
+    hs->frees = h->frees;
+    hs->failures = h->failures;
+    return hs->largest;
 }
-#endif
 
 #ifdef RTAPI
 EXPORT_SYMBOL(rtapi_malloc);
@@ -17,9 +17,15 @@ RTAPI_BEGIN_DECLS
 
 struct rtapi_heap;
 struct rtapi_heap_stat {
-    size_t total_avail;
-    size_t fragments;
-    size_t largest;
+    size_t total_avail;   // bytes on free lists
+    size_t fragments;     // number of free blocks
+    size_t largest;       // largest free block
+    size_t arena_size;    // total memory added via rtapi_heap_addmem()
+    size_t in_use;        // bytes currently allocated
+    size_t in_use_max;    // high water mark of in_use
+    unsigned long allocs; // successful rtapi_malloc() calls
+    unsigned long frees;
+    unsigned long failures; // rtapi_malloc() calls returning NULL
 };
 
 void *rtapi_malloc(struct rtapi_heap *h, size_t nbytes);
@@ -31,6 +37,8 @@ size_t rtapi_allocsize(void *p);
 int rtapi_heap_init(struct rtapi_heap *h);
 // any memory added to the heap must lie above the rtapi_heap structure:
 int rtapi_heap_addmem(struct rtapi_heap *h, void *space, size_t size);
+// fills in hs and returns the size of the largest free block.
+// walks the free lists - not intended for use in RT context.
 size_t rtapi_heap_status(struct rtapi_heap *h, struct rtapi_heap_stat *hs);
 
 RTAPI_END_DECLS
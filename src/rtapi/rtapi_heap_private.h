@@ -8,26 +8,77 @@
 // the arena(s) are allocated above the rtapi_heap structure in a particular segment
 // the offsets used in the rtapi_heap and rtapi_malloc_header structure
 // are offsets from the rtapi_heap structure.
+//
+// the allocator is a TLSF (two-level segregated fit) allocator:
+// free blocks are kept in size-class lists indexed by a first level
+// (power of two) and second level (linear subdivision of the power of two)
+// index. Two bitmaps tell which lists are non-empty, so malloc and free
+// are O(1) - no list walking regardless of fragmentation.
+//
+// see: M. Masmano et al, "TLSF: a New Dynamic Memory Allocator for
+// Real-Time Systems", ECRTS 2004
 
 #define RTAPI_HEAP_MIN_ALLOC 1024 // with alignment 8 == 8k arena
 
+// block sizes are multiples of RTAPI_HEAP_ALIGN
+#define RTAPI_HEAP_ALIGN_LOG2 3
+#define RTAPI_HEAP_ALIGN      (1 << RTAPI_HEAP_ALIGN_LOG2)
+
+// log2 of the number of second level lists per first level
+#define RTAPI_HEAP_SL_LOG2    4
+#define RTAPI_HEAP_SL_COUNT   (1 << RTAPI_HEAP_SL_LOG2)
+
+// first level: all blocks below RTAPI_HEAP_SMALL_BLOCK go into fl 0,
+// linearly subdivided. RTAPI_HEAP_FL_MAX bounds the largest block (1GB).
+#define RTAPI_HEAP_FL_SHIFT   (RTAPI_HEAP_SL_LOG2 + RTAPI_HEAP_ALIGN_LOG2)
+#define RTAPI_HEAP_FL_MAX     30
+#define RTAPI_HEAP_FL_COUNT   (RTAPI_HEAP_FL_MAX - RTAPI_HEAP_FL_SHIFT + 1)
+#define RTAPI_HEAP_SMALL_BLOCK (1 << RTAPI_HEAP_FL_SHIFT)
+
+// block->size low bits carry flags since sizes are aligned
+#define RTAPI_HEAP_BLOCK_FREE      1
+#define RTAPI_HEAP_PREV_FREE       2
+#define RTAPI_HEAP_FLAGS           (RTAPI_HEAP_BLOCK_FREE|RTAPI_HEAP_PREV_FREE)
+
 typedef double rtapi_malloc_align;
 
+// every block - used or free - starts with this header
+// the payload follows immediately. While a block is free,
+// the first two words of the payload hold the free list links.
 union rtapi_malloc_header {
     struct {
-	size_t   next;	// next block if on free list
-	unsigned size;	// size of this block
+	size_t   prev_phys; // offset of physically preceding block
+	size_t   size;      // payload size in bytes | flags
     } s;
     rtapi_malloc_align align;	// unused - force alignment of blocks
 };
 
 typedef union rtapi_malloc_header rtapi_malloc_hdr_t;
 
+// free list links, overlaying the payload of a free block
+struct rtapi_free_links {
+    size_t next_free;
+    size_t prev_free;
+};
+
+#define RTAPI_HEAP_HDR_SIZE  sizeof(rtapi_malloc_hdr_t)
+#define RTAPI_HEAP_MIN_BLOCK sizeof(struct rtapi_free_links)
+
 struct rtapi_heap {
-    rtapi_malloc_hdr_t base;
-    size_t free_p;
     size_t arena_size;
     rtapi_atomic_type mutex;
+
+    // TLSF control: list heads are offsets, 0 == empty
+    unsigned fl_bitmap;
+    unsigned sl_bitmap[RTAPI_HEAP_FL_COUNT];
+    size_t   blocks[RTAPI_HEAP_FL_COUNT][RTAPI_HEAP_SL_COUNT];
+
+    // statistics, see rtapi_heap_status()
+    size_t in_use;        // payload bytes currently allocated
+    size_t in_use_max;    // high water mark of the above
+    unsigned long allocs;
+    unsigned long frees;
+    unsigned long failures;
 };
 
 static inline void *heap_ptr(struct rtapi_heap *base, size_t offset) {
@@ -48,6 +48,9 @@
 #define STREAMER_SHMEM_KEY 	0x00535430
 #define SAMPLER_SHMEM_KEY	0x00534130
 
+// from emc/motion/volcomp.h
+#define VOLCOMP_SHMEM_KEY	0x00564F4C
+
 // from hal/classicladder/arrays.c
 #define CL_SHMEM_KEY 0x004C522b // "CLR+"
 
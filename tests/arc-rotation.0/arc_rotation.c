@@ -0,0 +1,162 @@
+// checks the incremental arc evaluation of the TP, pmRotationCacheEval()
+// with pmCircle9Point() and arcPointRotated(), against pmCirclePoint()
+// on a spiral helix and on a blend arc, over NCYCLES servo cycles each
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "rtapi.h"
+#include "posemath.h"
+#include "tc.h"
+#include "blendmath.h"
+#include "spherical_arc.h"
+
+#define NCYCLES   200000
+#define JUMP      9973      // every JUMP cycles, a step past TC_ROTATION_MAX_STEP
+#define MAX_ERR   1e-9      // machine units
+
+static int failed;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double dist(const PmCartesian *a, const PmCartesian *b)
+{
+    PmCartesian d;
+    double mag;
+
+    pmCartCartSub(a, b, &d);
+    pmCartMag(&d, &mag);
+    return mag;
+}
+
+// progress of each cycle: uneven steps as the TP makes them while it
+// accelerates and blends, and an occasional large one
+static void make_progress(double *progress, double length)
+{
+    double step = length / NCYCLES, p = 0.0;
+    long i;
+
+    srand(1);
+    for (i = 0; i < NCYCLES; i++) {
+        progress[i] = p;
+        if (i % JUMP == JUMP - 1) {
+            p += 0.2 * length;
+        } else {
+            p += step * (0.2 + 1.6 * rand() / RAND_MAX);
+        }
+        if (p > length) {
+            p = fmod(p, length);
+        }
+    }
+}
+
+static void report(const char *curve, double max_err, long long tcache,
+        long long tref)
+{
+    printf("%s: max error %g, cached avg=%lldns pmCirclePoint avg=%lldns\n",
+            curve, max_err, tcache / NCYCLES, tref / NCYCLES);
+    if (!(max_err < MAX_ERR)) {
+        printf("FAIL: %s: error %g exceeds %g\n", curve, max_err, MAX_ERR);
+        failed = 1;
+    }
+}
+
+// three turns of a helix that spirals out from radius 2 to 2.5
+static void helix(double *progress)
+{
+    EmcPose start = {{2, 0, 0}, 0, 0, 0, 0, 0, 0};
+    EmcPose end = {{2.5, 0, 3}, 0, 0, 0, 0, 0, 0};
+    PmCartesian center = {0, 0, 0}, normal = {0, 0, 1}, pos, ref;
+    PmCircle9 circ;
+    PmRotationCache rot = {0};
+    double angle, c, s, err, max_err = 0.0;
+    long long t, tcache = 0, tref = 0;
+    long i;
+
+    if (pmCircle9Init(&circ, &start, &end, &center, &normal, 2)) {
+        printf("FAIL: helix: pmCircle9Init\n");
+        failed = 1;
+        return;
+    }
+    make_progress(progress, pmCircle9Target(&circ));
+    for (i = 0; i < NCYCLES; i++) {
+        angle = pmCircle9AngleFromProgress(&circ, progress[i]);
+        t = now_ns();
+        pmRotationCacheEval(&rot, angle, &c, &s);
+        pmCircle9Point(&circ, angle, c, s, &pos);
+        tcache += now_ns() - t;
+        t = now_ns();
+        pmCirclePoint(&circ.xyz, angle, &ref);
+        tref += now_ns() - t;
+        err = dist(&pos, &ref);
+        if (!(err <= max_err)) {
+            max_err = err;
+        }
+    }
+    report("helix", max_err, tcache, tref);
+}
+
+// a blend arc of radius 0.4 turning through 100 degrees, as between
+// two lines, with the circle through the same points as reference
+static void blend_arc(double *progress)
+{
+    PmCartesian start = {0.4, 0, 1}, center = {0, 0, 1}, end, normal;
+    PmCartesian pos, ref;
+    PmCircle circ;
+    SphericalArc arc;
+    PmRotationCache rot = {0};
+    double a = 100.0 * M_PI / 180.0, length, angle, c, s, err, max_err = 0.0;
+    long long t, tcache = 0, tref = 0;
+    long i;
+
+    end.x = 0.4 * cos(a);
+    end.y = 0.4 * sin(a) * 0.6;
+    end.z = 1 + 0.4 * sin(a) * 0.8;
+    if (arcInitFromPoints(&arc, &start, &end, &center)) {
+        printf("FAIL: blend arc: arcInitFromPoints\n");
+        failed = 1;
+        return;
+    }
+    arc.line_length = 0.0;
+    pmCartCartCross(&arc.rStart, &arc.rEnd, &normal);
+    pmCartUnitEq(&normal);
+    if (pmCircleInit(&circ, &start, &end, &center, &normal, 0)) {
+        printf("FAIL: blend arc: pmCircleInit\n");
+        failed = 1;
+        return;
+    }
+    arcLength(&arc, &length);
+    make_progress(progress, length);
+    for (i = 0; i < NCYCLES; i++) {
+        angle = arcAngleFromProgress(&arc, progress[i]);
+        t = now_ns();
+        pmRotationCacheEval(&rot, angle, &c, &s);
+        arcPointRotated(&arc, progress[i], c, s, &pos);
+        tcache += now_ns() - t;
+        t = now_ns();
+        pmCirclePoint(&circ, angle, &ref);
+        tref += now_ns() - t;
+        err = dist(&pos, &ref);
+        if (!(err <= max_err)) {
+            max_err = err;
+        }
+    }
+    report("blend arc", max_err, tcache, tref);
+}
+
+int main(int argc, char **argv)
+{
+    static double progress[NCYCLES];
+
+    helix(progress);
+    blend_arc(progress);
+    if (!failed)
+        printf("within %g of pmCirclePoint\n", MAX_ERR);
+    return failed ? 1 : 0;
+}
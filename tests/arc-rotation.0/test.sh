@@ -0,0 +1,14 @@
+#!/bin/sh
+rm -f arc_rotation
+TP=../../src/emc/tp
+gcc -g -O2 -DULAPI -DBUILD_SYS_USER_DSO \
+    -I../../include \
+    arc_rotation.c \
+    $TP/tc.c $TP/blendmath.c $TP/spherical_arc.c \
+    ../../src/emc/nml_intf/emcpose.c \
+    ../../src/libnml/posemath/_posemath.c \
+    ../../src/libnml/posemath/sincos.c \
+    ../../lib/liblinuxcnculapi.so ../../lib/librtapi_math.so.0 \
+    -lm -o arc_rotation || exit 1
+
+./arc_rotation
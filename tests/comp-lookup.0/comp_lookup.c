@@ -0,0 +1,143 @@
+// checks comp_lookup() of the motion controller against a linear
+// search of the same leadscrew compensation table, for evenly and
+// unevenly spaced tables, stepping and jumping through the table,
+// past both ends, and for +-inf and NaN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "comp_lookup.h"
+
+#define ENTRIES 50
+
+// guard entries either side of the table: a lookup that reads past a
+// sentinel runs into them and returns a pointer outside the table
+static emcmot_comp_entry_t buf[ENTRIES + 4];
+static emcmot_comp_t comp;
+static int failed;
+
+// the table as motion.c initializes it and EMCMOT_SET_JOINT_COMP
+// fills it
+static void init_table(double first, const double *step, int nstep)
+{
+    int n;
+
+    buf[0].nominal = -INFINITY;
+    buf[ENTRIES + 3].nominal = INFINITY;
+    comp.array = buf + 1;
+    comp.entry = comp.array;
+    comp.entries = 0;
+    comp.uniform = 0;
+    comp.inv_step = 0.0;
+    comp.array[0].nominal = -DBL_MAX;
+    for (n = 1; n < ENTRIES + 2; n++) {
+        comp.array[n].nominal = DBL_MAX;
+    }
+    for (n = 1; n <= ENTRIES; n++) {
+        comp.array[n].nominal = first;
+        first += step[(n - 1) % nstep];
+        comp.entries++;
+        if (n == 2) {
+            comp.uniform = 1;
+            comp.inv_step = 1.0 / (comp.array[2].nominal - comp.array[1].nominal);
+        } else if (n > 2 && comp.uniform) {
+            double r = (comp.array[n].nominal - comp.array[n-1].nominal) *
+                comp.inv_step;
+            if (fabs(r - 1.0) > 1e-6) {
+                comp.uniform = 0;
+            }
+        }
+    }
+}
+
+static void check(const char *table, double pos)
+{
+    emcmot_comp_entry_t *a = comp.array, *e, *ref;
+
+    e = comp_lookup(&comp, pos);
+    if (e < a || e > a + comp.entries) {
+        printf("%s: pos %g: entry %d is outside the table\n",
+               table, pos, (int)(e - a));
+        failed = 1;
+        return;
+    }
+    if (isnan(pos)) {
+        comp.entry = e;
+        return;
+    }
+    for (ref = a; ref < a + comp.entries && pos >= (ref+1)->nominal; ref++)
+        ;
+    if (e != ref) {
+        printf("%s: pos %g: entry %d, expected %d\n",
+               table, pos, (int)(e - a), (int)(ref - a));
+        failed = 1;
+    }
+    comp.entry = e;
+}
+
+static void run(const char *table)
+{
+    double lo = comp.array[1].nominal, hi = comp.array[comp.entries].nominal;
+    double pos, span = hi - lo;
+    int n;
+
+    // small steps, as in a move, both ways and on the table points
+    for (pos = lo - 0.1 * span; pos <= hi + 0.1 * span; pos += span / 997) {
+        check(table, pos);
+    }
+    for (pos = hi + 0.1 * span; pos >= lo - 0.1 * span; pos -= span / 997) {
+        check(table, pos);
+    }
+    for (n = 1; n <= comp.entries; n++) {
+        check(table, comp.array[n].nominal);
+        check(table, nextafter(comp.array[n].nominal, -INFINITY));
+    }
+    // large jumps across the table
+    srand(1);
+    for (n = 0; n < 10000; n++) {
+        check(table, lo - 0.2 * span + 1.4 * span * rand() / RAND_MAX);
+    }
+    // past both ends, from either end of the table
+    comp.entry = comp.array + comp.entries;
+    check(table, lo - 1e6 * span);
+    check(table, hi + 1e6 * span);
+    check(table, -DBL_MAX);
+    check(table, DBL_MAX);
+    check(table, 0.5 * (lo + hi));
+    check(table, 1e300);
+    check(table, -1e300);
+    // +-inf and NaN, starting at each end of the table
+    for (n = 0; n < 2; n++) {
+        comp.entry = n ? comp.array + comp.entries : comp.array;
+        check(table, -INFINITY);
+        check(table, INFINITY);
+        check(table, INFINITY);
+        comp.entry = n ? comp.array + comp.entries : comp.array;
+        check(table, NAN);
+        check(table, NAN);
+        check(table, -INFINITY);
+        check(table, -INFINITY);
+        check(table, NAN);
+    }
+}
+
+int main(void)
+{
+    static const double even[] = { 0.25 };
+    static const double uneven[] = { 0.25, 0.1, 0.7, 0.05, 0.3 };
+
+    init_table(-3.0, even, 1);
+    if (!comp.uniform) {
+        printf("evenly spaced table not detected\n");
+        failed = 1;
+    }
+    run("uniform");
+    init_table(-3.0, uneven, 5);
+    if (comp.uniform) {
+        printf("unevenly spaced table taken as uniform\n");
+        failed = 1;
+    }
+    run("non-uniform");
+    return failed;
+}
@@ -0,0 +1,8 @@
+#!/bin/sh
+rm -f comp_lookup
+gcc -g -O2 -DULAPI \
+    -I../../include \
+    comp_lookup.c \
+    -o comp_lookup -lm || exit 1
+
+./comp_lookup
@@ -0,0 +1,21 @@
+#!/bin/sh
+# two turns of joint 0 with the other joints at 10 20 0 30 0: a single
+# process tracks joint 0 up to 720 degrees, a process starting in the
+# middle of the path from the first pose's joints would not
+python -c "
+import math
+n = 60000
+for i in range(n):
+    t = 720.0 * i / n
+    r = math.radians(t)
+    x, y = 138.743596, 70.0
+    print('%f %f %f %f %f %f' % (x * math.cos(r) - y * math.sin(r),
+                                 x * math.sin(r) + y * math.cos(r),
+                                 -423.504615, 180, 60, t))
+" > path || exit 1
+
+for procs in 1 4; do
+    echo "procs $procs"
+    genserkins c $procs < path | sed 's/, [0-9.]* secs$//' || exit 1
+done
+rm -f path
@@ -0,0 +1,236 @@
+// benchmark and correctness check for hal_cgroup_match() on a
+// 10k member group, with and without the 'sigmark' funct running,
+// plus a mixed type check of the per-type change detection
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "rtapi.h"
+#include "hal.h"
+#include "hal_priv.h"
+#include "hal_group.h"
+
+#define NSIGS   10000
+#define NMIXED  100     // bit and s32 members each
+#define NLOOPS  200
+#define GROUP   "gbench"
+#define WAIT_NS 10000000000LL   // give up waiting for 'sigmark' after 10s
+
+static int failed;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *sigptr(const char *name)
+{
+    hal_sig_t *sig;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    sig = halpr_find_sig_by_name(name);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return SHMPTR(sig->data_ptr);
+}
+
+static hal_float_t *sigval(int i)
+{
+    char name[HAL_NAME_LEN + 1];
+
+    snprintf(name, sizeof(name), GROUP ".%d", i);
+    return sigptr(name);
+}
+
+// wait until a 'sigmark' pass started after the caller's writes has
+// completed: two more passes, as one may have been in progress
+static int wait_sigmark(void)
+{
+    __u32 start = hal_data->sigmark_runs;
+    long long deadline = now_ns() + WAIT_NS;
+
+    while ((__u32)(hal_data->sigmark_runs - start) < 2) {
+	if (now_ns() > deadline) {
+	    printf("FAIL: 'sigmark' is not running\n");
+	    failed++;
+	    return -1;
+	}
+	usleep(100);
+    }
+    return 0;
+}
+
+// find the member index of a signal, as used in the changed bitmap
+static int member_index(hal_compiled_group_t *cg, const char *name)
+{
+    int i;
+
+    for (i = 0; i < cg->n_members; i++) {
+	hal_sig_t *sig = SHMPTR(cg->member[i]->sig_member_ptr);
+	if (strcmp(sig->name, name) == 0)
+	    return i;
+    }
+    return -1;
+}
+
+// write one bit and one s32 member and check exactly those are reported
+static void check_mixed(hal_compiled_group_t *cg)
+{
+    int n, b = member_index(cg, GROUP ".b.42"), s = member_index(cg, GROUP ".s.17");
+
+    *((hal_bit_t *) sigptr(GROUP ".b.42")) = 1;
+    *((hal_s32_t *) sigptr(GROUP ".s.17")) = -5;
+    n = hal_cgroup_match(cg);
+    if ((n != 2) || !RTAPI_BIT_TEST(cg->changed, b) ||
+	!RTAPI_BIT_TEST(cg->changed, s)) {
+	printf("FAIL: mixed types: match returned %d, bit=%d s32=%d\n", n,
+	       RTAPI_BIT_TEST(cg->changed, b) != 0,
+	       RTAPI_BIT_TEST(cg->changed, s) != 0);
+	failed++;
+	return;
+    }
+    if (hal_cgroup_match(cg) != 0) {
+	printf("FAIL: mixed types: change reported twice\n");
+	failed++;
+	return;
+    }
+    printf("mixed types: ok\n");
+}
+
+// a group compiled while 'sigmark' runs must report every member which
+// already holds a non-default value on its first match
+static void check_first_match(void)
+{
+    hal_compiled_group_t *cg;
+    int i, n, expect = 0, retval;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    retval = halpr_group_compile(GROUP, &cg);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval) {
+	printf("FAIL: halpr_group_compile: %d\n", retval);
+	failed++;
+	return;
+    }
+    for (i = 0; i < cg->n_members; i++) {
+	hal_sig_t *sig = SHMPTR(cg->member[i]->sig_member_ptr);
+	void *v = sigptr(sig->name);
+	switch (sig->type) {
+	case HAL_BIT:   expect += *((hal_bit_t *) v) != 0; break;
+	case HAL_FLOAT: expect += *((hal_float_t *) v) != 0.0; break;
+	case HAL_S32:   expect += *((hal_s32_t *) v) != 0; break;
+	default: break;
+	}
+    }
+    if (wait_sigmark() == 0) {
+	n = hal_cgroup_match(cg);
+	if ((n != expect) || (expect == 0)) {
+	    printf("FAIL: first match returned %d, expected %d\n", n, expect);
+	    failed++;
+	} else {
+	    printf("first match: ok\n");
+	}
+    }
+    hal_cgroup_free(cg);
+}
+
+// time NLOOPS matches, writing 'nwrites' signals before each one
+static void run(const char *label, hal_compiled_group_t *cg,
+		int nwrites, int expect, int sigmark)
+{
+    long long t, total = 0, max = 0;
+    int i, j, n;
+
+    for (i = 0; i < NLOOPS; i++) {
+	for (j = 0; j < nwrites; j++)
+	    *sigval((i * 7 + j * 13) % NSIGS) += 1.0;
+	if (sigmark && wait_sigmark())
+	    return;
+	t = now_ns();
+	n = hal_cgroup_match(cg);
+	t = now_ns() - t;
+	total += t;
+	if (t > max)
+	    max = t;
+	if (n != expect) {
+	    printf("FAIL: %s: match returned %d, expected %d\n",
+		   label, n, expect);
+	    failed++;
+	    return;
+	}
+    }
+    printf("%s: avg=%lldns max=%lldns\n", label, total / NLOOPS, max);
+}
+
+int main(int argc, char **argv)
+{
+    hal_compiled_group_t *cg;
+    char name[HAL_NAME_LEN + 1];
+    int comp_id, i, retval;
+
+    comp_id = hal_init("group_bench");
+    if (comp_id < 0) {
+	printf("FAIL: hal_init: %d\n", comp_id);
+	return 1;
+    }
+    if (hal_group_new(GROUP, 100,
+		      GROUP_REPORT_ON_CHANGE|GROUP_MONITOR_ALL_MEMBERS)) {
+	printf("FAIL: hal_group_new\n");
+	return 1;
+    }
+    for (i = 0; i < NSIGS; i++) {
+	snprintf(name, sizeof(name), GROUP ".%d", i);
+	if (hal_signal_new(name, HAL_FLOAT) ||
+	    hal_member_new(GROUP, name, MEMBER_MONITOR_CHANGE, 0)) {
+	    printf("FAIL: creating signal %s\n", name);
+	    return 1;
+	}
+    }
+    for (i = 0; i < NMIXED; i++) {
+	snprintf(name, sizeof(name), GROUP ".b.%d", i);
+	if (hal_signal_new(name, HAL_BIT) ||
+	    hal_member_new(GROUP, name, MEMBER_MONITOR_CHANGE, 0)) {
+	    printf("FAIL: creating signal %s\n", name);
+	    return 1;
+	}
+	snprintf(name, sizeof(name), GROUP ".s.%d", i);
+	if (hal_signal_new(name, HAL_S32) ||
+	    hal_member_new(GROUP, name, MEMBER_MONITOR_CHANGE, 0)) {
+	    printf("FAIL: creating signal %s\n", name);
+	    return 1;
+	}
+    }
+    hal_ready(comp_id);
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    retval = halpr_group_compile(GROUP, &cg);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval) {
+	printf("FAIL: halpr_group_compile: %d\n", retval);
+	return 1;
+    }
+    hal_cgroup_match(cg); // initial state
+
+    // threads are not started yet, so 'sigmark' does not run
+    run("full scan idle", cg, 0, 0, 0);
+    run("full scan 1 change", cg, 1, 1, 0);
+    check_mixed(cg);
+
+    // the thread running 'sigmark' was set up by test.sh
+    if (hal_start_threads()) {
+	printf("FAIL: hal_start_threads\n");
+	return 1;
+    }
+    run("sigmark idle", cg, 0, 0, 1);
+    run("sigmark 1 change", cg, 1, 1, 1);
+    run("sigmark 100 changes", cg, 100, 100, 1);
+    check_first_match();
+    hal_stop_threads();
+
+    hal_cgroup_free(cg);
+    hal_exit(comp_id);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+rm -f group_bench
+gcc -g -O2 -DULAPI \
+    -I../../include \
+    group_bench.c \
+    ../../lib/liblinuxcnchal.so ../../lib/liblinuxcnculapi.so \
+    -o group_bench || exit 1
+
+realtime start
+halcmd newthread slow 1000000
+halcmd addf sigmark slow
+./group_bench
+result=$?
+realtime stop
+exit $result
@@ -0,0 +1,22 @@
+#!/bin/bash
+# Runs batch.hal with -k, with and without -B.  Both runs must leave
+# the same HAL behind and report the same failed lines: loadrt
+# nosuchmodule is only sent to rtapi_app once the net on the line
+# after it needs the batch done, and that net must still run.
+
+run() {
+    realtime start
+    halcmd -k $1 -f batch.hal 2>&1 |
+	sed -n 's/^\(batch.hal:[0-9]*\):.*/\1/p' | sort -t: -k2n -u > $2.errors
+    echo "exit ${PIPESTATUS[0]}" >> $2.errors
+    halcmd save all > $2.hal
+    halcmd gets y >> $2.hal
+    halcmd getp or2.0.in1 >> $2.hal
+    realtime stop
+}
+
+run "" plain
+run -B batched
+diff -u plain.errors batched.errors >&2 || exit 1
+diff -u plain.hal batched.hal >&2 || exit 1
+cat batched.errors
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+# A stand-in for a 7I92 ethernet board, enough of LBP16 over UDP for
+# hm2_eth to register a HostMot2 firmware with one IOPort module (two
+# 17 pin connectors) and run it.
+#
+# Pins 0-2 of the first connector read back the number of TRAM reads
+# (datagrams that read the IOPort data) so far, mod 8.  test.hal loops
+# them back to output pins 3-5, so each TRAM write carries the count of
+# the read the host last collected.  Its lag behind the reads answered
+# so far is 1 if every read request went out before the write of the
+# same period, as with a working read-request, and 0 if the host only
+# sent it from the read funct.  On SIGTERM the number of TRAM reads and
+# a histogram of the lags are written to the log file.
+#
+# With 'lose', the reply to TRAM read number 'lose' is not sent.
+#
+# usage: lbp16_standin.py readyfile logfile [lose]
+
+import signal, socket, struct, sys
+
+LBP16_UDP_PORT = 27181
+
+LBP16_WRITE = 0x8000
+LBP16_ADDR = 0x4000
+LBP16_INFO_ACC = 0x2000
+LBP16_SPACE_MASK = 0x1C00
+LBP16_SPACE_BOARD_INFO = 0x1C00
+LBP16_ARGS_32BIT = 0x0200
+LBP16_SIZE_MASK = 0x7F
+
+IOPORT_BASE = 0x1000
+
+mem = bytearray(0x10000)
+
+def set32(addr, val):
+    mem[addr:addr + 4] = struct.pack('<I', val & 0xFFFFFFFF)
+
+def get32(addr):
+    return struct.unpack('<I', bytes(mem[addr:addr + 4]))[0]
+
+def set_md(index, gtag, version, instances, base, num_registers, multiple):
+    addr = 0x440 + index * 12
+    # ClockLow, RegisterStride 0 (0x100), InstanceStride 0 (4)
+    set32(addr + 0, gtag | (version << 8) | (1 << 16) | (instances << 24))
+    set32(addr + 4, base | (num_registers << 16))
+    set32(addr + 8, multiple)
+
+# same layout as the behavioral model of hm2_test, see hm2_test_model.c
+set32(0x0100, 0x55AACAFE)           # IO cookie
+mem[0x0104:0x010C] = b'HOSTMOT2'
+set32(0x010C, 0x400)                # IDROM offset
+set32(0x400, 2)                     # standard idrom type
+set32(0x404, 0x40)                  # Module Descriptors at 0x440
+set32(0x408, 0x200)                 # Pin Descriptors at 0x600
+mem[0x40C:0x414] = b'STANDIN '
+set32(0x41C, 2)                     # IOPorts
+set32(0x420, 34)                    # IOWidth
+set32(0x424, 17)                    # PortWidth
+set32(0x428, 50000000)              # ClockLow
+set32(0x42C, 100000000)             # ClockHigh
+set32(0x430, 4)                     # InstanceStride0
+set32(0x434, 0x40)                  # InstanceStride1
+set32(0x438, 0x100)                 # RegisterStride0
+set32(0x43C, 4)                     # RegisterStride1
+set_md(0, 3, 0, 2, IOPORT_BASE, 5, 0x1F)    # IOPort
+for pin in range(34):
+    set32(0x600 + pin * 4, 3 << 24)         # GPIO
+
+board_name = b'7I92\0\0\0\0\0\0\0\0\0\0\0\0'
+
+tram_reads = [0]
+lags = {}
+
+def write_hm2(addr, data):
+    mem[addr:addr + len(data)] = data
+    if addr <= IOPORT_BASE < addr + len(data):
+        echo = (get32(IOPORT_BASE) >> 3) & 7
+        lag = (tram_reads[0] - echo) & 7
+        lags[lag] = lags.get(lag, 0) + 1
+
+def read_hm2(addr, count):
+    if addr <= IOPORT_BASE < addr + 4 * count:
+        tram_reads[0] += 1
+        set32(IOPORT_BASE, tram_reads[0] & 7)
+    return bytes(mem[addr:addr + 4 * count])
+
+def handle(data):
+    reply = b''
+    pos = 0
+    while pos + 2 <= len(data):
+        cmd = struct.unpack('<H', data[pos:pos + 2])[0]
+        pos += 2
+        addr = 0
+        if cmd & LBP16_ADDR:
+            addr = struct.unpack('<H', data[pos:pos + 2])[0]
+            pos += 2
+        count = cmd & LBP16_SIZE_MASK
+        width = 4 if cmd & LBP16_ARGS_32BIT else 2
+        space = cmd & LBP16_SPACE_MASK
+        if cmd & LBP16_WRITE:
+            if space == 0 and not cmd & LBP16_INFO_ACC:
+                write_hm2(addr, data[pos:pos + width * count])
+            pos += width * count
+        elif space == LBP16_SPACE_BOARD_INFO:
+            reply += board_name[addr:addr + width * count].ljust(width * count, b'\0')
+        elif space == 0 and width == 4:
+            reply += read_hm2(addr, count)
+        else:
+            reply += b'\0' * (width * count)
+    return reply
+
+def main():
+    readyfile, logfile = sys.argv[1], sys.argv[2]
+    lose = int(sys.argv[3]) if len(sys.argv) > 3 else 0
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('127.0.0.1', LBP16_UDP_PORT))
+
+    def quit(signum, frame):
+        with open(logfile, 'w') as f:
+            f.write('tram reads %d\n' % tram_reads[0])
+            for lag in sorted(lags):
+                f.write('lag %d %d\n' % (lag, lags[lag]))
+        sys.exit(0)
+    signal.signal(signal.SIGTERM, quit)
+
+    open(readyfile, 'w').close()
+    while True:
+        data, peer = sock.recvfrom(2048)
+        reads = tram_reads[0]
+        reply = handle(bytearray(data))
+        if lose and reads < lose <= tram_reads[0]:
+            continue
+        if reply:
+            sock.sendto(reply, peer)
+
+main()
@@ -0,0 +1,32 @@
+#!/bin/bash
+# the stand-in board answers on 127.0.0.1, see README
+rm -f standin.ready standin.log result.samples
+
+# run_standin halfile [lose]
+run_standin() {
+    rm -f standin.ready standin.log
+    python lbp16_standin.py standin.ready standin.log $2 &
+    standin=$!
+    for i in $(seq 100); do
+	test -f standin.ready && break
+	sleep 0.1
+    done
+    if ! test -f standin.ready; then
+	echo "stand-in did not start"
+	kill $standin
+	return 1
+    fi
+
+    halrun -f $1 > result.samples
+    retval=$?
+
+    kill -TERM $standin
+    wait $standin
+    cat result.samples standin.log
+    rm -f standin.ready standin.log result.samples
+    return $retval
+}
+
+run_standin test.hal || exit 1
+echo lost reply
+run_standin lost.hal 20
@@ -0,0 +1,28 @@
+#!/bin/bash
+# Runs test.hal on the hm2_test model with the registers of a module
+# 0x100 apart and 8 apart, then counts the llio traffic of a second of
+# servo periods in each run, see README.
+
+traffic() {
+    for p in ticks reads read-bytes writes write-bytes; do
+        echo -n " $(halcmd getp hm2_test.0.model.$p)"
+    done
+}
+
+run() {
+    export SIM_REGISTER_STRIDE=$1
+    echo "stride $1"
+    realtime start
+    halcmd -f test.hal || { realtime stop; exit 1; }
+    echo "bursts $(halcmd getp hm2_test.0.tram.read_bursts) $(halcmd getp hm2_test.0.tram.write_bursts)"
+    before=$(traffic)
+    halcmd start
+    sleep 1
+    halcmd stop
+    echo "traffic$before$(traffic)"
+    realtime stop
+}
+
+run 256
+run 8
+exit 0
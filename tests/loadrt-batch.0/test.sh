@@ -0,0 +1,20 @@
+#!/bin/bash
+# Loads batch.hal one command at a time, then several times with -B,
+# where the loadrt lines reach rtapi_app as one batch and are preloaded
+# in parallel.  The preload order varies from run to run; every run
+# must leave the same HAL behind.
+
+run() {
+    realtime start
+    halcmd $1 -f batch.hal || { realtime stop; exit 1; }
+    halcmd save all > $2.hal
+    halcmd show funct >> $2.hal
+    realtime stop
+}
+
+run "" plain
+for i in 1 2 3 4 5; do
+    run -B batched
+    diff -u plain.hal batched.hal >&2 || exit 1
+done
+exit 0
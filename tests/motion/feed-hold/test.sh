@@ -0,0 +1,61 @@
+#!/bin/bash
+
+rm -f sim.var result.halsamples
+
+linuxcnc -r motion-test.ini &
+
+# Post EL6, netcat nc is replaced by nmap, which has no -z equivalent arg
+if test -x /usr/bin/tcping; then
+    TCPING=tcping
+else
+    TCPING="nc -z"
+fi
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO
+    if $TCPING localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+(
+    echo hello EMC mt 1.0
+    echo set enable EMCTOO
+
+    echo set mode manual
+    echo set estop off
+    echo set machine on
+
+    echo set mode mdi
+    # enable the feed hold input
+    echo set mdi m53 p1
+    echo set wait done
+
+    # exact stop, so the line gets the full acceleration
+    halcmd setp sampler.0.enable 1
+    echo set mdi g61 g1 x30 f120
+
+    # cruising at 2 in/s by now
+    sleep 1.0
+    halcmd sets hold 1
+    sleep 0.6
+    halcmd setp sampler.0.enable 0
+
+    # at least 1600 samples are waiting
+    halsampler -t -n 1400 >| result.halsamples
+
+    echo shutdown
+) | nc localhost 5007
+
+# wait for linuxcnc to finish
+wait
+
+exit 0
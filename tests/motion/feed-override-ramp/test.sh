@@ -0,0 +1,60 @@
+#!/bin/bash
+
+rm -f sim.var result.halsamples
+
+linuxcnc -r motion-test.ini &
+
+# Post EL6, netcat nc is replaced by nmap, which has no -z equivalent arg
+if test -x /usr/bin/tcping; then
+    TCPING=tcping
+else
+    TCPING="nc -z"
+fi
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO
+    if $TCPING localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+(
+    echo hello EMC mt 1.0
+    echo set enable EMCTOO
+
+    echo set mode manual
+    echo set estop off
+    echo set machine on
+
+    echo set mode mdi
+    echo set feed_override 100
+    echo set wait done
+
+    # exact stop, the line cruises at F60 until the override changes
+    halcmd setp sampler.0.enable 1
+    echo set mdi g61 g1 x30 f60
+
+    # cruising at 1 in/s by now
+    sleep 1.0
+    echo set feed_override 200
+    sleep 0.5
+    halcmd setp sampler.0.enable 0
+
+    # at least 1500 samples are waiting
+    halsampler -t -n 1400 >| result.halsamples
+
+    echo shutdown
+) | nc localhost 5007
+
+# wait for linuxcnc to finish
+wait
+
+exit 0
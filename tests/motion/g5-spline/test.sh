@@ -0,0 +1,61 @@
+#!/bin/bash
+
+rm -f sim.var result.halsamples
+
+linuxcnc -r motion-test.ini &
+
+# Post EL6, netcat nc is replaced by nmap, which has no -z equivalent arg
+if test -x /usr/bin/tcping; then
+    TCPING=tcping
+else
+    TCPING="nc -z"
+fi
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO
+    if $TCPING localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+(
+    echo hello EMC mt 1.0
+    echo set enable EMCTOO
+
+    echo set mode manual
+    echo set estop off
+    echo set machine on
+
+    echo set mode mdi
+
+    halsampler -t >| result.halsamples &
+    SAMPLER=$!
+    halcmd setp sampler.0.enable 1
+
+    # exact stop, so the splines are not blended into each other
+    echo set mdi g61 g5 x4 y0 i1 j2 p-1 q2 f240
+    echo set wait done
+    echo set mdi g5.1 x8 y0 i2 j-2
+    echo set wait done
+
+    # about 11 inches of path at 4 in/s
+    sleep 4.0
+    halcmd setp sampler.0.enable 0
+    sleep 0.1
+    kill $SAMPLER
+
+    echo shutdown
+) | nc localhost 5007
+
+# wait for linuxcnc to finish
+wait
+
+exit 0
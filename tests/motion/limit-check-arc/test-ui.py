@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+# Runs bulge.ngc and expects the queued limit check to refuse the arc
+# on line 4 before the machine gets to it.
+
+import linuxcnc
+import sys
+import time
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+def fail(msg):
+    print(msg)
+    c.state(linuxcnc.STATE_ESTOP)
+    c.wait_complete()
+    sys.exit(1)
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.wait_complete()
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+c.mode(linuxcnc.MODE_AUTO)
+c.wait_complete()
+c.program_open("bulge.ngc")
+c.auto(linuxcnc.AUTO_RUN, 0)
+
+error = None
+start = time.time()
+while error is None and time.time() - start < 10:
+    msg = e.poll()
+    if msg:
+        error = msg[1]
+    time.sleep(0.05)
+if error is None:
+    fail("no error for the arc on line 4")
+print(error)
+if "Circular move on line 4" not in error or "joint 1's positive" not in error:
+    fail("wrong error")
+
+# the check runs well ahead, so motion stops on the lead-in to X-3
+time.sleep(0.5)
+s.poll()
+print("stopped at X=%f Y=%f" % (s.position[0], s.position[1]))
+if not -3 + 1e-6 < s.position[0] <= 0 or s.position[1] != 0:
+    fail("motion did not stop on line 2")
+
+c.state(linuxcnc.STATE_ESTOP)
+c.wait_complete()
+sys.exit(0)
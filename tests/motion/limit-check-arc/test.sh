@@ -0,0 +1,6 @@
+#!/bin/bash
+
+rm -f sim.var
+
+linuxcnc -r motion-test.ini
+exit $?
@@ -0,0 +1,219 @@
+/* Copyright (C) 2014 Michael Haberler <license AT mah DOT priv DOT at>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// stress test and timing benchmark for the rtapi_heap allocator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtapi.h"
+#include "rtapi_heap.h"
+#include "rtapi_heap_private.h"
+
+#define ARENA_SIZE   (4 * 1024 * 1024)
+#define NSLOTS       4096
+#define NOPS         2000000
+#define MAXSIZE      8192
+
+struct slot {
+    unsigned char *p;
+    size_t size;
+    unsigned char pattern;
+};
+
+static struct slot slots[NSLOTS];
+static int failed;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct timing {
+    const char *name;
+    long long total, max;
+    unsigned long n;
+};
+
+static void account(struct timing *t, long long dt)
+{
+    t->total += dt;
+    t->n++;
+    if (dt > t->max)
+	t->max = dt;
+}
+
+static size_t random_size(void)
+{
+    // mostly small message-sized buffers, some large ones
+    if ((rand() % 16) == 0)
+	return 1 + rand() % MAXSIZE;
+    return 1 + rand() % 256;
+}
+
+static void fill(struct slot *s)
+{
+    s->pattern = rand() & 0xff;
+    memset(s->p, s->pattern, s->size);
+}
+
+static void verify(struct slot *s)
+{
+    size_t i;
+    for (i = 0; i < s->size; i++) {
+	if (s->p[i] != s->pattern) {
+	    printf("FAIL: corrupted block %p at %zu\n", s->p, i);
+	    failed++;
+	    return;
+	}
+    }
+}
+
+// walk all arena blocks in physical order and cross-check
+// flags, links and statistics
+static void check_heap(struct rtapi_heap *h, size_t first)
+{
+    size_t b = first, prev = 0, free_bytes = 0, used_bytes = 0;
+    int prev_free = 0;
+    struct rtapi_heap_stat hs;
+
+    for (;;) {
+	rtapi_malloc_hdr_t *hdr = heap_ptr(h, b);
+	size_t size = hdr->s.size & ~((size_t)RTAPI_HEAP_FLAGS);
+	int is_free = (hdr->s.size & RTAPI_HEAP_BLOCK_FREE) != 0;
+
+	if (((hdr->s.size & RTAPI_HEAP_PREV_FREE) != 0) != prev_free) {
+	    printf("FAIL: prev_free flag mismatch at %zu\n", b);
+	    failed++;
+	}
+	if (prev_free && hdr->s.prev_phys != prev) {
+	    printf("FAIL: prev_phys mismatch at %zu\n", b);
+	    failed++;
+	}
+	if (size == 0)  // sentinel
+	    break;
+	if (is_free && prev_free) {
+	    printf("FAIL: adjacent free blocks at %zu\n", b);
+	    failed++;
+	}
+	if (is_free)
+	    free_bytes += size;
+	else
+	    used_bytes += size;
+	prev = b;
+	prev_free = is_free;
+	b += RTAPI_HEAP_HDR_SIZE + size;
+    }
+    rtapi_heap_status(h, &hs);
+    if (hs.total_avail != free_bytes) {
+	printf("FAIL: free list total %zu != arena free %zu\n",
+	       hs.total_avail, free_bytes);
+	failed++;
+    }
+    if (hs.in_use != used_bytes) {
+	printf("FAIL: in_use %zu != arena used %zu\n", hs.in_use, used_bytes);
+	failed++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct rtapi_heap *h = malloc(sizeof(struct rtapi_heap) + ARENA_SIZE);
+    unsigned char *arena = (unsigned char *)(h + 1);
+    struct timing tm = { "malloc", 0, 0, 0 };
+    struct timing tf = { "free", 0, 0, 0 };
+    struct rtapi_heap_stat hs;
+    long long t;
+    int i;
+
+    srand(4711);
+    rtapi_heap_init(h);
+    if (rtapi_heap_addmem(h, arena, ARENA_SIZE)) {
+	printf("FAIL: rtapi_heap_addmem\n");
+	return 1;
+    }
+    size_t first = ((heap_off(h, arena) + RTAPI_HEAP_ALIGN - 1) &
+		    ~((size_t)RTAPI_HEAP_ALIGN - 1));
+
+    for (i = 0; i < NOPS; i++) {
+	struct slot *s = &slots[rand() % NSLOTS];
+
+	if (s->p) {
+	    verify(s);
+	    if ((rand() % 8) == 0) {
+		size_t nsize = random_size();
+		void *np = rtapi_realloc(h, s->p, nsize);
+		if (np) {
+		    s->p = np;
+		    s->size = nsize;
+		    fill(s);
+		}
+		continue;
+	    }
+	    t = now_ns();
+	    rtapi_free(h, s->p);
+	    account(&tf, now_ns() - t);
+	    s->p = NULL;
+	} else {
+	    s->size = random_size();
+	    t = now_ns();
+	    s->p = rtapi_malloc(h, s->size);
+	    account(&tm, now_ns() - t);
+	    if (s->p) {
+		if (rtapi_allocsize(s->p) < s->size) {
+		    printf("FAIL: allocsize %zu < %zu\n",
+			   rtapi_allocsize(s->p), s->size);
+		    failed++;
+		}
+		fill(s);
+	    }
+	}
+	if ((i % (NOPS / 20)) == 0)
+	    check_heap(h, first);
+	if (failed)
+	    break;
+    }
+    check_heap(h, first);
+    rtapi_heap_status(h, &hs);
+    printf("heap: arena=%zu in_use=%zu max=%zu free=%zu fragments=%zu "
+	   "largest=%zu allocs=%lu frees=%lu failures=%lu\n",
+	   hs.arena_size, hs.in_use, hs.in_use_max, hs.total_avail,
+	   hs.fragments, hs.largest, hs.allocs, hs.frees, hs.failures);
+
+    for (i = 0; i < NSLOTS; i++)
+	if (slots[i].p) {
+	    verify(&slots[i]);
+	    rtapi_free(h, slots[i].p);
+	}
+    check_heap(h, first);
+    rtapi_heap_status(h, &hs);
+    if ((hs.fragments != 1) || hs.in_use) {
+	printf("FAIL: heap not fully coalesced: fragments=%zu in_use=%zu\n",
+	       hs.fragments, hs.in_use);
+	failed++;
+    }
+
+    printf("%s: n=%lu avg=%lldns max=%lldns\n", tm.name, tm.n,
+	   tm.n ? tm.total / (long long)tm.n : 0, tm.max);
+    printf("%s: n=%lu avg=%lldns max=%lldns\n", tf.name, tf.n,
+	   tf.n ? tf.total / (long long)tf.n : 0, tf.max);
+    free(h);
+    return failed ? 1 : 0;
+}
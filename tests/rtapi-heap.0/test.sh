@@ -0,0 +1,8 @@
+#!/bin/sh
+rm -f heap_stress
+gcc -g -O2 -DULAPI \
+    -I../../include \
+    heap_stress.c ../../src/rtapi/rtapi_heap.c \
+    -o heap_stress || exit 1
+
+./heap_stress
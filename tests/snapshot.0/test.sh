@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+rm -f snapshot.bin
+halrun -f setup.hal
+halrun -f restore.hal
+rm -f snapshot.bin
@@ -0,0 +1,252 @@
+// benchmark and equivalence check of the structure-of-arrays stepgen
+// kernel against the per-channel make_pulses() loop it replaced, for
+// 8 and 16 step/dir channels
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtapi.h"
+#include "hal.h"
+#include "stepgen_core.h"
+
+#define PICKOFF   STEPGEN_PICKOFF
+#define STEP_PIN  0
+#define DIR_PIN   1
+#define PERIOD    25000     // base thread period, ns
+#define SLOW      40        // update_freq runs every SLOW periods
+#define NPERIODS  2000000
+
+// the per-channel layout and loop of make_pulses() before the split,
+// step/dir output only
+typedef struct {
+    unsigned int timer1;
+    unsigned int timer2;
+    unsigned int timer3;
+    int hold_dds;
+    long addval;
+    volatile long long accum;
+    hal_s32_t rawcount;
+    int curr_dir;
+    int state;
+    hal_bit_t *enable;
+    long target_addval;
+    long deltalim;
+    hal_u32_t step_len;
+    hal_u32_t dir_hold_dly;
+    hal_u32_t dir_setup;
+    int step_type;
+    int cycle_max;
+    int num_phases;
+    hal_bit_t *phase[5];
+    const unsigned char *lut;
+} ref_t;
+
+static void ref_make_pulses(ref_t *stepgen, int num_chan, long periodns)
+{
+    long old_addval, target_addval, new_addval, step_now;
+    int n;
+
+    for (n = 0; n < num_chan; n++) {
+	if ( stepgen->timer1 > 0 ) {
+	    if ( stepgen->timer1 > periodns ) {
+		stepgen->timer1 -= periodns;
+	    } else {
+		stepgen->timer1 = 0;
+	    }
+	}
+	if ( stepgen->timer2 > 0 ) {
+	    if ( stepgen->timer2 > periodns ) {
+		stepgen->timer2 -= periodns;
+	    } else {
+		stepgen->timer2 = 0;
+	    }
+	}
+	if ( stepgen->timer3 > 0 ) {
+	    if ( stepgen->timer3 > periodns ) {
+		stepgen->timer3 -= periodns;
+	    } else {
+		stepgen->timer3 = 0;
+		stepgen->hold_dds = 0;
+	    }
+	}
+	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
+	    old_addval = stepgen->addval;
+	    target_addval = stepgen->target_addval;
+	    if (stepgen->deltalim != 0) {
+		if (target_addval > (old_addval + stepgen->deltalim)) {
+		    new_addval = old_addval + stepgen->deltalim;
+		} else if (target_addval < (old_addval - stepgen->deltalim)) {
+		    new_addval = old_addval - stepgen->deltalim;
+		} else {
+		    new_addval = target_addval;
+		}
+	    } else {
+		new_addval = target_addval;
+	    }
+	    stepgen->addval = new_addval;
+	    if (((new_addval >= 0) && (old_addval < 0)) ||
+		((new_addval < 0) && (old_addval >= 0))) {
+		if ( stepgen->timer3 != 0 ) {
+		    stepgen->hold_dds = 1;
+		}
+	    }
+	}
+	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
+	    step_now = stepgen->accum;
+	    stepgen->accum += stepgen->addval;
+	    step_now ^= stepgen->accum;
+	    step_now &= (1L << PICKOFF);
+	    stepgen->rawcount = stepgen->accum >> PICKOFF;
+	} else {
+	    step_now = 0;
+	}
+	if ( stepgen->timer2 == 0 ) {
+	    if ( stepgen->addval > 0 ) {
+		stepgen->curr_dir = 1;
+	    } else if ( stepgen->addval < 0 ) {
+		stepgen->curr_dir = -1;
+	    }
+	}
+	if ( step_now ) {
+	    stepgen->timer1 = stepgen->step_len;
+	    stepgen->timer2 = stepgen->timer1 + stepgen->dir_hold_dly;
+	    stepgen->timer3 = stepgen->timer2 + stepgen->dir_setup;
+	}
+	if (stepgen->step_type == 0) {
+	    if ( stepgen->timer1 != 0 ) {
+		 *(stepgen->phase[STEP_PIN]) = 1;
+	    } else {
+		 *(stepgen->phase[STEP_PIN]) = 0;
+	    }
+	    if ( stepgen->curr_dir < 0 ) {
+		 *(stepgen->phase[DIR_PIN]) = 1;
+	    } else {
+		 *(stepgen->phase[DIR_PIN]) = 0;
+	    }
+	}
+	stepgen++;
+    }
+}
+
+static ref_t ref[STEPGEN_MAX_CHAN];
+static stepgen_core_t core;
+static hal_bit_t enable[STEPGEN_MAX_CHAN];
+static hal_bit_t ref_pins[STEPGEN_MAX_CHAN][2], core_pins[STEPGEN_MAX_CHAN][2];
+static int failed;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void setup(int nchan)
+{
+    int n;
+
+    memset(ref, 0, sizeof(ref));
+    memset(&core, 0, sizeof(core));
+    core.num_chan = nchan;
+    for (n = 0; n < nchan; n++) {
+	enable[n] = 1;
+	ref[n].enable = &enable[n];
+	ref[n].phase[STEP_PIN] = &ref_pins[n][0];
+	ref[n].phase[DIR_PIN] = &ref_pins[n][1];
+	ref[n].accum = 1 << (PICKOFF - 1);
+	ref[n].step_len = ref[n].dir_hold_dly = ref[n].dir_setup = PERIOD * (1 + n % 3);
+	core.enable[n] = &enable[n];
+	core.step[n] = &core_pins[n][0];
+	core.dir[n] = &core_pins[n][1];
+	core.sd[core.num_sd++] = n;
+	core.accum[n] = 1 << (PICKOFF - 1);
+	core.step_len[n] = core.dir_hold_dly[n] = core.dir_setup[n] = ref[n].step_len;
+    }
+}
+
+// what update_freq would feed in: random frequencies, both directions,
+// with and without accel limit, and the odd disable
+static void command(int nchan, unsigned seed)
+{
+    int n;
+
+    srand(seed);
+    for (n = 0; n < nchan; n++) {
+	long target = (long)(rand() % 20001 - 10000) * 1000;
+	long lim = (rand() % 4) ? rand() % 5000 : 0;
+	core.target_addval[n] = ref[n].target_addval = target;
+	core.deltalim[n] = ref[n].deltalim = lim;
+	enable[n] = (rand() % 50) != 0;
+	if (!enable[n]) {
+	    core.addval[n] = ref[n].addval = 0;
+	    core.target_addval[n] = ref[n].target_addval = 0;
+	}
+    }
+}
+
+static void compare(int nchan, long i)
+{
+    int n;
+
+    for (n = 0; n < nchan; n++) {
+	if ((ref_pins[n][0] != core_pins[n][0]) ||
+	    (ref_pins[n][1] != core_pins[n][1]) ||
+	    (ref[n].accum != core.accum[n]) ||
+	    (ref[n].rawcount != core.rawcount[n]) ||
+	    (ref[n].timer3 != core.timer3[n]) ||
+	    (ref[n].hold_dds != core.hold_dds[n])) {
+	    printf("FAIL: channel %d differs at period %ld\n", n, i);
+	    failed++;
+	    return;
+	}
+    }
+}
+
+static void run(int nchan)
+{
+    long long t, tref, tcore;
+    long i;
+
+    // equivalence, in lockstep
+    setup(nchan);
+    for (i = 0; i < NPERIODS && !failed; i++) {
+	if ((i % SLOW) == 0)
+	    command(nchan, i);
+	ref_make_pulses(ref, nchan, PERIOD);
+	stepgen_core_update(&core, PERIOD);
+	stepgen_core_stepdir(&core);
+	compare(nchan, i);
+    }
+    // timing, each on its own
+    setup(nchan);
+    tref = 0;
+    for (i = 0; i < NPERIODS; i++) {
+	if ((i % SLOW) == 0)
+	    command(nchan, i);
+	t = now_ns();
+	ref_make_pulses(ref, nchan, PERIOD);
+	tref += now_ns() - t;
+    }
+    setup(nchan);
+    tcore = 0;
+    for (i = 0; i < NPERIODS; i++) {
+	if ((i % SLOW) == 0)
+	    command(nchan, i);
+	t = now_ns();
+	stepgen_core_update(&core, PERIOD);
+	stepgen_core_stepdir(&core);
+	tcore += now_ns() - t;
+    }
+    printf("%d channels: per-channel avg=%lldns soa avg=%lldns\n", nchan,
+	   tref / NPERIODS, tcore / NPERIODS);
+}
+
+int main(int argc, char **argv)
+{
+    run(8);
+    run(16);
+    if (!failed)
+	printf("outputs identical\n");
+    return failed ? 1 : 0;
+}
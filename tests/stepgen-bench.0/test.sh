@@ -0,0 +1,8 @@
+#!/bin/sh
+rm -f stepgen_bench
+gcc -g -O2 -DULAPI \
+    -I../../include -I../../src/hal/components \
+    stepgen_bench.c \
+    -o stepgen_bench || exit 1
+
+./stepgen_bench
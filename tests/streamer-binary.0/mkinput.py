@@ -0,0 +1,24 @@
+#!/usr/bin/env python
+# write the test inputs: raw packed 'ufb' values, and the same values
+# as a halsampler capture with header and sample numbers
+import struct
+
+HAL_BIT, HAL_FLOAT, HAL_U32 = 1, 2, 4
+MAX_PINS = 20
+HAL_NAME_LEN = 47
+N = 1000
+
+rec = '=IdB'
+raw = open('raw.bin', 'wb')
+cap = open('capture.bin', 'wb')
+types = [HAL_U32, HAL_FLOAT, HAL_BIT]
+hdr = struct.pack('=8sIIII', b'HALSAMP', 1,
+                  24 + 4 * MAX_PINS + (HAL_NAME_LEN + 1) * MAX_PINS,
+                  4 + struct.calcsize(rec), len(types))
+hdr += struct.pack('=%dI' % MAX_PINS, *(types + [0] * (MAX_PINS - len(types))))
+hdr += b'\0' * ((HAL_NAME_LEN + 1) * MAX_PINS)
+cap.write(hdr)
+for i in range(1, N + 1):
+    v = struct.pack(rec, i, i * 0.5, i & 1)
+    raw.write(v)
+    cap.write(struct.pack('=I', i - 1) + v)
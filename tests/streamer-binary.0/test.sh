@@ -0,0 +1,5 @@
+#!/bin/sh
+set -e
+rm -f raw.bin capture.bin out0.bin out1.bin
+python mkinput.py
+halrun -f stream.hal
@@ -0,0 +1,15 @@
+#!/usr/bin/env python
+# writes a 2 x 2 x 2 volcomp grid, see src/emc/motion/volcomp.h:
+# origin 0 0 0, step 2, and at node (i, j, k) the correction
+# dx = 0.1 + 0.05 * i, dy = -0.2, dz = 0.02 * k
+import struct
+import sys
+
+f = open(sys.argv[1], 'wb')
+f.write(struct.pack('=8sIIII6d', b'VOLCOMP', 1, 2, 2, 2,
+                    0.0, 0.0, 0.0, 2.0, 2.0, 2.0))
+for k in range(2):
+    for j in range(2):
+        for i in range(2):
+            f.write(struct.pack('=3f', 0.1 + 0.05 * i, -0.2, 0.02 * k))
+f.close()
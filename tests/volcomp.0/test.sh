@@ -0,0 +1,79 @@
+#!/bin/bash
+
+rm -f grid.vc sim.var
+python make_grid.py grid.vc || exit 1
+
+linuxcnc -r volcomp.ini &
+
+# Post EL6, netcat nc is replaced by nmap, which has no -z equivalent arg
+if test -x /usr/bin/tcping; then
+    TCPING=tcping
+else
+    TCPING="nc -z"
+fi
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO 1>&2
+    if $TCPING localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+# the machine is off, motion releases the grid right away
+volcomp grid.vc 1>&2 && echo "load while off: ok" || echo "load while off: refused"
+
+(
+    echo hello EMC mt 1.0
+    echo set enable EMCTOO
+
+    echo set mode manual
+    echo set estop off
+    echo set machine on
+
+    echo set mode mdi
+    echo set mdi g0 x1 y1 z1
+    echo set wait done
+
+    # wait for the move: joint 0 most of the way to x1 and motion in
+    # position again
+    TOGO=200
+    while [ $TOGO -gt 0 ]; do
+        if [ "$(halcmd getp motion.in-position)" = TRUE ] &&
+           halcmd getp axis.0.joint-pos-cmd | awk '{ exit !($1 > 0.5) }'; then
+            break
+        fi
+        sleep 0.05
+        TOGO=$(($TOGO - 1))
+    done
+    if [ $TOGO -eq 0 ]; then
+        echo "move to x1 y1 z1 timed out" >> joints
+    fi
+
+    for j in 0 1 2; do
+        echo "joint $j $(halcmd getp axis.$j.motor-pos-cmd)" >> joints
+    done
+
+    # the grid is in use now, a load must not get through
+    if volcomp -t 0.2 grid.vc 1>&2; then
+        echo "load while on: ok" >> joints
+    else
+        echo "load while on: refused" >> joints
+    fi
+
+    echo shutdown
+) | nc localhost 5007 > /dev/null
+
+# wait for linuxcnc to finish
+wait
+
+cat joints
+rm -f joints grid.vc
+exit 0